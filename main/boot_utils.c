@@ -0,0 +1,62 @@
+/*******************************************************************************
+ * @file        boot_utils.c
+ * @brief       Marcas de tiempo de los hitos del arranque, desde el inicio de
+ *              la aplicación hasta la primera telemetría publicada.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "boot_utils.h"
+#include "esp_log.h"
+#include "hal.h"
+#include <stdio.h>
+
+static const char *TAG = "BOOT";
+
+static const char *const milestone_names[BOOT_MILESTONE_COUNT] = {
+    "app_start",
+    "net_ready",
+    "mqtt_connected",
+    "first_telemetry",
+};
+
+// Microsegundos desde el arranque de cada hito alcanzado
+static int64_t milestones[BOOT_MILESTONE_COUNT];
+static uint8_t reached_mask = 0;
+static bool fast_path_used = false;
+
+void boot_mark(boot_milestone_t milestone) {
+  if (milestone >= BOOT_MILESTONE_COUNT || boot_reached(milestone))
+    return;
+  milestones[milestone] = hal_time_us();
+  reached_mask |= 1u << milestone;
+  ESP_LOGI(TAG, "%s at %lld ms", milestone_names[milestone],
+           (long long)(milestones[milestone] / 1000));
+}
+
+bool boot_reached(boot_milestone_t milestone) {
+  return milestone < BOOT_MILESTONE_COUNT &&
+         (reached_mask & (1u << milestone)) != 0;
+}
+
+void boot_set_fast_path(bool fast_path) { fast_path_used = fast_path; }
+
+int boot_format_report(char *buf, size_t size) {
+  int len = snprintf(buf, size, "{\"fw_version\":\"%s\",\"boot_fast_path\":%s",
+                     FIRMWARE_VERSION, fast_path_used ? "true" : "false");
+  for (int i = 0; i < BOOT_MILESTONE_COUNT; i++) {
+    if (len < 0 || (size_t)len >= size)
+      return 0;
+    if (!boot_reached(i))
+      continue;
+    len += snprintf(buf + len, size - len, ",\"boot_%s_ms\":%lld",
+                    milestone_names[i], (long long)(milestones[i] / 1000));
+  }
+  if (len < 0 || (size_t)len + 1 >= size)
+    return 0;
+  buf[len++] = '}';
+  buf[len] = 0;
+  return len;
+}
@@ -0,0 +1,40 @@
+/*******************************************************************************
+ * @file        buzzer_pattern.c
+ * @brief       Secuenciador de patrones del buzzer a partir de tablas de pasos.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "buzzer_pattern.h"
+
+const buzzer_step_t *buzzer_player_start(buzzer_player_t *player,
+                                         const buzzer_pattern_t *pattern) {
+  player->pattern = pattern;
+  player->step = 0;
+  player->loops = 0;
+
+  if (pattern == NULL || pattern->count == 0) {
+    player->pattern = NULL;
+    return NULL;
+  }
+  return &pattern->steps[0];
+}
+
+const buzzer_step_t *buzzer_player_next(buzzer_player_t *player) {
+  const buzzer_pattern_t *pattern = player->pattern;
+
+  if (pattern == NULL)
+    return NULL;
+
+  if (++player->step >= pattern->count) {
+    player->step = 0;
+    // Las repeticiones infinitas no avanzan el contador
+    if (pattern->repeat != 0 && ++player->loops >= pattern->repeat) {
+      player->pattern = NULL;
+      return NULL;
+    }
+  }
+  return &pattern->steps[player->step];
+}
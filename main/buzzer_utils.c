@@ -8,44 +8,103 @@
  ******************************************************************************/
 
 #include "buzzer_utils.h"
-#include "driver/ledc.h"
 #include "esp_err.h"
+#include "buzzer_pattern.h"
 #include "esp_log.h"
+#include "hal.h"
+#include "log_utils.h"
+#include <stdatomic.h>
 
 static const char *TAG = "BUZZER";
 
-static bool buzzer_state = false;
+#define TONE(freq, ms) {(freq), BUZZER_PWM_DUTY, (ms)}
+#define REST(ms) {0, 0, (ms)}
+
+static const buzzer_step_t continuous_steps[] = {TONE(BUZZER_FREQUENCY, 0)};
+static const buzzer_step_t warning_steps[] = {
+    TONE(BUZZER_FREQUENCY, 200),
+    REST(1800),
+};
+static const buzzer_step_t alarm_steps[] = {
+    TONE(BUZZER_FREQUENCY, 100), REST(100), TONE(BUZZER_FREQUENCY, 100),
+    REST(100),                   TONE(BUZZER_FREQUENCY, 100), REST(600),
+};
+static const buzzer_step_t critical_steps[] = {
+    TONE(1500, 150), TONE(2000, 150), TONE(2500, 150),
+    TONE(3000, 150), REST(100),
+};
+
+#define PATTERN(steps) {(steps), sizeof(steps) / sizeof((steps)[0]), 0}
+
+// Un patrón vacío silencia el buzzer
+static const buzzer_pattern_t patterns[BUZZER_PATTERN_COUNT] = {
+    [BUZZER_PATTERN_OFF] = {NULL, 0, 1},
+    [BUZZER_PATTERN_CONTINUOUS] = {continuous_steps, 1, 1},
+    [BUZZER_PATTERN_WARNING] = PATTERN(warning_steps),
+    [BUZZER_PATTERN_ALARM] = PATTERN(alarm_steps),
+    [BUZZER_PATTERN_CRITICAL] = PATTERN(critical_steps),
+};
+
+static buzzer_pattern_id_t current_pattern = BUZZER_PATTERN_OFF;
 static bool manual_mode = false;
 static float temp_threshold = TEMP_THRESHOLD;
-esp_err_t buzzer_init(void) {
-  esp_err_t ret;
 
-  // Configurar el timer LEDC
-  ledc_timer_config_t ledc_timer = {.speed_mode = BUZZER_LEDC_MODE,
-                                    .duty_resolution = BUZZER_LEDC_DUTY_RES,
-                                    .timer_num = BUZZER_LEDC_TIMER,
-                                    .freq_hz = BUZZER_FREQUENCY,
-                                    .clk_cfg = LEDC_AUTO_CLK};
+// Estado del secuenciador, solo lo toca el callback del temporizador
+static hal_timer_t buzzer_timer = NULL;
+static buzzer_player_t player;
+static uint32_t current_freq = BUZZER_FREQUENCY;
+// Patrón solicitado por la tarea de control, pendiente de tomar
+static _Atomic(const buzzer_pattern_t *) requested_pattern = NULL;
 
-  ret = ledc_timer_config(&ledc_timer);
-  if (ret != ESP_OK) {
-    ESP_LOGE(TAG, "Failed to configure LEDC timer: %s", esp_err_to_name(ret));
-    return ret;
+static void buzzer_apply_step(const buzzer_step_t *step) {
+  if (step == NULL) {
+    hal_pwm_set_duty(BUZZER_PWM_CHANNEL, 0);
+    return;
+  }
+
+  // Reprogramar el timer LEDC solo si el tono cambia
+  if (step->duty != 0 && step->freq_hz != current_freq &&
+      hal_pwm_set_freq(BUZZER_PWM_CHANNEL, step->freq_hz) == ESP_OK) {
+    current_freq = step->freq_hz;
   }
+  hal_pwm_set_duty(BUZZER_PWM_CHANNEL, step->duty);
 
-  ledc_channel_config_t ledc_channel = {.gpio_num = BUZZER_GPIO,
-                                        .speed_mode = BUZZER_LEDC_MODE,
-                                        .channel = BUZZER_LEDC_CHANNEL,
-                                        .intr_type = LEDC_INTR_DISABLE,
-                                        .timer_sel = BUZZER_LEDC_TIMER,
-                                        .duty = 0, // Iniciar con buzzer apagado
-                                        .hpoint = 0};
+  if (step->duration_ms != 0) {
+    hal_timer_start_once(buzzer_timer, (uint64_t)step->duration_ms * 1000);
+  }
+}
 
-  ret = ledc_channel_config(&ledc_channel);
+static void buzzer_timer_cb(void *arg) {
+  const buzzer_pattern_t *requested =
+      atomic_exchange(&requested_pattern, NULL);
+
+  if (requested != NULL) {
+    buzzer_apply_step(buzzer_player_start(&player, requested));
+  } else {
+    buzzer_apply_step(buzzer_player_next(&player));
+  }
+}
+
+esp_err_t buzzer_init(void) {
+  esp_err_t ret;
+
+  // Configurar el canal PWM, iniciando con el buzzer apagado
+  ret = hal_pwm_init(BUZZER_PWM_CHANNEL, BUZZER_GPIO, BUZZER_FREQUENCY,
+                     BUZZER_PWM_DUTY_RES);
   if (ret != ESP_OK) {
-    ESP_LOGE(TAG, "Failed to configure LEDC channel: %s", esp_err_to_name(ret));
+    ESP_LOGE(TAG, "Failed to configure PWM: %s", esp_err_to_name(ret));
     return ret;
   }
+  current_freq = BUZZER_FREQUENCY;
+
+  if (buzzer_timer == NULL) {
+    ret = hal_timer_create(buzzer_timer_cb, NULL, &buzzer_timer);
+    if (ret != ESP_OK) {
+      ESP_LOGE(TAG, "Failed to create pattern timer: %s",
+               esp_err_to_name(ret));
+      return ret;
+    }
+  }
 
   ESP_LOGI(TAG, "Buzzer initialized on GPIO%d at %dHz", BUZZER_GPIO,
            BUZZER_FREQUENCY);
@@ -54,59 +113,64 @@ esp_err_t buzzer_init(void) {
   return ESP_OK;
 }
 
+void buzzer_play(buzzer_pattern_id_t pattern) {
+  if (pattern >= BUZZER_PATTERN_COUNT || buzzer_timer == NULL)
+    return;
+  current_pattern = pattern;
+  atomic_store(&requested_pattern, &patterns[pattern]);
+
+  // Disparar el temporizador ya; si el callback lo rearmó entre la parada y
+  // el arranque, volver a intentarlo para no esperar al fin del paso actual
+  for (int attempt = 0; attempt < 3; attempt++) {
+    hal_timer_stop(buzzer_timer);
+    if (hal_timer_start_once(buzzer_timer, 0) == ESP_OK)
+      break;
+  }
+}
+
+buzzer_pattern_id_t buzzer_get_pattern(void) { return current_pattern; }
+
 void buzzer_set(bool state, bool manual) {
   if (manual) {
     manual_mode = true;
-    ESP_LOGI(TAG, "Manual mode activated");
+    DLOGI(TAG, "Manual mode activated");
   }
 
-  buzzer_state = state;
-
-  // Establecer ciclo de trabajo
-  uint32_t duty = state ? BUZZER_LEDC_DUTY : 0;
+  buzzer_play(state ? BUZZER_PATTERN_CONTINUOUS : BUZZER_PATTERN_OFF);
 
-  ledc_set_duty(BUZZER_LEDC_MODE, BUZZER_LEDC_CHANNEL, duty);
-  ledc_update_duty(BUZZER_LEDC_MODE, BUZZER_LEDC_CHANNEL);
-
-  ESP_LOGI(TAG, "Buzzer %s %s", state ? "ON" : "OFF",
-           manual ? "(manual)" : "(auto)");
+  DLOGI(TAG, "Buzzer %s %s", state ? "ON" : "OFF",
+        manual ? "(manual)" : "(auto)");
 }
 
-void buzzer_update_by_temperature(float temperature) {
+// Reproducir el patrón pedido por las reglas, salvo en modo manual
+void buzzer_update_auto(buzzer_pattern_id_t pattern) {
   // No actualizar si está en modo manual
   if (manual_mode) {
     return;
   }
 
-  bool should_activate = temperature > temp_threshold;
-
-  // Solo cambiar estado si es diferente
-  if (should_activate != buzzer_state) {
-    buzzer_set(should_activate, false);
+  // Solo cambiar si la severidad es diferente
+  if (pattern != current_pattern) {
+    buzzer_play(pattern);
 
-    if (should_activate) {
-      ESP_LOGW(TAG,
-               "Temperature %.1f°C exceeds threshold %.1f°C - Buzzer activated",
-               temperature, temp_threshold);
+    if (pattern != BUZZER_PATTERN_OFF) {
+      DLOGW(TAG, "Alarm rule active - Buzzer pattern %d", pattern);
     } else {
-      ESP_LOGI(TAG,
-               "Temperature %.1f°C below threshold %.1f°C - Buzzer deactivated",
-               temperature, temp_threshold);
+      DLOGI(TAG, "No alarm rule active - Buzzer deactivated");
     }
   }
 }
 
-bool buzzer_get_state(void) { return buzzer_state; }
-
+bool buzzer_get_state(void) { return current_pattern != BUZZER_PATTERN_OFF; }
 bool buzzer_is_manual_mode(void) { return manual_mode; }
 
 void buzzer_set_threshold(float threshold) {
   temp_threshold = threshold;
-  ESP_LOGI(TAG, "Temperature threshold updated to %.1f°C", threshold);
+  DLOGI(TAG, "Temperature threshold updated to %.1f°C", threshold);
 
   // Resetear modo manual al cambiar el umbral
   manual_mode = false;
-  ESP_LOGI(TAG, "Switched to automatic mode");
+  DLOGI(TAG, "Switched to automatic mode");
 }
 
 float buzzer_get_threshold(void) { return temp_threshold; }
\ No newline at end of file
@@ -0,0 +1,232 @@
+/*******************************************************************************
+ * @file        conn_utils.c
+ * @brief       Máquina de estados de conectividad con espera exponencial.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "conn_utils.h"
+#include "stats_utils.h"
+#include <stdio.h>
+
+static const char *const state_names[CONN_STATE_COUNT] = {
+    "wifi_connecting",
+    "ip_waiting",
+    "mqtt_connecting",
+    "online",
+    "backoff",
+};
+
+static const char *const reason_names[CONN_REASON_COUNT] = {
+    "none",
+    "no_ap",
+    "auth",
+    "assoc",
+    "beacon_loss",
+    "wifi_other",
+    "ip_timeout",
+    "ip_lost",
+    "weak_signal",
+    "mqtt_transport",
+    "mqtt_refused",
+};
+
+void conn_init(conn_t *conn, uint32_t seed) {
+  *conn = (conn_t){
+      .state = CONN_STATE_WIFI_CONNECTING,
+      .seed = seed ? seed : 1,
+  };
+}
+
+// xorshift32: suficiente para repartir los reintentos
+static uint32_t conn_random(conn_t *conn) {
+  uint32_t x = conn->seed;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  conn->seed = x;
+  return x;
+}
+
+// Programar el siguiente intento: la espera se duplica con cada fallo hasta
+// el máximo y se desplaza al azar dentro de CONN_BACKOFF_JITTER_PCT
+static void conn_backoff(conn_t *conn, int64_t now_ms) {
+  uint32_t delay = CONN_BACKOFF_BASE_MS;
+
+  for (uint8_t i = 0; i < conn->attempts && delay < CONN_BACKOFF_MAX_MS; i++)
+    delay *= 2;
+  conn->capped = delay >= CONN_BACKOFF_MAX_MS;
+  if (conn->capped)
+    delay = CONN_BACKOFF_MAX_MS;
+
+  uint32_t spread = delay / 100 * CONN_BACKOFF_JITTER_PCT;
+  if (spread > 0)
+    delay = delay - spread + conn_random(conn) % (2 * spread + 1);
+
+  if (conn->attempts < UINT8_MAX)
+    conn->attempts++;
+  conn->backoff_ms = delay;
+  conn->deadline_ms = now_ms + delay;
+  conn->state = CONN_STATE_BACKOFF;
+}
+
+static void conn_fail(conn_t *conn, conn_reason_t reason, int64_t now_ms) {
+  conn->reasons[reason]++;
+  // Tras un rato estable, la caída empieza de nuevo desde la espera mínima
+  if (conn->state == CONN_STATE_ONLINE &&
+      now_ms - conn->online_ms >= CONN_STABLE_MS)
+    conn->attempts = 0;
+  conn_backoff(conn, now_ms);
+}
+
+static void conn_wait_ip(conn_t *conn, int64_t now_ms) {
+  conn->state = CONN_STATE_IP_WAITING;
+  conn->deadline_ms = now_ms + CONN_IP_TIMEOUT_MS;
+}
+
+// Conectar al corredor, salvo que la señal sea tan débil que el intento
+// probablemente falle; con la espera al máximo se intenta de todos modos
+static conn_action_t conn_try_mqtt(conn_t *conn, int64_t now_ms) {
+  if (conn->rssi != 0 && conn->rssi < CONN_RSSI_MIN && !conn->capped) {
+    conn_fail(conn, CONN_REASON_WEAK_SIGNAL, now_ms);
+    return CONN_ACTION_NONE;
+  }
+  conn->state = CONN_STATE_MQTT_CONNECTING;
+  return CONN_ACTION_MQTT_CONNECT;
+}
+
+conn_action_t conn_event(conn_t *conn, conn_event_t event,
+                         conn_reason_t reason, int64_t now_ms) {
+  switch (event) {
+  case CONN_EVENT_WIFI_UP:
+    conn->wifi = true;
+    conn->ip = false;
+    conn_wait_ip(conn, now_ms);
+    break;
+
+  case CONN_EVENT_WIFI_DOWN:
+    // La desasociación que pidió el propio gestor ya está contada
+    if (!conn->wifi && conn->state == CONN_STATE_BACKOFF)
+      break;
+    if (conn->ip && !conn->link_lost) {
+      conn->link_lost = true;
+      conn->link_lost_ms = now_ms;
+    }
+    conn->wifi = false;
+    conn->ip = false;
+    conn_fail(conn, reason, now_ms);
+    break;
+
+  case CONN_EVENT_IP_UP:
+    // Con la red de vuelta, los fallos del corredor cuentan desde cero
+    conn->wifi = true;
+    conn->ip = true;
+    conn->attempts = 0;
+    if (conn->link_lost) {
+      conn->link_lost = false;
+      conn->outages++;
+      conn->last_recovery_ms = now_ms - conn->link_lost_ms;
+      STATS_RECORD(STATS_STAGE_NET_RECOVER,
+                   (int64_t)conn->last_recovery_ms * 1000);
+    }
+    return conn_try_mqtt(conn, now_ms);
+
+  case CONN_EVENT_IP_LOST:
+    conn->reasons[CONN_REASON_IP_LOST]++;
+    if (conn->ip && !conn->link_lost) {
+      conn->link_lost = true;
+      conn->link_lost_ms = now_ms;
+    }
+    conn->ip = false;
+    if (conn->wifi && conn->state != CONN_STATE_BACKOFF)
+      conn_wait_ip(conn, now_ms);
+    break;
+
+  case CONN_EVENT_MQTT_UP:
+    conn->state = CONN_STATE_ONLINE;
+    conn->online_ms = now_ms;
+    conn->capped = false;
+    conn->backoff_ms = 0;
+    break;
+
+  case CONN_EVENT_MQTT_DOWN:
+    // Sin IP la caída ya la atiende la etapa de red
+    if (conn->state != CONN_STATE_MQTT_CONNECTING &&
+        conn->state != CONN_STATE_ONLINE)
+      break;
+    conn_fail(conn, reason, now_ms);
+    break;
+  }
+  return CONN_ACTION_NONE;
+}
+
+conn_action_t conn_poll(conn_t *conn, int64_t now_ms) {
+  if (now_ms < conn->deadline_ms)
+    return CONN_ACTION_NONE;
+
+  switch (conn->state) {
+  case CONN_STATE_IP_WAITING:
+    conn->wifi = false;
+    conn_fail(conn, CONN_REASON_IP_TIMEOUT, now_ms);
+    return CONN_ACTION_WIFI_DISCONNECT;
+
+  case CONN_STATE_BACKOFF:
+    if (!conn->wifi) {
+      conn->state = CONN_STATE_WIFI_CONNECTING;
+      return CONN_ACTION_WIFI_CONNECT;
+    }
+    if (!conn->ip) {
+      conn_wait_ip(conn, now_ms);
+      return CONN_ACTION_NONE;
+    }
+    return conn_try_mqtt(conn, now_ms);
+
+  default:
+    return CONN_ACTION_NONE;
+  }
+}
+
+int64_t conn_wait_ms(const conn_t *conn, int64_t now_ms) {
+  if (conn->state != CONN_STATE_BACKOFF &&
+      conn->state != CONN_STATE_IP_WAITING)
+    return -1;
+  return conn->deadline_ms > now_ms ? conn->deadline_ms - now_ms : 0;
+}
+
+void conn_set_rssi(conn_t *conn, int8_t rssi) { conn->rssi = rssi; }
+
+const char *conn_state_name(conn_state_t state) {
+  return state < CONN_STATE_COUNT ? state_names[state] : "unknown";
+}
+
+const char *conn_reason_name(conn_reason_t reason) {
+  return reason < CONN_REASON_COUNT ? reason_names[reason] : "unknown";
+}
+
+int conn_format(const conn_t *conn, int64_t now_ms, char *buf, size_t size) {
+  size_t len = 0;
+  int n;
+
+#define APPEND(...)                                                            \
+  do {                                                                         \
+    n = snprintf(buf + len, size - len, __VA_ARGS__);                          \
+    if (n < 0 || (size_t)n >= size - len)                                      \
+      return 0;                                                                \
+    len += n;                                                                  \
+  } while (0)
+
+  APPEND("{\"state\":\"%s\",\"rssi\":%d,\"attempts\":%u,\"retry_ms\":%lld,"
+         "\"outages\":%lu,\"last_recovery_ms\":%lu,\"reasons\":{",
+         conn_state_name(conn->state), conn->rssi, conn->attempts,
+         (long long)conn_wait_ms(conn, now_ms), (unsigned long)conn->outages,
+         (unsigned long)conn->last_recovery_ms);
+  for (int i = CONN_REASON_NONE + 1; i < CONN_REASON_COUNT; i++) {
+    APPEND("\"%s\":%lu%s", reason_names[i], (unsigned long)conn->reasons[i],
+           i + 1 < CONN_REASON_COUNT ? "," : "}}");
+  }
+#undef APPEND
+
+  return len;
+}
@@ -0,0 +1,58 @@
+/*******************************************************************************
+ * @file        dht11_decode.c
+ * @brief       Decodificación de tramas DHT11 a partir de anchos de pulso.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "dht11_decode.h"
+#include <string.h>
+
+dht_decode_result_t dht_decode_pulses(const dht_pulse_t *pulses, size_t count,
+                                      uint8_t data[DHT_FRAME_BYTES]) {
+  memset(data, 0, DHT_FRAME_BYTES);
+
+  // Recorrer de atrás hacia adelante hasta encontrar los 40 pulsos HIGH
+  int bit = DHT_FRAME_BITS - 1;
+  for (size_t i = count; i > 0 && bit >= 0; i--) {
+    const dht_pulse_t *p = &pulses[i - 1];
+    if (!p->level || p->duration_us == 0 ||
+        p->duration_us > DHT_BIT_MAX_US)
+      continue;
+
+    if (p->duration_us > DHT_BIT_THRESHOLD_US) {
+      data[bit / 8] |= (1 << (7 - (bit % 8)));
+    }
+    bit--;
+  }
+
+  if (bit >= 0) {
+    return DHT_DECODE_ERR_SHORT;
+  }
+
+  // Verificar checksum
+  if (data[4] != ((data[0] + data[1] + data[2] + data[3]) & 0xFF)) {
+    return DHT_DECODE_ERR_CHECKSUM;
+  }
+
+  return DHT_DECODE_OK;
+}
+
+void dht_decode_values(dht_type_t type, const uint8_t data[DHT_FRAME_BYTES],
+                       float *humidity, float *temperature) {
+  if (type == DHT_TYPE_DHT22) {
+    *humidity = ((data[0] << 8) | data[1]) / 10.0f;
+    *temperature = (((data[2] & 0x7F) << 8) | data[3]) / 10.0f;
+    if (data[2] & 0x80)
+      *temperature = -*temperature;
+    return;
+  }
+
+  // DHT11: el bit alto del decimal de temperatura indica valor negativo
+  *humidity = data[0] + data[1] / 10.0f;
+  *temperature = data[2] + (data[3] & 0x7F) / 10.0f;
+  if (data[3] & 0x80)
+    *temperature = -*temperature;
+}
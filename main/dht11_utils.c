@@ -1,6 +1,6 @@
 /*******************************************************************************
  * @file        dht11_utils.c
- * @brief       Funciones para interactuar con el sensor DHT11.
+ * @brief       Funciones para interactuar con sensores DHT11 y DHT22.
  * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
  * @date        30/8/2025
  * @version     1.0.0
@@ -8,109 +8,229 @@
  ******************************************************************************/
 
 #include "dht11_utils.h"
+#include "dht11_decode.h"
 #include "driver/gpio.h"
+#include "driver/rmt_rx.h"
+#include "esp_attr.h"
 #include "esp_log.h"
-#include "esp_rom_gpio.h"
+#include "esp_rom_sys.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
 #include "freertos/task.h"
 #include <stdint.h>
 #include <stdio.h>
 
-const char *TAG = "DHT11_UTILS";
+static const char *TAG = "DHT11_UTILS";
+
+// Cada sensor tiene su canal RMT y su búfer, así se capturan en paralelo
+typedef struct {
+  uint8_t gpio;
+  dht_type_t type;
+  rmt_channel_handle_t channel;
+  rmt_symbol_word_t symbols[DHT_RMT_MEM_SYMBOLS];
+} dht_sensor_t;
+
+// Fin de captura de un canal, enviado desde la ISR del RMT
+typedef struct {
+  uint8_t index;
+  size_t num_symbols;
+} dht_rx_event_t;
+
+static dht_sensor_t dht_sensors[HAL_DHT_MAX_SENSORS];
+static size_t dht_count = 0;
+static QueueHandle_t dht_rx_queue = NULL;
+
+static const rmt_receive_config_t dht_receive_config = {
+    .signal_range_min_ns = DHT_RMT_MIN_PULSE_NS,
+    .signal_range_max_ns = DHT_RMT_IDLE_NS,
+};
+
+// Callback del RMT al terminar la captura, corre en contexto de ISR
+static bool IRAM_ATTR dht_rx_done(rmt_channel_handle_t channel,
+                                  const rmt_rx_done_event_data_t *edata,
+                                  void *user_data) {
+  BaseType_t task_woken = pdFALSE;
+  dht_rx_event_t event = {
+      .index = (uint8_t)(uintptr_t)user_data,
+      .num_symbols = edata->num_symbols,
+  };
+  xQueueSendFromISR(dht_rx_queue, &event, &task_woken);
+  return task_woken == pdTRUE;
+}
 
-// spinlock para secciones críticas
-static portMUX_TYPE dht_spinlock = portMUX_INITIALIZER_UNLOCKED;
+esp_err_t dht_init(void) {
+  if (dht_rx_queue != NULL)
+    return ESP_OK;
 
-int dht_await_pin_state(uint32_t timeout, int expected_state) {
-  for (uint32_t i = 0; i < timeout; i++) {
-    if (gpio_get_level(DHT_GPIO) == expected_state)
-      return 0;
-    esp_rom_delay_us(1);
+  dht_rx_queue = xQueueCreate(HAL_DHT_MAX_SENSORS, sizeof(dht_rx_event_t));
+  if (dht_rx_queue == NULL) {
+    ESP_LOGE(TAG, "Failed to create RMT queue");
+    return ESP_ERR_NO_MEM;
   }
-  return -1;
+  return ESP_OK;
 }
 
-int dht_read_data(float *humidity, float *temperature) {
-  uint8_t data[5] = {0};
-  int result = 0;
+int dht_add_sensor(uint8_t gpio, dht_type_t type) {
+  esp_err_t ret;
 
-  // Enviar señal de inicio, puede ser interrumpida
-  gpio_set_direction(DHT_GPIO, GPIO_MODE_OUTPUT);
-  gpio_set_level(DHT_GPIO, 0);
-  esp_rom_delay_us(20000); // 20ms LOW
+  if (dht_rx_queue == NULL || dht_count >= HAL_DHT_MAX_SENSORS) {
+    ESP_LOGE(TAG, "Cannot register sensor on GPIO%d", gpio);
+    return -1;
+  }
+  dht_sensor_t *sensor = &dht_sensors[dht_count];
+
+  rmt_rx_channel_config_t rx_config = {
+      .gpio_num = gpio,
+      .clk_src = RMT_CLK_SRC_DEFAULT,
+      .resolution_hz = DHT_RMT_RESOLUTION_HZ,
+      .mem_block_symbols = DHT_RMT_MEM_SYMBOLS,
+  };
+
+  ret = rmt_new_rx_channel(&rx_config, &sensor->channel);
+  if (ret != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to create RMT channel: %s", esp_err_to_name(ret));
+    return -1;
+  }
+
+  rmt_rx_event_callbacks_t callbacks = {.on_recv_done = dht_rx_done};
+  ret = rmt_rx_register_event_callbacks(sensor->channel, &callbacks,
+                                        (void *)(uintptr_t)dht_count);
+  if (ret == ESP_OK)
+    ret = rmt_enable(sensor->channel);
+  if (ret != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to enable RMT channel: %s", esp_err_to_name(ret));
+    rmt_del_channel(sensor->channel);
+    return -1;
+  }
 
-  gpio_set_level(DHT_GPIO, 1);
-  esp_rom_delay_us(40); // 20-40us HIGH
+  // Drenaje abierto: el pin se maneja en LOW para el inicio y el RMT
+  // sigue viendo la línea como entrada
+  gpio_set_direction(gpio, GPIO_MODE_INPUT_OUTPUT_OD);
+  gpio_set_pull_mode(gpio, GPIO_PULLUP_ONLY);
+  gpio_set_level(gpio, 1);
+
+  sensor->gpio = gpio;
+  sensor->type = type;
+  ESP_LOGI(TAG, "%s initialized on GPIO%d (RMT capture)",
+           type == DHT_TYPE_DHT22 ? "DHT22" : "DHT11", gpio);
+  return dht_count++;
+}
 
-  // Cambiar a entrada para leer datos
-  gpio_set_direction(DHT_GPIO, GPIO_MODE_INPUT);
+size_t dht_sensor_count(void) { return dht_count; }
 
-  portENTER_CRITICAL(&dht_spinlock);
+// Armar la captura y liberar la línea de los sensores del tipo dado.
+// Retorna la máscara de sensores armados.
+static uint32_t dht_release(dht_type_t type) {
+  uint32_t armed = 0;
 
-  // Esperar respuesta del DHT11 bajar a LOW - 80us
-  if (dht_await_pin_state(DHT_TIMEOUT, 0) != 0) {
-    result = -1;
-    goto cleanup;
-  }
+  for (size_t i = 0; i < dht_count; i++) {
+    dht_sensor_t *sensor = &dht_sensors[i];
+    if (sensor->type != type)
+      continue;
 
-  // Esperar a que DHT11 suba a HIGH - 80us
-  if (dht_await_pin_state(DHT_TIMEOUT, 1) != 0) {
-    result = -1;
-    goto cleanup;
+    // Armar la captura antes de liberar la línea para no perder la respuesta
+    if (rmt_receive(sensor->channel, sensor->symbols, sizeof(sensor->symbols),
+                    &dht_receive_config) == ESP_OK) {
+      armed |= 1u << i;
+    } else {
+      ESP_LOGE(TAG, "GPIO%d read failed: RMT busy", sensor->gpio);
+    }
+    gpio_set_level(sensor->gpio, 1);
   }
+  return armed;
+}
 
-  // Esperar a que DHT11 baje a LOW - inicio de datos
-  if (dht_await_pin_state(DHT_TIMEOUT, 0) != 0) {
-    result = -1;
-    goto cleanup;
+static bool dht_decode_sensor(const dht_sensor_t *sensor, size_t num_symbols,
+                              hal_dht_reading_t *reading) {
+  uint8_t data[DHT_FRAME_BYTES];
+  dht_pulse_t pulses[DHT_RMT_MEM_SYMBOLS * 2];
+
+  // Convertir símbolos RMT a pulsos (nivel, duración)
+  size_t count = 0;
+  for (size_t i = 0; i < num_symbols && i < DHT_RMT_MEM_SYMBOLS; i++) {
+    const rmt_symbol_word_t *sym = &sensor->symbols[i];
+    pulses[count++] = (dht_pulse_t){sym->level0, sym->duration0};
+    pulses[count++] = (dht_pulse_t){sym->level1, sym->duration1};
   }
 
-  // Leer 40 bits
-  for (int i = 0; i < 40; i++) {
-    // Esperar a que suba a HIGH - inicio del bit
-    // Esperar a la señal en alto que indica el valor del bit
-    if (dht_await_pin_state(DHT_TIMEOUT, 1) != 0) {
-      result = -1;
-      goto cleanup;
-    }
-
-    // Crítico: medir duración del pulso HIGH
-    esp_rom_delay_us(30);
+  dht_decode_result_t result = dht_decode_pulses(pulses, count, data);
+  if (result == DHT_DECODE_ERR_SHORT) {
+    ESP_LOGE(TAG, "GPIO%d read failed: %u symbols captured", sensor->gpio,
+             (unsigned)num_symbols);
+    return false;
+  }
+  if (result == DHT_DECODE_ERR_CHECKSUM) {
+    ESP_LOGE(TAG, "GPIO%d checksum error: expected %d, got %d", sensor->gpio,
+             ((data[0] + data[1] + data[2] + data[3]) & 0xFF), data[4]);
+    return false;
+  }
 
-    if (gpio_get_level(DHT_GPIO)) {
-      // Todavía está HIGH, es un bit 1
-      data[i / 8] |= (1 << (7 - (i % 8)));
-    }
+  ESP_LOGD(TAG, "GPIO%d raw data: %d %d %d %d %d", sensor->gpio, data[0],
+           data[1], data[2], data[3], data[4]);
+  dht_decode_values(sensor->type, data, &reading->humidity,
+                    &reading->temperature);
+  return true;
+}
 
-    // Esperar a que baje a LOW - fin del bit
-    if (dht_await_pin_state(DHT_TIMEOUT, 0) != 0) {
-      result = -1;
-      goto cleanup;
-    }
+int dht_read_all(hal_dht_reading_t readings[HAL_DHT_MAX_SENSORS]) {
+  bool has_dht11 = false;
+  bool has_dht22 = false;
+  dht_rx_event_t event;
+  int valid = 0;
+
+  for (size_t i = 0; i < HAL_DHT_MAX_SENSORS; i++)
+    readings[i].valid = false;
+  if (dht_count == 0) {
+    ESP_LOGE(TAG, "No DHT sensors registered");
+    return 0;
   }
 
-cleanup:
-  // Siempre salir de la sección crítica
-  portEXIT_CRITICAL(&dht_spinlock);
+  xQueueReset(dht_rx_queue);
 
-  // Si hubo un error durante la lectura, retornar
-  if (result != 0) {
-    ESP_LOGE(TAG, "DHT11 read failed");
-    return result;
+  // Enviar la señal de inicio a todos los sensores a la vez
+  for (size_t i = 0; i < dht_count; i++) {
+    gpio_set_level(dht_sensors[i].gpio, 0);
+    has_dht11 |= dht_sensors[i].type == DHT_TYPE_DHT11;
+    has_dht22 |= dht_sensors[i].type == DHT_TYPE_DHT22;
   }
 
-  // Verificar checksum
-  if (data[4] != ((data[0] + data[1] + data[2] + data[3]) & 0xFF)) {
-    ESP_LOGE(TAG, "Checksum error: expected %d, got %d",
-             ((data[0] + data[1] + data[2] + data[3]) & 0xFF), data[4]);
-    return -1;
+  // El DHT22 requiere un pulso corto; su trama se captura mientras la tarea
+  // cede el CPU durante el pulso largo del DHT11
+  uint32_t pending = 0;
+  if (has_dht22) {
+    esp_rom_delay_us(DHT22_START_PULSE_US);
+    pending |= dht_release(DHT_TYPE_DHT22);
+  }
+  if (has_dht11) {
+    vTaskDelay(pdMS_TO_TICKS(DHT11_START_PULSE_MS) + 1);
+    pending |= dht_release(DHT_TYPE_DHT11);
   }
 
-  *humidity = data[0];
-  *temperature = data[2];
+  TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(DHT_TIMEOUT_MS);
+  while (pending != 0) {
+    TickType_t now = xTaskGetTickCount();
+    TickType_t wait = (int32_t)(deadline - now) > 0 ? deadline - now : 0;
+    if (xQueueReceive(dht_rx_queue, &event, wait) != pdTRUE)
+      break;
+    if (event.index >= dht_count || !(pending & (1u << event.index)))
+      continue;
+
+    pending &= ~(1u << event.index);
+    if (dht_decode_sensor(&dht_sensors[event.index], event.num_symbols,
+                          &readings[event.index])) {
+      readings[event.index].valid = true;
+      valid++;
+    }
+  }
 
-  ESP_LOGI(TAG, "Raw data: %d %d %d %d %d", data[0], data[1], data[2], data[3],
-           data[4]);
+  // Abortar las recepciones pendientes reiniciando sus canales
+  for (size_t i = 0; i < dht_count; i++) {
+    if (!(pending & (1u << i)))
+      continue;
+    rmt_disable(dht_sensors[i].channel);
+    rmt_enable(dht_sensors[i].channel);
+    ESP_LOGE(TAG, "GPIO%d read failed: no response", dht_sensors[i].gpio);
+  }
 
-  return 0;
-}
\ No newline at end of file
+  return valid;
+}
@@ -0,0 +1,355 @@
+/*******************************************************************************
+ * @file        encoder_utils.c
+ * @brief       Codificadores intercambiables para la telemetría: JSON para
+ *              ThingsBoard y CBOR compacto para un decodificador local.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "encoder_utils.h"
+#include "esp_log.h"
+#include "gateway_utils.h"
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "ENCODER";
+
+static const telemetry_encoder_t *active_encoder =
+#if GATEWAY_MODE
+    &telemetry_encoder_gateway;
+#elif TELEMETRY_ENCODING == TELEMETRY_ENCODING_CBOR
+    &telemetry_encoder_cbor;
+#else
+    &telemetry_encoder_json;
+#endif
+
+static int32_t encoder_tenths(float value) { return lroundf(value * 10); }
+
+/* ---------------------------------- JSON ---------------------------------- */
+
+static bool json_append(char *buf, size_t size, size_t *len, const char *fmt,
+                        ...) {
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(buf + *len, size - *len, fmt, args);
+  va_end(args);
+  if (n < 0 || *len + n >= size)
+    return false;
+  *len += n;
+  return true;
+}
+
+// Decimales con aritmética entera, sin el formateo de flotantes de newlib
+static bool json_append_tenths(char *buf, size_t size, size_t *len,
+                               const char *key, float value) {
+  int32_t tenths = encoder_tenths(value);
+  long abs_tenths = labs(tenths);
+  return json_append(buf, size, len, "%s\"%s\":%s%ld.%ld",
+                     buf[*len - 1] == '{' ? "" : ",", key,
+                     tenths < 0 ? "-" : "", abs_tenths / 10, abs_tenths % 10);
+}
+
+static size_t json_begin(uint8_t *buf, size_t size) {
+  size_t len = 0;
+  return json_append((char *)buf, size, &len, "[") ? len : 0;
+}
+
+static size_t json_sample(uint8_t *out, size_t size,
+                          const telemetry_sample_t *sample, int64_t ts_ms,
+                          bool first) {
+  char *buf = (char *)out;
+  uint16_t keys = sample->keys;
+  size_t len = 0;
+  bool ok = true;
+
+  if (!first)
+    ok = json_append(buf, size, &len, ",");
+  if (ok && ts_ms != 0)
+    ok = json_append(buf, size, &len, "{\"ts\":%lld,\"values\":",
+                     (long long)ts_ms);
+  ok = ok && json_append(buf, size, &len, "{");
+
+  // Cada clave va precedida de coma excepto la primera
+#define SEP() (buf[len - 1] == '{' ? "" : ",")
+  if (ok && (keys & (1 << TELEMETRY_KEY_TEMPERATURE)))
+    ok = json_append_tenths(buf, size, &len, "temperature",
+                            sample->temperature);
+  if (ok && (keys & (1 << TELEMETRY_KEY_HUMIDITY)))
+    ok = json_append_tenths(buf, size, &len, "humidity", sample->humidity);
+  if (ok && (keys & (1 << TELEMETRY_KEY_BUZZER)))
+    ok = json_append(buf, size, &len, "%s\"buzzer\":%s", SEP(),
+                     sample->buzzer ? "true" : "false");
+  if (ok && (keys & (1 << TELEMETRY_KEY_BUZZER_MODE)))
+    ok = json_append(buf, size, &len, "%s\"buzzer_mode\":\"%s\"", SEP(),
+                     sample->buzzer_manual ? "manual" : "auto");
+  if (ok && (keys & (1 << TELEMETRY_KEY_TEMP_THRESHOLD)))
+    ok = json_append_tenths(buf, size, &len, "temp_threshold",
+                            sample->temp_threshold);
+  if (ok && (keys & (1 << TELEMETRY_KEY_MODE)))
+    ok = json_append(buf, size, &len, "%s\"mode\":\"%s\"", SEP(),
+                     sample->automatic_mode ? "automatic" : "manual");
+  for (int i = 0; ok && i < 3; i++) {
+    if (keys & (1 << (TELEMETRY_KEY_LED1 + i)))
+      ok = json_append(buf, size, &len, "%s\"led%d\":%d", SEP(), i + 1,
+                       (sample->leds >> i) & 1);
+  }
+  for (int i = 0; ok && i < TELEMETRY_AUX_SENSORS; i++) {
+    char name[16];
+    if (keys & (1 << TELEMETRY_KEY_AUX_TEMPERATURE(i))) {
+      snprintf(name, sizeof(name), "temperature%d", i + 2);
+      ok = json_append_tenths(buf, size, &len, name,
+                              sample->aux_temperature[i]);
+    }
+    if (ok && (keys & (1 << TELEMETRY_KEY_AUX_HUMIDITY(i)))) {
+      snprintf(name, sizeof(name), "humidity%d", i + 2);
+      ok = json_append_tenths(buf, size, &len, name, sample->aux_humidity[i]);
+    }
+  }
+#undef SEP
+
+  ok = ok && json_append(buf, size, &len, ts_ms ? "}}" : "}");
+  return ok ? len : 0;
+}
+
+static size_t json_end(uint8_t *buf, size_t size) {
+  size_t len = 0;
+  return json_append((char *)buf, size, &len, "]") ? len : 0;
+}
+
+const telemetry_encoder_t telemetry_encoder_json = {
+    .name = "json",
+    .topic = TELEMETRY_TOPIC,
+    .begin = json_begin,
+    .sample = json_sample,
+    .end = json_end,
+    .end_size = 2, // "]" y el terminador
+};
+
+/* ---------------------------------- CBOR ---------------------------------- */
+
+#define CBOR_MAJOR_UINT 0
+#define CBOR_MAJOR_NINT 1
+#define CBOR_MAJOR_MAP 5
+#define CBOR_FALSE 0xF4
+#define CBOR_TRUE 0xF5
+#define CBOR_ARRAY_INDEFINITE 0x9F
+#define CBOR_BREAK 0xFF
+#define CBOR_KEY_TS (-1)
+
+// Encabezado de un elemento: tipo mayor y argumento en la forma más corta
+static size_t cbor_head(uint8_t *buf, size_t size, uint8_t major,
+                        uint64_t value) {
+  uint8_t type = major << 5;
+  size_t n;
+
+  if (value < 24) {
+    n = 1;
+  } else if (value <= UINT8_MAX) {
+    n = 2;
+    type |= 24;
+  } else if (value <= UINT16_MAX) {
+    n = 3;
+    type |= 25;
+  } else if (value <= UINT32_MAX) {
+    n = 5;
+    type |= 26;
+  } else {
+    n = 9;
+    type |= 27;
+  }
+  if (n > size)
+    return 0;
+
+  buf[0] = n == 1 ? type | value : type;
+  for (size_t i = 1; i < n; i++) {
+    buf[i] = value >> (8 * (n - 1 - i));
+  }
+  return n;
+}
+
+static size_t cbor_int(uint8_t *buf, size_t size, int64_t value) {
+  return value >= 0 ? cbor_head(buf, size, CBOR_MAJOR_UINT, value)
+                    : cbor_head(buf, size, CBOR_MAJOR_NINT, -1 - value);
+}
+
+static size_t cbor_pair_int(uint8_t *buf, size_t size, int key,
+                            int64_t value) {
+  size_t k = cbor_int(buf, size, key);
+  size_t v = k ? cbor_int(buf + k, size - k, value) : 0;
+  return v ? k + v : 0;
+}
+
+static size_t cbor_pair_bool(uint8_t *buf, size_t size, int key, bool value) {
+  size_t k = cbor_int(buf, size, key);
+  if (k == 0 || k >= size)
+    return 0;
+  buf[k] = value ? CBOR_TRUE : CBOR_FALSE;
+  return k + 1;
+}
+
+static size_t cbor_begin(uint8_t *buf, size_t size) {
+  if (size < 1)
+    return 0;
+  buf[0] = CBOR_ARRAY_INDEFINITE;
+  return 1;
+}
+
+static size_t cbor_sample(uint8_t *buf, size_t size,
+                          const telemetry_sample_t *sample, int64_t ts_ms,
+                          bool first) {
+  uint16_t keys = sample->keys;
+  size_t pairs = __builtin_popcount(keys) + (ts_ms != 0 ? 1 : 0);
+  size_t len = cbor_head(buf, size, CBOR_MAJOR_MAP, pairs);
+  size_t n = len;
+
+#define PUT(expr)                                                              \
+  do {                                                                         \
+    n = (expr);                                                                \
+    if (n == 0)                                                                \
+      return 0;                                                                \
+    len += n;                                                                  \
+  } while (0)
+
+  if (n == 0)
+    return 0;
+  if (ts_ms != 0)
+    PUT(cbor_pair_int(buf + len, size - len, CBOR_KEY_TS, ts_ms));
+  if (keys & (1 << TELEMETRY_KEY_TEMPERATURE))
+    PUT(cbor_pair_int(buf + len, size - len, TELEMETRY_KEY_TEMPERATURE,
+                      encoder_tenths(sample->temperature)));
+  if (keys & (1 << TELEMETRY_KEY_HUMIDITY))
+    PUT(cbor_pair_int(buf + len, size - len, TELEMETRY_KEY_HUMIDITY,
+                      encoder_tenths(sample->humidity)));
+  if (keys & (1 << TELEMETRY_KEY_BUZZER))
+    PUT(cbor_pair_bool(buf + len, size - len, TELEMETRY_KEY_BUZZER,
+                       sample->buzzer));
+  if (keys & (1 << TELEMETRY_KEY_BUZZER_MODE))
+    PUT(cbor_pair_bool(buf + len, size - len, TELEMETRY_KEY_BUZZER_MODE,
+                       sample->buzzer_manual));
+  if (keys & (1 << TELEMETRY_KEY_TEMP_THRESHOLD))
+    PUT(cbor_pair_int(buf + len, size - len, TELEMETRY_KEY_TEMP_THRESHOLD,
+                      encoder_tenths(sample->temp_threshold)));
+  if (keys & (1 << TELEMETRY_KEY_MODE))
+    PUT(cbor_pair_bool(buf + len, size - len, TELEMETRY_KEY_MODE,
+                       sample->automatic_mode));
+  for (int i = 0; i < 3; i++) {
+    if (keys & (1 << (TELEMETRY_KEY_LED1 + i)))
+      PUT(cbor_pair_bool(buf + len, size - len, TELEMETRY_KEY_LED1 + i,
+                         (sample->leds >> i) & 1));
+  }
+  for (int i = 0; i < TELEMETRY_AUX_SENSORS; i++) {
+    if (keys & (1 << TELEMETRY_KEY_AUX_TEMPERATURE(i)))
+      PUT(cbor_pair_int(buf + len, size - len, TELEMETRY_KEY_AUX_TEMPERATURE(i),
+                        encoder_tenths(sample->aux_temperature[i])));
+    if (keys & (1 << TELEMETRY_KEY_AUX_HUMIDITY(i)))
+      PUT(cbor_pair_int(buf + len, size - len, TELEMETRY_KEY_AUX_HUMIDITY(i),
+                        encoder_tenths(sample->aux_humidity[i])));
+  }
+#undef PUT
+
+  return len;
+}
+
+static size_t cbor_end(uint8_t *buf, size_t size) {
+  if (size < 1)
+    return 0;
+  buf[0] = CBOR_BREAK;
+  return 1;
+}
+
+const telemetry_encoder_t telemetry_encoder_cbor = {
+    .name = "cbor",
+    .topic = TELEMETRY_CBOR_TOPIC,
+    .begin = cbor_begin,
+    .sample = cbor_sample,
+    .end = cbor_end,
+    .end_size = 1,
+};
+
+/* ---------------------------------- Lotes --------------------------------- */
+
+const telemetry_encoder_t *encoder_get(void) { return active_encoder; }
+
+const telemetry_encoder_t *encoder_find(const char *name, size_t name_len) {
+  // En modo pasarela ThingsBoard solo acepta el lote por dispositivo, y
+  // fuera de él nadie está suscrito a v1/gateway/telemetry
+  static const telemetry_encoder_t *const encoders[] = {
+#if GATEWAY_MODE
+      &telemetry_encoder_gateway,
+#else
+      &telemetry_encoder_json,
+      &telemetry_encoder_cbor,
+#endif
+  };
+
+  for (size_t i = 0; i < sizeof(encoders) / sizeof(encoders[0]); i++) {
+    if (strlen(encoders[i]->name) == name_len &&
+        memcmp(encoders[i]->name, name, name_len) == 0)
+      return encoders[i];
+  }
+  return NULL;
+}
+
+void encoder_set(const telemetry_encoder_t *encoder) {
+  if (encoder == NULL || encoder == active_encoder)
+    return;
+  active_encoder = encoder;
+  ESP_LOGI(TAG, "Telemetry encoding set to %s on %s", encoder->name,
+           encoder->topic);
+}
+
+void encoder_batch_begin(telemetry_batch_t *batch, uint8_t *buf, size_t size) {
+  batch->encoder = active_encoder;
+  batch->buf = buf;
+  batch->size = size;
+  batch->count = 0;
+  memset(batch->sections, 0, sizeof(batch->sections));
+  batch->len = batch->encoder->begin(buf, size);
+}
+
+bool encoder_batch_add(telemetry_batch_t *batch,
+                       const telemetry_sample_t *sample, int64_t ts_ms) {
+  const telemetry_encoder_t *encoder = batch->encoder;
+  if (batch->len == 0 || batch->len + encoder->end_size >= batch->size)
+    return false;
+  if (encoder->add != NULL)
+    return encoder->add(batch, sample, ts_ms);
+
+  size_t n = encoder->sample(batch->buf + batch->len,
+                             batch->size - batch->len - encoder->end_size,
+                             sample, ts_ms, batch->count == 0);
+  if (n == 0)
+    return false;
+  batch->len += n;
+  batch->count++;
+  return true;
+}
+
+size_t encoder_batch_end(telemetry_batch_t *batch) {
+  if (batch->count == 0)
+    return 0;
+  size_t n = batch->encoder->end(batch->buf + batch->len,
+                                 batch->size - batch->len);
+  if (n == 0)
+    return 0;
+  batch->len += n;
+  return batch->len;
+}
+
+size_t encoder_single(const telemetry_encoder_t *encoder, uint8_t *buf,
+                      size_t size, const telemetry_sample_t *sample) {
+  if (encoder->add == NULL)
+    return encoder->sample(buf, size, sample, 0, true);
+
+  // Los formatos agrupados siempre necesitan el lote que los envuelve
+  telemetry_batch_t batch = {.encoder = encoder, .buf = buf, .size = size};
+  batch.len = encoder->begin(buf, size);
+  if (!encoder_batch_add(&batch, sample, 0))
+    return 0;
+  return encoder_batch_end(&batch);
+}
@@ -0,0 +1,84 @@
+/*******************************************************************************
+ * @file        filter_utils.c
+ * @brief       Acondicionamiento de lecturas en punto fijo (décimas): rechazo
+ *              de picos, mediana deslizante y promedio exponencial, más
+ *              bandas de histéresis para las salidas.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "filter_utils.h"
+#include <stdlib.h>
+#include <string.h>
+
+void filter_init(filter_t *filter, const filter_config_t *config) {
+  memset(filter, 0, sizeof(*filter));
+  filter->config = *config;
+  if (filter->config.median_window == 0)
+    filter->config.median_window = 1;
+  if (filter->config.median_window > FILTER_MEDIAN_MAX)
+    filter->config.median_window = FILTER_MEDIAN_MAX;
+}
+
+// Mediana de la ventana por inserción; con ventana incompleta toma el
+// elemento central inferior
+static int32_t filter_median(const filter_t *filter) {
+  int32_t sorted[FILTER_MEDIAN_MAX];
+
+  for (uint8_t i = 0; i < filter->count; i++) {
+    int32_t value = filter->window[i];
+    int j = i;
+    while (j > 0 && sorted[j - 1] > value) {
+      sorted[j] = sorted[j - 1];
+      j--;
+    }
+    sorted[j] = value;
+  }
+  return sorted[(filter->count - 1) / 2];
+}
+
+bool filter_apply(filter_t *filter, int32_t input, int32_t *output) {
+  const filter_config_t *config = &filter->config;
+
+  // Un salto aislado se descarta; si persiste es un cambio real
+  if (filter->primed && config->spike_limit > 0 &&
+      abs(input - filter->last_input) > config->spike_limit &&
+      filter->rejects < config->spike_max_reject) {
+    filter->rejects++;
+    *output = filter->output;
+    return false;
+  }
+  filter->rejects = 0;
+  filter->last_input = input;
+
+  filter->window[filter->next] = input;
+  filter->next = (filter->next + 1) % config->median_window;
+  if (filter->count < config->median_window)
+    filter->count++;
+  int32_t value = filter_median(filter);
+
+  if (config->ema_shift == 0 || !filter->primed) {
+    filter->ema = value * (1 << FILTER_EMA_FRAC_BITS);
+  } else {
+    filter->ema += (value * (1 << FILTER_EMA_FRAC_BITS) - filter->ema) /
+                   (1 << config->ema_shift);
+  }
+
+  // Redondear al décimo más cercano
+  int32_t half = 1 << (FILTER_EMA_FRAC_BITS - 1);
+  filter->output = (filter->ema + (filter->ema >= 0 ? half : -half)) /
+                   (1 << FILTER_EMA_FRAC_BITS);
+  filter->primed = true;
+  *output = filter->output;
+  return true;
+}
+
+bool hysteresis_update(bool state, int32_t value, int32_t on, int32_t off) {
+  if (!state && value > on)
+    return true;
+  if (state && value < off)
+    return false;
+  return state;
+}
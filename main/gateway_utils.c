@@ -0,0 +1,174 @@
+/*******************************************************************************
+ * @file        gateway_utils.c
+ * @brief       Modo pasarela de ThingsBoard: anuncio de los dispositivos
+ *              hijos y codificador de telemetría agrupado por dispositivo.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "gateway_utils.h"
+#include "esp_log.h"
+#include "publish_utils.h"
+#include <stdio.h>
+#include <string.h>
+
+#define GATEWAY_ELEMENT_SIZE 256
+
+static const char *TAG = "GATEWAY";
+
+static const char *const device_names[] = GATEWAY_DEVICE_NAMES;
+
+// Vistas ya codificadas de una muestra; los lotes solo se arman desde la
+// tarea que publica, igual que los búferes de telemetry_utils
+static char elements[GATEWAY_DEVICES][GATEWAY_ELEMENT_SIZE];
+
+_Static_assert(sizeof(device_names) / sizeof(device_names[0]) >=
+                   GATEWAY_DEVICES,
+               "GATEWAY_DEVICE_NAMES must name every sensor");
+
+esp_err_t gateway_connect_devices(size_t count) {
+  char payload[64];
+  esp_err_t ret = ESP_OK;
+
+  if (count > GATEWAY_DEVICES)
+    count = GATEWAY_DEVICES;
+  for (size_t i = 0; i < count; i++) {
+    int n = snprintf(payload, sizeof(payload), "{\"device\":\"%s\"}",
+                     device_names[i]);
+    if (publish_send(PUBLISH_STREAM_GATEWAY, GATEWAY_CONNECT_TOPIC, payload,
+                     n) < 0)
+      ret = ESP_FAIL;
+  }
+  ESP_LOGI(TAG, "Announced %u child devices", (unsigned)count);
+  return ret;
+}
+
+int gateway_device_index(const char *name, size_t len) {
+  for (int i = 0; i < GATEWAY_DEVICES; i++) {
+    if (strlen(device_names[i]) == len &&
+        memcmp(device_names[i], name, len) == 0)
+      return i;
+  }
+  return -1;
+}
+
+// Vista de la muestra para un dispositivo: el primero lleva todo menos los
+// sensores adicionales; cada adicional pasa a temperature/humidity
+static bool gateway_view(const telemetry_sample_t *sample, int device,
+                         telemetry_sample_t *view) {
+  *view = *sample;
+  if (device == 0) {
+    for (int i = 0; i < TELEMETRY_AUX_SENSORS; i++)
+      view->keys &= ~TELEMETRY_KEYS_AUX(i);
+    return view->keys != 0;
+  }
+
+  int aux = device - 1;
+  view->keys = 0;
+  if (sample->keys & (1 << TELEMETRY_KEY_AUX_TEMPERATURE(aux))) {
+    view->keys |= 1 << TELEMETRY_KEY_TEMPERATURE;
+    view->temperature = sample->aux_temperature[aux];
+  }
+  if (sample->keys & (1 << TELEMETRY_KEY_AUX_HUMIDITY(aux))) {
+    view->keys |= 1 << TELEMETRY_KEY_HUMIDITY;
+    view->humidity = sample->aux_humidity[aux];
+  }
+  return view->keys != 0;
+}
+
+static size_t gateway_begin(uint8_t *buf, size_t size) {
+  if (size < 1)
+    return 0;
+  buf[0] = '{';
+  return 1;
+}
+
+static size_t gateway_end(uint8_t *buf, size_t size) {
+  if (size < 1)
+    return 0;
+  buf[0] = '}';
+  return 1;
+}
+
+// Insertar el elemento al final de la sección del dispositivo, corriendo lo
+// que le sigue, o abrir la sección al final del lote
+static bool gateway_insert(telemetry_batch_t *batch, int device,
+                           const char *element, size_t n) {
+  size_t mark = batch->sections[device];
+  char header[48];
+  size_t extra;
+
+  if (mark != 0) {
+    extra = n + 1; // ","
+  } else {
+    int h = snprintf(header, sizeof(header), "%s\"%s\":[",
+                     batch->len > 1 ? "," : "", device_names[device]);
+    if (h < 0 || (size_t)h >= sizeof(header))
+      return false;
+    extra = h + n + 1; // "]"
+  }
+  if (batch->len + extra + batch->encoder->end_size > batch->size)
+    return false;
+
+  uint8_t *buf = batch->buf;
+  if (mark != 0) {
+    memmove(buf + mark + extra, buf + mark, batch->len - mark);
+    buf[mark] = ',';
+    memcpy(buf + mark + 1, element, n);
+    for (int i = 0; i < GATEWAY_DEVICES; i++) {
+      if (batch->sections[i] >= mark)
+        batch->sections[i] += extra;
+    }
+  } else {
+    size_t h = extra - n - 1;
+    memcpy(buf + batch->len, header, h);
+    memcpy(buf + batch->len + h, element, n);
+    buf[batch->len + h + n] = ']';
+    batch->sections[device] = batch->len + h + n;
+  }
+  batch->len += extra;
+  return true;
+}
+
+static bool gateway_add(telemetry_batch_t *batch,
+                        const telemetry_sample_t *sample, int64_t ts_ms) {
+  size_t lengths[GATEWAY_DEVICES];
+  size_t total = 0;
+
+  // Codificar todas las vistas antes de tocar el lote: la muestra entra
+  // completa o no entra
+  for (int i = 0; i < GATEWAY_DEVICES; i++) {
+    telemetry_sample_t view;
+    lengths[i] = 0;
+    if (!gateway_view(sample, i, &view))
+      continue;
+    lengths[i] = telemetry_encoder_json.sample(
+        (uint8_t *)elements[i], sizeof(elements[i]), &view, ts_ms, true);
+    if (lengths[i] == 0)
+      return false;
+    total += lengths[i] + (batch->sections[i] != 0
+                               ? 1
+                               : strlen(device_names[i]) + 6); // ,"":[]
+  }
+  if (batch->len + total + batch->encoder->end_size > batch->size)
+    return false;
+
+  for (int i = 0; i < GATEWAY_DEVICES; i++) {
+    if (lengths[i] != 0 &&
+        !gateway_insert(batch, i, elements[i], lengths[i]))
+      return false;
+  }
+  batch->count++;
+  return true;
+}
+
+const telemetry_encoder_t telemetry_encoder_gateway = {
+    .name = "gateway",
+    .topic = GATEWAY_TELEMETRY_TOPIC,
+    .begin = gateway_begin,
+    .end = gateway_end,
+    .end_size = 2, // "}" y el terminador
+    .add = gateway_add,
+};
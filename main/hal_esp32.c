@@ -0,0 +1,756 @@
+/*******************************************************************************
+ * @file        hal_esp32.c
+ * @brief       Implementación de la capa de abstracción de hardware sobre los
+ *              controladores de ESP-IDF para el ESP32.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "hal.h"
+#include "boot_utils.h"
+#include "dht11_utils.h"
+#include "driver/gpio.h"
+#include "driver/ledc.h"
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_netif_sntp.h"
+#include "esp_random.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "esp_transport_tcp.h"
+#include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "lwip/inet.h"
+#include "lwip/sockets.h"
+#include "mqtt_client.h"
+#include "nvs.h"
+#include "tls_utils.h"
+#include <string.h>
+#include <time.h>
+
+#ifndef WIFI_SSID
+#error "WIFI_SSID must be defined using: -D WIFI_SSID=<YOUR_SSID>"
+#endif
+
+#ifndef WIFI_PASS
+#error "WIFI_PASS must be defined using: -D WIFI_PASS=<YOUR_PASSWORD>"
+#endif
+
+#define HAL_LEDC_MODE LEDC_LOW_SPEED_MODE
+
+#ifndef SNTP_SERVER
+#define SNTP_SERVER "pool.ntp.org"
+#endif
+
+// Reutilizar la última IP como estática en lugar de esperar el DHCP. Es
+// opcional: con DHCP detenido la concesión no se renueva y el servidor puede
+// entregar la dirección a otro equipo. Por defecto el arranque rápido solo
+// salta el escaneo y el DHCP pide de nuevo la última IP
+// (CONFIG_LWIP_DHCP_RESTORE_LAST_IP), que el servidor suele confirmar en un
+// solo intercambio.
+#ifndef NET_CACHE_STATIC_IP
+#define NET_CACHE_STATIC_IP 0
+#endif
+
+// Duración supuesta de la concesión. La IP guardada se usa como estática
+// solo durante la primera mitad, cuando el cliente DHCP aún no la habría
+// renovado, y solo si el reloj tiene hora real para saberlo.
+#ifndef NET_CACHE_LEASE_S
+#define NET_CACHE_LEASE_S 3600
+#endif
+
+// Antes de esta fecha (2020) el reloj no tiene hora real
+#define NET_CACHE_MIN_VALID_EPOCH_S 1577836800
+
+// Fallos de MQTT con la red guardada antes de volver al escaneo completo
+#ifndef NET_CACHE_MAX_FAILURES
+#define NET_CACHE_MAX_FAILURES 2
+#endif
+
+#define NET_CACHE_NAMESPACE "netcache"
+#define NET_CACHE_KEY_WIFI "wifi"
+#define NET_CACHE_KEY_BROKER "broker"
+#define NET_CACHE_KEY_BROKER_HOST "broker_host"
+
+// Escrituras de la caché que piden los eventos de esp-mqtt. Su tarea no debe
+// esperar a la flash, así que se hacen en el bucle de eventos por defecto,
+// donde ya se guarda la caché de la WiFi
+ESP_EVENT_DEFINE_BASE(NET_CACHE_EVENT);
+
+enum {
+  NET_CACHE_EVENT_BROKER,        // datos: IP del corredor conectado
+  NET_CACHE_EVENT_BROKER_FAILED, // la IP guardada no conecta
+  NET_CACHE_EVENT_FULL_SCAN,     // la red guardada no llega al corredor
+};
+
+static const char *TAG = "HAL_ESP32";
+
+// Último punto de acceso y concesión válidos, guardados en NVS
+typedef struct {
+  char ssid[33];
+  uint8_t channel;
+  uint8_t bssid[6];
+  esp_netif_ip_info_t ip;
+  esp_ip4_addr_t dns;
+  int64_t lease_start_s; // hora real al obtener la IP, 0 si no se sabía
+} net_cache_t;
+
+static esp_netif_t *sta_netif = NULL;
+static net_cache_t net_cache;
+static bool net_fast_path = false;
+static bool net_static_ip = false; // la IP guardada se fijó sin DHCP
+static esp_timer_handle_t net_lease_timer = NULL;
+static bool net_ready = false;
+
+// Gestor de conectividad y temporizador de su próximo plazo
+static conn_t net_conn;
+static SemaphoreHandle_t net_lock = NULL;
+static esp_timer_handle_t net_timer = NULL;
+
+static esp_mqtt_client_handle_t mqtt_client = NULL;
+static esp_transport_handle_t mqtt_transport = NULL;
+static bool mqtt_tls = false;
+static hal_mqtt_event_cb_t mqtt_callback = NULL;
+static const char *mqtt_host = NULL;
+static char mqtt_cached_host[16];
+static bool mqtt_host_cached = false;
+static bool mqtt_connected_once = false;
+static int mqtt_failures = 0;
+static conn_reason_t mqtt_error_reason = CONN_REASON_MQTT_TRANSPORT;
+
+void hal_gpio_config_output(uint64_t pin_mask) {
+  gpio_config_t io_conf = {
+      .pin_bit_mask = pin_mask,
+      .mode = GPIO_MODE_OUTPUT,
+      .pull_up_en = GPIO_PULLUP_DISABLE,
+      .pull_down_en = GPIO_PULLDOWN_DISABLE,
+      .intr_type = GPIO_INTR_DISABLE,
+  };
+  gpio_config(&io_conf);
+}
+
+void hal_gpio_set_level(uint8_t gpio, uint32_t level) {
+  gpio_set_level((gpio_num_t)gpio, level);
+}
+
+int hal_gpio_get_level(uint8_t gpio) { return gpio_get_level((gpio_num_t)gpio); }
+
+esp_err_t hal_pwm_init(uint8_t channel, uint8_t gpio, uint32_t freq_hz,
+                       uint8_t duty_resolution_bits) {
+  esp_err_t ret;
+
+  // Configurar el timer LEDC, uno por canal
+  ledc_timer_config_t ledc_timer = {
+      .speed_mode = HAL_LEDC_MODE,
+      .duty_resolution = (ledc_timer_bit_t)duty_resolution_bits,
+      .timer_num = (ledc_timer_t)(channel % LEDC_TIMER_MAX),
+      .freq_hz = freq_hz,
+      .clk_cfg = LEDC_AUTO_CLK};
+
+  ret = ledc_timer_config(&ledc_timer);
+  if (ret != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to configure LEDC timer: %s", esp_err_to_name(ret));
+    return ret;
+  }
+
+  ledc_channel_config_t ledc_channel = {
+      .gpio_num = gpio,
+      .speed_mode = HAL_LEDC_MODE,
+      .channel = (ledc_channel_t)channel,
+      .intr_type = LEDC_INTR_DISABLE,
+      .timer_sel = (ledc_timer_t)(channel % LEDC_TIMER_MAX),
+      .duty = 0,
+      .hpoint = 0};
+
+  ret = ledc_channel_config(&ledc_channel);
+  if (ret != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to configure LEDC channel: %s", esp_err_to_name(ret));
+  }
+  return ret;
+}
+
+void hal_pwm_set_duty(uint8_t channel, uint32_t duty) {
+  ledc_set_duty(HAL_LEDC_MODE, (ledc_channel_t)channel, duty);
+  ledc_update_duty(HAL_LEDC_MODE, (ledc_channel_t)channel);
+}
+
+esp_err_t hal_pwm_set_freq(uint8_t channel, uint32_t freq_hz) {
+  return ledc_set_freq(HAL_LEDC_MODE, (ledc_timer_t)(channel % LEDC_TIMER_MAX),
+                       freq_hz);
+}
+
+esp_err_t hal_timer_create(hal_timer_cb_t callback, void *arg,
+                           hal_timer_t *timer) {
+  esp_timer_create_args_t args = {
+      .callback = callback,
+      .arg = arg,
+      .name = "hal_timer",
+  };
+  return esp_timer_create(&args, (esp_timer_handle_t *)timer);
+}
+
+esp_err_t hal_timer_start_once(hal_timer_t timer, uint64_t timeout_us) {
+  return esp_timer_start_once((esp_timer_handle_t)timer, timeout_us);
+}
+
+void hal_timer_stop(hal_timer_t timer) {
+  esp_timer_stop((esp_timer_handle_t)timer);
+}
+
+esp_err_t hal_dht_init(void) { return dht_init(); }
+
+int hal_dht_add(uint8_t gpio, dht_type_t type) {
+  return dht_add_sensor(gpio, type);
+}
+
+size_t hal_dht_count(void) { return dht_sensor_count(); }
+
+int hal_dht_read_all(hal_dht_reading_t readings[HAL_DHT_MAX_SENSORS]) {
+  return dht_read_all(readings);
+}
+
+static bool net_cache_load(net_cache_t *cache) {
+  nvs_handle_t handle;
+  size_t size = sizeof(*cache);
+
+  if (nvs_open(NET_CACHE_NAMESPACE, NVS_READONLY, &handle) != ESP_OK)
+    return false;
+  esp_err_t err = nvs_get_blob(handle, NET_CACHE_KEY_WIFI, cache, &size);
+  nvs_close(handle);
+
+  // Descartar datos de otra red o de otro formato
+  return err == ESP_OK && size == sizeof(*cache) &&
+         strncmp(cache->ssid, WIFI_SSID, sizeof(cache->ssid)) == 0 &&
+         cache->channel != 0;
+}
+
+static void net_cache_store(const char *key, const void *data, size_t size,
+                            bool is_string) {
+  nvs_handle_t handle;
+
+  if (nvs_open(NET_CACHE_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK)
+    return;
+  esp_err_t err;
+  if (data == NULL) {
+    err = nvs_erase_key(handle, key);
+  } else if (is_string) {
+    err = nvs_set_str(handle, key, data);
+  } else {
+    err = nvs_set_blob(handle, key, data, size);
+  }
+  if (err == ESP_OK || err == ESP_ERR_NVS_NOT_FOUND)
+    err = nvs_commit(handle);
+  nvs_close(handle);
+  if (err != ESP_OK)
+    ESP_LOGW(TAG, "Failed to update %s cache: %s", key, esp_err_to_name(err));
+}
+
+static void net_set_config(bool use_cache) {
+  wifi_config_t wifi_config = {
+      .sta =
+          {
+              .ssid = WIFI_SSID,
+              .password = WIFI_PASS,
+          },
+  };
+
+  // Ir directo al canal y BSSID conocidos en lugar de escanear todo
+  if (use_cache) {
+    wifi_config.sta.channel = net_cache.channel;
+    wifi_config.sta.bssid_set = true;
+    memcpy(wifi_config.sta.bssid, net_cache.bssid, sizeof(net_cache.bssid));
+    wifi_config.sta.scan_method = WIFI_FAST_SCAN;
+  } else {
+    wifi_config.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+  }
+  esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+}
+
+// Segundos que le quedan a la IP guardada para usarse como estática según
+// la hora real, o 0 si ya no sirve
+static int64_t net_cache_lease_left(const net_cache_t *cache) {
+  int64_t now = time(NULL);
+  if (!NET_CACHE_STATIC_IP || now < NET_CACHE_MIN_VALID_EPOCH_S ||
+      cache->lease_start_s == 0 || now < cache->lease_start_s)
+    return 0;
+  int64_t left = cache->lease_start_s + NET_CACHE_LEASE_S / 2 - now;
+  return left > 0 ? left : 0;
+}
+
+// Dejar la IP estática y volver a pedir la concesión por DHCP
+static void net_dhcp_resume(void) {
+  if (!net_static_ip)
+    return;
+  net_static_ip = false;
+  esp_timer_stop(net_lease_timer);
+  esp_netif_dhcpc_start(sta_netif);
+}
+
+static void net_lease_timer_cb(void *arg) {
+  ESP_LOGI(TAG, "Cached lease due for renewal, resuming DHCP");
+  net_dhcp_resume();
+}
+
+// Olvidar la red guardada y volver al escaneo completo con DHCP
+static void net_use_full_scan(void) {
+  if (!net_fast_path)
+    return;
+  ESP_LOGW(TAG, "Cached network failed, falling back to full scan");
+  net_fast_path = false;
+  boot_set_fast_path(false);
+  net_cache_store(NET_CACHE_KEY_WIFI, NULL, 0, false);
+  net_set_config(false);
+  net_dhcp_resume();
+}
+
+static void net_cache_post(int32_t event_id, const void *data, size_t size) {
+  if (esp_event_post(NET_CACHE_EVENT, event_id, (void *)data, size, 0) !=
+      ESP_OK)
+    ESP_LOGW(TAG, "Network cache update %ld dropped", (long)event_id);
+}
+
+static void net_cache_event_handler(void *arg, esp_event_base_t event_base,
+                                    int32_t event_id, void *event_data) {
+  switch (event_id) {
+  case NET_CACHE_EVENT_BROKER:
+    net_cache_store(NET_CACHE_KEY_BROKER_HOST, mqtt_host, 0, true);
+    net_cache_store(NET_CACHE_KEY_BROKER, event_data, 0, true);
+    break;
+  case NET_CACHE_EVENT_BROKER_FAILED:
+    net_cache_store(NET_CACHE_KEY_BROKER, NULL, 0, true);
+    break;
+  case NET_CACHE_EVENT_FULL_SCAN:
+    // Varios fallos seguidos pueden pedirlo más de una vez
+    if (net_fast_path) {
+      net_use_full_scan();
+      esp_wifi_disconnect();
+    }
+    break;
+  }
+}
+
+static conn_reason_t net_wifi_reason(uint8_t reason) {
+  switch (reason) {
+  case WIFI_REASON_NO_AP_FOUND:
+    return CONN_REASON_WIFI_NO_AP;
+  case WIFI_REASON_AUTH_FAIL:
+  case WIFI_REASON_AUTH_EXPIRE:
+  case WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT:
+  case WIFI_REASON_HANDSHAKE_TIMEOUT:
+    return CONN_REASON_WIFI_AUTH;
+  case WIFI_REASON_ASSOC_FAIL:
+  case WIFI_REASON_ASSOC_EXPIRE:
+    return CONN_REASON_WIFI_ASSOC;
+  case WIFI_REASON_BEACON_TIMEOUT:
+    return CONN_REASON_WIFI_BEACON_LOSS;
+  default:
+    return CONN_REASON_WIFI_OTHER;
+  }
+}
+
+// Con net_lock
+static void net_update_rssi(void) {
+  wifi_ap_record_t ap;
+  if (esp_wifi_sta_get_ap_info(&ap) == ESP_OK)
+    conn_set_rssi(&net_conn, ap.rssi);
+}
+
+// Ejecutar la acción pedida por el gestor fuera del candado: reconectar
+// MQTT toma el candado del cliente, cuya tarea también entrega eventos aquí
+static void net_apply(conn_action_t action) {
+  switch (action) {
+  case CONN_ACTION_WIFI_CONNECT:
+    ESP_LOGI(TAG, "Retrying WiFi connection...");
+    esp_wifi_connect();
+    break;
+  case CONN_ACTION_WIFI_DISCONNECT:
+    ESP_LOGW(TAG, "No IP address, reassociating");
+    esp_wifi_disconnect();
+    break;
+  case CONN_ACTION_MQTT_CONNECT:
+    // Antes de hal_mqtt_start el propio arranque del cliente conecta
+    if (mqtt_client != NULL)
+      esp_mqtt_client_reconnect(mqtt_client);
+    break;
+  default:
+    break;
+  }
+}
+
+// Rearmar el temporizador con el próximo plazo del gestor; con net_lock
+static void net_schedule(int64_t now_ms, uint8_t attempts) {
+  int64_t wait_ms = conn_wait_ms(&net_conn, now_ms);
+
+  esp_timer_stop(net_timer);
+  if (wait_ms >= 0)
+    esp_timer_start_once(net_timer, wait_ms * 1000);
+  // Solo las esperas recién calculadas, no cada rearme
+  if (net_conn.state == CONN_STATE_BACKOFF && net_conn.attempts != attempts)
+    ESP_LOGI(TAG, "Reconnecting in %lld ms (attempt %u)", (long long)wait_ms,
+             net_conn.attempts);
+}
+
+static void net_dispatch(conn_event_t event, conn_reason_t reason) {
+  int64_t now_ms = hal_time_us() / 1000;
+
+  xSemaphoreTake(net_lock, portMAX_DELAY);
+  uint8_t attempts = net_conn.attempts;
+  if (event == CONN_EVENT_WIFI_UP)
+    net_update_rssi();
+  conn_action_t action = conn_event(&net_conn, event, reason, now_ms);
+  net_schedule(now_ms, attempts);
+  xSemaphoreGive(net_lock);
+  net_apply(action);
+}
+
+// Vence un plazo del gestor: reintentar o abandonar la espera por la IP
+static void net_timer_cb(void *arg) {
+  int64_t now_ms = hal_time_us() / 1000;
+
+  xSemaphoreTake(net_lock, portMAX_DELAY);
+  uint8_t attempts = net_conn.attempts;
+  if (net_conn.wifi)
+    net_update_rssi();
+  conn_action_t action = conn_poll(&net_conn, now_ms);
+  net_schedule(now_ms, attempts);
+  xSemaphoreGive(net_lock);
+  net_apply(action);
+}
+
+void hal_net_status(conn_t *status) {
+  xSemaphoreTake(net_lock, portMAX_DELAY);
+  *status = net_conn;
+  xSemaphoreGive(net_lock);
+}
+
+// Manejo de eventos WiFi
+static void wifi_event_handler(void *arg, esp_event_base_t event_base,
+                               int32_t event_id, void *event_data) {
+  if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
+    esp_wifi_connect();
+  } else if (event_base == WIFI_EVENT &&
+             event_id == WIFI_EVENT_STA_CONNECTED) {
+    wifi_event_sta_connected_t *event = event_data;
+    if (!net_fast_path) {
+      net_cache.channel = event->channel;
+      memcpy(net_cache.bssid, event->bssid, sizeof(net_cache.bssid));
+    }
+    // Una reconexión tras vencer la concesión vuelve al DHCP
+    if (net_static_ip && net_cache_lease_left(&net_cache) == 0)
+      net_dhcp_resume();
+    if (net_static_ip) {
+      // Con DHCP detenido, fijar la IP genera IP_EVENT_STA_GOT_IP
+      esp_netif_dns_info_t dns = {.ip.type = ESP_IPADDR_TYPE_V4};
+      dns.ip.u_addr.ip4 = net_cache.dns;
+      esp_netif_set_ip_info(sta_netif, &net_cache.ip);
+      esp_netif_set_dns_info(sta_netif, ESP_NETIF_DNS_MAIN, &dns);
+    }
+    net_dispatch(CONN_EVENT_WIFI_UP, CONN_REASON_NONE);
+  } else if (event_base == WIFI_EVENT &&
+             event_id == WIFI_EVENT_STA_DISCONNECTED) {
+    wifi_event_sta_disconnected_t *event = event_data;
+    // Si la red guardada no responde antes de tener IP, escanear todo
+    if (!net_ready)
+      net_use_full_scan();
+    ESP_LOGI(TAG, "WiFi disconnected, reason %u", event->reason);
+    net_dispatch(CONN_EVENT_WIFI_DOWN, net_wifi_reason(event->reason));
+  } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_LOST_IP) {
+    ESP_LOGW(TAG, "Lost IP address");
+    net_dispatch(CONN_EVENT_IP_LOST, CONN_REASON_IP_LOST);
+  } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
+    ip_event_got_ip_t *event = (ip_event_got_ip_t *)event_data;
+    ESP_LOGI(TAG, "Got IP: " IPSTR "%s", IP2STR(&event->ip_info.ip),
+             net_static_ip ? " (cached)" : "");
+    net_ready = true;
+    boot_mark(BOOT_MILESTONE_NET_READY);
+    // Pedir la concesión al DHCP cuando este ya la habría renovado
+    if (net_static_ip) {
+      esp_timer_stop(net_lease_timer);
+      esp_timer_start_once(net_lease_timer,
+                           net_cache_lease_left(&net_cache) * 1000000ULL);
+    }
+    // Cada concesión del DHCP, también la que confirma la IP anterior,
+    // reinicia la concesión. Con la misma IP la caché solo se reescribe cada
+    // cuarto de concesión, para no gastar la flash en cada despertar.
+    int64_t now = time(NULL);
+    int64_t lease_start = now >= NET_CACHE_MIN_VALID_EPOCH_S ? now : 0;
+    if (!net_static_ip &&
+        (!net_fast_path || net_cache.ip.ip.addr != event->ip_info.ip.addr ||
+         (lease_start != 0 &&
+          lease_start - net_cache.lease_start_s >= NET_CACHE_LEASE_S / 4))) {
+      esp_netif_dns_info_t dns;
+      strncpy(net_cache.ssid, WIFI_SSID, sizeof(net_cache.ssid) - 1);
+      net_cache.ip = event->ip_info;
+      if (esp_netif_get_dns_info(sta_netif, ESP_NETIF_DNS_MAIN, &dns) ==
+          ESP_OK)
+        net_cache.dns = dns.ip.u_addr.ip4;
+      net_cache.lease_start_s = lease_start;
+      net_cache_store(NET_CACHE_KEY_WIFI, &net_cache, sizeof(net_cache),
+                      false);
+    }
+    net_dispatch(CONN_EVENT_IP_UP, CONN_REASON_NONE);
+  }
+}
+
+// Inicializar WiFi
+esp_err_t hal_net_init(void) {
+  ESP_ERROR_CHECK(esp_netif_init());
+  ESP_ERROR_CHECK(esp_event_loop_create_default());
+  sta_netif = esp_netif_create_default_wifi_sta();
+
+  wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+  ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+
+  esp_event_handler_instance_t instance_any_id;
+  esp_event_handler_instance_t instance_got_ip;
+  ESP_ERROR_CHECK(esp_event_handler_instance_register(
+      WIFI_EVENT, ESP_EVENT_ANY_ID, &wifi_event_handler, NULL,
+      &instance_any_id));
+  esp_event_handler_instance_t instance_lost_ip;
+  ESP_ERROR_CHECK(esp_event_handler_instance_register(
+      IP_EVENT, IP_EVENT_STA_GOT_IP, &wifi_event_handler, NULL,
+      &instance_got_ip));
+  ESP_ERROR_CHECK(esp_event_handler_instance_register(
+      IP_EVENT, IP_EVENT_STA_LOST_IP, &wifi_event_handler, NULL,
+      &instance_lost_ip));
+  esp_event_handler_instance_t instance_cache;
+  ESP_ERROR_CHECK(esp_event_handler_instance_register(
+      NET_CACHE_EVENT, ESP_EVENT_ANY_ID, &net_cache_event_handler, NULL,
+      &instance_cache));
+
+  const esp_timer_create_args_t timer_args = {
+      .callback = net_timer_cb,
+      .name = "net_retry",
+  };
+  net_lock = xSemaphoreCreateMutex();
+  if (net_lock == NULL)
+    return ESP_ERR_NO_MEM;
+  ESP_ERROR_CHECK(esp_timer_create(&timer_args, &net_timer));
+  conn_init(&net_conn, esp_random());
+
+  net_fast_path = net_cache_load(&net_cache);
+  if (!net_fast_path)
+    memset(&net_cache, 0, sizeof(net_cache));
+  boot_set_fast_path(net_fast_path);
+  if (net_fast_path) {
+    ESP_LOGI(TAG, "Using cached network on channel %u", net_cache.channel);
+    if (net_cache_lease_left(&net_cache) > 0) {
+      const esp_timer_create_args_t lease_args = {
+          .callback = net_lease_timer_cb,
+          .name = "net_lease",
+      };
+      ESP_ERROR_CHECK(esp_timer_create(&lease_args, &net_lease_timer));
+      esp_netif_dhcpc_stop(sta_netif);
+      net_static_ip = true;
+    }
+  }
+
+  ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+  net_set_config(net_fast_path);
+  ESP_ERROR_CHECK(esp_wifi_start());
+
+  ESP_LOGI(TAG, "WiFi initialization complete");
+
+  // Sincronizar la hora para las marcas de tiempo de la telemetría
+  esp_sntp_config_t sntp_config = ESP_NETIF_SNTP_DEFAULT_CONFIG(SNTP_SERVER);
+  ESP_ERROR_CHECK(esp_netif_sntp_init(&sntp_config));
+
+  return ESP_OK;
+}
+
+int64_t hal_time_us(void) { return esp_timer_get_time(); }
+
+void hal_deep_sleep(uint64_t duration_us) {
+  // Cerrar la sesión MQTT de forma ordenada antes de apagar la radio
+  if (mqtt_client != NULL) {
+    esp_mqtt_client_disconnect(mqtt_client);
+  }
+  ESP_LOGI(TAG, "Entering deep sleep for %llu ms",
+           (unsigned long long)(duration_us / 1000));
+  esp_sleep_enable_timer_wakeup(duration_us);
+  esp_deep_sleep_start();
+}
+
+bool hal_woke_from_sleep(void) {
+  return esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER;
+}
+
+// Dirección del corredor leída del socket ya conectado, sin volver al DNS
+static bool mqtt_broker_peer(char *ip, size_t size) {
+  struct sockaddr_in peer;
+  socklen_t len = sizeof(peer);
+  int sock = mqtt_tls ? tls_transport_socket(mqtt_transport)
+                      : esp_transport_get_socket(mqtt_transport);
+
+  if (sock < 0 || getpeername(sock, (struct sockaddr *)&peer, &len) != 0 ||
+      peer.sin_family != AF_INET)
+    return false;
+  return inet_ntoa_r(peer.sin_addr, ip, size) != NULL;
+}
+
+// Guardar la dirección del broker para evitar el DNS al arrancar
+static void mqtt_cache_broker(void) {
+  struct in_addr addr;
+  char ip[sizeof(mqtt_cached_host)];
+
+  if (mqtt_host_cached || inet_aton(mqtt_host, &addr) ||
+      !mqtt_broker_peer(ip, sizeof(ip)))
+    return;
+  net_cache_post(NET_CACHE_EVENT_BROKER, ip, sizeof(ip));
+}
+
+// Descartar los datos guardados que impiden la primera conexión
+static void mqtt_connect_failed(void) {
+  // Los fallos sin red no dicen nada de los datos guardados
+  if (mqtt_connected_once || !net_ready)
+    return;
+  mqtt_failures++;
+
+  if (mqtt_host_cached) {
+    ESP_LOGW(TAG, "Cached broker address failed, resolving %s", mqtt_host);
+    esp_mqtt_client_config_t mqtt_cfg = {
+        .broker.address.hostname = mqtt_host,
+    };
+    mqtt_host_cached = false;
+    net_cache_post(NET_CACHE_EVENT_BROKER_FAILED, NULL, 0);
+    esp_mqtt_set_config(mqtt_client, &mqtt_cfg);
+  } else if (net_fast_path && mqtt_failures >= NET_CACHE_MAX_FAILURES) {
+    net_cache_post(NET_CACHE_EVENT_FULL_SCAN, NULL, 0);
+  }
+}
+
+static bool mqtt_load_broker(const char *host) {
+  nvs_handle_t handle;
+  char cached_host[64];
+  size_t host_size = sizeof(cached_host);
+  size_t ip_size = sizeof(mqtt_cached_host);
+  bool found = false;
+
+  if (nvs_open(NET_CACHE_NAMESPACE, NVS_READONLY, &handle) != ESP_OK)
+    return false;
+  if (nvs_get_str(handle, NET_CACHE_KEY_BROKER_HOST, cached_host,
+                  &host_size) == ESP_OK &&
+      strcmp(cached_host, host) == 0 &&
+      nvs_get_str(handle, NET_CACHE_KEY_BROKER, mqtt_cached_host, &ip_size) ==
+          ESP_OK)
+    found = true;
+  nvs_close(handle);
+  return found;
+}
+
+// Traducir eventos de esp-mqtt a eventos de la HAL
+static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
+                               int32_t event_id, void *event_data) {
+  esp_mqtt_event_handle_t event = event_data;
+  hal_mqtt_event_t hal_event = {0};
+
+  switch (event->event_id) {
+  case MQTT_EVENT_CONNECTED:
+    hal_event.event_id = HAL_MQTT_EVENT_CONNECTED;
+    hal_event.session_present = event->session_present;
+    if (!mqtt_connected_once) {
+      mqtt_connected_once = true;
+      mqtt_cache_broker();
+    }
+    mqtt_error_reason = CONN_REASON_MQTT_TRANSPORT;
+    net_dispatch(CONN_EVENT_MQTT_UP, CONN_REASON_NONE);
+    break;
+  case MQTT_EVENT_DISCONNECTED:
+    hal_event.event_id = HAL_MQTT_EVENT_DISCONNECTED;
+    mqtt_connect_failed();
+    net_dispatch(CONN_EVENT_MQTT_DOWN, mqtt_error_reason);
+    mqtt_error_reason = CONN_REASON_MQTT_TRANSPORT;
+    break;
+  case MQTT_EVENT_ERROR:
+    hal_event.event_id = HAL_MQTT_EVENT_ERROR;
+    // El error precede a la desconexión y dice su causa
+    if (event->error_handle != NULL &&
+        event->error_handle->error_type ==
+            MQTT_ERROR_TYPE_CONNECTION_REFUSED)
+      mqtt_error_reason = CONN_REASON_MQTT_REFUSED;
+    break;
+  case MQTT_EVENT_DATA:
+    hal_event.event_id = HAL_MQTT_EVENT_DATA;
+    hal_event.topic = event->topic;
+    hal_event.topic_len = event->topic_len;
+    hal_event.data = event->data;
+    hal_event.data_len = event->data_len;
+    hal_event.total_data_len = event->total_data_len;
+    hal_event.current_data_offset = event->current_data_offset;
+    break;
+  default:
+    return;
+  }
+
+  if (mqtt_callback != NULL) {
+    mqtt_callback(&hal_event);
+  }
+}
+
+// Inicializar MQTT
+esp_err_t hal_mqtt_start(const hal_mqtt_config_t *config,
+                         hal_mqtt_event_cb_t callback) {
+  mqtt_host = config->host;
+  mqtt_host_cached = mqtt_load_broker(config->host);
+  if (mqtt_host_cached)
+    ESP_LOGI(TAG, "Using cached broker address %s", mqtt_cached_host);
+
+  esp_mqtt_client_config_t mqtt_cfg = {
+      .broker.address.hostname =
+          mqtt_host_cached ? mqtt_cached_host : config->host,
+      .broker.address.port = config->port,
+      .broker.address.transport = MQTT_TRANSPORT_OVER_TCP,
+      .credentials.username = config->username,
+      .session.disable_clean_session = config->persistent_session,
+      // Los reintentos los programa el gestor de conectividad
+      .network.disable_auto_reconnect = true,
+      .outbox.limit = config->outbox_limit,
+  };
+
+  // El transporte propio reanuda la sesión TLS y verifica el certificado
+  // contra el nombre del corredor aunque se conecte a la IP guardada. Sin
+  // TLS también se crea aquí, para leer del socket la IP que se guarda.
+  mqtt_tls = config->tls;
+  mqtt_transport = mqtt_tls ? tls_transport_create(config->host)
+                            : esp_transport_tcp_init();
+  if (mqtt_transport == NULL) {
+    ESP_LOGE(TAG, "Failed to create MQTT transport");
+    return ESP_FAIL;
+  }
+  mqtt_cfg.network.transport = mqtt_transport;
+
+  mqtt_callback = callback;
+  mqtt_client = esp_mqtt_client_init(&mqtt_cfg);
+  if (mqtt_client == NULL) {
+    ESP_LOGE(TAG, "Failed to create MQTT client");
+    return ESP_FAIL;
+  }
+  esp_mqtt_client_register_event(mqtt_client, ESP_EVENT_ANY_ID,
+                                 mqtt_event_handler, NULL);
+  return esp_mqtt_client_start(mqtt_client);
+}
+
+int hal_mqtt_publish(const char *topic, const char *data, int len, int qos,
+                     int retain) {
+  if (mqtt_client == NULL) {
+    return -1;
+  }
+  return esp_mqtt_client_publish(mqtt_client, topic, data, len, qos, retain);
+}
+
+int hal_mqtt_subscribe(const char *topic, int qos) {
+  if (mqtt_client == NULL) {
+    return -1;
+  }
+  return esp_mqtt_client_subscribe(mqtt_client, topic, qos);
+}
+
+int hal_mqtt_outbox_size(void) {
+  if (mqtt_client == NULL) {
+    return 0;
+  }
+  return esp_mqtt_client_get_outbox_size(mqtt_client);
+}
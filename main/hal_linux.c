@@ -0,0 +1,730 @@
+/*******************************************************************************
+ * @file        hal_linux.c
+ * @brief       Implementación de la capa de abstracción de hardware para el
+ *              objetivo linux de ESP-IDF: pines y PWM simulados, sensores DHT
+ *              simulados y un cliente MQTT 3.1.1 mínimo sobre sockets POSIX
+ *              para usar un corredor local.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "hal.h"
+#include "boot_utils.h"
+#include "dht11_decode.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "freertos/timers.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+// Modelo de los DHT simulados: valor base más una oscilación lenta
+#ifndef HAL_SIM_TEMPERATURE
+#define HAL_SIM_TEMPERATURE 28.0
+#endif
+
+#ifndef HAL_SIM_HUMIDITY
+#define HAL_SIM_HUMIDITY 60.0
+#endif
+
+#ifndef HAL_SIM_AMPLITUDE
+#define HAL_SIM_AMPLITUDE 5.0
+#endif
+
+#ifndef HAL_SIM_PERIOD_S
+#define HAL_SIM_PERIOD_S 600
+#endif
+
+#define SIM_GPIO_COUNT 40
+#define SIM_PWM_CHANNELS 8
+
+#define SIM_MQTT_CLIENT_ID "proyecto_3_embebidos_sim"
+#define SIM_MQTT_KEEPALIVE_S 60
+#define SIM_MQTT_BUFFER_SIZE 1024
+#define SIM_MQTT_TOPIC_SIZE 128
+#define SIM_MQTT_POLL_MS 10
+#define SIM_MQTT_TASK_STACK 8192
+#define SIM_MQTT_INFLIGHT 64
+
+// Tipos de paquete MQTT 3.1.1
+#define MQTT_PKT_CONNECT 0x10
+#define MQTT_PKT_CONNACK 0x20
+#define MQTT_PKT_PUBLISH 0x30
+#define MQTT_PKT_PUBACK 0x40
+#define MQTT_PKT_SUBSCRIBE 0x82
+#define MQTT_PKT_PINGREQ 0xC0
+
+static const char *TAG = "HAL_LINUX";
+
+static uint8_t gpio_levels[SIM_GPIO_COUNT];
+static uint32_t pwm_duty[SIM_PWM_CHANNELS];
+static uint32_t pwm_freq[SIM_PWM_CHANNELS];
+
+static hal_mqtt_config_t mqtt_config;
+static hal_mqtt_event_cb_t mqtt_callback = NULL;
+static SemaphoreHandle_t mqtt_tx_lock = NULL;
+static int mqtt_sock = -1;
+static bool mqtt_connected = false;
+static uint16_t mqtt_next_id = 1;
+static time_t mqtt_last_tx = 0;
+
+// Mensajes QoS1 enviados y aún sin PUBACK: emulan la bandeja de salida del
+// cliente de la placa (aquí no se retransmiten tras reconectar)
+typedef struct {
+  uint16_t id;
+  uint16_t len;
+} sim_inflight_t;
+
+static sim_inflight_t mqtt_inflight[SIM_MQTT_INFLIGHT];
+static int mqtt_outbox_bytes = 0;
+
+static char mqtt_topic[SIM_MQTT_TOPIC_SIZE];
+static uint8_t mqtt_rx_buffer[SIM_MQTT_BUFFER_SIZE];
+
+void hal_gpio_config_output(uint64_t pin_mask) {
+  for (int i = 0; i < SIM_GPIO_COUNT; i++) {
+    if (pin_mask & (1ULL << i)) {
+      gpio_levels[i] = 0;
+    }
+  }
+}
+
+void hal_gpio_set_level(uint8_t gpio, uint32_t level) {
+  if (gpio >= SIM_GPIO_COUNT)
+    return;
+  gpio_levels[gpio] = level ? 1 : 0;
+  ESP_LOGD(TAG, "GPIO%d -> %d", gpio, gpio_levels[gpio]);
+}
+
+int hal_gpio_get_level(uint8_t gpio) {
+  return gpio < SIM_GPIO_COUNT ? gpio_levels[gpio] : 0;
+}
+
+esp_err_t hal_pwm_init(uint8_t channel, uint8_t gpio, uint32_t freq_hz,
+                       uint8_t duty_resolution_bits) {
+  if (channel >= SIM_PWM_CHANNELS)
+    return ESP_ERR_INVALID_ARG;
+  pwm_duty[channel] = 0;
+  pwm_freq[channel] = freq_hz;
+  ESP_LOGI(TAG, "PWM channel %d on GPIO%d at %luHz (%d bits)", channel, gpio,
+           (unsigned long)freq_hz, duty_resolution_bits);
+  return ESP_OK;
+}
+
+void hal_pwm_set_duty(uint8_t channel, uint32_t duty) {
+  if (channel >= SIM_PWM_CHANNELS)
+    return;
+  pwm_duty[channel] = duty;
+  ESP_LOGD(TAG, "PWM channel %d duty %lu at %lld ms", channel,
+           (unsigned long)duty, (long long)(hal_time_us() / 1000));
+}
+
+esp_err_t hal_pwm_set_freq(uint8_t channel, uint32_t freq_hz) {
+  if (channel >= SIM_PWM_CHANNELS)
+    return ESP_ERR_INVALID_ARG;
+  pwm_freq[channel] = freq_hz;
+  ESP_LOGD(TAG, "PWM channel %d frequency %luHz at %lld ms", channel,
+           (unsigned long)freq_hz, (long long)(hal_time_us() / 1000));
+  return ESP_OK;
+}
+
+// Los temporizadores se simulan con el servicio de timers de FreeRTOS, con
+// la resolución de un tick
+typedef struct {
+  TimerHandle_t handle;
+  hal_timer_cb_t callback;
+  void *arg;
+} sim_timer_t;
+
+static void sim_timer_expired(TimerHandle_t handle) {
+  sim_timer_t *timer = pvTimerGetTimerID(handle);
+  timer->callback(timer->arg);
+}
+
+esp_err_t hal_timer_create(hal_timer_cb_t callback, void *arg,
+                           hal_timer_t *timer) {
+  sim_timer_t *sim = calloc(1, sizeof(*sim));
+  if (sim == NULL)
+    return ESP_ERR_NO_MEM;
+  sim->callback = callback;
+  sim->arg = arg;
+  sim->handle = xTimerCreate("hal_timer", 1, pdFALSE, sim, sim_timer_expired);
+  if (sim->handle == NULL) {
+    free(sim);
+    return ESP_ERR_NO_MEM;
+  }
+  *timer = sim;
+  return ESP_OK;
+}
+
+esp_err_t hal_timer_start_once(hal_timer_t timer, uint64_t timeout_us) {
+  sim_timer_t *sim = timer;
+  TickType_t ticks = pdMS_TO_TICKS(timeout_us / 1000);
+  if (ticks == 0)
+    ticks = 1;
+  return xTimerChangePeriod(sim->handle, ticks, 0) == pdPASS ? ESP_OK
+                                                             : ESP_FAIL;
+}
+
+void hal_timer_stop(hal_timer_t timer) {
+  xTimerStop(((sim_timer_t *)timer)->handle, 0);
+}
+
+static struct {
+  uint8_t gpio;
+  dht_type_t type;
+} sim_dht[HAL_DHT_MAX_SENSORS];
+static size_t sim_dht_count = 0;
+
+esp_err_t hal_dht_init(void) {
+  ESP_LOGI(TAG, "Simulated DHT: %.1f°C, %.1f%% +/- %.1f", HAL_SIM_TEMPERATURE,
+           HAL_SIM_HUMIDITY, HAL_SIM_AMPLITUDE);
+  return ESP_OK;
+}
+
+int hal_dht_add(uint8_t gpio, dht_type_t type) {
+  if (sim_dht_count >= HAL_DHT_MAX_SENSORS)
+    return -1;
+  sim_dht[sim_dht_count].gpio = gpio;
+  sim_dht[sim_dht_count].type = type;
+  ESP_LOGI(TAG, "Simulated %s on GPIO%d",
+           type == DHT_TYPE_DHT22 ? "DHT22" : "DHT11", gpio);
+  return sim_dht_count++;
+}
+
+size_t hal_dht_count(void) { return sim_dht_count; }
+
+// Construir la secuencia de pulsos que el DHT pondría en la línea
+static size_t sim_dht_trace(const uint8_t data[DHT_FRAME_BYTES],
+                            dht_pulse_t *pulses) {
+  size_t n = 0;
+  pulses[n++] = (dht_pulse_t){1, 30}; // liberación de la línea
+  pulses[n++] = (dht_pulse_t){0, 80}; // respuesta del sensor
+  pulses[n++] = (dht_pulse_t){1, 80};
+  for (int i = 0; i < DHT_FRAME_BITS; i++) {
+    bool bit = data[i / 8] & (1 << (7 - (i % 8)));
+    pulses[n++] = (dht_pulse_t){0, 50};
+    pulses[n++] = (dht_pulse_t){1, bit ? 70 : 27};
+  }
+  pulses[n++] = (dht_pulse_t){0, 50};
+  return n;
+}
+
+// Codificar la trama que enviaría un sensor del tipo dado
+static void sim_dht_frame(dht_type_t type, double humidity,
+                          double temperature, uint8_t frame[DHT_FRAME_BYTES]) {
+  int h = (int)lround(humidity * 10);
+  int t = (int)lround(fabs(temperature) * 10);
+
+  if (type == DHT_TYPE_DHT22) {
+    frame[0] = h >> 8;
+    frame[1] = h & 0xFF;
+    frame[2] = ((t >> 8) & 0x7F) | (temperature < 0 ? 0x80 : 0);
+    frame[3] = t & 0xFF;
+  } else {
+    frame[0] = h / 10;
+    frame[1] = h % 10;
+    frame[2] = t / 10;
+    frame[3] = (t % 10) | (temperature < 0 ? 0x80 : 0);
+  }
+  frame[4] = (frame[0] + frame[1] + frame[2] + frame[3]) & 0xFF;
+}
+
+int hal_dht_read_all(hal_dht_reading_t readings[HAL_DHT_MAX_SENSORS]) {
+  struct timespec now;
+  int valid = 0;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  for (size_t i = 0; i < HAL_DHT_MAX_SENSORS; i++) {
+    readings[i].valid = false;
+    if (i >= sim_dht_count)
+      continue;
+
+    // Cada sensor simulado va desfasado para distinguir sus lecturas
+    double phase = 2.0 * M_PI *
+                   ((double)(now.tv_sec % HAL_SIM_PERIOD_S) / HAL_SIM_PERIOD_S +
+                    (double)i / HAL_DHT_MAX_SENSORS);
+    uint8_t frame[DHT_FRAME_BYTES];
+    sim_dht_frame(sim_dht[i].type,
+                  HAL_SIM_HUMIDITY + HAL_SIM_AMPLITUDE * sin(phase),
+                  HAL_SIM_TEMPERATURE + HAL_SIM_AMPLITUDE * cos(phase), frame);
+
+    // Pasar la trama por el mismo decodificador que usa la placa
+    dht_pulse_t pulses[2 * DHT_FRAME_BITS + 4];
+    uint8_t data[DHT_FRAME_BYTES];
+    if (dht_decode_pulses(pulses, sim_dht_trace(frame, pulses), data) !=
+        DHT_DECODE_OK) {
+      ESP_LOGE(TAG, "Simulated DHT frame failed to decode");
+      continue;
+    }
+    dht_decode_values(sim_dht[i].type, data, &readings[i].humidity,
+                      &readings[i].temperature);
+    readings[i].valid = true;
+    valid++;
+  }
+  return valid;
+}
+
+// La red del anfitrión siempre está; el gestor solo espacia los reintentos
+// contra el corredor
+static conn_t net_conn;
+static SemaphoreHandle_t net_lock = NULL;
+
+static void sim_net_event(conn_event_t event, conn_reason_t reason) {
+  xSemaphoreTake(net_lock, portMAX_DELAY);
+  uint8_t attempts = net_conn.attempts;
+  conn_event(&net_conn, event, reason, hal_time_us() / 1000);
+  if (net_conn.state == CONN_STATE_BACKOFF && net_conn.attempts != attempts)
+    ESP_LOGI(TAG, "Reconnecting in %lu ms (attempt %u)",
+             (unsigned long)net_conn.backoff_ms, net_conn.attempts);
+  xSemaphoreGive(net_lock);
+}
+
+// Si ya toca conectar al corredor
+static bool sim_net_should_connect(void) {
+  xSemaphoreTake(net_lock, portMAX_DELAY);
+  conn_poll(&net_conn, hal_time_us() / 1000);
+  bool connect = net_conn.state == CONN_STATE_MQTT_CONNECTING;
+  xSemaphoreGive(net_lock);
+  return connect;
+}
+
+esp_err_t hal_net_init(void) {
+  ESP_LOGI(TAG, "Using host network and clock");
+  net_lock = xSemaphoreCreateMutex();
+  if (net_lock == NULL)
+    return ESP_ERR_NO_MEM;
+  conn_init(&net_conn, (uint32_t)time(NULL));
+  sim_net_event(CONN_EVENT_WIFI_UP, CONN_REASON_NONE);
+  sim_net_event(CONN_EVENT_IP_UP, CONN_REASON_NONE);
+  boot_mark(BOOT_MILESTONE_NET_READY);
+  return ESP_OK;
+}
+
+void hal_net_status(conn_t *status) {
+  xSemaphoreTake(net_lock, portMAX_DELAY);
+  *status = net_conn;
+  xSemaphoreGive(net_lock);
+}
+
+int64_t hal_time_us(void) {
+  // Contar desde la primera llamada, como esp_timer cuenta desde el arranque
+  static int64_t start_us = -1;
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  int64_t now_us = (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+  if (start_us < 0)
+    start_us = now_us;
+  return now_us - start_us;
+}
+
+static bool woke_from_sleep = false;
+
+void hal_deep_sleep(uint64_t duration_us) {
+  ESP_LOGI(TAG, "Simulating deep sleep for %llu ms",
+           (unsigned long long)(duration_us / 1000));
+  vTaskDelay(pdMS_TO_TICKS(duration_us / 1000));
+  woke_from_sleep = true;
+}
+
+bool hal_woke_from_sleep(void) { return woke_from_sleep; }
+
+static void sim_mqtt_emit(hal_mqtt_event_t *event) {
+  if (mqtt_callback != NULL) {
+    mqtt_callback(event);
+  }
+}
+
+static int sim_send(const uint8_t *buf, size_t len) {
+  while (len > 0) {
+    ssize_t sent = send(mqtt_sock, buf, len, MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        vTaskDelay(1);
+        continue;
+      }
+      return -1;
+    }
+    buf += sent;
+    len -= sent;
+  }
+  mqtt_last_tx = time(NULL);
+  return 0;
+}
+
+static int sim_recv(uint8_t *buf, size_t len) {
+  while (len > 0) {
+    ssize_t got = recv(mqtt_sock, buf, len, 0);
+    if (got == 0) {
+      return -1;
+    }
+    if (got < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        vTaskDelay(1);
+        continue;
+      }
+      return -1;
+    }
+    buf += got;
+    len -= got;
+  }
+  return 0;
+}
+
+static size_t sim_encode_length(uint8_t *buf, uint32_t len) {
+  size_t n = 0;
+  do {
+    uint8_t byte = len % 128;
+    len /= 128;
+    buf[n++] = len > 0 ? (byte | 0x80) : byte;
+  } while (len > 0);
+  return n;
+}
+
+static int sim_decode_length(uint32_t *len) {
+  uint32_t multiplier = 1;
+  uint8_t byte;
+  *len = 0;
+  for (int i = 0; i < 4; i++) {
+    if (sim_recv(&byte, 1) != 0)
+      return -1;
+    *len += (byte & 0x7F) * multiplier;
+    if (!(byte & 0x80))
+      return 0;
+    multiplier *= 128;
+  }
+  return -1;
+}
+
+// Enviar encabezado fijo, y luego cada segmento del paquete
+static int sim_send_packet(uint8_t type, const uint8_t *var, size_t var_len,
+                           const uint8_t *payload, size_t payload_len) {
+  uint8_t header[5];
+  header[0] = type;
+  size_t n = 1 + sim_encode_length(&header[1], var_len + payload_len);
+
+  int ret = -1;
+  xSemaphoreTake(mqtt_tx_lock, portMAX_DELAY);
+  if (mqtt_sock >= 0 && sim_send(header, n) == 0 &&
+      sim_send(var, var_len) == 0 &&
+      (payload_len == 0 || sim_send(payload, payload_len) == 0)) {
+    ret = 0;
+  }
+  xSemaphoreGive(mqtt_tx_lock);
+  return ret;
+}
+
+static size_t sim_put_string(uint8_t *buf, const char *str, size_t len) {
+  buf[0] = len >> 8;
+  buf[1] = len & 0xFF;
+  memcpy(&buf[2], str, len);
+  return len + 2;
+}
+
+static uint16_t sim_packet_id(void) {
+  uint16_t id = mqtt_next_id++;
+  if (mqtt_next_id == 0)
+    mqtt_next_id = 1;
+  return id;
+}
+
+static int sim_mqtt_connect(void) {
+  char port[8];
+  struct addrinfo hints = {.ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM};
+  struct addrinfo *res = NULL;
+
+  snprintf(port, sizeof(port), "%u", mqtt_config.port);
+  if (getaddrinfo(mqtt_config.host, port, &hints, &res) != 0) {
+    ESP_LOGE(TAG, "Cannot resolve %s", mqtt_config.host);
+    return -1;
+  }
+
+  int sock = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+  if (sock < 0 || connect(sock, res->ai_addr, res->ai_addrlen) != 0) {
+    freeaddrinfo(res);
+    if (sock >= 0)
+      close(sock);
+    return -1;
+  }
+  freeaddrinfo(res);
+  fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK);
+  mqtt_sock = sock;
+
+  // CONNECT: nombre de protocolo, nivel 4, banderas y keepalive
+  uint8_t var[10 + 2 + sizeof(SIM_MQTT_CLIENT_ID) + 2 + 128];
+  size_t n = sim_put_string(var, "MQTT", 4);
+  var[n++] = 4;
+  var[n++] = (mqtt_config.persistent_session ? 0 : 0x02) | // clean session
+             (mqtt_config.username ? 0x80 : 0);
+  var[n++] = 0;
+  var[n++] = SIM_MQTT_KEEPALIVE_S;
+  n += sim_put_string(&var[n], SIM_MQTT_CLIENT_ID,
+                      strlen(SIM_MQTT_CLIENT_ID));
+  if (mqtt_config.username) {
+    size_t user_len = strnlen(mqtt_config.username, 128);
+    n += sim_put_string(&var[n], mqtt_config.username, user_len);
+  }
+
+  return sim_send_packet(MQTT_PKT_CONNECT, var, n, NULL, 0);
+}
+
+// Reservar un lugar en la bandeja; false si está llena
+static bool sim_inflight_add(uint16_t id, size_t len) {
+  bool added = false;
+
+  xSemaphoreTake(mqtt_tx_lock, portMAX_DELAY);
+  if (mqtt_config.outbox_limit == 0 ||
+      mqtt_outbox_bytes + len <= mqtt_config.outbox_limit) {
+    for (int i = 0; i < SIM_MQTT_INFLIGHT && !added; i++) {
+      if (mqtt_inflight[i].id != 0)
+        continue;
+      mqtt_inflight[i] = (sim_inflight_t){id, len};
+      mqtt_outbox_bytes += len;
+      added = true;
+    }
+  }
+  xSemaphoreGive(mqtt_tx_lock);
+  return added;
+}
+
+static void sim_inflight_remove(uint16_t id) {
+  xSemaphoreTake(mqtt_tx_lock, portMAX_DELAY);
+  for (int i = 0; i < SIM_MQTT_INFLIGHT; i++) {
+    if (mqtt_inflight[i].id == id) {
+      mqtt_outbox_bytes -= mqtt_inflight[i].len;
+      mqtt_inflight[i].id = 0;
+      break;
+    }
+  }
+  xSemaphoreGive(mqtt_tx_lock);
+}
+
+static void sim_mqtt_close(void) {
+  xSemaphoreTake(mqtt_tx_lock, portMAX_DELAY);
+  if (mqtt_sock >= 0) {
+    close(mqtt_sock);
+    mqtt_sock = -1;
+  }
+  memset(mqtt_inflight, 0, sizeof(mqtt_inflight));
+  mqtt_outbox_bytes = 0;
+  xSemaphoreGive(mqtt_tx_lock);
+
+  if (mqtt_connected) {
+    mqtt_connected = false;
+    hal_mqtt_event_t event = {.event_id = HAL_MQTT_EVENT_DISCONNECTED};
+    sim_mqtt_emit(&event);
+  }
+}
+
+// Entregar un PUBLISH entrante en fragmentos del tamaño del búfer
+static int sim_mqtt_handle_publish(uint8_t flags, uint32_t remaining) {
+  uint8_t buf[2];
+  int qos = (flags >> 1) & 0x03;
+
+  if (sim_recv(buf, 2) != 0)
+    return -1;
+  uint16_t topic_len = (buf[0] << 8) | buf[1];
+  if (topic_len >= SIM_MQTT_TOPIC_SIZE ||
+      sim_recv((uint8_t *)mqtt_topic, topic_len) != 0)
+    return -1;
+  mqtt_topic[topic_len] = 0;
+  remaining -= 2 + topic_len;
+
+  uint16_t packet_id = 0;
+  if (qos > 0) {
+    if (sim_recv(buf, 2) != 0)
+      return -1;
+    packet_id = (buf[0] << 8) | buf[1];
+    remaining -= 2;
+  }
+
+  hal_mqtt_event_t event = {
+      .event_id = HAL_MQTT_EVENT_DATA,
+      .topic = mqtt_topic,
+      .topic_len = topic_len,
+      .total_data_len = remaining,
+  };
+
+  uint32_t offset = 0;
+  do {
+    uint32_t chunk = remaining - offset;
+    if (chunk > SIM_MQTT_BUFFER_SIZE)
+      chunk = SIM_MQTT_BUFFER_SIZE;
+    if (sim_recv(mqtt_rx_buffer, chunk) != 0)
+      return -1;
+    event.data = (const char *)mqtt_rx_buffer;
+    event.data_len = chunk;
+    event.current_data_offset = offset;
+    sim_mqtt_emit(&event);
+
+    // Igual que esp-mqtt, el tópico solo viaja en el primer fragmento
+    event.topic = NULL;
+    event.topic_len = 0;
+    offset += chunk;
+  } while (offset < remaining);
+
+  if (qos == 1) {
+    buf[0] = packet_id >> 8;
+    buf[1] = packet_id & 0xFF;
+    return sim_send_packet(MQTT_PKT_PUBACK, buf, 2, NULL, 0);
+  }
+  return 0;
+}
+
+static int sim_mqtt_handle_packet(void) {
+  uint8_t type;
+  uint32_t remaining;
+
+  if (sim_recv(&type, 1) != 0 || sim_decode_length(&remaining) != 0)
+    return -1;
+
+  if ((type & 0xF0) == MQTT_PKT_PUBLISH) {
+    return sim_mqtt_handle_publish(type & 0x0F, remaining);
+  }
+
+  // El resto de paquetes cabe en el búfer y solo interesa el CONNACK
+  if (remaining > SIM_MQTT_BUFFER_SIZE ||
+      sim_recv(mqtt_rx_buffer, remaining) != 0)
+    return -1;
+
+  if (type == MQTT_PKT_PUBACK && remaining >= 2) {
+    sim_inflight_remove((mqtt_rx_buffer[0] << 8) | mqtt_rx_buffer[1]);
+    return 0;
+  }
+
+  if (type == MQTT_PKT_CONNACK) {
+    if (remaining < 2 || mqtt_rx_buffer[1] != 0) {
+      ESP_LOGE(TAG, "Broker refused connection");
+      sim_net_event(CONN_EVENT_MQTT_DOWN, CONN_REASON_MQTT_REFUSED);
+      hal_mqtt_event_t event = {.event_id = HAL_MQTT_EVENT_ERROR};
+      sim_mqtt_emit(&event);
+      return -1;
+    }
+    mqtt_connected = true;
+    sim_net_event(CONN_EVENT_MQTT_UP, CONN_REASON_NONE);
+    hal_mqtt_event_t event = {
+        .event_id = HAL_MQTT_EVENT_CONNECTED,
+        .session_present = mqtt_rx_buffer[0] & 0x01,
+    };
+    sim_mqtt_emit(&event);
+  }
+  return 0;
+}
+
+static void sim_mqtt_task(void *pvParameters) {
+  while (1) {
+    if (mqtt_sock < 0) {
+      if (!sim_net_should_connect()) {
+        vTaskDelay(pdMS_TO_TICKS(SIM_MQTT_POLL_MS));
+        continue;
+      }
+      if (sim_mqtt_connect() != 0) {
+        sim_mqtt_close();
+        sim_net_event(CONN_EVENT_MQTT_DOWN, CONN_REASON_MQTT_TRANSPORT);
+        continue;
+      }
+    }
+
+    // Revisar sin bloquear si hay datos, para no detener el planificador
+    uint8_t peek;
+    ssize_t got = recv(mqtt_sock, &peek, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      if (mqtt_connected &&
+          time(NULL) - mqtt_last_tx >= SIM_MQTT_KEEPALIVE_S / 2) {
+        sim_send_packet(MQTT_PKT_PINGREQ, NULL, 0, NULL, 0);
+      }
+      vTaskDelay(pdMS_TO_TICKS(SIM_MQTT_POLL_MS));
+      continue;
+    }
+
+    if (got <= 0 || sim_mqtt_handle_packet() != 0) {
+      ESP_LOGW(TAG, "Connection to %s lost", mqtt_config.host);
+      sim_mqtt_close();
+      sim_net_event(CONN_EVENT_MQTT_DOWN, CONN_REASON_MQTT_TRANSPORT);
+    }
+  }
+}
+
+esp_err_t hal_mqtt_start(const hal_mqtt_config_t *config,
+                         hal_mqtt_event_cb_t callback) {
+  mqtt_config = *config;
+  mqtt_callback = callback;
+  mqtt_tx_lock = xSemaphoreCreateMutex();
+  if (mqtt_tx_lock == NULL) {
+    return ESP_ERR_NO_MEM;
+  }
+
+  ESP_LOGI(TAG, "Simulated MQTT client -> %s:%u", config->host, config->port);
+  if (config->tls)
+    ESP_LOGW(TAG, "TLS not available on linux target, using plain TCP");
+  if (xTaskCreate(sim_mqtt_task, "sim_mqtt", SIM_MQTT_TASK_STACK, NULL, 5,
+                  NULL) != pdPASS) {
+    return ESP_ERR_NO_MEM;
+  }
+  return ESP_OK;
+}
+
+int hal_mqtt_publish(const char *topic, const char *data, int len, int qos,
+                     int retain) {
+  if (!mqtt_connected) {
+    return -1;
+  }
+  if (len == 0) {
+    len = strlen(data);
+  }
+
+  uint8_t var[2 + SIM_MQTT_TOPIC_SIZE + 2];
+  size_t topic_len = strnlen(topic, SIM_MQTT_TOPIC_SIZE);
+  size_t n = sim_put_string(var, topic, topic_len);
+  int msg_id = 0;
+  if (qos > 0) {
+    msg_id = sim_packet_id();
+    // Igual que esp-mqtt, -2 indica la bandeja llena
+    if (!sim_inflight_add(msg_id, len)) {
+      return -2;
+    }
+    var[n++] = msg_id >> 8;
+    var[n++] = msg_id & 0xFF;
+  }
+
+  uint8_t type = MQTT_PKT_PUBLISH | ((qos & 0x03) << 1) | (retain ? 1 : 0);
+  if (sim_send_packet(type, var, n, (const uint8_t *)data, len) != 0) {
+    if (qos > 0) {
+      sim_inflight_remove(msg_id);
+    }
+    return -1;
+  }
+  return msg_id;
+}
+
+int hal_mqtt_outbox_size(void) { return mqtt_outbox_bytes; }
+
+int hal_mqtt_subscribe(const char *topic, int qos) {
+  if (!mqtt_connected) {
+    return -1;
+  }
+
+  uint8_t var[2 + 2 + SIM_MQTT_TOPIC_SIZE + 1];
+  int msg_id = sim_packet_id();
+  var[0] = msg_id >> 8;
+  var[1] = msg_id & 0xFF;
+  size_t topic_len = strnlen(topic, SIM_MQTT_TOPIC_SIZE);
+  size_t n = 2 + sim_put_string(&var[2], topic, topic_len);
+  var[n++] = qos & 0x03;
+
+  if (sim_send_packet(MQTT_PKT_SUBSCRIBE, var, n, NULL, 0) != 0) {
+    return -1;
+  }
+  return msg_id;
+}
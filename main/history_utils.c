@@ -0,0 +1,411 @@
+/*******************************************************************************
+ * @file        history_utils.c
+ * @brief       Historial local en tres resoluciones con cubetas persistentes.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "history_utils.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "nvs.h"
+#include <math.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HISTORY_NVS_NAMESPACE "history"
+#define HISTORY_FORMAT_VERSION 1
+
+// Bytes reservados para cerrar la respuesta: ],"next":<índice>}
+#define HISTORY_TAIL_SIZE 24
+
+// Valores en décimas, igual que los filtros
+typedef struct {
+  uint32_t mono_s;
+  int16_t temperature;
+  uint16_t humidity;
+} history_raw_t;
+
+typedef struct {
+  uint32_t start_s; // epoch del inicio del periodo
+  uint16_t count;
+  int16_t t_min;
+  int16_t t_max;
+  uint16_t h_min;
+  uint16_t h_max;
+  int32_t t_sum;
+  uint32_t h_sum;
+} history_bucket_t;
+
+// Anillo de cubetas cerradas más la cubeta en curso; es lo que se guarda
+typedef struct {
+  uint16_t version;
+  uint16_t head; // la más antigua
+  uint16_t count;
+  history_bucket_t open; // count 0 si no hay
+} history_meta_t;
+
+typedef struct {
+  const char *name;
+  uint32_t period_s;
+  history_bucket_t *buckets;
+  uint16_t capacity;
+  history_meta_t meta;
+} history_ring_t;
+
+static const char *TAG = "HISTORY";
+
+static history_raw_t raw[HISTORY_RAW_SIZE];
+static size_t raw_head = 0;
+static size_t raw_count = 0;
+
+// Minutos cerrados desde la última escritura en NVS
+static unsigned minutes_unsaved = 0;
+
+static history_bucket_t minute_buckets[HISTORY_MINUTE_SIZE];
+static history_bucket_t hour_buckets[HISTORY_HOUR_SIZE];
+static history_ring_t minutes = {
+    .name = "minute",
+    .period_s = 60,
+    .buckets = minute_buckets,
+    .capacity = HISTORY_MINUTE_SIZE,
+    .meta.version = HISTORY_FORMAT_VERSION,
+};
+static history_ring_t hours = {
+    .name = "hour",
+    .period_s = 3600,
+    .buckets = hour_buckets,
+    .capacity = HISTORY_HOUR_SIZE,
+    .meta.version = HISTORY_FORMAT_VERSION,
+};
+
+// Protege el historial: lo escribe la tarea de control y lo lee la RPC
+static SemaphoreHandle_t history_lock = NULL;
+
+static const char *const tier_names[HISTORY_TIER_COUNT] = {
+    [HISTORY_TIER_RAW] = "raw",
+    [HISTORY_TIER_MINUTE] = "minute",
+    [HISTORY_TIER_HOUR] = "hour",
+};
+
+/* ------------------------------- Persistencia ----------------------------- */
+
+// Cada nivel se guarda como dos blobs: el anillo y su estado
+static void history_save(const history_ring_t *ring) {
+  char key[16];
+  nvs_handle_t nvs;
+
+  if (nvs_open(HISTORY_NVS_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK)
+    return;
+  snprintf(key, sizeof(key), "%s_meta", ring->name);
+  esp_err_t ret = nvs_set_blob(nvs, ring->name, ring->buckets,
+                               ring->capacity * sizeof(history_bucket_t));
+  if (ret == ESP_OK)
+    ret = nvs_set_blob(nvs, key, &ring->meta, sizeof(ring->meta));
+  if (ret == ESP_OK)
+    ret = nvs_commit(nvs);
+  nvs_close(nvs);
+  if (ret != ESP_OK)
+    ESP_LOGW(TAG, "Failed to save %s history: %s", ring->name,
+             esp_err_to_name(ret));
+}
+
+static void history_load(nvs_handle_t nvs, history_ring_t *ring) {
+  char key[16];
+  history_meta_t meta;
+  size_t size = sizeof(meta);
+
+  snprintf(key, sizeof(key), "%s_meta", ring->name);
+  if (nvs_get_blob(nvs, key, &meta, &size) != ESP_OK ||
+      size != sizeof(meta) || meta.version != HISTORY_FORMAT_VERSION ||
+      meta.head >= ring->capacity || meta.count > ring->capacity)
+    return;
+
+  // Un cambio de capacidad invalida lo guardado
+  size = ring->capacity * sizeof(history_bucket_t);
+  if (nvs_get_blob(nvs, ring->name, ring->buckets, &size) != ESP_OK ||
+      size != ring->capacity * sizeof(history_bucket_t)) {
+    memset(ring->buckets, 0, ring->capacity * sizeof(history_bucket_t));
+    return;
+  }
+  ring->meta = meta;
+}
+
+static void history_reset(history_ring_t *ring) {
+  memset(ring->buckets, 0, ring->capacity * sizeof(history_bucket_t));
+  ring->meta = (history_meta_t){.version = HISTORY_FORMAT_VERSION};
+}
+
+esp_err_t history_init(void) {
+  nvs_handle_t nvs;
+
+  if (history_lock == NULL)
+    history_lock = xSemaphoreCreateMutex();
+  if (history_lock == NULL)
+    return ESP_ERR_NO_MEM;
+
+  // Como tras un reinicio: el anillo crudo solo vive en RAM y las cubetas
+  // son las que se guardaron
+  raw_head = 0;
+  raw_count = 0;
+  minutes_unsaved = 0;
+  history_reset(&minutes);
+  history_reset(&hours);
+  if (nvs_open(HISTORY_NVS_NAMESPACE, NVS_READONLY, &nvs) == ESP_OK) {
+    history_load(nvs, &minutes);
+    history_load(nvs, &hours);
+    nvs_close(nvs);
+  }
+  ESP_LOGI(TAG, "Restored %u minute and %u hour buckets",
+           minutes.meta.count, hours.meta.count);
+  return ESP_OK;
+}
+
+/* ------------------------------- Actualización ---------------------------- */
+
+static void history_bucket_merge(history_bucket_t *into,
+                                 const history_bucket_t *from) {
+  if (from->count == 0)
+    return;
+  if (into->count == 0) {
+    uint32_t start_s = into->start_s;
+    *into = *from;
+    into->start_s = start_s;
+    return;
+  }
+  into->t_min = from->t_min < into->t_min ? from->t_min : into->t_min;
+  into->t_max = from->t_max > into->t_max ? from->t_max : into->t_max;
+  into->h_min = from->h_min < into->h_min ? from->h_min : into->h_min;
+  into->h_max = from->h_max > into->h_max ? from->h_max : into->h_max;
+  into->t_sum += from->t_sum;
+  into->h_sum += from->h_sum;
+  into->count += from->count;
+}
+
+// Cerrar la cubeta en curso si epoch_s cae en otro periodo; retorna la
+// cubeta cerrada o NULL
+static const history_bucket_t *history_roll(history_ring_t *ring,
+                                            uint32_t epoch_s) {
+  history_meta_t *meta = &ring->meta;
+  uint32_t start_s = epoch_s - epoch_s % ring->period_s;
+  const history_bucket_t *closed = NULL;
+
+  // Un reloj que retrocede (ajuste de SNTP) se queda en la cubeta actual
+  if (meta->open.count == 0 || start_s <= meta->open.start_s) {
+    if (meta->open.count == 0)
+      meta->open.start_s = start_s;
+    return NULL;
+  }
+
+  size_t slot = (meta->head + meta->count) % ring->capacity;
+  ring->buckets[slot] = meta->open;
+  closed = &ring->buckets[slot];
+  if (meta->count < ring->capacity)
+    meta->count++;
+  else
+    meta->head = (meta->head + 1) % ring->capacity;
+
+  meta->open = (history_bucket_t){.start_s = start_s};
+  return closed;
+}
+
+void history_add(int64_t mono_ms, int64_t epoch_ms, float temperature,
+                 float humidity) {
+  int16_t t = lroundf(temperature * 10);
+  uint16_t h = lroundf(humidity * 10);
+
+  if (history_lock == NULL)
+    return;
+  xSemaphoreTake(history_lock, portMAX_DELAY);
+
+  raw[(raw_head + raw_count) % HISTORY_RAW_SIZE] =
+      (history_raw_t){mono_ms / 1000, t, h};
+  if (raw_count < HISTORY_RAW_SIZE)
+    raw_count++;
+  else
+    raw_head = (raw_head + 1) % HISTORY_RAW_SIZE;
+
+  if (epoch_ms != 0) {
+    uint32_t epoch_s = epoch_ms / 1000;
+    history_bucket_t sample = {
+        .count = 1, .t_min = t, .t_max = t, .h_min = h, .h_max = h,
+        .t_sum = t, .h_sum = h,
+    };
+
+    // Cada minuto cerrado se acumula en la hora. Ambos niveles se guardan
+    // juntos, al cerrar una hora o cada HISTORY_SAVE_MINUTES minutos, para
+    // que la hora en curso restaurada coincida con los minutos
+    const history_bucket_t *minute = history_roll(&minutes, epoch_s);
+    if (minute != NULL) {
+      bool hour_closed = history_roll(&hours, minute->start_s) != NULL;
+      history_bucket_merge(&hours.meta.open, minute);
+      if (hour_closed || ++minutes_unsaved >= HISTORY_SAVE_MINUTES) {
+        history_save(&minutes);
+        history_save(&hours);
+        minutes_unsaved = 0;
+      }
+    }
+    history_bucket_merge(&minutes.meta.open, &sample);
+  }
+
+  xSemaphoreGive(history_lock);
+}
+
+/* --------------------------------- Consulta ------------------------------- */
+
+int history_tier_parse(const char *name, size_t len) {
+  for (int i = 0; i < HISTORY_TIER_COUNT; i++) {
+    if (strlen(tier_names[i]) == len && memcmp(tier_names[i], name, len) == 0)
+      return i;
+  }
+  return -1;
+}
+
+static bool history_append(char *buf, size_t size, size_t *len,
+                           const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(buf + *len, size - *len, fmt, args);
+  va_end(args);
+  if (n < 0 || *len + n >= size)
+    return false;
+  *len += n;
+  return true;
+}
+
+// Décimas con aritmética entera, igual que el codificador JSON
+static bool history_append_tenths(char *buf, size_t size, size_t *len,
+                                  const char *prefix, int32_t tenths) {
+  return history_append(buf, size, len, "%s%s%ld.%ld", prefix,
+                        tenths < 0 ? "-" : "", labs(tenths) / 10,
+                        labs(tenths) % 10);
+}
+
+static bool history_append_bucket(char *buf, size_t size, size_t *len,
+                                  const history_bucket_t *bucket) {
+  int32_t t_avg = lroundf((float)bucket->t_sum / bucket->count);
+  int32_t h_avg = lroundf((float)bucket->h_sum / bucket->count);
+
+  return history_append(buf, size, len, "{\"ts\":%lld,\"n\":%u",
+                        (long long)bucket->start_s * 1000, bucket->count) &&
+         history_append_tenths(buf, size, len, ",\"t\":[", bucket->t_min) &&
+         history_append_tenths(buf, size, len, ",", t_avg) &&
+         history_append_tenths(buf, size, len, ",", bucket->t_max) &&
+         history_append_tenths(buf, size, len, "],\"h\":[", bucket->h_min) &&
+         history_append_tenths(buf, size, len, ",", h_avg) &&
+         history_append_tenths(buf, size, len, ",", bucket->h_max) &&
+         history_append(buf, size, len, "]}");
+}
+
+static bool history_append_raw(char *buf, size_t size, size_t *len,
+                               const history_raw_t *sample,
+                               int64_t epoch_offset_ms) {
+  int64_t mono_ms = (int64_t)sample->mono_s * 1000;
+
+  // Sin hora válida se informa el reloj monotónico
+  return (epoch_offset_ms != 0
+              ? history_append(buf, size, len, "{\"ts\":%lld",
+                               (long long)(mono_ms + epoch_offset_ms))
+              : history_append(buf, size, len, "{\"mono\":%lld",
+                               (long long)mono_ms)) &&
+         history_append_tenths(buf, size, len, ",\"t\":",
+                               sample->temperature) &&
+         history_append_tenths(buf, size, len, ",\"h\":", sample->humidity) &&
+         history_append(buf, size, len, "}");
+}
+
+// Cubetas en curso de un nivel, que van después de las cerradas. La hora
+// en curso incluye el minuto que aún no se ha cerrado; si ese minuto ya
+// empieza otra hora, esa hora va como una cubeta nueva después de la otra.
+static size_t history_open_buckets(const history_ring_t *ring,
+                                   history_bucket_t out[2]) {
+  size_t n = 0;
+
+  if (ring->meta.open.count != 0)
+    out[n++] = ring->meta.open;
+  if (ring == &hours && minutes.meta.open.count != 0) {
+    uint32_t start_s = minutes.meta.open.start_s -
+                       minutes.meta.open.start_s % hours.period_s;
+    if (n == 0 || out[n - 1].start_s != start_s)
+      out[n++] = (history_bucket_t){.start_s = start_s};
+    history_bucket_merge(&out[n - 1], &minutes.meta.open);
+  }
+  return n;
+}
+
+static size_t history_bucket_total(const history_ring_t *ring) {
+  history_bucket_t open[2];
+  return ring->meta.count + history_open_buckets(ring, open);
+}
+
+// Cubeta index-ésima de un nivel, contando las que están en curso al final
+static bool history_bucket_at(const history_ring_t *ring, size_t index,
+                              history_bucket_t *out) {
+  const history_meta_t *meta = &ring->meta;
+  history_bucket_t open[2];
+
+  if (index < meta->count) {
+    *out = ring->buckets[(meta->head + index) % ring->capacity];
+    return true;
+  }
+  if (index - meta->count >= history_open_buckets(ring, open))
+    return false;
+  *out = open[index - meta->count];
+  return true;
+}
+
+int history_format(history_tier_t tier, size_t from, size_t limit,
+                   int64_t epoch_offset_ms, char *buf, size_t size) {
+  size_t len = 0;
+  size_t total;
+  size_t index = from;
+
+  if (tier >= HISTORY_TIER_COUNT || size <= HISTORY_TAIL_SIZE ||
+      history_lock == NULL)
+    return 0;
+  xSemaphoreTake(history_lock, portMAX_DELAY);
+
+  const history_ring_t *ring = tier == HISTORY_TIER_MINUTE ? &minutes : &hours;
+  total = tier == HISTORY_TIER_RAW ? raw_count : history_bucket_total(ring);
+
+  // Cada elemento se escribe directo en la respuesta; al no caber el
+  // siguiente se corta la página y se indica desde dónde seguir
+  bool ok = history_append(buf, size, &len,
+                           "{\"tier\":\"%s\",\"total\":%u,\"from\":%u,"
+                           "\"items\":[",
+                           tier_names[tier], (unsigned)total, (unsigned)from);
+  for (; ok && index < total && index - from < limit; index++) {
+    size_t mark = len;
+    size_t room = size - HISTORY_TAIL_SIZE;
+    bool fits = history_append(buf, room, &len, index > from ? "," : "");
+
+    if (tier == HISTORY_TIER_RAW) {
+      fits = fits &&
+             history_append_raw(buf, room, &len,
+                                &raw[(raw_head + index) % HISTORY_RAW_SIZE],
+                                epoch_offset_ms);
+    } else {
+      history_bucket_t bucket;
+      fits = fits && history_bucket_at(ring, index, &bucket) &&
+             history_append_bucket(buf, room, &len, &bucket);
+    }
+    if (!fits) {
+      len = mark;
+      break;
+    }
+  }
+  xSemaphoreGive(history_lock);
+
+  if (!ok || (index == from && from < total))
+    return 0;
+  ok = index < total
+           ? history_append(buf, size, &len, "],\"next\":%u}", (unsigned)index)
+           : history_append(buf, size, &len, "],\"next\":null}");
+  return ok ? len : 0;
+}
@@ -0,0 +1,227 @@
+/*******************************************************************************
+ * @file        http_utils.c
+ * @brief       Servidor HTTP local con /metrics y difusión por WebSocket.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "http_utils.h"
+#include "sdkconfig.h"
+
+#if CONFIG_HTTPD_WS_SUPPORT
+
+#include "esp_http_server.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "log_utils.h"
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+
+#define HTTP_WS_RX_SIZE 128
+
+// Trama compartida por todos los clientes: se codifica una vez y se libera
+// cuando el último envío termina
+typedef struct {
+  atomic_int refs;
+  size_t len;
+  char data[HTTP_FRAME_SIZE];
+} http_frame_t;
+
+typedef struct {
+  int fd; // -1 si la ranura está libre
+  int pending; // tramas encoladas sin confirmar
+} http_client_t;
+
+static const char *TAG = "HTTP";
+
+static httpd_handle_t server = NULL;
+static http_metrics_fn_t metrics_fn = NULL;
+static char metrics_buf[HTTP_METRICS_SIZE]; // solo la usa la tarea httpd
+
+static http_frame_t frames[HTTP_FRAME_SLOTS];
+static http_client_t clients[HTTP_WS_MAX_CLIENTS];
+static atomic_int client_count;
+static SemaphoreHandle_t clients_lock = NULL;
+
+static http_client_t *http_client_find(int fd) {
+  for (int i = 0; i < HTTP_WS_MAX_CLIENTS; i++) {
+    if (clients[i].fd == fd)
+      return &clients[i];
+  }
+  return NULL;
+}
+
+static void http_client_remove(int fd) {
+  xSemaphoreTake(clients_lock, portMAX_DELAY);
+  http_client_t *client = http_client_find(fd);
+  if (client != NULL) {
+    client->fd = -1;
+    atomic_fetch_sub(&client_count, 1);
+  }
+  xSemaphoreGive(clients_lock);
+}
+
+static esp_err_t http_metrics_handler(httpd_req_t *req) {
+  int len = metrics_fn != NULL ? metrics_fn(metrics_buf, sizeof(metrics_buf))
+                               : 0;
+  if (len <= 0)
+    return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, NULL);
+
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+  return httpd_resp_send(req, metrics_buf, len);
+}
+
+static esp_err_t http_ws_handler(httpd_req_t *req) {
+  int fd = httpd_req_to_sockfd(req);
+
+  // El saludo ya se completó; registrar al cliente o rechazarlo
+  if (req->method == HTTP_GET) {
+    xSemaphoreTake(clients_lock, portMAX_DELAY);
+    http_client_t *client = http_client_find(-1);
+    if (client != NULL) {
+      *client = (http_client_t){fd, 0};
+      atomic_fetch_add(&client_count, 1);
+    }
+    xSemaphoreGive(clients_lock);
+    if (client == NULL) {
+      DLOGW(TAG, "WebSocket client rejected, %d connected",
+            HTTP_WS_MAX_CLIENTS);
+      return ESP_FAIL;
+    }
+    DLOGI(TAG, "WebSocket client %d connected", fd);
+    return ESP_OK;
+  }
+
+  // Los clientes solo escuchan; descartar lo que envíen
+  uint8_t rx[HTTP_WS_RX_SIZE];
+  httpd_ws_frame_t frame = {.payload = rx};
+  esp_err_t ret = httpd_ws_recv_frame(req, &frame, 0);
+  if (ret != ESP_OK || frame.len > sizeof(rx))
+    return ESP_FAIL;
+  return httpd_ws_recv_frame(req, &frame, frame.len);
+}
+
+static void http_close(httpd_handle_t handle, int fd) {
+  http_client_remove(fd);
+  close(fd);
+}
+
+static void http_send_done(esp_err_t err, int fd, void *arg) {
+  http_frame_t *frame = arg;
+
+  xSemaphoreTake(clients_lock, portMAX_DELAY);
+  http_client_t *client = http_client_find(fd);
+  if (client != NULL && client->pending > 0)
+    client->pending--;
+  xSemaphoreGive(clients_lock);
+  atomic_fetch_sub(&frame->refs, 1);
+}
+
+esp_err_t http_init(http_metrics_fn_t metrics) {
+  httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+  config.server_port = HTTP_PORT;
+  config.max_open_sockets = HTTP_WS_MAX_CLIENTS + 2; // y /metrics
+  config.lru_purge_enable = true;
+  config.close_fn = http_close;
+
+  metrics_fn = metrics;
+  for (int i = 0; i < HTTP_WS_MAX_CLIENTS; i++)
+    clients[i].fd = -1;
+  clients_lock = xSemaphoreCreateMutex();
+  if (clients_lock == NULL)
+    return ESP_ERR_NO_MEM;
+
+  esp_err_t ret = httpd_start(&server, &config);
+  if (ret != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to start HTTP server: %s", esp_err_to_name(ret));
+    return ret;
+  }
+
+  static const httpd_uri_t metrics_uri = {
+      .uri = "/metrics",
+      .method = HTTP_GET,
+      .handler = http_metrics_handler,
+  };
+  static const httpd_uri_t ws_uri = {
+      .uri = "/ws",
+      .method = HTTP_GET,
+      .handler = http_ws_handler,
+      .is_websocket = true,
+  };
+  httpd_register_uri_handler(server, &metrics_uri);
+  httpd_register_uri_handler(server, &ws_uri);
+  ESP_LOGI(TAG, "HTTP server on port %d: /metrics, /ws", HTTP_PORT);
+  return ESP_OK;
+}
+
+int http_client_count(void) { return atomic_load(&client_count); }
+
+void http_broadcast(const char *data, size_t len) {
+  http_frame_t *frame = NULL;
+  int slow[HTTP_WS_MAX_CLIENTS];
+  int slow_count = 0;
+
+  if (server == NULL || len > HTTP_FRAME_SIZE || http_client_count() == 0)
+    return;
+
+  // Una trama libre es la que ya ningún envío referencia
+  for (int i = 0; i < HTTP_FRAME_SLOTS && frame == NULL; i++) {
+    int expected = 0;
+    if (atomic_compare_exchange_strong(&frames[i].refs, &expected, 1))
+      frame = &frames[i];
+  }
+  if (frame == NULL) {
+    DLOGW(TAG, "All frames in flight, sample not streamed");
+    return;
+  }
+  memcpy(frame->data, data, len);
+  frame->len = len;
+
+  httpd_ws_frame_t ws = {
+      .final = true,
+      .type = HTTPD_WS_TYPE_TEXT,
+      .payload = (uint8_t *)frame->data,
+      .len = frame->len,
+  };
+
+  xSemaphoreTake(clients_lock, portMAX_DELAY);
+  for (int i = 0; i < HTTP_WS_MAX_CLIENTS; i++) {
+    http_client_t *client = &clients[i];
+    if (client->fd < 0)
+      continue;
+
+    // Un cliente que no vacía sus tramas se desconecta en lugar de
+    // acumular memoria o retener las tramas compartidas
+    if (client->pending >= HTTP_WS_MAX_PENDING) {
+      slow[slow_count++] = client->fd;
+      continue;
+    }
+    atomic_fetch_add(&frame->refs, 1);
+    if (httpd_ws_send_data_async(server, client->fd, &ws, http_send_done,
+                                 frame) == ESP_OK) {
+      client->pending++;
+    } else {
+      atomic_fetch_sub(&frame->refs, 1);
+    }
+  }
+  xSemaphoreGive(clients_lock);
+  atomic_fetch_sub(&frame->refs, 1);
+
+  for (int i = 0; i < slow_count; i++) {
+    DLOGW(TAG, "WebSocket client %d too slow, closing", slow[i]);
+    httpd_sess_trigger_close(server, slow[i]);
+  }
+}
+
+#else
+
+esp_err_t http_init(http_metrics_fn_t metrics) { return ESP_ERR_NOT_SUPPORTED; }
+int http_client_count(void) { return 0; }
+void http_broadcast(const char *data, size_t len) {}
+
+#endif // CONFIG_HTTPD_WS_SUPPORT
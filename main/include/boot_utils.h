@@ -0,0 +1,38 @@
+/*******************************************************************************
+ * @file        boot_utils.h
+ * @brief       Marcas de tiempo de los hitos del arranque, desde el inicio de
+ *              la aplicación hasta la primera telemetría publicada.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#ifndef BOOT_UTILS_H
+#define BOOT_UTILS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef FIRMWARE_VERSION
+#define FIRMWARE_VERSION "1.0.0"
+#endif
+
+typedef enum {
+  BOOT_MILESTONE_APP_START,
+  BOOT_MILESTONE_NET_READY,
+  BOOT_MILESTONE_MQTT_CONNECTED,
+  BOOT_MILESTONE_FIRST_TELEMETRY,
+  BOOT_MILESTONE_COUNT,
+} boot_milestone_t;
+
+// Registrar un hito; solo cuenta la primera vez que se alcanza
+void boot_mark(boot_milestone_t milestone);
+bool boot_reached(boot_milestone_t milestone);
+// Indicar si la red se levantó con los datos guardados en NVS
+void boot_set_fast_path(bool fast_path);
+// Formatear los hitos como telemetría JSON; retorna la longitud o 0
+int boot_format_report(char *buf, size_t size);
+
+#endif // BOOT_UTILS_H
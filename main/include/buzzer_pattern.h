@@ -0,0 +1,42 @@
+/*******************************************************************************
+ * @file        buzzer_pattern.h
+ * @brief       Secuenciador de patrones del buzzer a partir de tablas de pasos
+ *              (frecuencia, ciclo de trabajo, duración). No depende del
+ *              hardware: buzzer_utils.c aplica cada paso desde un temporizador.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#ifndef BUZZER_PATTERN_H
+#define BUZZER_PATTERN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+  uint16_t freq_hz;
+  uint16_t duty;        // en la resolución del PWM; 0 es silencio
+  uint16_t duration_ms; // 0 mantiene el paso indefinidamente
+} buzzer_step_t;
+
+typedef struct {
+  const buzzer_step_t *steps;
+  uint8_t count;
+  uint8_t repeat; // veces que se reproduce la tabla; 0 repite sin fin
+} buzzer_pattern_t;
+
+typedef struct {
+  const buzzer_pattern_t *pattern;
+  uint8_t step;
+  uint8_t loops;
+} buzzer_player_t;
+
+// Comenzar un patrón; retorna el primer paso o NULL si está vacío
+const buzzer_step_t *buzzer_player_start(buzzer_player_t *player,
+                                         const buzzer_pattern_t *pattern);
+// Avanzar al siguiente paso; retorna NULL al terminar el patrón
+const buzzer_step_t *buzzer_player_next(buzzer_player_t *player);
+
+#endif // BUZZER_PATTERN_H
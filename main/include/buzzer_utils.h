@@ -1,6 +1,7 @@
 /*******************************************************************************
  * @file        buzzer_utils.h
- * @brief       Funciones para controlar el buzzer basado en el umbral de temperatura.
+ * @brief       Funciones para controlar el buzzer basado en el umbral de
+ *              temperatura, con patrones de alarma según la severidad.
  * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
  * @date        30/8/2025
  * @version     1.0.0
@@ -13,25 +14,35 @@
 #include "esp_err.h"
 #include <stdbool.h>
 
-#define BUZZER_GPIO GPIO_NUM_33
+#define BUZZER_GPIO 33
 
 #ifndef BUZZER_FREQUENCY
 #define BUZZER_FREQUENCY 2000
 #endif
 
-#define BUZZER_LEDC_TIMER LEDC_TIMER_1
-#define BUZZER_LEDC_MODE LEDC_LOW_SPEED_MODE
-#define BUZZER_LEDC_CHANNEL LEDC_CHANNEL_1
-#define BUZZER_LEDC_DUTY_RES LEDC_TIMER_10_BIT
-#define BUZZER_LEDC_DUTY 512 // 50% ciclo de trabajo para 10 bits
+#define BUZZER_PWM_CHANNEL 1 // canal y timer LEDC 1
+#define BUZZER_PWM_DUTY_RES 10
+#define BUZZER_PWM_DUTY 512 // 50% ciclo de trabajo para 10 bits
 
 #ifndef TEMP_THRESHOLD
 #define TEMP_THRESHOLD 30.0
 #endif
 
+typedef enum {
+  BUZZER_PATTERN_OFF,
+  BUZZER_PATTERN_CONTINUOUS, // tono fijo, usado en modo manual
+  BUZZER_PATTERN_WARNING,    // pitido lento
+  BUZZER_PATTERN_ALARM,      // ráfagas de pitidos
+  BUZZER_PATTERN_CRITICAL,   // sirena de frecuencia creciente
+  BUZZER_PATTERN_COUNT,
+} buzzer_pattern_id_t;
+
 esp_err_t buzzer_init(void);
+// Reproducir un patrón sin bloquear, reemplazando al actual de inmediato
+void buzzer_play(buzzer_pattern_id_t pattern);
+buzzer_pattern_id_t buzzer_get_pattern(void);
 void buzzer_set(bool state, bool manual);
-void buzzer_update_by_temperature(float temperature);
+void buzzer_update_auto(buzzer_pattern_id_t pattern);
 bool buzzer_get_state(void);
 bool buzzer_is_manual_mode(void);
 void buzzer_set_threshold(float threshold);
@@ -0,0 +1,126 @@
+/*******************************************************************************
+ * @file        conn_utils.h
+ * @brief       Gestor de conectividad WiFi -> IP -> MQTT: decide cuándo
+ *              reintentar cada etapa con espera exponencial y aleatoria,
+ *              retiene los intentos MQTT con señal débil, cuenta las causas
+ *              de desconexión y mide cuánto tarda en recuperarse la red. Es
+ *              una máquina de estados sin dependencias del hardware: la HAL
+ *              le pasa los eventos y ejecuta las acciones que retorna.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#ifndef CONN_UTILS_H
+#define CONN_UTILS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Primera espera tras un fallo; se duplica con cada fallo seguido
+#ifndef CONN_BACKOFF_BASE_MS
+#define CONN_BACKOFF_BASE_MS 1000
+#endif
+
+#ifndef CONN_BACKOFF_MAX_MS
+#define CONN_BACKOFF_MAX_MS 120000
+#endif
+
+// Variación aleatoria de cada espera, para que varios dispositivos no
+// reintenten a la vez tras una caída del punto de acceso
+#ifndef CONN_BACKOFF_JITTER_PCT
+#define CONN_BACKOFF_JITTER_PCT 25
+#endif
+
+// Espera máxima por la dirección IP tras asociarse antes de reasociar
+#ifndef CONN_IP_TIMEOUT_MS
+#define CONN_IP_TIMEOUT_MS 15000
+#endif
+
+// Con menos señal los intentos MQTT se posponen, salvo cuando la espera ya
+// llegó al máximo
+#ifndef CONN_RSSI_MIN
+#define CONN_RSSI_MIN -85
+#endif
+
+// Tiempo en línea a partir del cual una caída vuelve a la espera inicial
+#ifndef CONN_STABLE_MS
+#define CONN_STABLE_MS 60000
+#endif
+
+typedef enum {
+  CONN_STATE_WIFI_CONNECTING,
+  CONN_STATE_IP_WAITING,
+  CONN_STATE_MQTT_CONNECTING,
+  CONN_STATE_ONLINE,
+  CONN_STATE_BACKOFF,
+  CONN_STATE_COUNT,
+} conn_state_t;
+
+typedef enum {
+  CONN_EVENT_WIFI_UP,
+  CONN_EVENT_WIFI_DOWN,
+  CONN_EVENT_IP_UP,
+  CONN_EVENT_IP_LOST,
+  CONN_EVENT_MQTT_UP,
+  CONN_EVENT_MQTT_DOWN,
+} conn_event_t;
+
+typedef enum {
+  CONN_ACTION_NONE,
+  CONN_ACTION_WIFI_CONNECT,
+  CONN_ACTION_WIFI_DISCONNECT, // forzar una nueva asociación
+  CONN_ACTION_MQTT_CONNECT,
+} conn_action_t;
+
+typedef enum {
+  CONN_REASON_NONE,
+  CONN_REASON_WIFI_NO_AP,
+  CONN_REASON_WIFI_AUTH,
+  CONN_REASON_WIFI_ASSOC,
+  CONN_REASON_WIFI_BEACON_LOSS,
+  CONN_REASON_WIFI_OTHER,
+  CONN_REASON_IP_TIMEOUT,
+  CONN_REASON_IP_LOST,
+  CONN_REASON_WEAK_SIGNAL,
+  CONN_REASON_MQTT_TRANSPORT,
+  CONN_REASON_MQTT_REFUSED,
+  CONN_REASON_COUNT,
+} conn_reason_t;
+
+typedef struct {
+  conn_state_t state;
+  bool wifi;
+  bool ip;
+  int8_t rssi;         // 0 mientras no se conoce
+  uint8_t attempts;    // fallos seguidos
+  bool capped;         // la última espera llegó a CONN_BACKOFF_MAX_MS
+  uint32_t backoff_ms; // última espera calculada
+  int64_t deadline_ms; // fin de la espera o del plazo por la IP
+  int64_t online_ms;   // desde cuándo está en línea
+  bool link_lost;      // se perdió la IP y aún no vuelve
+  int64_t link_lost_ms;
+  uint32_t outages;
+  uint32_t last_recovery_ms;
+  uint32_t reasons[CONN_REASON_COUNT];
+  uint32_t seed; // generador de la variación aleatoria
+} conn_t;
+
+void conn_init(conn_t *conn, uint32_t seed);
+// Registrar un evento de la red; retorna la acción que hay que ejecutar ya
+conn_action_t conn_event(conn_t *conn, conn_event_t event,
+                         conn_reason_t reason, int64_t now_ms);
+// Revisar los plazos vencidos; retorna la acción que hay que ejecutar ya
+conn_action_t conn_poll(conn_t *conn, int64_t now_ms);
+// Milisegundos hasta el próximo plazo, o -1 si no hay ninguno
+int64_t conn_wait_ms(const conn_t *conn, int64_t now_ms);
+void conn_set_rssi(conn_t *conn, int8_t rssi);
+
+const char *conn_state_name(conn_state_t state);
+const char *conn_reason_name(conn_reason_t reason);
+// Escribir el estado y las causas como JSON; retorna la longitud o 0
+int conn_format(const conn_t *conn, int64_t now_ms, char *buf, size_t size);
+
+#endif // CONN_UTILS_H
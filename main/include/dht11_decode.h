@@ -0,0 +1,63 @@
+/*******************************************************************************
+ * @file        dht11_decode.h
+ * @brief       Decodificación de tramas DHT11 a partir de anchos de pulso.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#ifndef DHT11_DECODE_H
+#define DHT11_DECODE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DHT_FRAME_BITS 40
+#define DHT_FRAME_BYTES 5
+
+// Un pulso HIGH más largo que este umbral es un bit 1 (26-28us vs 70us)
+#ifndef DHT_BIT_THRESHOLD_US
+#define DHT_BIT_THRESHOLD_US 50
+#endif
+
+// Pulsos HIGH más largos que esto no son bits (línea en reposo)
+#ifndef DHT_BIT_MAX_US
+#define DHT_BIT_MAX_US 100
+#endif
+
+typedef enum {
+  DHT_TYPE_DHT11,
+  DHT_TYPE_DHT22,
+} dht_type_t;
+
+typedef enum {
+  DHT_DECODE_OK = 0,
+  DHT_DECODE_ERR_SHORT = -1,    // menos de 40 pulsos HIGH capturados
+  DHT_DECODE_ERR_CHECKSUM = -2, // la suma de verificación no coincide
+} dht_decode_result_t;
+
+// Un nivel sostenido de la línea y su duración en microsegundos
+typedef struct {
+  uint8_t level;
+  uint16_t duration_us;
+} dht_pulse_t;
+
+/**
+ * Decodifica una trama de 40 bits a partir de la secuencia de pulsos
+ * grabada en la línea de datos. Toma los últimos 40 pulsos en alto como los
+ * bits de datos, por lo que los pulsos de inicio y respuesta previos se
+ * ignoran sin importar cuántos se hayan capturado. No depende del hardware.
+ */
+dht_decode_result_t dht_decode_pulses(const dht_pulse_t *pulses, size_t count,
+                                      uint8_t data[DHT_FRAME_BYTES]);
+
+/**
+ * Convierte una trama válida a humedad (%) y temperatura (°C). El DHT11
+ * envía la parte entera y la decimal en bytes separados; el DHT22 envía
+ * valores de 16 bits en décimas con el signo en el bit más alto.
+ */
+void dht_decode_values(dht_type_t type, const uint8_t data[DHT_FRAME_BYTES],
+                       float *humidity, float *temperature);
+
+#endif // DHT11_DECODE_H
@@ -1,6 +1,6 @@
 /*******************************************************************************
  * @file        dht11_utils.h
- * @brief       Funciones para interactuar con el sensor DHT11.
+ * @brief       Funciones para interactuar con sensores DHT11 y DHT22.
  * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
  * @date        30/8/2025
  * @version     1.0.0
@@ -10,12 +10,25 @@
 #ifndef DHT11_UTILS_H
 #define DHT11_UTILS_H
 
+#include "esp_err.h"
+#include "hal.h"
 #include "stdint.h"
 
-#define DHT_GPIO GPIO_NUM_23
-#define DHT_TIMEOUT 200
+#define DHT_TIMEOUT_MS 50         // espera máxima por las tramas completas
+#define DHT11_START_PULSE_MS 20   // pulso de inicio en LOW (mínimo 18ms)
+#define DHT22_START_PULSE_US 1100 // pulso de inicio en LOW (0.8 a 20ms)
 
-int dht_await_pin_state(uint32_t timeout, int expected_state);
-int dht_read_data(float *humidity, float *temperature);
+// Captura por RMT a 1 MHz: cada tick equivale a 1us
+#define DHT_RMT_RESOLUTION_HZ 1000000
+#define DHT_RMT_MEM_SYMBOLS 64
+#define DHT_RMT_MIN_PULSE_NS 1000  // filtro de glitches
+#define DHT_RMT_IDLE_NS 200000     // fin de trama tras 200us sin flancos
 
-#endif // DHT11_UTILS_H
\ No newline at end of file
+esp_err_t dht_init(void);
+// Registrar un sensor con su propio canal RMT; retorna su índice o -1
+int dht_add_sensor(uint8_t gpio, dht_type_t type);
+size_t dht_sensor_count(void);
+// Disparar todos los sensores a la vez y decodificar sus tramas
+int dht_read_all(hal_dht_reading_t readings[HAL_DHT_MAX_SENSORS]);
+
+#endif // DHT11_UTILS_H
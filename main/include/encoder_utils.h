@@ -0,0 +1,90 @@
+/*******************************************************************************
+ * @file        encoder_utils.h
+ * @brief       Codificadores intercambiables para la telemetría: JSON para
+ *              ThingsBoard y CBOR compacto para un decodificador local.
+ *
+ *              Formato CBOR: un lote es un arreglo de longitud indefinida
+ *              (0x9F ... 0xFF) de mapas, uno por muestra. En cada mapa la
+ *              clave -1 es la marca de tiempo epoch en ms (ausente si no hay
+ *              hora válida) y las claves 0..14 son telemetry_key_t (de la 9
+ *              en adelante, temperatura y humedad de cada sensor adicional).
+ *              Las temperaturas, la humedad y el umbral van como enteros en
+ *              décimas; buzzer y LEDs como booleanos; buzzer_mode es true si
+ *              es manual y mode es true si es automático.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#ifndef ENCODER_UTILS_H
+#define ENCODER_UTILS_H
+
+#include "esp_err.h"
+#include "telemetry_utils.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define TELEMETRY_ENCODING_JSON 0
+#define TELEMETRY_ENCODING_CBOR 1
+
+#ifndef TELEMETRY_ENCODING
+#define TELEMETRY_ENCODING TELEMETRY_ENCODING_JSON
+#endif
+
+#ifndef TELEMETRY_CBOR_TOPIC
+#define TELEMETRY_CBOR_TOPIC "proyecto3/telemetry/cbor"
+#endif
+
+typedef struct telemetry_batch telemetry_batch_t;
+
+typedef struct {
+  const char *name;
+  const char *topic;
+  // Escriben en buf y retornan los bytes usados, o 0 si no caben
+  size_t (*begin)(uint8_t *buf, size_t size);
+  size_t (*sample)(uint8_t *buf, size_t size, const telemetry_sample_t *sample,
+                   int64_t ts_ms, bool first);
+  size_t (*end)(uint8_t *buf, size_t size);
+  size_t end_size; // bytes reservados para cerrar el lote
+  // Opcional: agregar la muestra al lote completo en lugar de al final, para
+  // formatos que agrupan por sensor; reemplaza a sample
+  bool (*add)(telemetry_batch_t *batch, const telemetry_sample_t *sample,
+              int64_t ts_ms);
+} telemetry_encoder_t;
+
+// Lote en construcción sobre un búfer del llamador
+struct telemetry_batch {
+  const telemetry_encoder_t *encoder;
+  uint8_t *buf;
+  size_t size;
+  size_t len;
+  size_t count;
+  // Posición del cierre de la sección de cada sensor, 0 si aún no tiene;
+  // solo la usan los codificadores con add
+  size_t sections[TELEMETRY_AUX_SENSORS + 1];
+};
+
+extern const telemetry_encoder_t telemetry_encoder_json;
+extern const telemetry_encoder_t telemetry_encoder_cbor;
+
+const telemetry_encoder_t *encoder_get(void);
+// Buscar un codificador por su nombre entre los que admite la compilación
+// ("json" y "cbor", o solo "gateway" con GATEWAY_MODE); retorna NULL si no
+// existe
+const telemetry_encoder_t *encoder_find(const char *name, size_t name_len);
+// Cambiar el codificador activo; solo desde la tarea que publica, que es la
+// única que lo lee
+void encoder_set(const telemetry_encoder_t *encoder);
+
+void encoder_batch_begin(telemetry_batch_t *batch, uint8_t *buf, size_t size);
+bool encoder_batch_add(telemetry_batch_t *batch,
+                       const telemetry_sample_t *sample, int64_t ts_ms);
+size_t encoder_batch_end(telemetry_batch_t *batch);
+
+// Una sola muestra sin arreglo, para cuando aún no hay hora válida
+size_t encoder_single(const telemetry_encoder_t *encoder, uint8_t *buf,
+                      size_t size, const telemetry_sample_t *sample);
+
+#endif // ENCODER_UTILS_H
@@ -0,0 +1,53 @@
+/*******************************************************************************
+ * @file        filter_utils.h
+ * @brief       Acondicionamiento de lecturas en punto fijo (décimas): rechazo
+ *              de picos, mediana deslizante y promedio exponencial, más
+ *              bandas de histéresis para las salidas. No depende del hardware.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#ifndef FILTER_UTILS_H
+#define FILTER_UTILS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define FILTER_MEDIAN_MAX 7
+
+// Salto máximo configurable, en décimas
+#define FILTER_SPIKE_LIMIT_MAX 1000
+
+// Fracción del EMA en punto fijo Q8
+#define FILTER_EMA_FRAC_BITS 8
+
+typedef struct {
+  int32_t spike_limit;      // salto máximo aceptado en décimas; 0 desactiva
+  uint8_t spike_max_reject; // rechazos seguidos antes de aceptar un escalón
+  uint8_t median_window;    // impar, hasta FILTER_MEDIAN_MAX; 1 desactiva
+  uint8_t ema_shift;        // alfa = 1 / 2^ema_shift; 0 desactiva
+} filter_config_t;
+
+typedef struct {
+  filter_config_t config;
+  int32_t window[FILTER_MEDIAN_MAX];
+  uint8_t count;
+  uint8_t next;
+  uint8_t rejects;
+  bool primed;
+  int32_t last_input; // última entrada aceptada
+  int32_t ema;        // en Q8
+  int32_t output;
+} filter_t;
+
+void filter_init(filter_t *filter, const filter_config_t *config);
+// Procesar una entrada en décimas y dejar en *output el valor filtrado.
+// Retorna false si la entrada se descartó como pico (la salida no cambia).
+bool filter_apply(filter_t *filter, int32_t input, int32_t *output);
+
+// Banda de histéresis: enciende por encima de on y apaga por debajo de off
+bool hysteresis_update(bool state, int32_t value, int32_t on, int32_t off);
+
+#endif // FILTER_UTILS_H
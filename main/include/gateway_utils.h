@@ -0,0 +1,47 @@
+/*******************************************************************************
+ * @file        gateway_utils.h
+ * @brief       Modo pasarela de ThingsBoard: cada sensor se publica como un
+ *              dispositivo hijo con nombre propio sobre la misma sesión MQTT,
+ *              por medio de los tópicos v1/gateway.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#ifndef GATEWAY_UTILS_H
+#define GATEWAY_UTILS_H
+
+#include "encoder_utils.h"
+#include "esp_err.h"
+#include "telemetry_utils.h"
+#include <stddef.h>
+
+// Con 1 la telemetría y las RPC usan la API de pasarela; el token de
+// THINGSBOARD_ACCESS_TOKEN debe ser el de un dispositivo tipo pasarela
+#ifndef GATEWAY_MODE
+#define GATEWAY_MODE 0
+#endif
+
+// Nombre del dispositivo hijo de cada sensor, en el orden de DHT_SENSORS.
+// El primero lleva además el estado de los LEDs, el zumbador y el modo.
+#ifndef GATEWAY_DEVICE_NAMES
+#define GATEWAY_DEVICE_NAMES {"DHT 1", "DHT 2", "DHT 3", "DHT 4"}
+#endif
+
+#define GATEWAY_CONNECT_TOPIC "v1/gateway/connect"
+#define GATEWAY_TELEMETRY_TOPIC "v1/gateway/telemetry"
+#define GATEWAY_RPC_TOPIC "v1/gateway/rpc"
+
+#define GATEWAY_DEVICES (TELEMETRY_AUX_SENSORS + 1)
+
+// Lote {"<dispositivo>":[{"ts":..,"values":{..}},..],..} agrupado por
+// dispositivo; solo JSON, que es lo que acepta la API de pasarela
+extern const telemetry_encoder_t telemetry_encoder_gateway;
+
+// Anunciar los primeros count dispositivos hijos tras cada conexión
+esp_err_t gateway_connect_devices(size_t count);
+// Índice del dispositivo con ese nombre, o -1
+int gateway_device_index(const char *name, size_t len);
+
+#endif // GATEWAY_UTILS_H
@@ -0,0 +1,113 @@
+/*******************************************************************************
+ * @file        hal.h
+ * @brief       Capa de abstracción de hardware para GPIO, PWM (LEDC), DHT,
+ *              red y MQTT. Implementada por hal_esp32.c en la placa y por
+ *              hal_linux.c en el objetivo linux de ESP-IDF.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#ifndef HAL_H
+#define HAL_H
+
+#include "conn_utils.h"
+#include "dht11_decode.h"
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// GPIO
+void hal_gpio_config_output(uint64_t pin_mask);
+void hal_gpio_set_level(uint8_t gpio, uint32_t level);
+int hal_gpio_get_level(uint8_t gpio);
+
+// PWM: un canal con su propio temporizador
+esp_err_t hal_pwm_init(uint8_t channel, uint8_t gpio, uint32_t freq_hz,
+                       uint8_t duty_resolution_bits);
+void hal_pwm_set_duty(uint8_t channel, uint32_t duty);
+esp_err_t hal_pwm_set_freq(uint8_t channel, uint32_t freq_hz);
+
+// Temporizador de un disparo; el callback corre fuera de las tareas de la
+// aplicación (tarea de esp_timer en la placa, servicio de timers en linux)
+typedef void *hal_timer_t;
+typedef void (*hal_timer_cb_t)(void *arg);
+
+esp_err_t hal_timer_create(hal_timer_cb_t callback, void *arg,
+                           hal_timer_t *timer);
+esp_err_t hal_timer_start_once(hal_timer_t timer, uint64_t timeout_us);
+void hal_timer_stop(hal_timer_t timer);
+
+// Sensores DHT11/DHT22: se registran en tiempo de ejecución y se disparan y
+// capturan todos a la vez. El primero registrado gobierna el control.
+#define HAL_DHT_MAX_SENSORS 4
+
+typedef struct {
+  float temperature;
+  float humidity;
+  bool valid;
+} hal_dht_reading_t;
+
+esp_err_t hal_dht_init(void);
+// Registrar un sensor; retorna su índice o -1
+int hal_dht_add(uint8_t gpio, dht_type_t type);
+size_t hal_dht_count(void);
+// Leer todos los sensores; retorna cuántos entregaron una lectura válida
+int hal_dht_read_all(hal_dht_reading_t readings[HAL_DHT_MAX_SENSORS]);
+
+// Red: en la placa inicia WiFi y SNTP, en linux usa la red del anfitrión.
+// Los reintentos de WiFi y MQTT los decide el gestor de conn_utils.
+esp_err_t hal_net_init(void);
+// Copia del estado del gestor de conectividad
+void hal_net_status(conn_t *status);
+
+// Reloj monotónico en microsegundos desde el arranque
+int64_t hal_time_us(void);
+
+// Sueño profundo: en la placa no retorna y el siguiente ciclo vuelve a
+// entrar por app_main; en linux se simula con una espera y sí retorna
+void hal_deep_sleep(uint64_t duration_us);
+bool hal_woke_from_sleep(void);
+
+// MQTT
+typedef enum {
+  HAL_MQTT_EVENT_CONNECTED,
+  HAL_MQTT_EVENT_DISCONNECTED,
+  HAL_MQTT_EVENT_ERROR,
+  HAL_MQTT_EVENT_DATA,
+} hal_mqtt_event_id_t;
+
+typedef struct {
+  hal_mqtt_event_id_t event_id;
+  const char *topic; // solo presente en el primer fragmento
+  int topic_len;
+  const char *data;
+  int data_len;
+  int total_data_len;
+  int current_data_offset;
+  bool session_present; // CONNECTED: el corredor conservó la sesión anterior
+} hal_mqtt_event_t;
+
+typedef void (*hal_mqtt_event_cb_t)(const hal_mqtt_event_t *event);
+
+typedef struct {
+  const char *host;
+  uint16_t port;
+  const char *username;
+  size_t outbox_limit; // bytes máximos en la bandeja de salida; 0 sin límite
+  bool tls;            // MQTTS con reanudación de la sesión TLS
+  bool persistent_session; // clean_session=false: suscripciones y mensajes
+                           // QoS1 sobreviven a la desconexión
+} hal_mqtt_config_t;
+
+esp_err_t hal_mqtt_start(const hal_mqtt_config_t *config,
+                         hal_mqtt_event_cb_t callback);
+int hal_mqtt_publish(const char *topic, const char *data, int len, int qos,
+                     int retain);
+int hal_mqtt_subscribe(const char *topic, int qos);
+// Bytes de mensajes QoS1 aún sin confirmar por el corredor
+int hal_mqtt_outbox_size(void);
+
+#endif // HAL_H
@@ -0,0 +1,63 @@
+/*******************************************************************************
+ * @file        history_utils.h
+ * @brief       Historial local del sensor principal en tres resoluciones: un
+ *              anillo de muestras crudas y cubetas de mínimo, máximo y
+ *              promedio por minuto y por hora, actualizadas con cada muestra.
+ *              Las cubetas se guardan en NVS para sobrevivir a un reinicio.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#ifndef HISTORY_UTILS_H
+#define HISTORY_UTILS_H
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Muestras crudas retenidas (a 20 s por muestra, unos 40 minutos)
+#ifndef HISTORY_RAW_SIZE
+#define HISTORY_RAW_SIZE 120
+#endif
+
+// Cubetas de un minuto (la última hora) y de una hora (los últimos dos días)
+#ifndef HISTORY_MINUTE_SIZE
+#define HISTORY_MINUTE_SIZE 60
+#endif
+#ifndef HISTORY_HOUR_SIZE
+#define HISTORY_HOUR_SIZE 48
+#endif
+
+// Minutos cerrados entre escrituras del nivel de minutos en NVS; cada hora
+// cerrada también escribe ambos niveles
+#ifndef HISTORY_SAVE_MINUTES
+#define HISTORY_SAVE_MINUTES 10
+#endif
+
+// Elementos por respuesta de getHistory cuando no se indica "limit"
+#define HISTORY_PAGE_DEFAULT 16
+
+typedef enum {
+  HISTORY_TIER_RAW,
+  HISTORY_TIER_MINUTE,
+  HISTORY_TIER_HOUR,
+  HISTORY_TIER_COUNT,
+} history_tier_t;
+
+// Cargar las cubetas guardadas; sin ellas el historial empieza vacío
+esp_err_t history_init(void);
+// Agregar una muestra ya filtrada. Sin hora válida (epoch_ms 0) solo entra
+// al anillo crudo, porque las cubetas se alinean al minuto y la hora reales.
+void history_add(int64_t mono_ms, int64_t epoch_ms, float temperature,
+                 float humidity);
+// Nivel por nombre ("raw", "minute", "hour"), o -1
+int history_tier_parse(const char *name, size_t len);
+// Escribir como JSON hasta limit elementos del nivel a partir de from (0 es
+// el más antiguo), con el índice de la página siguiente; retorna la
+// longitud o 0 si no cabe
+int history_format(history_tier_t tier, size_t from, size_t limit,
+                   int64_t epoch_offset_ms, char *buf, size_t size);
+
+#endif // HISTORY_UTILS_H
@@ -0,0 +1,54 @@
+/*******************************************************************************
+ * @file        http_utils.h
+ * @brief       Servidor HTTP local para ver las lecturas en la LAN sin pasar
+ *              por la nube: GET /metrics entrega una instantánea y /ws empuja
+ *              cada muestra nueva a los clientes WebSocket conectados.
+ *              Requiere CONFIG_HTTPD_WS_SUPPORT; sin él (objetivo linux) las
+ *              funciones no hacen nada.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#ifndef HTTP_UTILS_H
+#define HTTP_UTILS_H
+
+#include "esp_err.h"
+#include <stddef.h>
+
+#ifndef HTTP_SERVER_ENABLED
+#define HTTP_SERVER_ENABLED 1
+#endif
+
+#ifndef HTTP_PORT
+#define HTTP_PORT 80
+#endif
+
+// Clientes WebSocket simultáneos; lwIP tiene 10 sockets y MQTT usa uno
+#ifndef HTTP_WS_MAX_CLIENTS
+#define HTTP_WS_MAX_CLIENTS 4
+#endif
+
+// Tramas sin terminar de enviar a partir de las cuales un cliente se
+// considera lento y se desconecta
+#ifndef HTTP_WS_MAX_PENDING
+#define HTTP_WS_MAX_PENDING 2
+#endif
+
+// Tramas compartidas en vuelo y tamaño máximo de cada una
+#define HTTP_FRAME_SLOTS 4
+#define HTTP_FRAME_SIZE 512
+
+#define HTTP_METRICS_SIZE 3072
+
+// Escribe la instantánea de /metrics como JSON; retorna la longitud o 0
+typedef int (*http_metrics_fn_t)(char *buf, size_t size);
+
+esp_err_t http_init(http_metrics_fn_t metrics);
+// Clientes WebSocket conectados, para no codificar si no hay ninguno
+int http_client_count(void);
+// Enviar un mismo mensaje ya codificado a todos los clientes WebSocket
+void http_broadcast(const char *data, size_t len);
+
+#endif // HTTP_UTILS_H
@@ -1,6 +1,7 @@
 /*******************************************************************************
  * @file        led_utils.h
- * @brief       Funciones para controlar los LEDs basados en el umbral de humedad.
+ * @brief       Funciones para controlar los LEDs, de forma manual o según las
+ *              reglas del modo automático.
  * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
  * @date        30/8/2025
  * @version     1.0.0
@@ -15,14 +16,15 @@
 
 typedef struct {
   uint8_t gpio;
-  float humidity_threshold;
   bool state;
   bool manual_override;
 } led_t;
 
 void leds_init(void);
 void led_set(uint8_t led_number, bool on, bool manual);
-void leds_update_by_humidity(float humidity);
+void leds_update_auto(uint8_t states);
 void led_reset_manual_override(uint8_t led_number);
+bool led_get_state(uint8_t led_number);
+bool led_is_manual(uint8_t led_number);
 
 #endif // LED_UTILS_H
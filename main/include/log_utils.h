@@ -0,0 +1,108 @@
+/*******************************************************************************
+ * @file        log_utils.h
+ * @brief       Registro diferido: las macros DLOGx guardan el puntero al
+ *              formato y los argumentos sin formatear en un anillo sin
+ *              bloqueos, y una tarea de baja prioridad los expande hacia la
+ *              UART. Cada etiqueta tiene un límite de mensajes por segundo.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#ifndef LOG_UTILS_H
+#define LOG_UTILS_H
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include <stdint.h>
+
+// Con 0 las macros DLOGx equivalen a ESP_LOGx
+#ifndef LOG_DEFERRED
+#define LOG_DEFERRED 1
+#endif
+
+// Registros en el anillo; potencia de dos
+#ifndef LOG_RING_SIZE
+#define LOG_RING_SIZE 64
+#endif
+
+// Mensajes por segundo y etiqueta; el resto se descarta y se cuenta
+#ifndef LOG_RATE_PER_TAG
+#define LOG_RATE_PER_TAG 20
+#endif
+
+#define LOG_MAX_ARGS 6
+#define LOG_MAX_TAGS 16
+#define LOG_TASK_PRIORITY 1
+#define LOG_TASK_STACK_SIZE 3072
+
+#if LOG_DEFERRED
+
+// Un argumento ya promovido; el formato indica cómo leerlo. Las cadenas
+// (%s) deben ser estáticas porque se leen al expandir, no al registrar.
+typedef union {
+  int64_t i;
+  double f;
+  const void *p;
+} log_arg_t;
+
+static inline log_arg_t log_arg_int(int64_t value) {
+  return (log_arg_t){.i = value};
+}
+static inline log_arg_t log_arg_float(double value) {
+  return (log_arg_t){.f = value};
+}
+static inline log_arg_t log_arg_ptr(const void *value) {
+  return (log_arg_t){.p = value};
+}
+
+#define LOG_ARG(x)                                                             \
+  _Generic((x),                                                                \
+      float: log_arg_float,                                                    \
+      double: log_arg_float,                                                   \
+      char *: log_arg_ptr,                                                     \
+      const char *: log_arg_ptr,                                               \
+      default: log_arg_int)(x)
+
+#define LOG_COUNT_(_0, _1, _2, _3, _4, _5, _6, n, ...) n
+#define LOG_COUNT(...)                                                         \
+  LOG_COUNT_(_ __VA_OPT__(, ) __VA_ARGS__, 6, 5, 4, 3, 2, 1, 0)
+#define LOG_CAT_(a, b) a##b
+#define LOG_CAT(a, b) LOG_CAT_(a, b)
+#define LOG_MAP_0()
+#define LOG_MAP_1(a) LOG_ARG(a),
+#define LOG_MAP_2(a, ...) LOG_ARG(a), LOG_MAP_1(__VA_ARGS__)
+#define LOG_MAP_3(a, ...) LOG_ARG(a), LOG_MAP_2(__VA_ARGS__)
+#define LOG_MAP_4(a, ...) LOG_ARG(a), LOG_MAP_3(__VA_ARGS__)
+#define LOG_MAP_5(a, ...) LOG_ARG(a), LOG_MAP_4(__VA_ARGS__)
+#define LOG_MAP_6(a, ...) LOG_ARG(a), LOG_MAP_5(__VA_ARGS__)
+
+#define DLOG(level, tag, format, ...)                                          \
+  log_defer((level), (tag), (format), LOG_COUNT(__VA_ARGS__),                  \
+            (const log_arg_t[]){LOG_CAT(LOG_MAP_, LOG_COUNT(__VA_ARGS__))(     \
+                __VA_ARGS__){0}})
+
+esp_err_t log_init(void);
+// Guardar un registro sin formatearlo; no bloquea y descarta si no cabe
+void log_defer(esp_log_level_t level, const char *tag, const char *format,
+               int argc, const log_arg_t *argv);
+// Expandir en el llamador todo lo pendiente, p. ej. antes de dormir
+void log_flush(void);
+
+#define DLOGE(tag, ...) DLOG(ESP_LOG_ERROR, tag, __VA_ARGS__)
+#define DLOGW(tag, ...) DLOG(ESP_LOG_WARN, tag, __VA_ARGS__)
+#define DLOGI(tag, ...) DLOG(ESP_LOG_INFO, tag, __VA_ARGS__)
+
+#else
+
+static inline esp_err_t log_init(void) { return ESP_OK; }
+static inline void log_flush(void) {}
+
+#define DLOGE(tag, ...) ESP_LOGE(tag, __VA_ARGS__)
+#define DLOGW(tag, ...) ESP_LOGW(tag, __VA_ARGS__)
+#define DLOGI(tag, ...) ESP_LOGI(tag, __VA_ARGS__)
+
+#endif // LOG_DEFERRED
+
+#endif // LOG_UTILS_H
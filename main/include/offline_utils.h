@@ -0,0 +1,40 @@
+/*******************************************************************************
+ * @file        offline_utils.h
+ * @brief       Cola persistente en flash para almacenar muestras mientras no
+ *              hay conexión MQTT y reenviarlas al reconectar.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#ifndef OFFLINE_UTILS_H
+#define OFFLINE_UTILS_H
+
+#include "esp_err.h"
+#include "telemetry_utils.h"
+#include <stddef.h>
+
+#define OFFLINE_PARTITION_LABEL "offline"
+#define OFFLINE_PARTITION_SUBTYPE 0x40
+#define OFFLINE_SECTOR_SIZE 4096
+#define OFFLINE_RECORD_SIZE 16
+
+// Registros publicados por mensaje al vaciar la cola
+#ifndef OFFLINE_DRAIN_BATCH
+#define OFFLINE_DRAIN_BATCH 8
+#endif
+
+// Pausa mínima entre lotes para no saturar al corredor al reconectar
+#ifndef OFFLINE_DRAIN_INTERVAL_MS
+#define OFFLINE_DRAIN_INTERVAL_MS 1000
+#endif
+
+#define OFFLINE_PAYLOAD_SIZE 2048
+
+esp_err_t offline_init(void);
+esp_err_t offline_append(const telemetry_sample_t *sample);
+size_t offline_pending(void);
+int offline_drain(void);
+
+#endif // OFFLINE_UTILS_H
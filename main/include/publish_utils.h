@@ -0,0 +1,94 @@
+/*******************************************************************************
+ * @file        publish_utils.h
+ * @brief       Capa de publicación MQTT acotada: cada flujo tiene su QoS y
+ *              una política para cuando la bandeja de salida del cliente
+ *              llega a su límite, con contadores de envíos y descartes.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#ifndef PUBLISH_UTILS_H
+#define PUBLISH_UTILS_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+// Bytes retenidos en la bandeja de salida (mensajes QoS1 sin confirmar) a
+// partir de los cuales se aplica la política de cada flujo
+#ifndef PUBLISH_OUTBOX_LIMIT
+#define PUBLISH_OUTBOX_LIMIT 8192
+#endif
+
+// Espera máxima de un productor con la política PUBLISH_POLICY_BLOCK
+#ifndef PUBLISH_BLOCK_TIMEOUT_MS
+#define PUBLISH_BLOCK_TIMEOUT_MS 1000
+#endif
+
+// Mensajes retenidos con PUBLISH_POLICY_COALESCE o PUBLISH_POLICY_QUEUE,
+// entre todos los flujos, y el más grande que cabe: una respuesta RPC de
+// RPC_RESULT_SIZE dentro del sobre del gateway
+#ifndef PUBLISH_HOLD_DEPTH
+#define PUBLISH_HOLD_DEPTH 4
+#endif
+#ifndef PUBLISH_HOLD_SIZE
+#define PUBLISH_HOLD_SIZE 1664
+#endif
+
+// Cada cuánto reintenta la tarea de comunicaciones los mensajes retenidos
+#ifndef PUBLISH_POLL_INTERVAL_MS
+#define PUBLISH_POLL_INTERVAL_MS 100
+#endif
+
+#define PUBLISH_TOPIC_SIZE 64
+
+typedef enum {
+  PUBLISH_STREAM_TELEMETRY,   // muestras en vivo
+  PUBLISH_STREAM_BACKLOG,     // muestras recuperadas de flash
+  PUBLISH_STREAM_RPC,         // respuestas a RPC
+  PUBLISH_STREAM_DIAGNOSTICS, // reporte de arranque e histogramas
+  PUBLISH_STREAM_GATEWAY,     // anuncios de dispositivos hijos
+  PUBLISH_STREAM_COUNT,
+} publish_stream_t;
+
+typedef enum {
+  // Se descarta el mensaje nuevo
+  PUBLISH_POLICY_DROP_NEWEST,
+  // Se rechaza el mensaje y el productor lo conserva en su propio búfer
+  // acotado, que descarta lo más antiguo (anillo de telemetría, flash)
+  PUBLISH_POLICY_DROP_OLDEST,
+  // Se guarda solo el último mensaje y se envía cuando haya espacio
+  PUBLISH_POLICY_COALESCE,
+  // Se guardan los mensajes en orden y se envían cuando haya espacio; cada
+  // uno lleva su tópico, así que ninguno reemplaza a otro. Si no quedan
+  // lugares se descarta el nuevo
+  PUBLISH_POLICY_QUEUE,
+  // El productor espera hasta PUBLISH_BLOCK_TIMEOUT_MS; luego se descarta.
+  // No sirve en la tarea del cliente MQTT: mientras espera no procesa las
+  // confirmaciones que liberarían la bandeja
+  PUBLISH_POLICY_BLOCK,
+} publish_policy_t;
+
+typedef struct {
+  int qos;
+  publish_policy_t policy;
+} publish_stream_config_t;
+
+esp_err_t publish_init(void);
+esp_err_t publish_configure(publish_stream_t stream,
+                            const publish_stream_config_t *config);
+// Publicar según la política del flujo; retorna el id del mensaje, o -1 si
+// no salió ahora (desconexión, descarte, rechazo o mensaje retenido)
+int publish_send(publish_stream_t stream, const char *topic, const char *data,
+                 size_t len);
+// Enviar los mensajes retenidos, en orden de llegada, si ya hay espacio
+void publish_poll(void);
+// Hay mensajes retenidos esperando a publish_poll
+bool publish_pending(void);
+// Profundidad de la bandeja y contadores por flujo como JSON; retorna la
+// longitud o 0
+int publish_format(char *buf, size_t size);
+
+#endif // PUBLISH_UTILS_H
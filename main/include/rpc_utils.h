@@ -0,0 +1,121 @@
+/*******************************************************************************
+ * @file        rpc_utils.h
+ * @brief       Despachador de llamadas RPC de ThingsBoard basado en una tabla
+ *              de métodos registrados y un analizador JSON sin memoria
+ *              dinámica.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#ifndef RPC_UTILS_H
+#define RPC_UTILS_H
+
+#include "esp_err.h"
+#include "hal.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define RPC_REQUEST_TOPIC "v1/devices/me/rpc/request/+"
+#define RPC_RESPONSE_TOPIC "v1/devices/me/rpc/response/"
+
+// Tamaño máximo de un mensaje RPC reensamblado. La solicitud más grande es
+// setRules con RULES_MAX reglas de hasta RPC_RULE_BYTES cada una, más el
+// sobre de la pasarela; proyecto_3_embebidos.c lo comprueba al compilar
+#ifndef RPC_BUFFER_SIZE
+#define RPC_BUFFER_SIZE 3072
+#endif
+
+// Tokens JSON por solicitud: una regla de setRules usa RPC_RULE_TOKENS
+#ifndef RPC_MAX_TOKENS
+#define RPC_MAX_TOKENS 256
+#endif
+
+// Una regla completa: el objeto y seis pares clave-valor, con nombres y
+// números largos ("temperature4", "continuous", -40.5)
+#define RPC_RULE_TOKENS 13
+#define RPC_RULE_BYTES 128
+
+#define RPC_TOPIC_SIZE 64
+#define RPC_RESULT_SIZE 1536
+// Respuesta dentro del sobre del gateway, con el dispositivo y el id
+#define RPC_ENVELOPE_SIZE (RPC_RESULT_SIZE + 96)
+#define RPC_MAX_DEPTH 8
+#define RPC_MAX_METHODS 16
+
+typedef enum {
+  RPC_JSON_OBJECT,
+  RPC_JSON_ARRAY,
+  RPC_JSON_STRING,
+  RPC_JSON_PRIMITIVE,
+} rpc_json_type_t;
+
+// Un token apunta a su texto dentro del búfer original, sin copiarlo
+typedef struct {
+  uint8_t type;
+  uint16_t start;
+  uint16_t end;
+  uint16_t size; // hijos directos (en objetos cuenta claves y valores)
+} rpc_json_token_t;
+
+typedef struct {
+  const char *json;
+  const rpc_json_token_t *tokens;
+  int count;
+  int params; // índice del token "params", o -1
+  int device; // dispositivo hijo destino en modo pasarela (0 es el
+              // sensor principal), o -1 fuera de él
+} rpc_request_t;
+
+// Un manejador puede escribir un resultado JSON en result; si lo deja vacío
+// se responde {"success":true} o el error retornado. Con RPC_DEFERRED no se
+// responde: otra tarea lo hará con rpc_reply_deferred
+typedef esp_err_t (*rpc_handler_t)(const rpc_request_t *request, char *result,
+                                   size_t result_size);
+
+#define RPC_DEFERRED ESP_ERR_NOT_FINISHED
+
+// A quién responder después, copiado de la solicitud en curso para que
+// sobreviva al búfer de recepción
+#define RPC_ID_SIZE 24
+#define RPC_DEVICE_SIZE 32
+typedef struct {
+  char id[RPC_ID_SIZE];
+  char device[RPC_DEVICE_SIZE]; // vacío fuera del modo pasarela
+} rpc_deferred_t;
+
+esp_err_t rpc_register(const char *method, rpc_handler_t handler);
+// Registrar un método que distingue el dispositivo hijo por request->device.
+// Los de rpc_register actúan sobre el equipo completo, así que en modo
+// pasarela solo se aceptan para el primer hijo, que lleva los LEDs, el
+// zumbador y el modo; los demás reciben un error sin llamar al manejador
+esp_err_t rpc_register_device(const char *method, rpc_handler_t handler);
+void rpc_handle_data(const hal_mqtt_event_t *event);
+// Guardar el destino de la solicitud en curso; solo desde un manejador, que
+// después retorna RPC_DEFERRED
+esp_err_t rpc_defer(rpc_deferred_t *deferred);
+// Responder {"success":true} o el error a una solicitud diferida, desde
+// cualquier tarea
+void rpc_reply_deferred(const rpc_deferred_t *deferred, esp_err_t ret);
+
+// Analizar JSON en tokens; retorna la cantidad de tokens o -1
+int rpc_json_parse(const char *json, size_t len, rpc_json_token_t *tokens,
+                   int max_tokens);
+// Índice del primer token después del subárbol de tokens[i], para recorrer
+// los elementos de un arreglo
+int rpc_json_skip(const rpc_json_token_t *tokens, int count, int i);
+// Buscar una clave en un objeto; retorna el índice del valor o -1
+int rpc_json_find(const char *json, const rpc_json_token_t *tokens, int count,
+                  int object, const char *key);
+
+// Leer parámetros; con key NULL se lee el propio "params"
+bool rpc_param_float(const rpc_request_t *request, const char *key,
+                     float *out);
+bool rpc_param_int(const rpc_request_t *request, const char *key, int *out);
+bool rpc_param_bool(const rpc_request_t *request, const char *key, bool *out);
+bool rpc_param_string_equals(const rpc_request_t *request, const char *key,
+                             const char *value);
+
+#endif // RPC_UTILS_H
@@ -0,0 +1,115 @@
+/*******************************************************************************
+ * @file        rules_utils.h
+ * @brief       Motor de reglas para las salidas del modo automático: cada
+ *              regla compara una entrada (un canal de un sensor o un valor
+ *              derivado) contra un umbral con histéresis y pide un valor para
+ *              un actuador; por actuador gana la regla activa de mayor
+ *              prioridad. El conjunto se compila una vez en un arreglo plano
+ *              y se evalúa sin memoria dinámica.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#ifndef RULES_UTILS_H
+#define RULES_UTILS_H
+
+#include "esp_err.h"
+#include "telemetry_utils.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define RULES_MAX 16
+
+// Umbral e histéresis más grandes que acepta una regla, en unidades de la
+// entrada; mantienen las décimas dentro de int32
+#define RULES_VALUE_MAX 1000.0f
+
+// Reglas por defecto, las mismas que antes estaban fijas en las salidas:
+// cada LED enciende sobre su humedad y se apaga LED_HYSTERESIS por debajo
+#ifndef LED_HYSTERESIS
+#define LED_HYSTERESIS 2.0
+#endif
+
+// Un nivel de alarma se abandona solo al bajar esta cantidad bajo su límite
+#ifndef BUZZER_HYSTERESIS
+#define BUZZER_HYSTERESIS 0.5
+#endif
+
+// Grados sobre el umbral que separan cada nivel de severidad
+#ifndef BUZZER_SEVERITY_STEP
+#define BUZZER_SEVERITY_STEP 2.0
+#endif
+
+// Entradas, en décimas; las de cada sensor van por pares
+#define RULES_INPUT_TEMPERATURE(n) (2 * (n))
+#define RULES_INPUT_HUMIDITY(n) (2 * (n) + 1)
+
+typedef enum {
+  RULES_INPUT_DEW_POINT = RULES_INPUT_TEMPERATURE(TELEMETRY_AUX_SENSORS + 1),
+  RULES_INPUT_TEMP_EXCESS, // temperatura principal menos temp_threshold
+  RULES_INPUT_COUNT,
+} rules_input_t;
+
+typedef enum {
+  RULES_ACTUATOR_LED1,
+  RULES_ACTUATOR_LED2,
+  RULES_ACTUATOR_LED3,
+  RULES_ACTUATOR_BUZZER, // el valor es un buzzer_pattern_id_t
+  RULES_ACTUATOR_COUNT,
+} rules_actuator_t;
+
+// Regla ya compilada; los umbrales van en décimas
+typedef struct {
+  uint8_t input;
+  bool above;     // se activa al superar on; si no, al bajar de on
+  uint8_t actuator;
+  uint8_t value;  // 0 apaga el actuador
+  uint8_t priority;
+  int32_t on;
+  int32_t off; // on desplazado por la histéresis hacia el lado inactivo
+} rule_t;
+
+typedef struct {
+  rule_t rules[RULES_MAX]; // ordenadas de mayor a menor prioridad
+  uint8_t count;
+  uint32_t active; // bit n: la regla n está activada
+} rules_t;
+
+// Regla tal como llega por setRules o en la tabla por defecto
+typedef struct {
+  rules_input_t input;
+  bool above;
+  float threshold; // en las unidades de la entrada (°C o %)
+  float hysteresis;
+  rules_actuator_t actuator;
+  uint8_t value;
+  uint8_t priority;
+} rule_spec_t;
+
+// Valores de entrada de un ciclo y cuáles están disponibles
+typedef struct {
+  int32_t values[RULES_INPUT_COUNT];
+  uint32_t valid;
+} rules_inputs_t;
+
+// Compilar count reglas sobre out, que no cambia si alguna es inválida
+esp_err_t rules_compile(rules_t *out, const rule_spec_t *specs, size_t count);
+void rules_default(rules_t *rules);
+// Evaluar todas las reglas y dejar en outputs el valor de cada actuador
+void rules_evaluate(rules_t *rules, const rules_inputs_t *inputs,
+                    uint8_t outputs[RULES_ACTUATOR_COUNT]);
+// Punto de rocío en décimas a partir de temperatura y humedad en décimas
+int32_t rules_dew_point(int32_t temperature, int32_t humidity);
+
+// Nombres aceptados por setRules; retornan -1 si no existen
+int rules_input_parse(const char *name, size_t len);
+int rules_actuator_parse(const char *name, size_t len);
+
+// Conjunto activo en NVS, para no esperar a la nube tras arrancar
+esp_err_t rules_save(const rules_t *rules);
+esp_err_t rules_load(rules_t *rules);
+
+#endif // RULES_UTILS_H
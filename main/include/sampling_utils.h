@@ -0,0 +1,63 @@
+/*******************************************************************************
+ * @file        sampling_utils.h
+ * @brief       Política de muestreo: periodo fijo o adaptativo, que se acorta
+ *              cuando las lecturas cambian rápido o se acercan al umbral y
+ *              se alarga mientras se mantienen estables. No depende del
+ *              hardware.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#ifndef SAMPLING_UTILS_H
+#define SAMPLING_UTILS_H
+
+#include "esp_err.h"
+#include "rpc_utils.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Límite inferior de cualquier periodo: el DHT22 necesita 2 s entre lecturas
+#define SAMPLING_PERIOD_FLOOR_MS 2000
+
+// Límite superior: más de una hora sin lecturas deja al tablero sin datos
+#define SAMPLING_PERIOD_CEIL_MS 3600000
+
+typedef enum {
+  SAMPLING_MODE_FIXED,
+  SAMPLING_MODE_ADAPTIVE,
+} sampling_mode_t;
+
+typedef struct {
+  sampling_mode_t mode;
+  uint32_t period_ms;     // periodo fijo, y el inicial del modo adaptativo
+  uint32_t min_period_ms; // cota al acelerar
+  uint32_t max_period_ms; // cota al espaciar
+  float delta_temperature; // cambio entre muestras que se considera rápido
+  float delta_humidity;
+  float threshold_margin; // distancia al umbral de temperatura que acelera
+} sampling_policy_t;
+
+typedef struct {
+  sampling_policy_t policy;
+  uint32_t period_ms;
+  bool primed;
+  float last_temperature;
+  float last_humidity;
+} sampling_t;
+
+// Validar la política; retorna false si sus periodos no son coherentes
+bool sampling_policy_valid(const sampling_policy_t *policy);
+// Aplicar a policy los parámetros de setSamplingPolicy presentes en la
+// solicitud; los ausentes conservan su valor. Un modo desconocido, un
+// parámetro ilegible o una política resultante inválida retornan
+// ESP_ERR_INVALID_ARG sin cambiar policy.
+esp_err_t sampling_policy_parse(const rpc_request_t *request,
+                                sampling_policy_t *policy);
+void sampling_init(sampling_t *sampling, const sampling_policy_t *policy);
+// Registrar una lectura y retornar el periodo hasta la siguiente
+uint32_t sampling_update(sampling_t *sampling, float temperature,
+                         float humidity, float threshold);
+
+#endif // SAMPLING_UTILS_H
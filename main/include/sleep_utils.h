@@ -0,0 +1,98 @@
+/*******************************************************************************
+ * @file        sleep_utils.h
+ * @brief       Estado retenido en memoria RTC y planificación del despertar
+ *              para el modo de muestreo con sueño profundo. No depende del
+ *              hardware: la aplicación ubica el estado en RTC_DATA_ATTR.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#ifndef SLEEP_UTILS_H
+#define SLEEP_UTILS_H
+
+#include "filter_utils.h"
+#include "telemetry_utils.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Modo opcional: leer, publicar y dormir en lugar de esperar despierto
+#ifndef DEEP_SLEEP_MODE
+#define DEEP_SLEEP_MODE 0
+#endif
+
+// Conectar a la red cada tantas muestras (o antes si el búfer se llena)
+#ifndef SLEEP_PUBLISH_EVERY
+#define SLEEP_PUBLISH_EVERY 1
+#endif
+
+// Muestras retenidas entre ciclos mientras no se publican
+#ifndef SLEEP_PENDING_MAX
+#define SLEEP_PENDING_MAX 16
+#endif
+
+// Espera máxima por la conexión MQTT antes de volver a dormir
+#ifndef SLEEP_CONNECT_TIMEOUT_MS
+#define SLEEP_CONNECT_TIMEOUT_MS 10000
+#endif
+
+// Ventana para atender comandos RPC después de publicar
+#ifndef SLEEP_RPC_WINDOW_MS
+#define SLEEP_RPC_WINDOW_MS 500
+#endif
+
+// Tiempo mínimo de sueño aunque el ciclo se haya alargado
+#define SLEEP_MIN_MS 1000
+
+#define SLEEP_STATE_MAGIC 0x534C5032 // "SLP2"
+
+typedef struct {
+  uint32_t magic;
+  uint32_t cycle; // ciclos completados desde el último arranque en frío
+
+  // Estado de control
+  bool automatic_mode;
+  bool buzzer;
+  bool buzzer_manual;
+  uint8_t leds;        // bit n: LED n + 1 encendido
+  uint8_t leds_manual; // bit n: LED n + 1 en control manual
+  uint32_t rules_active; // reglas con la histéresis activada
+  float temp_threshold;
+  float last_temperature;
+  float last_humidity;
+  // Filtros de temperatura y humedad de cada sensor
+  filter_t filters[TELEMETRY_AUX_SENSORS + 1][2];
+
+  // Reloj monotónico al dormir y duración programada, para reubicar las
+  // marcas de tiempo de las muestras pendientes tras despertar
+  int64_t sleep_at_ms;
+  int64_t sleep_ms;
+
+  uint8_t pending_head;
+  uint8_t pending_count;
+  telemetry_sample_t pending[SLEEP_PENDING_MAX];
+
+  uint8_t crc;
+} sleep_state_t;
+
+// Reiniciar el estado tras un arranque en frío
+void sleep_state_reset(sleep_state_t *state, float temp_threshold);
+// Verificar que la memoria RTC contiene un estado íntegro
+bool sleep_state_valid(const sleep_state_t *state);
+// Reubicar las muestras pendientes en el reloj del nuevo ciclo
+void sleep_state_wake(sleep_state_t *state, int64_t now_ms);
+// Cerrar el ciclo: retorna los microsegundos a dormir y sella el estado
+uint64_t sleep_state_prepare(sleep_state_t *state, int64_t now_ms,
+                             int64_t cycle_start_ms, uint32_t period_ms);
+
+// Muestras pendientes; al llenarse se descarta la más antigua
+void sleep_pending_push(sleep_state_t *state, const telemetry_sample_t *sample);
+const telemetry_sample_t *sleep_pending_get(const sleep_state_t *state,
+                                            size_t index);
+void sleep_pending_clear(sleep_state_t *state);
+// Decidir si este ciclo debe levantar la red para publicar
+bool sleep_should_connect(const sleep_state_t *state);
+
+#endif // SLEEP_UTILS_H
@@ -0,0 +1,77 @@
+/*******************************************************************************
+ * @file        stats_utils.h
+ * @brief       Histogramas de latencia por etapa (lectura del sensor,
+ *              codificación, publicación, RPC, puntualidad del muestreo y
+ *              reconexión)
+ *              con escala logarítmica y contadores atómicos, sin bloqueos.
+ *              Con STATS_ENABLED en 0 las macros de medición desaparecen del
+ *              código.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#ifndef STATS_UTILS_H
+#define STATS_UTILS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef STATS_ENABLED
+#define STATS_ENABLED 1
+#endif
+
+// Intervalo de la clave "diagnostics" en la telemetría; 0 la desactiva
+#ifndef STATS_REPORT_INTERVAL_MS
+#define STATS_REPORT_INTERVAL_MS 600000
+#endif
+
+// El cubo i cuenta duraciones en [2^(i-1), 2^i) us; el último acumula el
+// resto (más de 4 s)
+#define STATS_BUCKETS 24
+
+typedef enum {
+  STATS_STAGE_DHT_READ,
+  STATS_STAGE_ENCODE,
+  STATS_STAGE_PUBLISH,
+  STATS_STAGE_RPC,
+  STATS_STAGE_SAMPLE_JITTER, // retraso de cada muestra respecto a su plazo
+  STATS_STAGE_TLS_HANDSHAKE, // CPU de cada saludo TLS, sin las esperas de red
+  STATS_STAGE_MQTT_RECONNECT, // desde que se cae la conexión hasta el CONNACK
+  STATS_STAGE_NET_RECOVER, // desde que se pierde la IP hasta recuperarla
+  STATS_STAGE_COUNT,
+} stats_stage_t;
+
+typedef enum {
+  STATS_COUNTER_READ_RETRY,
+  STATS_COUNTER_READ_FAILURE,
+  STATS_COUNTER_TLS_FULL,
+  STATS_COUNTER_TLS_RESUMED,
+  STATS_COUNTER_COUNT,
+} stats_counter_t;
+
+#if STATS_ENABLED
+
+#include "hal.h"
+
+void stats_record(stats_stage_t stage, int64_t elapsed_us);
+void stats_count(stats_counter_t counter);
+// Formatear los histogramas como JSON; retorna la longitud o 0
+int stats_format(char *buf, size_t size);
+
+#define STATS_BEGIN(start) int64_t start = hal_time_us()
+#define STATS_END(stage, start) stats_record((stage), hal_time_us() - (start))
+#define STATS_RECORD(stage, elapsed_us) stats_record((stage), (elapsed_us))
+#define STATS_COUNT(counter) stats_count(counter)
+
+#else
+
+#define STATS_BEGIN(start)
+#define STATS_END(stage, start)
+#define STATS_RECORD(stage, elapsed_us)
+#define STATS_COUNT(counter)
+
+#endif // STATS_ENABLED
+
+#endif // STATS_UTILS_H
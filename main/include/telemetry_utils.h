@@ -0,0 +1,114 @@
+/*******************************************************************************
+ * @file        telemetry_utils.h
+ * @brief       Búfer circular de muestras con marca de tiempo y publicación
+ *              por lotes hacia ThingsBoard.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#ifndef TELEMETRY_UTILS_H
+#define TELEMETRY_UTILS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define TELEMETRY_TOPIC "v1/devices/me/telemetry"
+
+// Publicar al acumular esta cantidad de muestras... Con 1 cada lectura se
+// publica apenas llega; agrupar es opcional porque retrasa el tablero hasta
+// TELEMETRY_MAX_AGE_MS. Las muestras que quedan pendientes porque la bandeja
+// de salida está llena o porque SNTP aún no sincroniza se envían agrupadas de
+// todos modos.
+#ifndef TELEMETRY_BATCH_SIZE
+#define TELEMETRY_BATCH_SIZE 1
+#endif
+
+// ...o cuando la muestra más antigua tenga esta edad
+#ifndef TELEMETRY_MAX_AGE_MS
+#define TELEMETRY_MAX_AGE_MS 60000
+#endif
+
+// Solo se publica un valor si se aleja del último publicado más que esto
+#ifndef TELEMETRY_DEADBAND_TEMPERATURE
+#define TELEMETRY_DEADBAND_TEMPERATURE 0.5
+#endif
+
+#ifndef TELEMETRY_DEADBAND_HUMIDITY
+#define TELEMETRY_DEADBAND_HUMIDITY 1.0
+#endif
+
+// Cada cuántas muestras se publica el estado completo
+#ifndef TELEMETRY_KEYFRAME_INTERVAL
+#define TELEMETRY_KEYFRAME_INTERVAL 15
+#endif
+
+#define TELEMETRY_RING_SIZE 32
+#define TELEMETRY_PAYLOAD_SIZE 2048
+
+// Antes de esta fecha (2020) se considera que SNTP no ha sincronizado
+#define TELEMETRY_MIN_VALID_EPOCH_S 1577836800
+
+// Sensores adicionales al principal (HAL_DHT_MAX_SENSORS - 1); se publican
+// como temperature2/humidity2 en adelante
+#define TELEMETRY_AUX_SENSORS 3
+
+// Claves de la telemetría; cada muestra lleva una máscara de las que publica
+typedef enum {
+  TELEMETRY_KEY_TEMPERATURE,
+  TELEMETRY_KEY_HUMIDITY,
+  TELEMETRY_KEY_BUZZER,
+  TELEMETRY_KEY_BUZZER_MODE,
+  TELEMETRY_KEY_TEMP_THRESHOLD,
+  TELEMETRY_KEY_MODE,
+  TELEMETRY_KEY_LED1,
+  TELEMETRY_KEY_LED2,
+  TELEMETRY_KEY_LED3,
+  TELEMETRY_KEY_AUX_FIRST, // temperatura y humedad de cada sensor adicional
+  TELEMETRY_KEY_COUNT = TELEMETRY_KEY_AUX_FIRST + 2 * TELEMETRY_AUX_SENSORS,
+} telemetry_key_t;
+
+#define TELEMETRY_KEYS_ALL ((1 << TELEMETRY_KEY_COUNT) - 1)
+#define TELEMETRY_KEY_AUX_TEMPERATURE(n) (TELEMETRY_KEY_AUX_FIRST + 2 * (n))
+#define TELEMETRY_KEY_AUX_HUMIDITY(n) (TELEMETRY_KEY_AUX_FIRST + 2 * (n) + 1)
+#define TELEMETRY_KEYS_AUX(n)                                                  \
+  ((1 << TELEMETRY_KEY_AUX_TEMPERATURE(n)) | (1 << TELEMETRY_KEY_AUX_HUMIDITY(n)))
+
+typedef struct {
+  int64_t mono_ms; // reloj monotónico al momento de la captura
+  uint16_t keys;   // máscara de claves a publicar
+  float temperature; // sensor principal, el que gobierna el control
+  float humidity;
+  float aux_temperature[TELEMETRY_AUX_SENSORS];
+  float aux_humidity[TELEMETRY_AUX_SENSORS];
+  uint8_t aux_valid; // bit n = el sensor adicional n tiene lectura
+  float temp_threshold;
+  bool buzzer;
+  bool buzzer_manual;
+  bool automatic_mode;
+  uint8_t leds; // bit i = estado del LED i+1
+} telemetry_sample_t;
+
+void telemetry_init(void);
+void telemetry_push(const telemetry_sample_t *sample);
+size_t telemetry_pending(void);
+bool telemetry_should_flush(int64_t now_ms);
+// Publicar el anillo en lotes con marca de tiempo. Retorna 0 si quedó vacío
+// y -1 si algo sigue pendiente: la bandeja rechazó un envío o aún no hay hora
+// real.
+int telemetry_flush(void);
+
+// Calcular qué claves cambiaron respecto a lo último publicado y guardarlas
+// en sample->keys. Retorna la máscara; 0 si no hay nada que publicar.
+uint16_t telemetry_diff(telemetry_sample_t *sample);
+// Todas las claves con valor en la muestra, para publicarla completa
+uint16_t telemetry_sample_keys(const telemetry_sample_t *sample);
+// Forzar que la siguiente muestra se publique completa
+void telemetry_force_keyframe(void);
+
+// Diferencia entre la hora real y el reloj monotónico, 0 si no hay SNTP
+int64_t telemetry_epoch_offset_ms(void);
+
+#endif // TELEMETRY_UTILS_H
@@ -0,0 +1,51 @@
+/*******************************************************************************
+ * @file        tls_scan.h
+ * @brief       Seguimiento de los mensajes en claro del saludo TLS 1.2 que
+ *              envía el servidor, para saber si reanudó la sesión ofrecida:
+ *              en ese caso pasa del ServerHello al ChangeCipherSpec sin
+ *              mandar su certificado. En TLS 1.3 el certificado va cifrado,
+ *              por eso el transporte limita la versión a 1.2.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#ifndef TLS_SCAN_H
+#define TLS_SCAN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Tipos de registro y de mensaje de saludo de TLS 1.2
+#define TLS_RECORD_HEADER 5
+#define TLS_RECORD_CHANGE_CIPHER_SPEC 20
+#define TLS_RECORD_HANDSHAKE 22
+#define TLS_HANDSHAKE_HEADER 4
+#define TLS_HANDSHAKE_CERTIFICATE 11
+
+typedef struct {
+  bool active;
+  bool certificate;    // el servidor mandó un mensaje Certificate
+  bool change_cipher;  // llegó el ChangeCipherSpec: el saludo en claro terminó
+  uint8_t record_type;
+  uint8_t header_pos;
+  uint8_t message_pos;
+  uint32_t header;
+  uint32_t message;
+  uint32_t record_left;
+  uint32_t message_left;
+} tls_scan_t;
+
+// Empezar con el primer byte que envía el servidor
+void tls_scan_start(tls_scan_t *scan);
+
+// Pasar los bytes recibidos tal como llegan, en trozos de cualquier tamaño;
+// después del ChangeCipherSpec se ignoran
+void tls_scan_feed(tls_scan_t *scan, const uint8_t *data, size_t len);
+
+// La sesión ofrecida se reanudó: el saludo en claro terminó sin certificado
+bool tls_scan_resumed(const tls_scan_t *scan);
+
+#endif // TLS_SCAN_H
@@ -0,0 +1,37 @@
+/*******************************************************************************
+ * @file        tls_utils.h
+ * @brief       Transporte TLS 1.2 para esp-mqtt que reanuda la sesión en
+ *              cada reconexión: guarda el ticket o el ID de sesión del
+ *              corredor en NVS, que sobrevive al sueño profundo y a los
+ *              reinicios, para evitar el saludo completo, y mide el costo de
+ *              cada saludo.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#ifndef TLS_UTILS_H
+#define TLS_UTILS_H
+
+#include "esp_transport.h"
+
+// Tamaño máximo de la sesión serializada. Con
+// CONFIG_MBEDTLS_SSL_KEEP_PEER_CERTIFICATE incluye el certificado del
+// corredor (entre 1 y 2 KB) además del ticket; si no cabe, cada conexión
+// hace el saludo completo
+#ifndef TLS_SESSION_MAX
+#define TLS_SESSION_MAX 3072
+#endif
+
+#define TLS_SERVER_NAME_SIZE 64
+
+// Crear el transporte; server_name se usa para SNI y para verificar el
+// certificado aunque la conexión vaya a la dirección IP guardada
+esp_transport_handle_t tls_transport_create(const char *server_name);
+
+// Socket de la conexión en curso, -1 si no hay; sirve para leer la dirección
+// del corredor sin volver a resolver su nombre
+int tls_transport_socket(esp_transport_handle_t t);
+
+#endif // TLS_UTILS_H
@@ -1,6 +1,7 @@
 /*******************************************************************************
  * @file        led_utils.c
- * @brief       Funciones para controlar los LEDs basados en el umbral de humedad.
+ * @brief       Funciones para controlar los LEDs, de forma manual o según las
+ *              reglas del modo automático.
  * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
  * @date        30/8/2025
  * @version     1.0.0
@@ -8,33 +9,25 @@
  ******************************************************************************/
 
 #include "led_utils.h"
-#include "driver/gpio.h"
 #include "esp_log.h"
-#include "mqtt_client.h"
+#include "hal.h"
+#include "log_utils.h"
 
 static led_t leds[3] = {
-    {GPIO_NUM_5, 50.0, false, false},
-    {GPIO_NUM_22, 65.0, false, false},
-    {GPIO_NUM_21, 80.0, false, false},
+    {5, false, false},
+    {22, false, false},
+    {21, false, false},
 };
 
 static const char *TAG = "LED_CONTROL";
-extern esp_mqtt_client_handle_t mqtt_client;
 
 // Inicializar los LEDs
 void leds_init(void) {
-  gpio_config_t io_conf = {
-      .mode = GPIO_MODE_OUTPUT,
-      .pull_up_en = GPIO_PULLUP_DISABLE,
-      .pull_down_en = GPIO_PULLDOWN_DISABLE,
-      .intr_type = GPIO_INTR_DISABLE,
-  };
-  io_conf.pin_bit_mask =
-      (1ULL << leds[0].gpio) | (1ULL << leds[1].gpio) | (1ULL << leds[2].gpio);
-  gpio_config(&io_conf);
+  hal_gpio_config_output((1ULL << leds[0].gpio) | (1ULL << leds[1].gpio) |
+                         (1ULL << leds[2].gpio));
 
   for (int i = 0; i < 3; i++) {
-    gpio_set_level(leds[i].gpio, 0);
+    hal_gpio_set_level(leds[i].gpio, 0);
     leds[i].state = false;
     leds[i].manual_override = false;
   }
@@ -51,31 +44,21 @@ void led_set(uint8_t led_number, bool on, bool manual) {
     led->manual_override = true;
   }
 
-  gpio_set_level(led->gpio, on ? 1 : 0);
+  hal_gpio_set_level(led->gpio, on ? 1 : 0);
   led->state = on;
 
-  ESP_LOGI(TAG, "LED %d turned %s %s", led_number, on ? "ON" : "OFF",
-           manual ? "(manual)" : "(auto)");
-
-  // Publicar el estado del LED a través de MQTT
-  if (mqtt_client != NULL) {
-    char payload[64];
-    snprintf(payload, sizeof(payload), "{\"led%d\":%d}", led_number,
-             on ? 1 : 0);
-    esp_mqtt_client_publish(mqtt_client, "v1/devices/me/telemetry", payload, 0,
-                            1, 0);
-  }
+  DLOGI(TAG, "LED %d turned %s %s", led_number, on ? "ON" : "OFF",
+        manual ? "(manual)" : "(auto)");
 }
 
-// Automáticamente actualizar los LEDs según la humedad
-void leds_update_by_humidity(float humidity) {
+// Llevar los LEDs que no están en manual al estado pedido por las reglas
+// (bit i = LED i+1)
+void leds_update_auto(uint8_t states) {
   for (int i = 0; i < 3; i++) {
     led_t *led = &leds[i];
-    if (!led->manual_override) {
-      bool should_turn_on = humidity > led->humidity_threshold;
-      if (led->state != should_turn_on) {
-        led_set(i + 1, should_turn_on, false); // manual = false
-      }
+    bool should_turn_on = states & (1 << i);
+    if (!led->manual_override && led->state != should_turn_on) {
+      led_set(i + 1, should_turn_on, false); // manual = false
     }
   }
 }
@@ -86,3 +69,16 @@ void led_reset_manual_override(uint8_t led_number) {
     return;
   leds[led_number - 1].manual_override = false;
 }
+
+// Estado actual de un LED, se publica junto con cada muestra de telemetría
+bool led_get_state(uint8_t led_number) {
+  if (led_number < 1 || led_number > 3)
+    return false;
+  return leds[led_number - 1].state;
+}
+
+bool led_is_manual(uint8_t led_number) {
+  if (led_number < 1 || led_number > 3)
+    return false;
+  return leds[led_number - 1].manual_override;
+}
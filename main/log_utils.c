@@ -0,0 +1,272 @@
+/*******************************************************************************
+ * @file        log_utils.c
+ * @brief       Registro diferido sobre un anillo sin bloqueos de varios
+ *              productores y un solo consumidor. El formateo y la escritura
+ *              en la UART ocurren en una tarea de baja prioridad.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "log_utils.h"
+
+#if LOG_DEFERRED
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+_Static_assert((LOG_RING_SIZE & (LOG_RING_SIZE - 1)) == 0,
+               "LOG_RING_SIZE must be a power of two");
+
+#define LOG_LINE_SIZE 160
+#define LOG_DRAIN_INTERVAL_MS 50
+
+// La secuencia dice a quién le toca la celda: igual a la posición de
+// escritura si está libre, una más si ya tiene un registro por expandir
+typedef struct {
+  atomic_uint_least32_t sequence;
+  uint32_t timestamp;
+  const char *tag;
+  const char *format;
+  uint8_t level;
+  uint8_t argc;
+  log_arg_t argv[LOG_MAX_ARGS];
+} log_record_t;
+
+// Ventana de un segundo por etiqueta; la etiqueta se compara por puntero
+typedef struct {
+  atomic_uintptr_t tag;
+  atomic_uint_least32_t second;
+  atomic_uint_least32_t count;
+  atomic_uint_least32_t suppressed;
+} log_limit_t;
+
+static const char *TAG = "LOG";
+
+static log_record_t ring[LOG_RING_SIZE];
+static atomic_uint_least32_t write_pos;
+static uint32_t read_pos; // protegido por drain_lock
+static atomic_uint_least32_t lost;
+static log_limit_t limits[LOG_MAX_TAGS];
+static SemaphoreHandle_t drain_lock = NULL;
+static atomic_bool ready;
+
+// Contar el mensaje en la ventana de su etiqueta; false si excede el límite
+static bool log_allow(const char *tag, uint32_t now_ms) {
+  uint32_t second = now_ms / 1000;
+
+  for (int i = 0; i < LOG_MAX_TAGS; i++) {
+    log_limit_t *limit = &limits[i];
+    uintptr_t owner = 0;
+
+    if (!atomic_compare_exchange_strong(&limit->tag, &owner, (uintptr_t)tag) &&
+        owner != (uintptr_t)tag)
+      continue;
+
+    uint_least32_t current =
+        atomic_load_explicit(&limit->second, memory_order_relaxed);
+    if (current != second &&
+        atomic_compare_exchange_strong(&limit->second, &current, second))
+      atomic_store_explicit(&limit->count, 0, memory_order_relaxed);
+
+    if (atomic_fetch_add_explicit(&limit->count, 1, memory_order_relaxed) <
+        LOG_RATE_PER_TAG)
+      return true;
+    atomic_fetch_add_explicit(&limit->suppressed, 1, memory_order_relaxed);
+    return false;
+  }
+  return true; // sin espacio para la etiqueta, no se limita
+}
+
+// Expandir el formato con los argumentos guardados. Soporta banderas, ancho,
+// precisión y modificadores de longitud, pero no '*'.
+static void log_format(char *out, size_t size, const char *format, int argc,
+                       const log_arg_t *argv) {
+  char spec[16];
+  size_t len = 0;
+  int arg = 0;
+
+  while (*format && len + 1 < size) {
+    if (format[0] != '%' || format[1] == '%') {
+      out[len++] = *format;
+      format += format[0] == '%' ? 2 : 1;
+      continue;
+    }
+
+    const char *start = format++;
+    while (*format && !strchr("diouxXcsfFeEgGp", *format))
+      format++;
+    if (!*format || (size_t)(format + 1 - start) >= sizeof(spec) ||
+        arg >= argc)
+      break;
+    char conversion = *format++;
+    memcpy(spec, start, format - start);
+    spec[format - start] = 0;
+
+    const log_arg_t *value = &argv[arg++];
+    size_t room = size - len;
+    int n;
+    switch (conversion) {
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+      n = snprintf(out + len, room, spec, value->f);
+      break;
+    case 's':
+      n = snprintf(out + len, room, spec,
+                   value->p ? (const char *)value->p : "(null)");
+      break;
+    case 'p':
+      n = snprintf(out + len, room, spec, value->p);
+      break;
+    default:
+      if (strstr(spec, "ll") || strchr(spec, 'j'))
+        n = snprintf(out + len, room, spec, (long long)value->i);
+      else if (strchr(spec, 'l'))
+        n = snprintf(out + len, room, spec, (long)value->i);
+      else if (strchr(spec, 'z'))
+        n = snprintf(out + len, room, spec, (size_t)value->i);
+      else
+        n = snprintf(out + len, room, spec, (int)value->i);
+      break;
+    }
+    if (n < 0)
+      break;
+    len += (size_t)n < room ? (size_t)n : room - 1;
+  }
+  out[len] = 0;
+}
+
+// Escribir con el formato de ESP_LOGx pero con la hora del registro
+static void log_emit(esp_log_level_t level, const char *tag,
+                     uint32_t timestamp, const char *format, int argc,
+                     const log_arg_t *argv) {
+  char line[LOG_LINE_SIZE];
+
+  log_format(line, sizeof(line), format, argc, argv);
+  esp_log_write(level, tag, "%c (%lu) %s: %s\n", "?EWIDV"[level],
+                (unsigned long)timestamp, tag, line);
+}
+
+void log_defer(esp_log_level_t level, const char *tag, const char *format,
+               int argc, const log_arg_t *argv) {
+  uint32_t now_ms = esp_log_timestamp();
+
+  if (!log_allow(tag, now_ms))
+    return;
+  if (argc > LOG_MAX_ARGS)
+    argc = LOG_MAX_ARGS;
+
+  // Antes de log_init no hay tarea que expanda: escribir directamente
+  if (!atomic_load_explicit(&ready, memory_order_acquire)) {
+    log_emit(level, tag, now_ms, format, argc, argv);
+    return;
+  }
+
+  // Reservar una celda libre avanzando la posición de escritura
+  uint_least32_t pos = atomic_load_explicit(&write_pos, memory_order_relaxed);
+  log_record_t *record;
+  while (1) {
+    record = &ring[pos & (LOG_RING_SIZE - 1)];
+    uint32_t sequence =
+        atomic_load_explicit(&record->sequence, memory_order_acquire);
+    int32_t diff = (int32_t)(sequence - pos);
+
+    if (diff == 0) {
+      if (atomic_compare_exchange_weak_explicit(&write_pos, &pos, pos + 1,
+                                                memory_order_relaxed,
+                                                memory_order_relaxed))
+        break;
+    } else if (diff < 0) {
+      atomic_fetch_add_explicit(&lost, 1, memory_order_relaxed);
+      return;
+    } else {
+      pos = atomic_load_explicit(&write_pos, memory_order_relaxed);
+    }
+  }
+
+  record->timestamp = now_ms;
+  record->tag = tag;
+  record->format = format;
+  record->level = level;
+  record->argc = argc;
+  memcpy(record->argv, argv, argc * sizeof(log_arg_t));
+  atomic_store_explicit(&record->sequence, pos + 1, memory_order_release);
+}
+
+void log_flush(void) {
+  if (drain_lock == NULL)
+    return;
+  xSemaphoreTake(drain_lock, portMAX_DELAY);
+
+  while (1) {
+    log_record_t *record = &ring[read_pos & (LOG_RING_SIZE - 1)];
+    if (atomic_load_explicit(&record->sequence, memory_order_acquire) !=
+        read_pos + 1)
+      break;
+
+    // Copiar y liberar la celda antes de la parte lenta
+    log_record_t copy = {
+        .timestamp = record->timestamp,
+        .tag = record->tag,
+        .format = record->format,
+        .level = record->level,
+        .argc = record->argc,
+    };
+    memcpy(copy.argv, record->argv, sizeof(copy.argv));
+    atomic_store_explicit(&record->sequence, read_pos + LOG_RING_SIZE,
+                          memory_order_release);
+    read_pos++;
+
+    log_emit(copy.level, copy.tag, copy.timestamp, copy.format, copy.argc,
+             copy.argv);
+  }
+
+  for (int i = 0; i < LOG_MAX_TAGS; i++) {
+    uint32_t suppressed = atomic_exchange(&limits[i].suppressed, 0);
+    if (suppressed > 0)
+      ESP_LOGW((const char *)atomic_load(&limits[i].tag),
+               "%lu messages suppressed", (unsigned long)suppressed);
+  }
+  uint32_t dropped = atomic_exchange(&lost, 0);
+  if (dropped > 0)
+    ESP_LOGW(TAG, "Ring full, %lu messages lost", (unsigned long)dropped);
+
+  xSemaphoreGive(drain_lock);
+}
+
+static void log_task(void *pvParameters) {
+  while (1) {
+    log_flush();
+    vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_INTERVAL_MS));
+  }
+}
+
+esp_err_t log_init(void) {
+  if (drain_lock != NULL)
+    return ESP_OK;
+
+  for (uint32_t i = 0; i < LOG_RING_SIZE; i++)
+    atomic_init(&ring[i].sequence, i);
+
+  drain_lock = xSemaphoreCreateMutex();
+  if (drain_lock == NULL)
+    return ESP_ERR_NO_MEM;
+  if (xTaskCreate(log_task, "log_task", LOG_TASK_STACK_SIZE, NULL,
+                  LOG_TASK_PRIORITY, NULL) != pdPASS)
+    return ESP_ERR_NO_MEM;
+
+  atomic_store_explicit(&ready, true, memory_order_release);
+  return ESP_OK;
+}
+
+#endif // LOG_DEFERRED
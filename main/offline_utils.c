@@ -0,0 +1,418 @@
+/*******************************************************************************
+ * @file        offline_utils.c
+ * @brief       Cola persistente en flash para almacenar muestras mientras no
+ *              hay conexión MQTT y reenviarlas al reconectar.
+ *
+ *              La partición se usa como un registro circular de registros de
+ *              16 bytes. Un registro se escribe una sola vez; al publicarse
+ *              se marca como consumido reescribiendo su marcador (la flash
+ *              solo cambia bits de 1 a 0), y el sector siguiente se borra
+ *              antes de entrar en él, así el desgaste se reparte en toda la
+ *              partición y tras un reinicio basta un recorrido para
+ *              reconstruir la cabeza y la cola.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "offline_utils.h"
+#include "encoder_utils.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "hal.h"
+#include "nvs.h"
+#include "publish_utils.h"
+#include "stats_utils.h"
+#include <stdio.h>
+#include <string.h>
+
+#define OFFLINE_MARK_ERASED 0xFF
+#define OFFLINE_MARK_VALID 0xA5
+#define OFFLINE_MARK_CONSUMED 0x00
+
+#define OFFLINE_FLAG_BUZZER (1 << 0)
+#define OFFLINE_FLAG_BUZZER_MANUAL (1 << 1)
+#define OFFLINE_FLAG_AUTOMATIC (1 << 2)
+#define OFFLINE_FLAG_LEDS_SHIFT 3           // 3 bits, uno por LED
+#define OFFLINE_FLAG_MONOTONIC (1 << 6)     // time_s es del reloj monotónico
+
+#define OFFLINE_SCAN_CHUNK 32 // registros leídos por acceso a flash
+
+typedef struct __attribute__((packed)) {
+  uint32_t time_s;        // segundos epoch, o monotónicos si no hay SNTP
+  int16_t temperature;    // décimas de °C
+  uint16_t humidity;      // décimas de %
+  int16_t temp_threshold; // décimas de °C
+  uint8_t flags;
+  uint8_t boot;  // arranque en que se capturó, para el reloj monotónico
+  uint8_t reserved[2];
+  uint8_t crc;
+  uint8_t marker; // último byte: un registro a medio escribir no es válido
+} offline_record_t;
+
+_Static_assert(sizeof(offline_record_t) == OFFLINE_RECORD_SIZE,
+               "offline record must be 16 bytes");
+
+static const char *TAG = "OFFLINE";
+
+static const esp_partition_t *partition = NULL;
+static size_t slots = 0;        // registros que caben en la partición
+static size_t head = 0;         // registro pendiente más antiguo
+static size_t tail = 0;         // siguiente posición libre
+static size_t pending = 0;      // registros válidos sin publicar
+static uint8_t boot_id = 0;
+static uint8_t payload[OFFLINE_PAYLOAD_SIZE];
+
+static uint8_t offline_crc8(const uint8_t *data, size_t len) {
+  uint8_t crc = 0;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (int b = 0; b < 8; b++) {
+      crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+static bool offline_record_valid(const offline_record_t *record) {
+  return record->marker == OFFLINE_MARK_VALID &&
+         record->crc == offline_crc8((const uint8_t *)record,
+                                     offsetof(offline_record_t, crc));
+}
+
+static void offline_encode(const telemetry_sample_t *sample,
+                           offline_record_t *record) {
+  int64_t offset = telemetry_epoch_offset_ms();
+
+  memset(record, 0, sizeof(*record));
+  if (offset != 0) {
+    record->time_s = (sample->mono_ms + offset) / 1000;
+  } else {
+    record->time_s = sample->mono_ms / 1000;
+    record->flags |= OFFLINE_FLAG_MONOTONIC;
+  }
+  record->temperature = (int16_t)(sample->temperature * 10);
+  record->humidity = (uint16_t)(sample->humidity * 10);
+  record->temp_threshold = (int16_t)(sample->temp_threshold * 10);
+  record->flags |= (sample->buzzer ? OFFLINE_FLAG_BUZZER : 0) |
+                   (sample->buzzer_manual ? OFFLINE_FLAG_BUZZER_MANUAL : 0) |
+                   (sample->automatic_mode ? OFFLINE_FLAG_AUTOMATIC : 0) |
+                   ((sample->leds & 0x07) << OFFLINE_FLAG_LEDS_SHIFT);
+  record->boot = boot_id;
+  record->crc =
+      offline_crc8((const uint8_t *)record, offsetof(offline_record_t, crc));
+  record->marker = OFFLINE_MARK_VALID;
+}
+
+// Convertir un registro a muestra; retorna la marca de tiempo epoch en ms,
+// o 0 si es monotónica y aún no hay hora real, o si es de un arranque
+// anterior y ya no se puede recuperar (ver offline_record_stale)
+static int64_t offline_decode(const offline_record_t *record,
+                              telemetry_sample_t *sample) {
+  // Los sensores adicionales no se guardan en el registro
+  sample->aux_valid = 0;
+  sample->keys = telemetry_sample_keys(sample);
+  sample->temperature = record->temperature / 10.0f;
+  sample->humidity = record->humidity / 10.0f;
+  sample->temp_threshold = record->temp_threshold / 10.0f;
+  sample->buzzer = record->flags & OFFLINE_FLAG_BUZZER;
+  sample->buzzer_manual = record->flags & OFFLINE_FLAG_BUZZER_MANUAL;
+  sample->automatic_mode = record->flags & OFFLINE_FLAG_AUTOMATIC;
+  sample->leds = (record->flags >> OFFLINE_FLAG_LEDS_SHIFT) & 0x07;
+
+  if (!(record->flags & OFFLINE_FLAG_MONOTONIC)) {
+    sample->mono_ms = 0;
+    return (int64_t)record->time_s * 1000;
+  }
+
+  sample->mono_ms = (int64_t)record->time_s * 1000;
+  int64_t offset = telemetry_epoch_offset_ms();
+  if (record->boot != boot_id || offset == 0)
+    return 0;
+  return sample->mono_ms + offset;
+}
+
+// Registro con hora monotónica de un arranque anterior: el reloj empezó de
+// nuevo en 0 y no hay forma de saber cuándo se capturó
+static bool offline_record_stale(const offline_record_t *record) {
+  return (record->flags & OFFLINE_FLAG_MONOTONIC) && record->boot != boot_id;
+}
+
+// Un registro a medio escribir tiene el marcador aún borrado pero el resto
+// no; solo un registro completamente en 0xFF sirve para escribir encima
+static bool offline_record_erased(const offline_record_t *record) {
+  const uint8_t *bytes = (const uint8_t *)record;
+  for (size_t i = 0; i < sizeof(*record); i++) {
+    if (bytes[i] != 0xFF)
+      return false;
+  }
+  return true;
+}
+
+static esp_err_t offline_read(size_t slot, offline_record_t *records,
+                              size_t count) {
+  return esp_partition_read(partition, slot * OFFLINE_RECORD_SIZE, records,
+                            count * OFFLINE_RECORD_SIZE);
+}
+
+// Recorrer la partición completa en bloques, entregando cada registro a un
+// callback, con memoria acotada
+typedef void (*offline_scan_cb_t)(size_t slot, const offline_record_t *record,
+                                  void *ctx);
+
+static esp_err_t offline_scan(size_t start, offline_scan_cb_t cb, void *ctx) {
+  offline_record_t chunk[OFFLINE_SCAN_CHUNK];
+  size_t done = 0;
+
+  while (done < slots) {
+    size_t slot = (start + done) % slots;
+    size_t count = slots - slot;
+    if (count > OFFLINE_SCAN_CHUNK)
+      count = OFFLINE_SCAN_CHUNK;
+    if (count > slots - done)
+      count = slots - done;
+
+    esp_err_t ret = offline_read(slot, chunk, count);
+    if (ret != ESP_OK)
+      return ret;
+    for (size_t i = 0; i < count; i++) {
+      cb(slot + i, &chunk[i], ctx);
+    }
+    done += count;
+  }
+  return ESP_OK;
+}
+
+typedef struct {
+  bool prev_erased;
+  bool found;
+  size_t tail;
+  bool any_written;
+} offline_tail_scan_t;
+
+// La cola es el primer registro borrado que sigue a uno escrito. Un registro
+// cortado por un reinicio cuenta como escrito: se salta en vez de reescribirlo.
+static void offline_find_tail(size_t slot, const offline_record_t *record,
+                              void *ctx) {
+  offline_tail_scan_t *scan = ctx;
+  bool erased = offline_record_erased(record);
+  if (!erased)
+    scan->any_written = true;
+  if (!scan->found && erased && !scan->prev_erased) {
+    scan->found = true;
+    scan->tail = slot;
+  }
+  scan->prev_erased = erased;
+}
+
+// Desde la cola, los registros aparecen del más antiguo al más reciente
+static void offline_count_pending(size_t slot, const offline_record_t *record,
+                                  void *ctx) {
+  bool *found_head = ctx;
+  if (offline_record_valid(record)) {
+    if (!*found_head) {
+      *found_head = true;
+      head = slot;
+    }
+    pending++;
+  }
+}
+
+static uint8_t offline_next_boot_id(void) {
+  nvs_handle_t nvs;
+  uint8_t id = 0;
+  if (nvs_open("offline", NVS_READWRITE, &nvs) == ESP_OK) {
+    nvs_get_u8(nvs, "boot", &id);
+    id++;
+    nvs_set_u8(nvs, "boot", id);
+    nvs_commit(nvs);
+    nvs_close(nvs);
+  }
+  return id;
+}
+
+static esp_err_t offline_erase_sector(size_t slot) {
+  size_t offset = (slot * OFFLINE_RECORD_SIZE) / OFFLINE_SECTOR_SIZE *
+                  OFFLINE_SECTOR_SIZE;
+  return esp_partition_erase_range(partition, offset, OFFLINE_SECTOR_SIZE);
+}
+
+esp_err_t offline_init(void) {
+  partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                       OFFLINE_PARTITION_SUBTYPE,
+                                       OFFLINE_PARTITION_LABEL);
+  if (partition == NULL) {
+    ESP_LOGE(TAG, "Partition '%s' not found", OFFLINE_PARTITION_LABEL);
+    return ESP_ERR_NOT_FOUND;
+  }
+
+  slots = partition->size / OFFLINE_RECORD_SIZE;
+  boot_id = offline_next_boot_id();
+
+  // Iniciar con el último registro como previo para detectar la vuelta
+  offline_record_t last;
+  esp_err_t ret = offline_read(slots - 1, &last, 1);
+  if (ret != ESP_OK)
+    return ret;
+
+  offline_tail_scan_t scan = {.prev_erased = offline_record_erased(&last)};
+  ret = offline_scan(0, offline_find_tail, &scan);
+  if (ret != ESP_OK)
+    return ret;
+
+  if (scan.found) {
+    tail = scan.tail;
+  } else {
+    // Partición vacía, o sin ningún hueco borrado: empezar de cero
+    tail = 0;
+    if (scan.any_written) {
+      ESP_LOGW(TAG, "Log has no free slot, erasing partition");
+      ret = esp_partition_erase_range(partition, 0, partition->size);
+      if (ret != ESP_OK)
+        return ret;
+    }
+  }
+
+  bool found_head = false;
+  pending = 0;
+  head = tail;
+  ret = offline_scan(tail, offline_count_pending, &found_head);
+  if (ret != ESP_OK)
+    return ret;
+
+  ESP_LOGI(TAG, "Offline log: %u slots, %u pending records", (unsigned)slots,
+           (unsigned)pending);
+  return ESP_OK;
+}
+
+esp_err_t offline_append(const telemetry_sample_t *sample) {
+  if (partition == NULL)
+    return ESP_ERR_INVALID_STATE;
+
+  offline_record_t record;
+  offline_encode(sample, &record);
+
+  esp_err_t ret = esp_partition_write(partition, tail * OFFLINE_RECORD_SIZE,
+                                      &record, sizeof(record));
+  if (ret != ESP_OK) {
+    ESP_LOGE(TAG, "Write failed: %s", esp_err_to_name(ret));
+    return ret;
+  }
+  if (pending == 0)
+    head = tail;
+  pending++;
+  tail = (tail + 1) % slots;
+
+  // Al llenar un sector, borrar el siguiente de inmediato para que siempre
+  // exista un hueco después de la cola. Sus registros más viejos se pierden.
+  if (tail % (OFFLINE_SECTOR_SIZE / OFFLINE_RECORD_SIZE) == 0) {
+    size_t sector_slots = OFFLINE_SECTOR_SIZE / OFFLINE_RECORD_SIZE;
+    offline_record_t chunk[OFFLINE_SCAN_CHUNK];
+    size_t lost = 0;
+
+    for (size_t i = 0; i < sector_slots; i += OFFLINE_SCAN_CHUNK) {
+      if (offline_read(tail + i, chunk, OFFLINE_SCAN_CHUNK) != ESP_OK)
+        break;
+      for (size_t j = 0; j < OFFLINE_SCAN_CHUNK; j++) {
+        if (offline_record_valid(&chunk[j]))
+          lost++;
+      }
+    }
+
+    ret = offline_erase_sector(tail);
+    if (ret != ESP_OK) {
+      ESP_LOGE(TAG, "Erase failed: %s", esp_err_to_name(ret));
+      return ret;
+    }
+
+    if (lost > 0) {
+      ESP_LOGW(TAG, "Log full, dropped %u oldest records", (unsigned)lost);
+      pending -= lost;
+      head = pending > 0 ? (tail + sector_slots) % slots : tail;
+    }
+  }
+
+  return ESP_OK;
+}
+
+size_t offline_pending(void) { return pending; }
+
+int offline_drain(void) {
+  if (partition == NULL || pending == 0)
+    return 0;
+
+  offline_record_t record;
+  telemetry_sample_t sample;
+  telemetry_batch_t batch;
+  size_t slots_used[OFFLINE_DRAIN_BATCH];
+  size_t used = 0;
+  size_t stale = 0;
+  size_t slot = head;
+  const uint8_t consumed = OFFLINE_MARK_CONSUMED;
+
+  encoder_batch_begin(&batch, payload, sizeof(payload));
+  while (used + stale < OFFLINE_DRAIN_BATCH && slot != tail) {
+    if (offline_read(slot, &record, 1) != ESP_OK)
+      return -1;
+
+    if (offline_record_valid(&record)) {
+      int64_t ts_ms = offline_decode(&record, &sample);
+      if (ts_ms == 0 && offline_record_stale(&record)) {
+        // Sin marca de tiempo el corredor la fecharía al recibirla, horas
+        // después de la lectura: se descarta en lugar de publicarla
+        esp_partition_write(partition,
+                            slot * OFFLINE_RECORD_SIZE +
+                                offsetof(offline_record_t, marker),
+                            &consumed, 1);
+        stale++;
+      } else if (ts_ms == 0) {
+        // Del arranque actual: se podrá fechar cuando sincronice SNTP
+        break;
+      } else {
+        if (!encoder_batch_add(&batch, &sample, ts_ms))
+          break;
+        slots_used[used++] = slot;
+      }
+    }
+    slot = (slot + 1) % slots;
+  }
+
+  if (stale > 0) {
+    ESP_LOGW(TAG, "Dropped %u records from an earlier boot without time",
+             (unsigned)stale);
+    pending -= stale;
+  }
+  if (used == 0) {
+    head = slot;
+    return 0;
+  }
+
+  size_t len = encoder_batch_end(&batch);
+  int msg_id = -1;
+  if (len != 0) {
+    STATS_BEGIN(publish_start);
+    msg_id = publish_send(PUBLISH_STREAM_BACKLOG, batch.encoder->topic,
+                          (const char *)payload, len);
+    STATS_END(STATS_STAGE_PUBLISH, publish_start);
+  }
+  if (msg_id < 0) {
+    ESP_LOGW(TAG, "Drain publish failed, %u records pending",
+             (unsigned)pending);
+    return -1;
+  }
+
+  // Marcar como consumidos: el marcador pasa de 0xA5 a 0x00 sin borrar
+  for (size_t i = 0; i < used; i++) {
+    esp_partition_write(partition,
+                        slots_used[i] * OFFLINE_RECORD_SIZE +
+                            offsetof(offline_record_t, marker),
+                        &consumed, 1);
+  }
+  pending -= used;
+  head = slot;
+
+  ESP_LOGI(TAG, "Drained %u records, %u pending", (unsigned)used,
+           (unsigned)pending);
+  return used;
+}
@@ -2,327 +2,1353 @@
  * @file        proyecto_3_embebidos.c
  * @brief       bucle principal de la aplicación que integra DHT11, LEDs,
  *              buzzer y comunicación con ThingsBoard vía MQTT.
+ *
+ *              El trabajo se reparte en tres tareas conectadas por colas:
+ *              adquisición (lee el sensor), control (único dueño de LEDs y
+ *              buzzer, atiende lecturas y comandos RPC) y comunicaciones
+ *              (publica o almacena la telemetría). El estado de la conexión
+ *              se comunica por bits de un grupo de eventos.
  * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
  * @date        30/8/2025
  * @version     1.0.0
  *
  ******************************************************************************/
 
+#include "boot_utils.h"
 #include "buzzer_utils.h"
-#include "cJSON.h"
-#include "dht11_utils.h"
-#include "driver/gpio.h"
-#include "driver/ledc.h"
-#include "esp_event.h"
+#include "encoder_utils.h"
+#include "esp_attr.h"
+#include "esp_bit_defs.h"
 #include "esp_log.h"
-#include "esp_rom_gpio.h"
-#include "esp_sleep.h"
-#include "esp_system.h"
-#include "esp_wifi.h"
+#include "filter_utils.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/queue.h"
 #include "freertos/task.h"
+#include "gateway_utils.h"
+#include "hal.h"
+#include "history_utils.h"
+#include "http_utils.h"
 #include "led_utils.h"
-#include "mqtt_client.h"
+#include "log_utils.h"
 #include "nvs_flash.h"
+#include "offline_utils.h"
+#include "publish_utils.h"
+#include "rpc_utils.h"
+#include "rules_utils.h"
+#include "sampling_utils.h"
+#include "sleep_utils.h"
+#include "stats_utils.h"
+#include "telemetry_utils.h"
+#include <math.h>
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 
-#ifndef WIFI_SSID
-#error "WIFI_SSID must be defined using: -D WIFI_SSID=<YOUR_SSID>"
+// Configuración de ThingsBoard
+#ifndef THINGSBOARD_HOST
+#define THINGSBOARD_HOST "mqtt.thingsboard.cloud"
 #endif
+#define THINGSBOARD_ACCESS_TOKEN "EA7PtD7515SMcN240yJp"
 
-#ifndef WIFI_PASS
-#error "WIFI_PASS must be defined using: -D WIFI_PASS=<YOUR_PASSWORD>"
+// MQTTS con reanudación de la sesión TLS; el objetivo linux usa TCP
+#ifndef MQTT_TLS
+#define MQTT_TLS 1
 #endif
-
-// Configuración de ThingsBoard
-#define THINGSBOARD_HOST "mqtt.thingsboard.cloud"
+#if MQTT_TLS
+#define THINGSBOARD_PORT 8883
+#else
 #define THINGSBOARD_PORT 1883
-#define THINGSBOARD_ACCESS_TOKEN "EA7PtD7515SMcN240yJp"
+#endif
+
+// Sesión MQTT persistente: el corredor conserva la suscripción RPC y las
+// peticiones que lleguen mientras el dispositivo está desconectado
+#ifndef MQTT_PERSISTENT_SESSION
+#define MQTT_PERSISTENT_SESSION 1
+#endif
+
+// Periodo entre lecturas del sensor
+#ifndef SAMPLE_PERIOD_MS
+#define SAMPLE_PERIOD_MS 20000
+#endif
+
+// Política de muestreo al arrancar; el modo adaptativo se mueve entre
+// SAMPLING_MIN_PERIOD_MS y SAMPLING_MAX_PERIOD_MS
+#ifndef SAMPLING_MODE
+#define SAMPLING_MODE SAMPLING_MODE_FIXED
+#endif
+#ifndef SAMPLING_MIN_PERIOD_MS
+#define SAMPLING_MIN_PERIOD_MS 5000
+#endif
+#ifndef SAMPLING_MAX_PERIOD_MS
+#define SAMPLING_MAX_PERIOD_MS 120000
+#endif
+#ifndef SAMPLING_DELTA_TEMPERATURE
+#define SAMPLING_DELTA_TEMPERATURE 0.5 // °C entre muestras
+#endif
+#ifndef SAMPLING_DELTA_HUMIDITY
+#define SAMPLING_DELTA_HUMIDITY 2.0 // % entre muestras
+#endif
+#ifndef SAMPLING_THRESHOLD_MARGIN
+#define SAMPLING_THRESHOLD_MARGIN 1.0 // °C alrededor del umbral
+#endif
+
+// Umbral de temperatura más alto que acepta setTempThreshold; el DHT22 mide
+// hasta 80 °C
+#define TEMP_THRESHOLD_MAX 80.0
+
+#define SENSOR_MAX_RETRIES 3
+#define SENSOR_RETRY_DELAY_MS 2000
+
+// Sensores registrados al arrancar como {GPIO, tipo}; el primero gobierna el
+// control y los demás se publican como temperature2/humidity2 en adelante
+#ifndef DHT_SENSORS
+#define DHT_SENSORS {{23, DHT_TYPE_DHT11}}
+#endif
 
-esp_mqtt_client_handle_t mqtt_client = NULL;
+// Cadena de filtros de cada canal, en décimas: rechazo de picos, mediana y
+// EMA con alfa = 1 / 2^shift
+#ifndef FILTER_TEMPERATURE_SPIKE
+#define FILTER_TEMPERATURE_SPIKE 50 // 5.0 °C
+#endif
+#ifndef FILTER_HUMIDITY_SPIKE
+#define FILTER_HUMIDITY_SPIKE 150 // 15.0 %
+#endif
+#ifndef FILTER_SPIKE_MAX_REJECT
+#define FILTER_SPIKE_MAX_REJECT 2
+#endif
+#ifndef FILTER_MEDIAN_WINDOW
+#define FILTER_MEDIAN_WINDOW 3
+#endif
+#ifndef FILTER_EMA_SHIFT
+#define FILTER_EMA_SHIFT 1
+#endif
+
+// Tareas: la pila WiFi/MQTT corre en el núcleo 0, el sensado y el control
+// en el núcleo 1 para no competir con la red
+#define COMMS_TASK_CORE 0
+#define SENSOR_TASK_CORE 1
+#define CONTROL_TASK_CORE 1
+#define CONTROL_TASK_PRIORITY 6
+#define SENSOR_TASK_PRIORITY 5
+#define COMMS_TASK_PRIORITY 4
+#define TASK_STACK_SIZE 4096
+#define COMMS_TASK_STACK_SIZE 8192
+
+// En objetivos de un solo núcleo (o linux) no hay afinidad
+#define TASK_CORE(core) ((core) < portNUM_PROCESSORS ? (core) : tskNO_AFFINITY)
+
+#define CONTROL_QUEUE_LEN 8
+#define TELEMETRY_QUEUE_LEN 8
+
+// Bits del grupo de eventos de la aplicación
+#define MQTT_CONNECTED_BIT BIT0     // nivel: conexión activa
+#define MQTT_CONNECT_EVENT_BIT BIT1 // flanco: se acaba de conectar
+#define SAMPLE_READY_BIT BIT2       // flanco: hay muestras en la cola
+#define ENCODER_CHANGE_BIT BIT3     // flanco: hay un codificador en su buzón
+
+typedef enum {
+  CONTROL_CMD_READING,
+  CONTROL_CMD_SET_MODE,
+  CONTROL_CMD_SET_LED,
+  CONTROL_CMD_SET_BUZZER,
+  CONTROL_CMD_SET_THRESHOLD,
+  CONTROL_CMD_SET_FILTER,
+  CONTROL_CMD_SET_RULES, // el conjunto nuevo espera en rules_queue
+} control_cmd_type_t;
+
+// Conjunto de reglas que espera en su buzón, con la solicitud que la tarea
+// de control responde después de guardarlo
+typedef struct {
+  rules_t rules;
+  rpc_deferred_t reply;
+} rules_update_t;
+
+typedef enum {
+  FILTER_CHANNEL_TEMPERATURE,
+  FILTER_CHANNEL_HUMIDITY,
+  FILTER_CHANNEL_COUNT,
+} filter_channel_t;
+
+static const filter_config_t filter_defaults[FILTER_CHANNEL_COUNT] = {
+    [FILTER_CHANNEL_TEMPERATURE] = {FILTER_TEMPERATURE_SPIKE,
+                                    FILTER_SPIKE_MAX_REJECT,
+                                    FILTER_MEDIAN_WINDOW, FILTER_EMA_SHIFT},
+    [FILTER_CHANNEL_HUMIDITY] = {FILTER_HUMIDITY_SPIKE, FILTER_SPIKE_MAX_REJECT,
+                                 FILTER_MEDIAN_WINDOW, FILTER_EMA_SHIFT},
+};
+
+typedef struct {
+  control_cmd_type_t type;
+  union {
+    struct {
+      hal_dht_reading_t sensors[HAL_DHT_MAX_SENSORS];
+      int64_t mono_ms;
+    } reading;
+    struct {
+      uint8_t number;
+      bool on;
+    } led;
+    bool automatic;
+    bool buzzer_on;
+    float threshold;
+    struct {
+      filter_channel_t channel;
+      int8_t sensor; // -1 para todos los sensores
+      filter_config_t config;
+    } filter;
+  };
+} control_cmd_t;
+
+// Estado de la lógica de control, propiedad de la tarea de control
+typedef struct {
+  bool automatic_mode;
+  float last_temperature; // lecturas ya filtradas del sensor principal
+  float last_humidity;
+  hal_dht_reading_t sensors[HAL_DHT_MAX_SENSORS]; // última lectura filtrada
+  int64_t mono_ms;
+  filter_t filters[HAL_DHT_MAX_SENSORS][FILTER_CHANNEL_COUNT];
+  rules_t rules; // reglas del modo automático
+} control_state_t;
+
+// Instantánea versionada del estado de control. Solo la tarea de control la
+// escribe; la versión es impar mientras se copia y los lectores repiten la
+// lectura si cambió, así nunca ven un modo y un umbral de distintos comandos
+typedef struct {
+  atomic_uint_least32_t version;
+  telemetry_sample_t sample;
+} control_snapshot_t;
 
 static const char *TAG = "DHT11_TB";
-static bool mqtt_connected = false;
 
-// Modo de control automático o manual
-static bool automatic_mode = true;
-static float last_temperature = 0.0;
-static float last_humidity = 0.0;
+static EventGroupHandle_t app_events = NULL;
+static QueueHandle_t control_queue = NULL;
+static QueueHandle_t telemetry_queue = NULL;
+static control_snapshot_t control_snapshot;
+static QueueHandle_t sampling_queue = NULL; // buzón de una política nueva
+static QueueHandle_t rules_queue = NULL;    // buzón de un conjunto de reglas
+static QueueHandle_t encoder_queue = NULL;  // buzón de un codificador nuevo
+static size_t sensor_count = 0;             // sensores en DHT_SENSORS
 
-// Manejo de eventos MQTT
-static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
-                               int32_t event_id, void *event_data) {
-  esp_mqtt_event_handle_t event = event_data;
+static const sampling_policy_t sampling_defaults = {
+    .mode = SAMPLING_MODE,
+    .period_ms = SAMPLE_PERIOD_MS,
+    .min_period_ms = SAMPLING_MIN_PERIOD_MS,
+    .max_period_ms = SAMPLING_MAX_PERIOD_MS,
+    .delta_temperature = SAMPLING_DELTA_TEMPERATURE,
+    .delta_humidity = SAMPLING_DELTA_HUMIDITY,
+    .threshold_margin = SAMPLING_THRESHOLD_MARGIN,
+};
+// Última política enviada a la tarea del sensor; solo la usa
+// setSamplingPolicy, desde la tarea del cliente MQTT
+static sampling_policy_t sampling_active;
+
+// Leer la instantánea sin bloquear al escritor; retorna su versión
+static uint32_t control_snapshot_read(telemetry_sample_t *sample) {
+  uint32_t before, after;
+
+  while (1) {
+    before =
+        atomic_load_explicit(&control_snapshot.version, memory_order_acquire);
+    *sample = control_snapshot.sample;
+    atomic_thread_fence(memory_order_acquire);
+    after =
+        atomic_load_explicit(&control_snapshot.version, memory_order_relaxed);
+    if (before == after && (before & 1) == 0)
+      return before / 2;
+    // El escritor quedó a mitad de la copia; cederle el procesador
+    vTaskDelay(1);
+  }
+}
+
+// Enviar un comando a la tarea de control sin bloquear al emisor
+static esp_err_t control_post(const control_cmd_t *cmd) {
+  if (xQueueSend(control_queue, cmd, 0) != pdTRUE) {
+    DLOGW(TAG, "Control queue full, command %d dropped", cmd->type);
+    return ESP_ERR_TIMEOUT;
+  }
+  return ESP_OK;
+}
+
+// Establecer modo automático o manual
+static esp_err_t rpc_set_mode(const rpc_request_t *request, char *result,
+                              size_t result_size) {
+  control_cmd_t cmd = {.type = CONTROL_CMD_SET_MODE};
+
+  if (rpc_param_string_equals(request, "mode", "automatic")) {
+    cmd.automatic = true;
+  } else if (rpc_param_string_equals(request, "mode", "manual")) {
+    cmd.automatic = false;
+  } else {
+    return ESP_ERR_INVALID_ARG;
+  }
+  return control_post(&cmd);
+}
+
+// Control manual de LEDs
+static esp_err_t rpc_set_led(const rpc_request_t *request, char *result,
+                             size_t result_size) {
+  int led_number;
+  bool led_on;
+
+  if (!rpc_param_int(request, "led", &led_number) ||
+      !rpc_param_bool(request, "state", &led_on)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (led_number < 1 || led_number > 3) {
+    DLOGW(TAG, "Invalid LED number: %d", led_number);
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  DLOGI(TAG, "RPC request - LED%d -> %s", led_number, led_on ? "ON" : "OFF");
+  control_cmd_t cmd = {.type = CONTROL_CMD_SET_LED,
+                       .led = {led_number, led_on}};
+  return control_post(&cmd);
+}
+
+// Control manual del Buzzer
+static esp_err_t rpc_set_buzzer(const rpc_request_t *request, char *result,
+                                size_t result_size) {
+  bool buzzer_on;
+
+  if (!rpc_param_bool(request, "state", &buzzer_on)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  DLOGI(TAG, "RPC request - Buzzer -> %s", buzzer_on ? "ON" : "OFF");
+  control_cmd_t cmd = {.type = CONTROL_CMD_SET_BUZZER, .buzzer_on = buzzer_on};
+  return control_post(&cmd);
+}
+
+// Establecer umbral de temperatura para el Buzzer
+static esp_err_t rpc_set_temp_threshold(const rpc_request_t *request,
+                                        char *result, size_t result_size) {
+  // Manejar tanto un número simple como un objeto json con "threshold"
+  float new_threshold = 0.0;
+
+  if (!rpc_param_float(request, NULL, &new_threshold)) {
+    rpc_param_float(request, "threshold", &new_threshold);
+  }
+
+  if (!(new_threshold > 0 && new_threshold <= TEMP_THRESHOLD_MAX)) {
+    DLOGW(TAG, "Invalid threshold value received");
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  DLOGI(TAG, "RPC request - Set temperature threshold to %.1f°C",
+        new_threshold);
+  control_cmd_t cmd = {.type = CONTROL_CMD_SET_THRESHOLD,
+                       .threshold = new_threshold};
+  return control_post(&cmd);
+}
+
+// Seleccionar el codificador de la telemetría: {"encoding":"json"|"cbor"}.
+// El nombre se valida aquí para responder el error; el cambio lo aplica la
+// tarea de comunicaciones, que es la que codifica
+static esp_err_t rpc_set_encoding(const rpc_request_t *request, char *result,
+                                  size_t result_size) {
+  int idx = rpc_json_find(request->json, request->tokens, request->count,
+                          request->params, "encoding");
+  if (idx < 0 || request->tokens[idx].type != RPC_JSON_STRING) {
+    return ESP_ERR_INVALID_ARG;
+  }
 
+  const rpc_json_token_t *name = &request->tokens[idx];
+  const telemetry_encoder_t *encoder =
+      encoder_find(request->json + name->start, name->end - name->start);
+  if (encoder == NULL)
+    return ESP_ERR_NOT_FOUND;
+
+  DLOGI(TAG, "RPC request - Telemetry encoding %s", encoder->name);
+  xQueueOverwrite(encoder_queue, &encoder);
+  xEventGroupSetBits(app_events, ENCODER_CHANGE_BIT);
+  return ESP_OK;
+}
+
+// Configurar la cadena de filtros de un canal; los parámetros ausentes
+// toman el valor por defecto. Dirigida a un dispositivo hijo solo cambia
+// los filtros de su sensor
+static esp_err_t rpc_set_filter(const rpc_request_t *request, char *result,
+                                size_t result_size) {
+  control_cmd_t cmd = {.type = CONTROL_CMD_SET_FILTER};
+  cmd.filter.sensor = request->device;
+  float spike;
+  int value;
+
+  if (rpc_param_string_equals(request, "channel", "temperature")) {
+    cmd.filter.channel = FILTER_CHANNEL_TEMPERATURE;
+  } else if (rpc_param_string_equals(request, "channel", "humidity")) {
+    cmd.filter.channel = FILTER_CHANNEL_HUMIDITY;
+  } else {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  filter_config_t *config = &cmd.filter.config;
+  *config = filter_defaults[cmd.filter.channel];
+  if (rpc_param_float(request, "spike", &spike)) {
+    if (!(spike >= 0 && spike * 10 <= FILTER_SPIKE_LIMIT_MAX))
+      return ESP_ERR_INVALID_ARG;
+    config->spike_limit = lroundf(spike * 10);
+  }
+  if (rpc_param_int(request, "reject", &value)) {
+    if (value < 0 || value > UINT8_MAX)
+      return ESP_ERR_INVALID_ARG;
+    config->spike_max_reject = value;
+  }
+  if (rpc_param_int(request, "median", &value)) {
+    if (value < 1 || value > FILTER_MEDIAN_MAX || value % 2 == 0)
+      return ESP_ERR_INVALID_ARG;
+    config->median_window = value;
+  }
+  if (rpc_param_int(request, "ema", &value)) {
+    if (value < 0 || value > 8)
+      return ESP_ERR_INVALID_ARG;
+    config->ema_shift = value;
+  }
+  return control_post(&cmd);
+}
+
+// Estado actual de las salidas y el modo, con la versión de la instantánea.
+// Un dispositivo hijo distinto del primero solo tiene su lectura
+static esp_err_t rpc_get_state(const rpc_request_t *request, char *result,
+                               size_t result_size) {
+  telemetry_sample_t sample;
+  uint32_t version = control_snapshot_read(&sample);
+  int len = snprintf(result, result_size, "{\"version\":%lu,\"state\":",
+                     (unsigned long)version);
+
+  if (request->device > 0) {
+    int aux = request->device - 1;
+    if (!(sample.aux_valid & (1 << aux)))
+      return ESP_ERR_NOT_FOUND;
+    sample.temperature = sample.aux_temperature[aux];
+    sample.humidity = sample.aux_humidity[aux];
+    sample.keys = (1 << TELEMETRY_KEY_TEMPERATURE) |
+                  (1 << TELEMETRY_KEY_HUMIDITY);
+  } else {
+    sample.keys = telemetry_sample_keys(&sample);
+  }
+  size_t n = telemetry_encoder_json.sample((uint8_t *)result + len,
+                                           result_size - len - 1, &sample, 0,
+                                           true);
+  if (n == 0)
+    return ESP_ERR_NO_MEM;
+  len += n;
+  result[len++] = '}';
+  result[len] = 0;
+  return ESP_OK;
+}
+
+// Cambiar la política de muestreo: {"mode":"fixed"|"adaptive","period":ms,
+// "min":ms,"max":ms,"delta_temperature":°C,"delta_humidity":%,"margin":°C}.
+// Los parámetros ausentes conservan el valor de la política activa.
+static esp_err_t rpc_set_sampling_policy(const rpc_request_t *request,
+                                         char *result, size_t result_size) {
+  sampling_policy_t policy = sampling_active;
+
+  if (sampling_policy_parse(request, &policy) != ESP_OK)
+    return ESP_ERR_INVALID_ARG;
+
+  sampling_active = policy;
+  DLOGI(TAG, "RPC request - Sampling %s, period %lu ms",
+        policy.mode == SAMPLING_MODE_FIXED ? "fixed" : "adaptive",
+        (unsigned long)policy.period_ms);
+  xQueueOverwrite(sampling_queue, &policy);
+  return ESP_OK;
+}
+
+// Leer el valor de una regla: 0/1 (o true/false, "on"/"off") para los LEDs
+// y el nombre del patrón para el zumbador
+static bool rpc_rule_value(const rpc_request_t *rule, rule_spec_t *spec) {
+  static const char *const patterns[BUZZER_PATTERN_COUNT] = {
+      [BUZZER_PATTERN_OFF] = "off",
+      [BUZZER_PATTERN_CONTINUOUS] = "continuous",
+      [BUZZER_PATTERN_WARNING] = "warning",
+      [BUZZER_PATTERN_ALARM] = "alarm",
+      [BUZZER_PATTERN_CRITICAL] = "critical",
+  };
+  bool on;
+
+  if (spec->actuator == RULES_ACTUATOR_BUZZER) {
+    for (int i = 0; i < BUZZER_PATTERN_COUNT; i++) {
+      if (rpc_param_string_equals(rule, "value", patterns[i])) {
+        spec->value = i;
+        return true;
+      }
+    }
+    return false;
+  }
+  if (rpc_param_string_equals(rule, "value", "on") ||
+      rpc_param_string_equals(rule, "value", "off")) {
+    spec->value = rpc_param_string_equals(rule, "value", "on");
+    return true;
+  }
+  if (!rpc_param_bool(rule, "value", &on))
+    return false;
+  spec->value = on;
+  return true;
+}
+
+// setRules debe caber completa en el despachador, con margen para "method",
+// "params" y el sobre de la pasarela
+_Static_assert(RPC_MAX_TOKENS >= RULES_MAX * RPC_RULE_TOKENS + 16,
+               "RPC_MAX_TOKENS too small for setRules");
+_Static_assert(RPC_BUFFER_SIZE >= RULES_MAX * RPC_RULE_BYTES + 256,
+               "RPC_BUFFER_SIZE too small for setRules");
+
+// Reemplazar las reglas del modo automático:
+// {"rules":[{"input":"humidity","above":50,"hysteresis":2,"output":"led1",
+// "value":"on","priority":0},..]}. Con "below" en lugar de "above" la regla
+// se activa bajo el umbral; hysteresis y priority son opcionales.
+static esp_err_t rpc_set_rules(const rpc_request_t *request, char *result,
+                               size_t result_size) {
+  rule_spec_t specs[RULES_MAX];
+  rules_update_t update, stale;
+  size_t count = 0;
+  int list = rpc_json_find(request->json, request->tokens, request->count,
+                           request->params, "rules");
+
+  if (list < 0 || request->tokens[list].type != RPC_JSON_ARRAY)
+    return ESP_ERR_INVALID_ARG;
+  if (request->tokens[list].size > RULES_MAX)
+    return ESP_ERR_INVALID_SIZE;
+
+  int idx = list + 1;
+  for (int i = 0; i < request->tokens[list].size; i++) {
+    rpc_request_t rule = *request;
+    rule_spec_t *spec = &specs[count++];
+    int input, output, priority = 0;
+
+    rule.params = idx;
+    idx = rpc_json_skip(request->tokens, request->count, idx);
+    if (request->tokens[rule.params].type != RPC_JSON_OBJECT)
+      return ESP_ERR_INVALID_ARG;
+
+    input = rpc_json_find(rule.json, rule.tokens, rule.count, rule.params,
+                          "input");
+    output = rpc_json_find(rule.json, rule.tokens, rule.count, rule.params,
+                           "output");
+    if (input < 0 || output < 0 ||
+        rule.tokens[input].type != RPC_JSON_STRING ||
+        rule.tokens[output].type != RPC_JSON_STRING)
+      return ESP_ERR_INVALID_ARG;
+    const rpc_json_token_t *in = &rule.tokens[input];
+    const rpc_json_token_t *out = &rule.tokens[output];
+    input = rules_input_parse(rule.json + in->start, in->end - in->start);
+    output =
+        rules_actuator_parse(rule.json + out->start, out->end - out->start);
+    if (input < 0 || output < 0)
+      return ESP_ERR_INVALID_ARG;
+
+    *spec = (rule_spec_t){.input = input, .actuator = output};
+    spec->above = rpc_param_float(&rule, "above", &spec->threshold);
+    if (!spec->above && !rpc_param_float(&rule, "below", &spec->threshold))
+      return ESP_ERR_INVALID_ARG;
+    rpc_param_float(&rule, "hysteresis", &spec->hysteresis);
+    rpc_param_int(&rule, "priority", &priority);
+    if (priority < 0 || priority > UINT8_MAX || !rpc_rule_value(&rule, spec))
+      return ESP_ERR_INVALID_ARG;
+    spec->priority = priority;
+  }
+
+  esp_err_t ret = rules_compile(&update.rules, specs, count);
+  if (ret == ESP_OK)
+    ret = rpc_defer(&update.reply);
+  if (ret != ESP_OK)
+    return ret;
+
+  // Escribir en NVS bloquearía la tarea del cliente MQTT: la tarea de
+  // control guarda el conjunto, lo aplica y responde. Uno que aún esperaba
+  // en el buzón queda reemplazado sin aplicarse
+  if (xQueueReceive(rules_queue, &stale, 0) == pdTRUE)
+    rpc_reply_deferred(&stale.reply, ESP_ERR_INVALID_STATE);
+  DLOGI(TAG, "RPC request - %u rules", (unsigned)count);
+  xQueueOverwrite(rules_queue, &update);
+  control_cmd_t cmd = {.type = CONTROL_CMD_SET_RULES};
+  if (control_post(&cmd) == ESP_OK)
+    return RPC_DEFERRED;
+  // Sin comando nadie lo tomaría; si un comando anterior ya lo tomó, ese
+  // responde
+  return xQueueReceive(rules_queue, &stale, 0) == pdTRUE ? ESP_ERR_TIMEOUT
+                                                         : RPC_DEFERRED;
+}
+
+// Historial local paginado: {"tier":"raw"|"minute"|"hour","from":n,
+// "limit":n}. La respuesta trae "next" para pedir la página siguiente.
+static esp_err_t rpc_get_history(const rpc_request_t *request, char *result,
+                                 size_t result_size) {
+  int tier = HISTORY_TIER_RAW;
+  int from = 0;
+  int limit = HISTORY_PAGE_DEFAULT;
+  int idx = rpc_json_find(request->json, request->tokens, request->count,
+                          request->params, "tier");
+
+  if (idx >= 0) {
+    const rpc_json_token_t *name = &request->tokens[idx];
+    tier = name->type == RPC_JSON_STRING
+               ? history_tier_parse(request->json + name->start,
+                                    name->end - name->start)
+               : -1;
+  }
+  rpc_param_int(request, "from", &from);
+  rpc_param_int(request, "limit", &limit);
+  if (tier < 0 || from < 0 || limit < 1)
+    return ESP_ERR_INVALID_ARG;
+
+  return history_format(tier, from, limit, telemetry_epoch_offset_ms(), result,
+                        result_size) > 0
+             ? ESP_OK
+             : ESP_ERR_NO_MEM;
+}
+
+// Profundidad de la bandeja de salida y contadores de cada flujo
+static esp_err_t rpc_get_publish_stats(const rpc_request_t *request,
+                                       char *result, size_t result_size) {
+  return publish_format(result, result_size) > 0 ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+// Estado del gestor de conectividad y causas de desconexión
+static esp_err_t rpc_get_connectivity(const rpc_request_t *request,
+                                      char *result, size_t result_size) {
+  conn_t net;
+
+  hal_net_status(&net);
+  return conn_format(&net, hal_time_us() / 1000, result, result_size) > 0
+             ? ESP_OK
+             : ESP_ERR_NO_MEM;
+}
+
+#if STATS_ENABLED
+// Histogramas de latencia por etapa
+static esp_err_t rpc_get_stats(const rpc_request_t *request, char *result,
+                               size_t result_size) {
+  return stats_format(result, result_size) > 0 ? ESP_OK : ESP_ERR_NO_MEM;
+}
+#endif
+
+// Inicio de la caída en curso, para medir la reconexión; 0 si no hay
+static int64_t mqtt_lost_us = 0;
+
+static void mqtt_mark_lost(void) {
+  EventBits_t bits = xEventGroupClearBits(app_events, MQTT_CONNECTED_BIT);
+  if ((bits & MQTT_CONNECTED_BIT) && mqtt_lost_us == 0)
+    mqtt_lost_us = hal_time_us();
+}
+
+// Manejo de eventos MQTT
+static void mqtt_event_handler(const hal_mqtt_event_t *event) {
   switch (event->event_id) {
-  case MQTT_EVENT_CONNECTED:
-    ESP_LOGI(TAG, "MQTT Connected to ThingsBoard");
-    mqtt_connected = true;
-    esp_mqtt_client_subscribe(mqtt_client, "v1/devices/me/rpc/request/+", 1);
+  case HAL_MQTT_EVENT_CONNECTED:
+    ESP_LOGI(TAG, "MQTT Connected to ThingsBoard%s",
+             event->session_present ? " (session resumed)" : "");
+    boot_mark(BOOT_MILESTONE_MQTT_CONNECTED);
+    if (mqtt_lost_us != 0) {
+      int64_t elapsed_us = hal_time_us() - mqtt_lost_us;
+      ESP_LOGI(TAG, "MQTT reconnected after %lld ms",
+               (long long)(elapsed_us / 1000));
+      STATS_RECORD(STATS_STAGE_MQTT_RECONNECT, elapsed_us);
+      mqtt_lost_us = 0;
+    }
+    // Con la sesión conservada las suscripciones siguen vigentes
+    if (!event->session_present) {
+      hal_mqtt_subscribe(RPC_REQUEST_TOPIC, 1);
+#if GATEWAY_MODE
+      hal_mqtt_subscribe(GATEWAY_RPC_TOPIC, 1);
+#endif
+    }
+    xEventGroupSetBits(app_events, MQTT_CONNECTED_BIT | MQTT_CONNECT_EVENT_BIT);
     break;
 
-  case MQTT_EVENT_DISCONNECTED:
+  case HAL_MQTT_EVENT_DISCONNECTED:
     ESP_LOGI(TAG, "MQTT Disconnected");
-    mqtt_connected = false;
+    mqtt_mark_lost();
     break;
 
-  case MQTT_EVENT_ERROR:
+  case HAL_MQTT_EVENT_ERROR:
     ESP_LOGE(TAG, "MQTT Error");
-    mqtt_connected = false;
+    mqtt_mark_lost();
     break;
 
-  case MQTT_EVENT_DATA: {
-    char topic[event->topic_len + 1];
-    strncpy(topic, event->topic, event->topic_len);
-    topic[event->topic_len] = 0;
-
-    char payload[event->data_len + 1];
-    strncpy(payload, event->data, event->data_len);
-    payload[event->data_len] = 0;
-
-    ESP_LOGI(TAG, "RPC topic: %s, payload: %s", topic, payload);
-
-    cJSON *root = cJSON_Parse(payload);
-    if (root) {
-      const cJSON *method = cJSON_GetObjectItem(root, "method");
-      const cJSON *params = cJSON_GetObjectItem(root, "params");
-
-      // Establecer modo automático o manual
-      if (method && params && strcmp(method->valuestring, "setMode") == 0) {
-        const cJSON *mode = cJSON_GetObjectItem(params, "mode");
-        if (mode && cJSON_IsString(mode)) {
-          if (strcmp(mode->valuestring, "automatic") == 0) {
-            automatic_mode = true;
-            ESP_LOGI(TAG, "Mode set to: AUTOMATIC");
-            led_reset_manual_override(1);
-            led_reset_manual_override(2);
-            led_reset_manual_override(3);
-            if (last_humidity > 0) {
-              ESP_LOGI(TAG, "Updating LEDs with last humidity: %.1f%%", last_humidity);
-              leds_update_by_humidity(last_humidity);
-            }
-            if (last_temperature > 0) {
-              ESP_LOGI(TAG, "Updating buzzer with last temperature: %.1f°C", last_temperature);
-              buzzer_update_by_temperature(last_temperature);
-            }
-          } else if (strcmp(mode->valuestring, "manual") == 0) {
-            automatic_mode = false;
-            ESP_LOGI(TAG, "Mode set to: MANUAL");
-          }
-        }
-      }
+  case HAL_MQTT_EVENT_DATA:
+    rpc_handle_data(event);
+    break;
 
-      // Control manual de LEDs
-      else if (method && params && strcmp(method->valuestring, "setLED") == 0) {
-        const cJSON *led = cJSON_GetObjectItem(params, "led");
-        const cJSON *state = cJSON_GetObjectItem(params, "state");
-
-        if (led && state) {
-          int led_number = led->valueint;
-
-          if (led_number < 1 || led_number > 3) {
-            ESP_LOGW(TAG, "Invalid LED number: %d", led_number);
-          } else {
-            bool led_on =
-                cJSON_IsBool(state) ? cJSON_IsTrue(state) : state->valueint;
-            ESP_LOGI(TAG, "RPC request - LED%d -> %s", led_number,
-                     led_on ? "ON" : "OFF");
-            led_set(led_number, led_on, true); // manual = true
-          }
-        }
-      }
+  default:
+    break;
+  }
+}
 
-      // Control manual del Buzzer
-      else if (method && params &&
-               strcmp(method->valuestring, "setBuzzer") == 0) {
-        const cJSON *state = cJSON_GetObjectItem(params, "state");
-
-        if (state) {
-          bool buzzer_on =
-              cJSON_IsBool(state) ? cJSON_IsTrue(state) : state->valueint;
-          ESP_LOGI(TAG, "RPC request - Buzzer -> %s", buzzer_on ? "ON" : "OFF");
-          buzzer_set(buzzer_on, true); // manual = true
-        }
-      }
+// Inicializar MQTT y la tabla de métodos RPC
+static void mqtt_init(void) {
+  rpc_register("setMode", rpc_set_mode);
+  rpc_register("setLED", rpc_set_led);
+  rpc_register("setBuzzer", rpc_set_buzzer);
+  rpc_register("setTempThreshold", rpc_set_temp_threshold);
+  rpc_register("setEncoding", rpc_set_encoding);
+  rpc_register_device("setFilter", rpc_set_filter);
+  rpc_register_device("getState", rpc_get_state);
+  rpc_register("setSamplingPolicy", rpc_set_sampling_policy);
+  rpc_register("getPublishStats", rpc_get_publish_stats);
+  rpc_register("setRules", rpc_set_rules);
+  rpc_register("getHistory", rpc_get_history);
+  rpc_register("getConnectivity", rpc_get_connectivity);
+#if STATS_ENABLED
+  rpc_register("getStats", rpc_get_stats);
+#endif
 
-      // Establecer umbral de temperatura para el Buzzer
-      else if (method && params &&
-               strcmp(method->valuestring, "setTempThreshold") == 0) {
-        // Manejar tanto un número simple como un objeto json con "threshold"
-        float new_threshold = 0.0;
-
-        if (cJSON_IsNumber(params)) {
-          new_threshold = (float)params->valuedouble;
-        } else if (cJSON_IsObject(params)) {
-          const cJSON *threshold = cJSON_GetObjectItem(params, "threshold");
-          if (threshold && cJSON_IsNumber(threshold)) {
-            new_threshold = (float)threshold->valuedouble;
-          }
-        }
-
-        if (new_threshold > 0) {
-          ESP_LOGI(TAG, "RPC request - Set temperature threshold to %.1f°C",
-                   new_threshold);
-          buzzer_set_threshold(new_threshold);
-        } else {
-          ESP_LOGW(TAG, "Invalid threshold value received");
-        }
-      }
+  hal_mqtt_config_t mqtt_cfg = {
+      .host = THINGSBOARD_HOST,
+      .port = THINGSBOARD_PORT,
+      .username = THINGSBOARD_ACCESS_TOKEN,
+      // Tope duro del cliente; las políticas actúan antes, al llegar a
+      // PUBLISH_OUTBOX_LIMIT
+      .outbox_limit = 2 * PUBLISH_OUTBOX_LIMIT,
+      .tls = MQTT_TLS,
+      .persistent_session = MQTT_PERSISTENT_SESSION,
+  };
 
-      cJSON_Delete(root);
+  ESP_ERROR_CHECK(hal_mqtt_start(&mqtt_cfg, mqtt_event_handler));
+}
+
+// Registrar los sensores configurados; el primero debe responder
+static esp_err_t sensors_init(void) {
+  static const struct {
+    uint8_t gpio;
+    dht_type_t type;
+  } sensors[] = DHT_SENSORS;
+  _Static_assert(sizeof(sensors) / sizeof(sensors[0]) <= HAL_DHT_MAX_SENSORS,
+                 "too many DHT sensors");
+  _Static_assert(TELEMETRY_AUX_SENSORS == HAL_DHT_MAX_SENSORS - 1,
+                 "telemetry keys must cover every sensor");
+
+  esp_err_t ret = hal_dht_init();
+  if (ret != ESP_OK)
+    return ret;
+  sensor_count = sizeof(sensors) / sizeof(sensors[0]);
+  for (size_t i = 0; i < sensor_count; i++) {
+    if (hal_dht_add(sensors[i].gpio, sensors[i].type) < 0 && i == 0)
+      return ESP_FAIL;
+  }
+  return ESP_OK;
+}
+
+// Leer todos los sensores a la vez, reintentando mientras el principal
+// falle; retorna 0 si el sensor principal entregó una lectura
+static int sensor_read(hal_dht_reading_t readings[HAL_DHT_MAX_SENSORS]) {
+  for (int attempt = 1; attempt <= SENSOR_MAX_RETRIES; attempt++) {
+    STATS_BEGIN(read_start);
+    hal_dht_read_all(readings);
+    STATS_END(STATS_STAGE_DHT_READ, read_start);
+    if (readings[0].valid) {
+      for (size_t i = 0; i < hal_dht_count(); i++) {
+        if (readings[i].valid)
+          DLOGI(TAG, "Sensor %u: Temperature: %.1f°C, Humidity: %.1f%%",
+                (unsigned)i + 1, readings[i].temperature,
+                readings[i].humidity);
+      }
+      return 0;
+    }
+    DLOGW(TAG, "Read attempt %d/%d failed", attempt, SENSOR_MAX_RETRIES);
+    if (attempt < SENSOR_MAX_RETRIES) {
+      STATS_COUNT(STATS_COUNTER_READ_RETRY);
+      vTaskDelay(pdMS_TO_TICKS(SENSOR_RETRY_DELAY_MS));
     }
-    break;
   }
 
-  default:
-    break;
+  STATS_COUNT(STATS_COUNTER_READ_FAILURE);
+  ESP_LOGE(TAG, "Failed to read DHT sensor after %d attempts",
+           SENSOR_MAX_RETRIES);
+  return -1;
+}
+
+// Tarea de adquisición: lee los sensores en cada periodo, sin depender de la
+// red. Los plazos son absolutos, así que la duración de la lectura y de sus
+// reintentos no desplaza a las muestras siguientes.
+static void sensor_task(void *pvParameters) {
+  control_cmd_t cmd = {.type = CONTROL_CMD_READING};
+  sampling_policy_t policy;
+  sampling_t sampling;
+  telemetry_sample_t state;
+
+  ESP_LOGI(TAG, "Sensor task started");
+  sampling_init(&sampling, &sampling_defaults);
+
+  TickType_t sample_tick = xTaskGetTickCount(); // plazo de la última muestra
+  TickType_t next_tick = sample_tick;
+  int64_t sample_us = hal_time_us();
+  int64_t next_us = sample_us;
+
+  while (1) {
+    // Esperar el plazo; una política nueva lo recalcula desde la última
+    // muestra, para no esperar el periodo anterior completo
+    int32_t remaining = (int32_t)(next_tick - xTaskGetTickCount());
+    if (xQueueReceive(sampling_queue, &policy,
+                      remaining > 0 ? (TickType_t)remaining : 0) == pdTRUE) {
+      sampling_init(&sampling, &policy);
+      next_tick = sample_tick + pdMS_TO_TICKS(policy.period_ms);
+      next_us = sample_us + policy.period_ms * 1000LL;
+      continue;
+    }
+
+    sample_tick = next_tick;
+    sample_us = next_us;
+    STATS_RECORD(STATS_STAGE_SAMPLE_JITTER, hal_time_us() - sample_us);
+
+    uint32_t period_ms = sampling.period_ms;
+    if (sensor_read(cmd.reading.sensors) == 0) {
+      cmd.reading.mono_ms = hal_time_us() / 1000;
+      control_post(&cmd);
+
+      control_snapshot_read(&state);
+      period_ms = sampling_update(&sampling, cmd.reading.sensors[0].temperature,
+                                  cmd.reading.sensors[0].humidity,
+                                  state.temp_threshold);
+    }
+
+    next_tick = sample_tick + pdMS_TO_TICKS(period_ms);
+    next_us = sample_us + period_ms * 1000LL;
+
+    // Si la lectura se pasó del plazo siguiente no se recuperan las muestras
+    // perdidas: se reprograma desde ahora
+    if ((int32_t)(next_tick - xTaskGetTickCount()) < 0) {
+      next_tick = xTaskGetTickCount();
+      next_us = hal_time_us();
+    }
   }
 }
 
-// Manejo de eventos WiFi
-static void wifi_event_handler(void *arg, esp_event_base_t event_base,
-                               int32_t event_id, void *event_data) {
-  if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
-    esp_wifi_connect();
-  } else if (event_base == WIFI_EVENT &&
-             event_id == WIFI_EVENT_STA_DISCONNECTED) {
-    ESP_LOGI(TAG, "Retrying WiFi connection...");
-    esp_wifi_connect();
-  } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
-    ip_event_got_ip_t *event = (ip_event_got_ip_t *)event_data;
-    ESP_LOGI(TAG, "Got IP: " IPSTR, IP2STR(&event->ip_info.ip));
-  }
-}
-
-// Inicializar WiFi
-static void wifi_init(void) {
-  ESP_ERROR_CHECK(esp_netif_init());
-  ESP_ERROR_CHECK(esp_event_loop_create_default());
-  esp_netif_create_default_wifi_sta();
-
-  wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-  ESP_ERROR_CHECK(esp_wifi_init(&cfg));
-
-  esp_event_handler_instance_t instance_any_id;
-  esp_event_handler_instance_t instance_got_ip;
-  ESP_ERROR_CHECK(esp_event_handler_instance_register(
-      WIFI_EVENT, ESP_EVENT_ANY_ID, &wifi_event_handler, NULL,
-      &instance_any_id));
-  ESP_ERROR_CHECK(esp_event_handler_instance_register(
-      IP_EVENT, IP_EVENT_STA_GOT_IP, &wifi_event_handler, NULL,
-      &instance_got_ip));
-
-  wifi_config_t wifi_config = {
-      .sta =
-          {
-              .ssid = WIFI_SSID,
-              .password = WIFI_PASS,
-          },
+// Construir una muestra con el estado actual de las salidas y las lecturas
+// de los sensores adicionales
+static void control_build_sample(const control_state_t *state,
+                                 telemetry_sample_t *sample) {
+  *sample = (telemetry_sample_t){
+      .mono_ms = state->mono_ms,
+      .temperature = state->last_temperature,
+      .humidity = state->last_humidity,
+      .temp_threshold = buzzer_get_threshold(),
+      .buzzer = buzzer_get_state(),
+      .buzzer_manual = buzzer_is_manual_mode(),
+      .automatic_mode = state->automatic_mode,
+      .leds = (led_get_state(1) ? 1 : 0) | (led_get_state(2) ? 2 : 0) |
+              (led_get_state(3) ? 4 : 0),
   };
-  ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-  ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
-  ESP_ERROR_CHECK(esp_wifi_start());
 
-  ESP_LOGI(TAG, "WiFi initialization complete");
+  for (int i = 0; i < TELEMETRY_AUX_SENSORS; i++) {
+    const hal_dht_reading_t *reading = &state->sensors[i + 1];
+    if (!reading->valid)
+      continue;
+    sample->aux_temperature[i] = reading->temperature;
+    sample->aux_humidity[i] = reading->humidity;
+    sample->aux_valid |= 1 << i;
+  }
 }
 
-// Inicializar MQTT
-static void mqtt_init(void) {
-  esp_mqtt_client_config_t mqtt_cfg = {
-      .broker.address.hostname = THINGSBOARD_HOST,
-      .broker.address.port = THINGSBOARD_PORT,
-      .broker.address.transport = MQTT_TRANSPORT_OVER_TCP,
-      .credentials.username = THINGSBOARD_ACCESS_TOKEN,
-  };
+static void control_state_init(control_state_t *state) {
+  *state = (control_state_t){.automatic_mode = true};
+  if (rules_load(&state->rules) != ESP_OK)
+    rules_default(&state->rules);
+  for (int i = 0; i < HAL_DHT_MAX_SENSORS; i++) {
+    for (int channel = 0; channel < FILTER_CHANNEL_COUNT; channel++)
+      filter_init(&state->filters[i][channel], &filter_defaults[channel]);
+  }
+}
 
-  mqtt_client = esp_mqtt_client_init(&mqtt_cfg);
-  esp_mqtt_client_register_event(mqtt_client, ESP_EVENT_ANY_ID,
-                                 mqtt_event_handler, NULL);
-  esp_mqtt_client_start(mqtt_client);
+// Publicar el estado ya aplicado como una nueva versión de la instantánea
+static void control_snapshot_store(const control_state_t *state) {
+  uint32_t version =
+      atomic_load_explicit(&control_snapshot.version, memory_order_relaxed);
+
+  atomic_store_explicit(&control_snapshot.version, version + 1,
+                        memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  control_build_sample(state, &control_snapshot.sample);
+  atomic_store_explicit(&control_snapshot.version, version + 2,
+                        memory_order_release);
+}
+
+// Pasar cada lectura por la cadena de filtros de su canal antes de usarla
+static void control_condition(control_state_t *state,
+                              hal_dht_reading_t sensors[HAL_DHT_MAX_SENSORS]) {
+  for (int i = 0; i < HAL_DHT_MAX_SENSORS; i++) {
+    hal_dht_reading_t *reading = &sensors[i];
+    int32_t temperature, humidity;
+
+    if (!reading->valid)
+      continue;
+    if (!filter_apply(&state->filters[i][FILTER_CHANNEL_TEMPERATURE],
+                      lroundf(reading->temperature * 10), &temperature))
+      DLOGW(TAG, "Sensor %d: temperature spike %.1f°C rejected", i + 1,
+            reading->temperature);
+    if (!filter_apply(&state->filters[i][FILTER_CHANNEL_HUMIDITY],
+                      lroundf(reading->humidity * 10), &humidity))
+      DLOGW(TAG, "Sensor %d: humidity spike %.1f%% rejected", i + 1,
+            reading->humidity);
+    reading->temperature = temperature / 10.0f;
+    reading->humidity = humidity / 10.0f;
+  }
 }
 
-// Enviar telemetría a ThingsBoard
-static void send_telemetry(float temperature, float humidity) {
-  char payload[256];
-  snprintf(payload, sizeof(payload),
-           "{\"temperature\":%.1f,\"humidity\":%.1f,\"buzzer\":%s,\"buzzer_"
-           "mode\":\"%s\",\"temp_threshold\":%.1f,\"mode\":\"%s\"}",
-           temperature, humidity, buzzer_get_state() ? "true" : "false",
-           buzzer_is_manual_mode() ? "manual" : "auto", buzzer_get_threshold(),
-           automatic_mode ? "automatic" : "manual");
+// Evaluar las reglas con las últimas lecturas y llevar las salidas
+// automáticas al resultado
+static void control_apply_rules(control_state_t *state) {
+  rules_inputs_t inputs = {0};
+  uint8_t outputs[RULES_ACTUATOR_COUNT];
 
-  int msg_id = esp_mqtt_client_publish(mqtt_client, "v1/devices/me/telemetry",
-                                       payload, 0, 1, 0);
+  // Tras despertar solo se conservan las lecturas del sensor principal
+  if (state->last_humidity > 0) {
+    int32_t temperature = lroundf(state->last_temperature * 10);
+    int32_t humidity = lroundf(state->last_humidity * 10);
+    inputs.values[RULES_INPUT_TEMPERATURE(0)] = temperature;
+    inputs.values[RULES_INPUT_HUMIDITY(0)] = humidity;
+    inputs.values[RULES_INPUT_DEW_POINT] =
+        rules_dew_point(temperature, humidity);
+    inputs.values[RULES_INPUT_TEMP_EXCESS] =
+        temperature - lroundf(buzzer_get_threshold() * 10);
+    inputs.valid |= (1UL << RULES_INPUT_TEMPERATURE(0)) |
+                    (1UL << RULES_INPUT_HUMIDITY(0)) |
+                    (1UL << RULES_INPUT_DEW_POINT) |
+                    (1UL << RULES_INPUT_TEMP_EXCESS);
+  }
+  for (int i = 1; i < HAL_DHT_MAX_SENSORS; i++) {
+    const hal_dht_reading_t *reading = &state->sensors[i];
+    if (!reading->valid)
+      continue;
+    inputs.values[RULES_INPUT_TEMPERATURE(i)] =
+        lroundf(reading->temperature * 10);
+    inputs.values[RULES_INPUT_HUMIDITY(i)] = lroundf(reading->humidity * 10);
+    inputs.valid |= (1UL << RULES_INPUT_TEMPERATURE(i)) |
+                    (1UL << RULES_INPUT_HUMIDITY(i));
+  }
+
+  rules_evaluate(&state->rules, &inputs, outputs);
+  leds_update_auto(outputs[RULES_ACTUATOR_LED1] |
+                   outputs[RULES_ACTUATOR_LED2] << 1 |
+                   outputs[RULES_ACTUATOR_LED3] << 2);
+  buzzer_update_auto(outputs[RULES_ACTUATOR_BUZZER]);
+}
 
-  if (msg_id != -1) {
-    ESP_LOGI(TAG, "Sent: %s", payload);
+// Aplicar una lectura nueva a las salidas según el modo
+static void control_apply_reading(control_state_t *state, float temperature,
+                                  float humidity) {
+  state->last_temperature = temperature;
+  state->last_humidity = humidity;
+
+  if (state->automatic_mode) {
+    DLOGI(TAG, "Running in AUTOMATIC mode");
+    control_apply_rules(state);
   } else {
-    ESP_LOGE(TAG, "Failed to send telemetry");
+    DLOGI(TAG, "Running in MANUAL mode");
   }
 }
 
-static void main_task(void *pvParameters) {
-  float temperature, humidity;
-  int retry_count = 0;
-  const int MAX_RETRIES = 3;
+// Aplicar un comando; las lecturas se filtran en el mismo comando
+static void control_apply_command(control_state_t *state, control_cmd_t *cmd) {
+  switch (cmd->type) {
+  case CONTROL_CMD_READING:
+    control_condition(state, cmd->reading.sensors);
+    memcpy(state->sensors, cmd->reading.sensors, sizeof(state->sensors));
+    state->mono_ms = cmd->reading.mono_ms;
+    if (state->sensors[0].valid) {
+      int64_t offset = telemetry_epoch_offset_ms();
+      history_add(state->mono_ms, offset ? state->mono_ms + offset : 0,
+                  state->sensors[0].temperature, state->sensors[0].humidity);
+    }
+    control_apply_reading(state, cmd->reading.sensors[0].temperature,
+                          cmd->reading.sensors[0].humidity);
+    break;
 
-  ESP_LOGI(TAG, "Sensor task started, waiting for MQTT connection...");
+  case CONTROL_CMD_SET_MODE:
+    state->automatic_mode = cmd->automatic;
+    if (!state->automatic_mode) {
+      DLOGI(TAG, "Mode set to: MANUAL");
+      break;
+    }
 
-  while (!mqtt_connected) {
-    ESP_LOGI(TAG, "Waiting for MQTT connection...");
-    vTaskDelay(pdMS_TO_TICKS(1000));
+    DLOGI(TAG, "Mode set to: AUTOMATIC");
+    led_reset_manual_override(1);
+    led_reset_manual_override(2);
+    led_reset_manual_override(3);
+    DLOGI(TAG, "Updating outputs with last reading: %.1f°C, %.1f%%",
+          state->last_temperature, state->last_humidity);
+    control_apply_rules(state);
+    break;
+
+  case CONTROL_CMD_SET_LED:
+    led_set(cmd->led.number, cmd->led.on, true); // manual = true
+    break;
+
+  case CONTROL_CMD_SET_BUZZER:
+    buzzer_set(cmd->buzzer_on, true); // manual = true
+    break;
+
+  case CONTROL_CMD_SET_THRESHOLD:
+    buzzer_set_threshold(cmd->threshold);
+    break;
+
+  case CONTROL_CMD_SET_RULES: {
+    rules_update_t update;
+    if (xQueueReceive(rules_queue, &update, 0) != pdTRUE)
+      break;
+    // Guardar antes de aplicar: si falla, el siguiente arranque no usaría
+    // las reglas que el servidor cree activas
+    esp_err_t ret = rules_save(&update.rules);
+    if (ret != ESP_OK) {
+      DLOGW(TAG, "Failed to persist rules: %s", esp_err_to_name(ret));
+      rpc_reply_deferred(&update.reply, ret);
+      break;
+    }
+    state->rules = update.rules;
+    DLOGI(TAG, "Rules replaced, %d active", state->rules.count);
+    if (state->automatic_mode)
+      control_apply_rules(state);
+    rpc_reply_deferred(&update.reply, ESP_OK);
+    break;
   }
 
-  ESP_LOGI(TAG, "MQTT connected! Starting sensor readings...");
+  case CONTROL_CMD_SET_FILTER:
+    DLOGI(TAG, "Filter %d on sensor %d: spike %ld, median %d, EMA 1/%d",
+          cmd->filter.channel, cmd->filter.sensor,
+          (long)cmd->filter.config.spike_limit,
+          cmd->filter.config.median_window, 1 << cmd->filter.config.ema_shift);
+    for (int i = 0; i < HAL_DHT_MAX_SENSORS; i++) {
+      if (cmd->filter.sensor < 0 || cmd->filter.sensor == i)
+        filter_init(&state->filters[i][cmd->filter.channel],
+                    &cmd->filter.config);
+    }
+    break;
+  }
+
+  control_snapshot_store(state);
+}
+
+// Tarea de control: único dueño de LEDs, buzzer y modo de operación
+static void control_task(void *pvParameters) {
+  control_state_t state;
+  telemetry_sample_t sample;
+  control_cmd_t cmd;
+
+  control_state_init(&state);
+  control_snapshot_store(&state);
 
   while (1) {
-    if (!mqtt_connected) {
-      ESP_LOGW(TAG, "MQTT disconnected, waiting for reconnection...");
-      vTaskDelay(pdMS_TO_TICKS(1000));
+    xQueueReceive(control_queue, &cmd, portMAX_DELAY);
+    control_apply_command(&state, &cmd);
+    if (cmd.type != CONTROL_CMD_READING)
+      continue;
+
+    control_build_sample(&state, &sample);
+    if (xQueueSend(telemetry_queue, &sample, 0) != pdTRUE) {
+      DLOGW(TAG, "Telemetry queue full, sample dropped");
       continue;
     }
+    xEventGroupSetBits(app_events, SAMPLE_READY_BIT);
+  }
+}
 
-    retry_count = 0;
-
-    while (retry_count < MAX_RETRIES) {
-      if (dht_read_data(&humidity, &temperature) == 0) {
-        ESP_LOGI(TAG, "Temperature: %.1f°C, Humidity: %.1f%%", temperature,
-                 humidity);
-        last_temperature = temperature;
-        last_humidity = humidity;
-        send_telemetry(temperature, humidity);
-        break;
-      } else {
-        retry_count++;
-        ESP_LOGW(TAG, "Read attempt %d/%d failed", retry_count, MAX_RETRIES);
-        if (retry_count < MAX_RETRIES) {
-          vTaskDelay(pdMS_TO_TICKS(2000));
-        }
-      }
+// Publicar una sola vez los tiempos del arranque junto a la telemetría
+static void publish_boot_report(void) {
+  char report[256];
+  int len = boot_format_report(report, sizeof(report));
+
+  if (len > 0)
+    publish_send(PUBLISH_STREAM_DIAGNOSTICS, TELEMETRY_TOPIC, report, len);
+}
+
+#if STATS_ENABLED && STATS_REPORT_INTERVAL_MS > 0
+// Publicar los histogramas como la clave "diagnostics" de la telemetría
+static void publish_diagnostics(void) {
+  static char report[RPC_RESULT_SIZE];
+  int len = snprintf(report, sizeof(report), "{\"diagnostics\":");
+  int n = stats_format(report + len, sizeof(report) - len - 1);
+
+  if (n == 0)
+    return;
+  len += n;
+  report[len++] = '}';
+  publish_send(PUBLISH_STREAM_DIAGNOSTICS, TELEMETRY_TOPIC, report, len);
+}
+#endif
+
+#if HTTP_SERVER_ENABLED
+// Instantánea para GET /metrics: el estado de control, la capa de
+// publicación y, si se compilan, las latencias por etapa
+static int http_metrics(char *buf, size_t size) {
+  telemetry_sample_t sample;
+  conn_t net;
+  uint32_t version = control_snapshot_read(&sample);
+  size_t len = 0;
+  int n;
+
+#define APPEND(expr)                                                           \
+  do {                                                                         \
+    n = (expr);                                                                \
+    if (n <= 0 || (size_t)n >= size - len)                                     \
+      return 0;                                                                \
+    len += n;                                                                  \
+  } while (0)
+
+  APPEND(snprintf(buf, size, "{\"uptime_ms\":%lld,\"version\":%lu,\"state\":",
+                  (long long)(hal_time_us() / 1000), (unsigned long)version));
+  sample.keys = telemetry_sample_keys(&sample);
+  APPEND(telemetry_encoder_json.sample((uint8_t *)buf + len, size - len,
+                                       &sample, 0, true));
+  APPEND(snprintf(buf + len, size - len, ",\"publish\":"));
+  APPEND(publish_format(buf + len, size - len));
+  APPEND(snprintf(buf + len, size - len, ",\"net\":"));
+  hal_net_status(&net);
+  APPEND(conn_format(&net, hal_time_us() / 1000, buf + len, size - len));
+#if STATS_ENABLED
+  APPEND(snprintf(buf + len, size - len, ",\"stats\":"));
+  APPEND(stats_format(buf + len, size - len));
+#endif
+  APPEND(snprintf(buf + len, size - len, "}"));
+#undef APPEND
+  return len;
+}
+
+// Difundir la muestra completa a los clientes locales; se codifica una vez
+// sin importar cuántos estén conectados
+static void http_stream_sample(const telemetry_sample_t *sample) {
+  char frame[HTTP_FRAME_SIZE];
+  telemetry_sample_t full = *sample;
+  int64_t offset = telemetry_epoch_offset_ms();
+
+  if (http_client_count() == 0)
+    return;
+  full.keys = telemetry_sample_keys(&full);
+  int64_t ts_ms = offset ? full.mono_ms + offset : 0;
+  size_t len = telemetry_encoder_json.sample((uint8_t *)frame, sizeof(frame),
+                                             &full, ts_ms, true);
+  if (len > 0)
+    http_broadcast(frame, len);
+}
+#endif
+
+// Tarea de comunicaciones: publica las muestras o las guarda en flash si no
+// hay conexión, y vacía la cola persistente al reconectar
+static void comms_task(void *pvParameters) {
+  telemetry_sample_t sample;
+  int64_t last_drain_ms = 0;
+#if STATS_ENABLED && STATS_REPORT_INTERVAL_MS > 0
+  int64_t last_diagnostics_ms = 0;
+#endif
+
+  while (1) {
+    EventBits_t bits = xEventGroupGetBits(app_events);
+    bool connected = bits & MQTT_CONNECTED_BIT;
+
+    // Con datos pendientes en flash, despertar a intervalos para vaciarlos;
+    // con mensajes combinados, más seguido para enviarlos cuando haya espacio
+    TickType_t wait = portMAX_DELAY;
+    if (connected && publish_pending()) {
+      wait = pdMS_TO_TICKS(PUBLISH_POLL_INTERVAL_MS);
+    } else if (connected && offline_pending() > 0) {
+      wait = pdMS_TO_TICKS(OFFLINE_DRAIN_INTERVAL_MS);
     }
+    bits = xEventGroupWaitBits(app_events,
+                               SAMPLE_READY_BIT | MQTT_CONNECT_EVENT_BIT |
+                                   ENCODER_CHANGE_BIT,
+                               pdTRUE, pdFALSE, wait);
+
+    connected = xEventGroupGetBits(app_events) & MQTT_CONNECTED_BIT;
 
-    // Actualizar salidas según el modo
-    if (automatic_mode) {
-      ESP_LOGI(TAG, "Running in AUTOMATIC mode");
-      leds_update_by_humidity(humidity);
-      buzzer_update_by_temperature(temperature);
-    } else {
-      ESP_LOGI(TAG, "Running in MANUAL mode");
+    // El codificador solo cambia entre dos mensajes, nunca a mitad de un lote
+    const telemetry_encoder_t *encoder;
+    if ((bits & ENCODER_CHANGE_BIT) &&
+        xQueueReceive(encoder_queue, &encoder, 0) == pdTRUE) {
+      encoder_set(encoder);
     }
 
-    if (retry_count >= MAX_RETRIES) {
-      ESP_LOGE(TAG, "Failed to read DHT11 sensor after %d attempts",
-               MAX_RETRIES);
+    // Tras una desconexión la referencia de cambios ya no es válida
+    if (bits & MQTT_CONNECT_EVENT_BIT) {
+      telemetry_force_keyframe();
+#if GATEWAY_MODE
+      gateway_connect_devices(sensor_count);
+#endif
     }
 
-    vTaskDelay(pdMS_TO_TICKS(20000));
+    while (xQueueReceive(telemetry_queue, &sample, 0) == pdTRUE) {
+#if HTTP_SERVER_ENABLED
+      http_stream_sample(&sample);
+#endif
+      if (!connected) {
+        offline_append(&sample);
+        continue;
+      }
+      // Publicar solo las claves que cambiaron en este ciclo
+      if (telemetry_diff(&sample) != 0) {
+        telemetry_push(&sample);
+      }
+    }
+
+    if (!connected)
+      continue;
+
+    // La primera muestra tras arrancar no espera a completar el lote, solo a
+    // la hora real
+    bool first = !boot_reached(BOOT_MILESTONE_FIRST_TELEMETRY);
+    if ((first && telemetry_pending() > 0) ||
+        telemetry_should_flush(hal_time_us() / 1000)) {
+      if (telemetry_flush() == 0 && first) {
+        boot_mark(BOOT_MILESTONE_FIRST_TELEMETRY);
+        publish_boot_report();
+      }
+    }
+    publish_poll();
+    int64_t now_ms = hal_time_us() / 1000;
+#if STATS_ENABLED && STATS_REPORT_INTERVAL_MS > 0
+    if (now_ms - last_diagnostics_ms >= STATS_REPORT_INTERVAL_MS) {
+      publish_diagnostics();
+      last_diagnostics_ms = now_ms;
+    }
+#endif
+    if (offline_pending() > 0 &&
+        now_ms - last_drain_ms >= OFFLINE_DRAIN_INTERVAL_MS) {
+      offline_drain();
+      last_drain_ms = now_ms;
+    }
+  }
+}
+
+#if DEEP_SLEEP_MODE
+#ifndef RTC_DATA_ATTR
+#define RTC_DATA_ATTR
+#endif
+
+// Estado que sobrevive al sueño profundo
+static RTC_DATA_ATTR sleep_state_t rtc_state;
+
+// Llevar el modo, los filtros y las salidas al estado retenido
+static void sleep_restore(control_state_t *control, bool warm) {
+  _Static_assert(sizeof(rtc_state.filters) == sizeof(control->filters),
+                 "retained filters must match the control state");
+
+  control_state_init(control);
+  if (warm)
+    memcpy(control->filters, rtc_state.filters, sizeof(control->filters));
+  control->automatic_mode = rtc_state.automatic_mode;
+  control->last_temperature = rtc_state.last_temperature;
+  control->last_humidity = rtc_state.last_humidity;
+  control->rules.active = rtc_state.rules_active;
+
+  buzzer_set_threshold(rtc_state.temp_threshold);
+  buzzer_set(rtc_state.buzzer, rtc_state.buzzer_manual);
+  for (uint8_t i = 0; i < 3; i++) {
+    led_set(i + 1, rtc_state.leds & (1 << i), rtc_state.leds_manual & (1 << i));
+  }
+  control_snapshot_store(control);
+}
+
+// Guardar el modo y las salidas antes de dormir
+static void sleep_save(const control_state_t *control) {
+  rtc_state.automatic_mode = control->automatic_mode;
+  rtc_state.last_temperature = control->last_temperature;
+  rtc_state.last_humidity = control->last_humidity;
+  memcpy(rtc_state.filters, control->filters, sizeof(rtc_state.filters));
+  rtc_state.rules_active = control->rules.active;
+
+  rtc_state.temp_threshold = buzzer_get_threshold();
+  rtc_state.buzzer = buzzer_get_state();
+  rtc_state.buzzer_manual = buzzer_is_manual_mode();
+  rtc_state.leds = 0;
+  rtc_state.leds_manual = 0;
+  for (uint8_t i = 0; i < 3; i++) {
+    rtc_state.leds |= led_get_state(i + 1) ? 1 << i : 0;
+    rtc_state.leds_manual |= led_is_manual(i + 1) ? 1 << i : 0;
   }
 }
 
+// Levantar la red, publicar las muestras retenidas y atender comandos
+static void sleep_publish(control_state_t *control) {
+  static bool network_started = false;
+  control_cmd_t cmd;
+
+  if (!network_started) {
+    ESP_ERROR_CHECK(hal_net_init());
+    mqtt_init();
+    network_started = true;
+  }
+
+  EventBits_t bits =
+      xEventGroupWaitBits(app_events, MQTT_CONNECTED_BIT, pdFALSE, pdTRUE,
+                          pdMS_TO_TICKS(SLEEP_CONNECT_TIMEOUT_MS));
+  if (!(bits & MQTT_CONNECTED_BIT)) {
+    ESP_LOGW(TAG, "MQTT not connected, keeping %u samples",
+             rtc_state.pending_count);
+    return;
+  }
+
+#if GATEWAY_MODE
+  gateway_connect_devices(sensor_count);
+#endif
+  telemetry_init();
+  for (size_t i = 0; i < rtc_state.pending_count; i++) {
+    telemetry_push(sleep_pending_get(&rtc_state, i));
+  }
+  if (telemetry_flush() == 0) {
+    sleep_pending_clear(&rtc_state);
+  }
+
+  while (xQueueReceive(control_queue, &cmd,
+                       pdMS_TO_TICKS(SLEEP_RPC_WINDOW_MS)) == pdTRUE) {
+    control_apply_command(control, &cmd);
+  }
+  // Respuestas que esperaban espacio en la bandeja
+  publish_poll();
+}
+
+// Un ciclo completo: leer, actuar, publicar si corresponde y dormir
+static void sleep_cycle(void) {
+  static bool hardware_ready = false;
+  control_state_t control;
+  control_cmd_t cmd = {.type = CONTROL_CMD_READING};
+  telemetry_sample_t sample;
+  int64_t start_ms = hal_time_us() / 1000;
+  bool warm = hal_woke_from_sleep() && sleep_state_valid(&rtc_state);
+
+  if (warm) {
+    sleep_state_wake(&rtc_state, start_ms);
+    ESP_LOGI(TAG, "Wake-up %lu, %u samples pending",
+             (unsigned long)rtc_state.cycle, rtc_state.pending_count);
+  } else {
+    ESP_LOGI(TAG, "Cold start, resetting retained state");
+    sleep_state_reset(&rtc_state, TEMP_THRESHOLD);
+  }
+
+  // Los periféricos pierden su configuración al dormir, los umbrales no
+  if (!hardware_ready) {
+    sensors_init();
+    leds_init();
+    buzzer_init();
+    hardware_ready = true;
+  }
+  sleep_restore(&control, warm);
+
+  if (sensor_read(cmd.reading.sensors) == 0) {
+    cmd.reading.mono_ms = hal_time_us() / 1000;
+    control_apply_command(&control, &cmd);
+    control_build_sample(&control, &sample);
+    sample.keys = telemetry_sample_keys(&sample);
+    sleep_pending_push(&rtc_state, &sample);
+  }
+
+  if (sleep_should_connect(&rtc_state)) {
+    sleep_publish(&control);
+  }
+
+  sleep_save(&control);
+  log_flush();
+  hal_deep_sleep(sleep_state_prepare(&rtc_state, hal_time_us() / 1000,
+                                     start_ms, SAMPLE_PERIOD_MS));
+}
+#endif // DEEP_SLEEP_MODE
+
 void app_main(void) {
+  boot_mark(BOOT_MILESTONE_APP_START);
   ESP_LOGI(TAG, "Starting DHT11 ThingsBoard Application");
+  ESP_ERROR_CHECK(log_init());
+  ESP_ERROR_CHECK(publish_init());
 
   // Inicializar NVS
   esp_err_t ret = nvs_flash_init();
@@ -332,17 +1358,56 @@ void app_main(void) {
     ret = nvs_flash_init();
   }
   ESP_ERROR_CHECK(ret);
+  ESP_ERROR_CHECK(history_init());
+
+  app_events = xEventGroupCreate();
+  control_queue = xQueueCreate(CONTROL_QUEUE_LEN, sizeof(control_cmd_t));
+  sampling_queue = xQueueCreate(1, sizeof(sampling_policy_t));
+  sampling_active = sampling_defaults;
+  rules_queue = xQueueCreate(1, sizeof(rules_update_t));
+  encoder_queue = xQueueCreate(1, sizeof(const telemetry_encoder_t *));
+  telemetry_queue =
+      xQueueCreate(TELEMETRY_QUEUE_LEN, sizeof(telemetry_sample_t));
+  if (app_events == NULL || control_queue == NULL || telemetry_queue == NULL ||
+      sampling_queue == NULL || rules_queue == NULL ||
+      encoder_queue == NULL) {
+    ESP_LOGE(TAG, "Failed to create task queues");
+    return;
+  }
+
+#if DEEP_SLEEP_MODE
+  // En la placa cada ciclo termina en un reinicio; en linux el bucle sigue
+  while (1) {
+    sleep_cycle();
+  }
+#endif
 
-  wifi_init();
+  ESP_ERROR_CHECK(hal_net_init());
   mqtt_init();
+#if HTTP_SERVER_ENABLED
+  if (http_init(http_metrics) != ESP_OK)
+    ESP_LOGW(TAG, "Local HTTP server not available");
+#endif
 
-  gpio_set_direction(DHT_GPIO, GPIO_MODE_INPUT);
-  gpio_set_pull_mode(DHT_GPIO, GPIO_PULLUP_ONLY);
+  if (sensors_init() != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to initialize the primary DHT sensor");
+  }
 
   leds_init();
 
   buzzer_init();
 
-  // Ininiciar súper-tarea
-  xTaskCreate(main_task, "main_task", 8192, NULL, 5, NULL);
-}
\ No newline at end of file
+  telemetry_init();
+  offline_init();
+
+  // Iniciar las tareas de la tubería
+  xTaskCreatePinnedToCore(control_task, "control_task", TASK_STACK_SIZE, NULL,
+                          CONTROL_TASK_PRIORITY, NULL,
+                          TASK_CORE(CONTROL_TASK_CORE));
+  xTaskCreatePinnedToCore(sensor_task, "sensor_task", TASK_STACK_SIZE, NULL,
+                          SENSOR_TASK_PRIORITY, NULL,
+                          TASK_CORE(SENSOR_TASK_CORE));
+  xTaskCreatePinnedToCore(comms_task, "comms_task", COMMS_TASK_STACK_SIZE, NULL,
+                          COMMS_TASK_PRIORITY, NULL,
+                          TASK_CORE(COMMS_TASK_CORE));
+}
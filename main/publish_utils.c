@@ -0,0 +1,239 @@
+/*******************************************************************************
+ * @file        publish_utils.c
+ * @brief       Capa de publicación MQTT acotada por flujo.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "publish_utils.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "hal.h"
+#include "log_utils.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef PUBLISH_TELEMETRY_QOS
+#define PUBLISH_TELEMETRY_QOS 1
+#endif
+#ifndef PUBLISH_TELEMETRY_POLICY
+#define PUBLISH_TELEMETRY_POLICY PUBLISH_POLICY_DROP_OLDEST
+#endif
+
+#define PUBLISH_BLOCK_POLL_MS 20
+
+static const char *stream_names[PUBLISH_STREAM_COUNT] = {
+    "telemetry",
+    "backlog",
+    "rpc",
+    "diagnostics",
+    "gateway",
+};
+
+static const char *policy_names[] = {
+    [PUBLISH_POLICY_DROP_NEWEST] = "drop_newest",
+    [PUBLISH_POLICY_DROP_OLDEST] = "drop_oldest",
+    [PUBLISH_POLICY_COALESCE] = "coalesce",
+    [PUBLISH_POLICY_QUEUE] = "queue",
+    [PUBLISH_POLICY_BLOCK] = "block",
+};
+
+typedef struct {
+  publish_stream_config_t config;
+  atomic_uint_least32_t sent;
+  atomic_uint_least32_t dropped;   // descartados por esta capa
+  atomic_uint_least32_t deferred;  // devueltos al productor
+  atomic_uint_least32_t coalesced; // reemplazados por uno más nuevo
+  size_t held;                     // mensajes retenidos de este flujo
+} publish_stream_state_t;
+
+// Un mensaje retenido hasta que haya espacio en la bandeja
+typedef struct {
+  publish_stream_t stream;
+  char topic[PUBLISH_TOPIC_SIZE];
+  size_t len;
+  char data[PUBLISH_HOLD_SIZE];
+} publish_held_t;
+
+static const char *TAG = "PUBLISH";
+
+static publish_stream_state_t streams[PUBLISH_STREAM_COUNT] = {
+    [PUBLISH_STREAM_TELEMETRY].config = {PUBLISH_TELEMETRY_QOS,
+                                         PUBLISH_TELEMETRY_POLICY},
+    [PUBLISH_STREAM_BACKLOG].config = {1, PUBLISH_POLICY_DROP_OLDEST},
+    // Las respuestas salen desde la tarea del cliente MQTT, que no puede
+    // esperar: con la bandeja llena se guardan y se envían después. Cada
+    // solicitud tiene su propio tópico de respuesta, así que no se combinan
+    [PUBLISH_STREAM_RPC].config = {1, PUBLISH_POLICY_QUEUE},
+    [PUBLISH_STREAM_DIAGNOSTICS].config = {0, PUBLISH_POLICY_COALESCE},
+    [PUBLISH_STREAM_GATEWAY].config = {1, PUBLISH_POLICY_BLOCK},
+};
+
+// Cola circular de mensajes retenidos, compartida por los flujos
+static publish_held_t held[PUBLISH_HOLD_DEPTH];
+static size_t held_head = 0;
+static size_t held_count = 0;
+
+// Protege los mensajes retenidos; los contadores son atómicos
+static SemaphoreHandle_t publish_lock = NULL;
+
+esp_err_t publish_init(void) {
+  if (publish_lock == NULL)
+    publish_lock = xSemaphoreCreateMutex();
+  return publish_lock != NULL ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+esp_err_t publish_configure(publish_stream_t stream,
+                            const publish_stream_config_t *config) {
+  if (stream >= PUBLISH_STREAM_COUNT || config->qos < 0 || config->qos > 1 ||
+      config->policy > PUBLISH_POLICY_QUEUE)
+    return ESP_ERR_INVALID_ARG;
+
+  xSemaphoreTake(publish_lock, portMAX_DELAY);
+  streams[stream].config = *config;
+  xSemaphoreGive(publish_lock);
+  return ESP_OK;
+}
+
+static bool publish_has_room(void) {
+  return hal_mqtt_outbox_size() < PUBLISH_OUTBOX_LIMIT;
+}
+
+static int publish_now(publish_stream_state_t *state, const char *topic,
+                       const char *data, size_t len) {
+  int msg_id = hal_mqtt_publish(topic, data, len, state->config.qos, 0);
+  if (msg_id >= 0)
+    atomic_fetch_add_explicit(&state->sent, 1, memory_order_relaxed);
+  return msg_id;
+}
+
+// Retener el mensaje al final de la cola; con PUBLISH_POLICY_COALESCE
+// reemplaza al que el flujo ya tenía retenido, en su mismo lugar
+static bool publish_hold(publish_stream_t stream, const char *topic,
+                         const char *data, size_t len) {
+  publish_stream_state_t *state = &streams[stream];
+  publish_held_t *slot = NULL;
+
+  if (len > PUBLISH_HOLD_SIZE || strlen(topic) >= PUBLISH_TOPIC_SIZE)
+    return false;
+
+  xSemaphoreTake(publish_lock, portMAX_DELAY);
+  if (state->config.policy == PUBLISH_POLICY_COALESCE && state->held > 0) {
+    for (size_t i = 0; i < held_count; i++) {
+      publish_held_t *h = &held[(held_head + i) % PUBLISH_HOLD_DEPTH];
+      if (h->stream == stream)
+        slot = h;
+    }
+    if (slot != NULL)
+      atomic_fetch_add_explicit(&state->coalesced, 1, memory_order_relaxed);
+  }
+  if (slot == NULL && held_count < PUBLISH_HOLD_DEPTH) {
+    slot = &held[(held_head + held_count) % PUBLISH_HOLD_DEPTH];
+    slot->stream = stream;
+    held_count++;
+    state->held++;
+  }
+  if (slot != NULL) {
+    strcpy(slot->topic, topic);
+    memcpy(slot->data, data, len);
+    slot->len = len;
+  }
+  xSemaphoreGive(publish_lock);
+  return slot != NULL;
+}
+
+int publish_send(publish_stream_t stream, const char *topic, const char *data,
+                 size_t len) {
+  if (stream >= PUBLISH_STREAM_COUNT)
+    return -1;
+  publish_stream_state_t *state = &streams[stream];
+
+  // Con mensajes retenidos del flujo, el nuevo va detrás para no adelantarlos
+  if (publish_has_room() && state->held == 0)
+    return publish_now(state, topic, data, len);
+
+  switch (state->config.policy) {
+  case PUBLISH_POLICY_DROP_NEWEST:
+    break;
+
+  case PUBLISH_POLICY_DROP_OLDEST:
+    atomic_fetch_add_explicit(&state->deferred, 1, memory_order_relaxed);
+    return -1;
+
+  case PUBLISH_POLICY_COALESCE:
+  case PUBLISH_POLICY_QUEUE:
+    if (publish_hold(stream, topic, data, len))
+      return -1;
+    break;
+
+  case PUBLISH_POLICY_BLOCK:
+    for (int waited = 0; waited < PUBLISH_BLOCK_TIMEOUT_MS;
+         waited += PUBLISH_BLOCK_POLL_MS) {
+      vTaskDelay(pdMS_TO_TICKS(PUBLISH_BLOCK_POLL_MS));
+      if (publish_has_room())
+        return publish_now(state, topic, data, len);
+    }
+    break;
+  }
+
+  atomic_fetch_add_explicit(&state->dropped, 1, memory_order_relaxed);
+  DLOGW(TAG, "Outbox full, %s message dropped", stream_names[stream]);
+  return -1;
+}
+
+void publish_poll(void) {
+  if (held_count == 0)
+    return;
+
+  xSemaphoreTake(publish_lock, portMAX_DELAY);
+  while (held_count > 0 && publish_has_room()) {
+    publish_held_t *h = &held[held_head];
+    publish_stream_state_t *state = &streams[h->stream];
+
+    if (publish_now(state, h->topic, h->data, h->len) < 0)
+      break;
+    state->held--;
+    held_head = (held_head + 1) % PUBLISH_HOLD_DEPTH;
+    held_count--;
+  }
+  xSemaphoreGive(publish_lock);
+}
+
+bool publish_pending(void) { return held_count > 0; }
+
+int publish_format(char *buf, size_t size) {
+  size_t len = 0;
+
+#define APPEND(...)                                                            \
+  do {                                                                         \
+    int n = snprintf(buf + len, size - len, __VA_ARGS__);                      \
+    if (n < 0 || (size_t)n >= size - len)                                      \
+      return 0;                                                                \
+    len += n;                                                                  \
+  } while (0)
+
+  APPEND("{\"outbox_bytes\":%d,\"outbox_limit\":%d", hal_mqtt_outbox_size(),
+         PUBLISH_OUTBOX_LIMIT);
+  for (int i = 0; i < PUBLISH_STREAM_COUNT; i++) {
+    publish_stream_state_t *state = &streams[i];
+    APPEND(",\"%s\":{\"qos\":%d,\"policy\":\"%s\",\"sent\":%lu,"
+           "\"dropped\":%lu,\"deferred\":%lu,\"coalesced\":%lu,"
+           "\"pending\":%u}",
+           stream_names[i], state->config.qos,
+           policy_names[state->config.policy],
+           (unsigned long)atomic_load(&state->sent),
+           (unsigned long)atomic_load(&state->dropped),
+           (unsigned long)atomic_load(&state->deferred),
+           (unsigned long)atomic_load(&state->coalesced),
+           (unsigned)state->held);
+  }
+  APPEND("}");
+#undef APPEND
+  return len;
+}
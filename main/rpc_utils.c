@@ -0,0 +1,470 @@
+/*******************************************************************************
+ * @file        rpc_utils.c
+ * @brief       Despachador de llamadas RPC de ThingsBoard basado en una tabla
+ *              de métodos registrados y un analizador JSON sin memoria
+ *              dinámica.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "rpc_utils.h"
+#include "esp_log.h"
+#include "gateway_utils.h"
+#include "log_utils.h"
+#include "publish_utils.h"
+#include "stats_utils.h"
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  const char *method;
+  rpc_handler_t handler;
+  bool per_device; // atiende a cada dispositivo hijo por separado
+} rpc_method_t;
+
+// A quién responder: el id del tópico de la solicitud o, en modo pasarela,
+// el dispositivo hijo y el id del sobre
+typedef struct {
+  const char *id;
+  int id_len;
+  const char *device; // NULL fuera del modo pasarela
+  int device_len;
+} rpc_target_t;
+
+static const char *TAG = "RPC";
+
+static rpc_method_t methods[RPC_MAX_METHODS];
+static int method_count = 0;
+
+// Estado del reensamblado de mensajes fragmentados
+static char rpc_topic[RPC_TOPIC_SIZE];
+static char rpc_buffer[RPC_BUFFER_SIZE];
+static bool rpc_overflow = false;
+
+static rpc_json_token_t rpc_tokens[RPC_MAX_TOKENS];
+static char rpc_result[RPC_RESULT_SIZE];
+static char rpc_envelope[RPC_ENVELOPE_SIZE];
+// Destino de la solicitud que se está atendiendo, para rpc_defer
+static const rpc_target_t *rpc_current = NULL;
+
+// Con la bandeja llena la respuesta más grande debe caber entre las retenidas
+_Static_assert(RPC_ENVELOPE_SIZE <= PUBLISH_HOLD_SIZE,
+               "PUBLISH_HOLD_SIZE too small for RPC replies");
+
+static esp_err_t rpc_add_method(const char *method, rpc_handler_t handler,
+                                bool per_device) {
+  if (method_count >= RPC_MAX_METHODS)
+    return ESP_ERR_NO_MEM;
+  methods[method_count++] = (rpc_method_t){method, handler, per_device};
+  return ESP_OK;
+}
+
+esp_err_t rpc_register(const char *method, rpc_handler_t handler) {
+  return rpc_add_method(method, handler, false);
+}
+
+esp_err_t rpc_register_device(const char *method, rpc_handler_t handler) {
+  return rpc_add_method(method, handler, true);
+}
+
+static int rpc_json_add(rpc_json_token_t *tokens, int *count, int max_tokens,
+                        rpc_json_type_t type, size_t start, size_t end) {
+  if (*count >= max_tokens)
+    return -1;
+  tokens[*count] = (rpc_json_token_t){type, start, end, 0};
+  return (*count)++;
+}
+
+int rpc_json_parse(const char *json, size_t len, rpc_json_token_t *tokens,
+                   int max_tokens) {
+  int stack[RPC_MAX_DEPTH];
+  int depth = 0;
+  int count = 0;
+
+  if (len > UINT16_MAX)
+    return -1;
+
+  for (size_t pos = 0; pos < len; pos++) {
+    char c = json[pos];
+    int idx;
+
+    switch (c) {
+    case '{':
+    case '[':
+      if (depth >= RPC_MAX_DEPTH)
+        return -1;
+      idx = rpc_json_add(tokens, &count, max_tokens,
+                         c == '{' ? RPC_JSON_OBJECT : RPC_JSON_ARRAY, pos, 0);
+      if (idx < 0)
+        return -1;
+      if (depth > 0)
+        tokens[stack[depth - 1]].size++;
+      stack[depth++] = idx;
+      break;
+
+    case '}':
+    case ']':
+      if (depth == 0)
+        return -1;
+      idx = stack[--depth];
+      if (tokens[idx].type != (c == '}' ? RPC_JSON_OBJECT : RPC_JSON_ARRAY))
+        return -1;
+      tokens[idx].end = pos + 1;
+      break;
+
+    case '"': {
+      size_t start = ++pos;
+      while (pos < len && json[pos] != '"') {
+        if (json[pos] == '\\')
+          pos++;
+        pos++;
+      }
+      if (pos >= len)
+        return -1;
+      if (rpc_json_add(tokens, &count, max_tokens, RPC_JSON_STRING, start,
+                       pos) < 0)
+        return -1;
+      if (depth > 0)
+        tokens[stack[depth - 1]].size++;
+      break;
+    }
+
+    case ' ':
+    case '\t':
+    case '\r':
+    case '\n':
+    case ':':
+    case ',':
+      break;
+
+    default: {
+      size_t start = pos;
+      while (pos < len && !strchr(" \t\r\n,:]}", json[pos]))
+        pos++;
+      if (rpc_json_add(tokens, &count, max_tokens, RPC_JSON_PRIMITIVE, start,
+                       pos) < 0)
+        return -1;
+      if (depth > 0)
+        tokens[stack[depth - 1]].size++;
+      pos--;
+      break;
+    }
+    }
+  }
+
+  return depth == 0 ? count : -1;
+}
+
+int rpc_json_skip(const rpc_json_token_t *tokens, int count, int i) {
+  uint16_t end = tokens[i].end;
+  for (i++; i < count && tokens[i].start < end; i++)
+    ;
+  return i;
+}
+
+static bool rpc_json_equals(const char *json, const rpc_json_token_t *token,
+                            const char *str) {
+  size_t len = token->end - token->start;
+  return strlen(str) == len && memcmp(json + token->start, str, len) == 0;
+}
+
+int rpc_json_find(const char *json, const rpc_json_token_t *tokens, int count,
+                  int object, const char *key) {
+  if (object < 0 || tokens[object].type != RPC_JSON_OBJECT)
+    return -1;
+
+  int i = object + 1;
+  while (i + 1 < count && tokens[i].start < tokens[object].end) {
+    if (tokens[i].type == RPC_JSON_STRING &&
+        rpc_json_equals(json, &tokens[i], key))
+      return i + 1;
+    i = rpc_json_skip(tokens, count, i + 1);
+  }
+  return -1;
+}
+
+static int rpc_param(const rpc_request_t *request, const char *key) {
+  if (key == NULL)
+    return request->params;
+  return rpc_json_find(request->json, request->tokens, request->count,
+                       request->params, key);
+}
+
+bool rpc_param_float(const rpc_request_t *request, const char *key,
+                     float *out) {
+  int idx = rpc_param(request, key);
+  if (idx < 0 || request->tokens[idx].type != RPC_JSON_PRIMITIVE)
+    return false;
+
+  const char *start = request->json + request->tokens[idx].start;
+  char *end;
+  float value = strtof(start, &end);
+  // strtof desborda a infinito con 1e39 y acepta "nan" e "inf"
+  if (end != request->json + request->tokens[idx].end || !isfinite(value))
+    return false;
+  *out = value;
+  return true;
+}
+
+bool rpc_param_int(const rpc_request_t *request, const char *key, int *out) {
+  float value;
+  if (!rpc_param_float(request, key, &value))
+    return false;
+  // Convertir un flotante fuera del rango de int es indefinido
+  if (value < (float)INT_MIN || value >= -(float)INT_MIN)
+    return false;
+  *out = (int)value;
+  return true;
+}
+
+bool rpc_param_bool(const rpc_request_t *request, const char *key, bool *out) {
+  int idx = rpc_param(request, key);
+  if (idx < 0 || request->tokens[idx].type != RPC_JSON_PRIMITIVE)
+    return false;
+
+  if (rpc_json_equals(request->json, &request->tokens[idx], "true")) {
+    *out = true;
+    return true;
+  }
+  if (rpc_json_equals(request->json, &request->tokens[idx], "false")) {
+    *out = false;
+    return true;
+  }
+
+  // También se aceptan números, igual que valueint en cJSON
+  int value;
+  if (!rpc_param_int(request, key, &value))
+    return false;
+  *out = value != 0;
+  return true;
+}
+
+bool rpc_param_string_equals(const rpc_request_t *request, const char *key,
+                             const char *value) {
+  int idx = rpc_param(request, key);
+  return idx >= 0 && request->tokens[idx].type == RPC_JSON_STRING &&
+         rpc_json_equals(request->json, &request->tokens[idx], value);
+}
+
+// El sobre del gateway se arma en envelope: rpc_envelope desde la tarea del
+// cliente MQTT, o uno local para las respuestas diferidas
+static void rpc_reply_in(const rpc_target_t *target, const char *result,
+                         int result_len, char *envelope,
+                         size_t envelope_size) {
+  if (target->device != NULL) {
+    int n = snprintf(envelope, envelope_size,
+                     "{\"device\":\"%.*s\",\"id\":%.*s,\"data\":%.*s}",
+                     target->device_len, target->device, target->id_len,
+                     target->id, result_len, result);
+    if (n < 0 || (size_t)n >= envelope_size) {
+      DLOGW(TAG, "Gateway RPC reply too large");
+      return;
+    }
+    publish_send(PUBLISH_STREAM_RPC, GATEWAY_RPC_TOPIC, envelope, n);
+    return;
+  }
+
+  char topic[RPC_TOPIC_SIZE];
+  snprintf(topic, sizeof(topic), RPC_RESPONSE_TOPIC "%.*s", target->id_len,
+           target->id);
+  publish_send(PUBLISH_STREAM_RPC, topic, result, result_len);
+}
+
+static void rpc_reply(const rpc_target_t *target, const char *result,
+                      int result_len) {
+  rpc_reply_in(target, result, result_len, rpc_envelope,
+               sizeof(rpc_envelope));
+}
+
+static void rpc_reply_error(const rpc_target_t *target, const char *error) {
+  int n = snprintf(rpc_result, sizeof(rpc_result),
+                   "{\"success\":false,\"error\":\"%s\"}", error);
+  rpc_reply(target, rpc_result, n);
+}
+
+esp_err_t rpc_defer(rpc_deferred_t *deferred) {
+  const rpc_target_t *target = rpc_current;
+
+  if (target == NULL)
+    return ESP_ERR_INVALID_STATE;
+  if (target->id_len >= RPC_ID_SIZE || target->device_len >= RPC_DEVICE_SIZE)
+    return ESP_ERR_INVALID_SIZE;
+  memcpy(deferred->id, target->id, target->id_len);
+  deferred->id[target->id_len] = 0;
+  deferred->device[0] = 0;
+  if (target->device != NULL) {
+    memcpy(deferred->device, target->device, target->device_len);
+    deferred->device[target->device_len] = 0;
+  }
+  return ESP_OK;
+}
+
+void rpc_reply_deferred(const rpc_deferred_t *deferred, esp_err_t ret) {
+  char result[96];
+  char envelope[sizeof(result) + RPC_ID_SIZE + RPC_DEVICE_SIZE + 32];
+  rpc_target_t target = {
+      .id = deferred->id,
+      .id_len = strlen(deferred->id),
+      .device = deferred->device[0] != 0 ? deferred->device : NULL,
+      .device_len = strlen(deferred->device),
+  };
+
+  int n = ret == ESP_OK
+              ? snprintf(result, sizeof(result), "{\"success\":true}")
+              : snprintf(result, sizeof(result),
+                         "{\"success\":false,\"error\":\"%s\"}",
+                         esp_err_to_name(ret));
+  rpc_reply_in(&target, result, n, envelope, sizeof(envelope));
+}
+
+// Fuera del modo pasarela el id de la solicitud es el último segmento del
+// tópico, así que se conoce aunque el cuerpo no se pueda leer
+static void rpc_topic_target(rpc_target_t *target) {
+  const char *request_id = strrchr(rpc_topic, '/');
+  target->id = request_id ? request_id + 1 : rpc_topic;
+  target->id_len = strlen(target->id);
+}
+
+// En modo pasarela la solicitud viene envuelta en
+// {"device":"<hijo>","data":{"id":n,"method":..,"params":..}}; retorna el
+// índice del objeto interno, o -1
+static int rpc_gateway_unwrap(int count, rpc_target_t *target) {
+  int device = rpc_json_find(rpc_buffer, rpc_tokens, count, 0, "device");
+  int data = rpc_json_find(rpc_buffer, rpc_tokens, count, 0, "data");
+  int id = rpc_json_find(rpc_buffer, rpc_tokens, count, data, "id");
+  if (device < 0 || id < 0 || rpc_tokens[device].type != RPC_JSON_STRING ||
+      rpc_tokens[id].type != RPC_JSON_PRIMITIVE)
+    return -1;
+
+  target->device = rpc_buffer + rpc_tokens[device].start;
+  target->device_len = rpc_tokens[device].end - rpc_tokens[device].start;
+  target->id = rpc_buffer + rpc_tokens[id].start;
+  target->id_len = rpc_tokens[id].end - rpc_tokens[id].start;
+  return data;
+}
+
+static void rpc_dispatch(size_t len) {
+  rpc_target_t target = {0};
+  int count = rpc_json_parse(rpc_buffer, len, rpc_tokens, RPC_MAX_TOKENS);
+  int root = count > 0 ? 0 : -1;
+
+  if (strcmp(rpc_topic, GATEWAY_RPC_TOPIC) == 0) {
+    // Sin dispositivo e id no hay a quién responder. Un sobre sin "method"
+    // es además lo que la propia pasarela publica como respuesta, y un
+    // corredor común se lo reenvía: contestarlo lo repetiría sin fin
+    root = root >= 0 ? rpc_gateway_unwrap(count, &target) : -1;
+    if (root < 0 ||
+        rpc_json_find(rpc_buffer, rpc_tokens, count, root, "method") < 0) {
+      DLOGW(TAG, "Malformed gateway RPC request");
+      return;
+    }
+  } else {
+    rpc_topic_target(&target);
+  }
+
+  int method = rpc_json_find(rpc_buffer, rpc_tokens, count, root, "method");
+  if (method < 0 || rpc_tokens[method].type != RPC_JSON_STRING) {
+    DLOGW(TAG, "Malformed RPC request");
+    rpc_reply_error(&target, "malformed request");
+    return;
+  }
+
+  rpc_request_t request = {
+      .json = rpc_buffer,
+      .tokens = rpc_tokens,
+      .count = count,
+      .params = rpc_json_find(rpc_buffer, rpc_tokens, count, root, "params"),
+      .device = -1,
+  };
+
+  const rpc_json_token_t *name = &rpc_tokens[method];
+  ESP_LOGD(TAG, "RPC %.*s: %.*s", target.id_len, target.id,
+           name->end - name->start, rpc_buffer + name->start);
+
+  if (target.device != NULL) {
+    request.device = gateway_device_index(target.device, target.device_len);
+    if (request.device < 0) {
+      DLOGW(TAG, "RPC for unknown gateway device");
+      rpc_reply_error(&target, "unknown device");
+      return;
+    }
+  }
+
+  for (int i = 0; i < method_count; i++) {
+    if (!rpc_json_equals(rpc_buffer, name, methods[i].method))
+      continue;
+
+    // El nombre registrado es estático y puede pasar al registro diferido
+    DLOGI(TAG, "RPC %s", methods[i].method);
+    if (request.device > 0 && !methods[i].per_device) {
+      DLOGW(TAG, "RPC %s not supported for gateway device %d",
+            methods[i].method, request.device);
+      rpc_reply_error(&target, "not supported for this device");
+      return;
+    }
+    rpc_result[0] = 0;
+    rpc_current = &target;
+    STATS_BEGIN(handler_start);
+    esp_err_t ret = methods[i].handler(&request, rpc_result,
+                                       sizeof(rpc_result));
+    STATS_END(STATS_STAGE_RPC, handler_start);
+    rpc_current = NULL;
+    if (ret == RPC_DEFERRED) {
+      // La respuesta sale de la tarea que termina el trabajo
+    } else if (ret != ESP_OK) {
+      DLOGW(TAG, "RPC %s failed: %s", methods[i].method,
+            esp_err_to_name(ret));
+      rpc_reply_error(&target, esp_err_to_name(ret));
+    } else if (rpc_result[0] != 0) {
+      rpc_reply(&target, rpc_result, strlen(rpc_result));
+    } else {
+      int n = snprintf(rpc_result, sizeof(rpc_result), "{\"success\":true}");
+      rpc_reply(&target, rpc_result, n);
+    }
+    return;
+  }
+
+  DLOGW(TAG, "Unknown RPC method");
+  rpc_reply_error(&target, "unknown method");
+}
+
+void rpc_handle_data(const hal_mqtt_event_t *event) {
+  // El primer fragmento trae el tópico; los siguientes solo datos
+  if (event->current_data_offset == 0) {
+    int topic_len = event->topic_len;
+    if (topic_len >= RPC_TOPIC_SIZE)
+      topic_len = RPC_TOPIC_SIZE - 1;
+    memcpy(rpc_topic, event->topic, topic_len);
+    rpc_topic[topic_len] = 0;
+    rpc_overflow = event->total_data_len >= RPC_BUFFER_SIZE;
+    if (rpc_overflow) {
+      ESP_LOGW(TAG, "RPC payload of %d bytes exceeds buffer, dropped",
+               event->total_data_len);
+      // El id de una solicitud de pasarela está dentro del cuerpo descartado
+      if (strcmp(rpc_topic, GATEWAY_RPC_TOPIC) != 0) {
+        rpc_target_t target = {0};
+        rpc_topic_target(&target);
+        rpc_reply_error(&target, "request too large");
+      }
+    }
+  }
+
+  if (rpc_overflow || event->current_data_offset + event->data_len >
+                          event->total_data_len)
+    return;
+
+  memcpy(rpc_buffer + event->current_data_offset, event->data,
+         event->data_len);
+
+  size_t received = event->current_data_offset + event->data_len;
+  if (received < (size_t)event->total_data_len)
+    return;
+
+  rpc_buffer[received] = 0;
+  rpc_dispatch(received);
+}
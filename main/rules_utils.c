@@ -0,0 +1,214 @@
+/*******************************************************************************
+ * @file        rules_utils.c
+ * @brief       Motor de reglas para las salidas del modo automático.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "rules_utils.h"
+#include "buzzer_utils.h"
+#include "esp_log.h"
+#include "filter_utils.h"
+#include "nvs.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define RULES_NVS_NAMESPACE "rules"
+#define RULES_NVS_KEY "set"
+
+static const char *TAG = "RULES";
+
+static const rule_spec_t rules_defaults[] = {
+    {RULES_INPUT_HUMIDITY(0), true, 50.0, LED_HYSTERESIS, RULES_ACTUATOR_LED1,
+     1, 0},
+    {RULES_INPUT_HUMIDITY(0), true, 65.0, LED_HYSTERESIS, RULES_ACTUATOR_LED2,
+     1, 0},
+    {RULES_INPUT_HUMIDITY(0), true, 80.0, LED_HYSTERESIS, RULES_ACTUATOR_LED3,
+     1, 0},
+    {RULES_INPUT_TEMP_EXCESS, true, 0, BUZZER_HYSTERESIS, RULES_ACTUATOR_BUZZER,
+     BUZZER_PATTERN_WARNING, 1},
+    {RULES_INPUT_TEMP_EXCESS, true, BUZZER_SEVERITY_STEP, BUZZER_HYSTERESIS,
+     RULES_ACTUATOR_BUZZER, BUZZER_PATTERN_ALARM, 2},
+    {RULES_INPUT_TEMP_EXCESS, true, 2 * BUZZER_SEVERITY_STEP, BUZZER_HYSTERESIS,
+     RULES_ACTUATOR_BUZZER, BUZZER_PATTERN_CRITICAL, 3},
+};
+
+static bool rules_valid(const rule_t *rule) {
+  if (rule->input >= RULES_INPUT_COUNT ||
+      rule->actuator >= RULES_ACTUATOR_COUNT)
+    return false;
+  if (rule->actuator == RULES_ACTUATOR_BUZZER)
+    return rule->value < BUZZER_PATTERN_COUNT;
+  return rule->value <= 1;
+}
+
+esp_err_t rules_compile(rules_t *out, const rule_spec_t *specs, size_t count) {
+  rules_t rules = {.count = count};
+
+  if (count > RULES_MAX)
+    return ESP_ERR_INVALID_SIZE;
+
+  for (size_t i = 0; i < count; i++) {
+    const rule_spec_t *spec = &specs[i];
+    if (!isfinite(spec->threshold) || fabsf(spec->threshold) > RULES_VALUE_MAX ||
+        !isfinite(spec->hysteresis) || spec->hysteresis < 0 ||
+        spec->hysteresis > RULES_VALUE_MAX)
+      return ESP_ERR_INVALID_ARG;
+
+    int32_t on = lroundf(spec->threshold * 10);
+    int32_t band = lroundf(spec->hysteresis * 10);
+    rule_t rule = {
+        .input = spec->input,
+        .above = spec->above,
+        .actuator = spec->actuator,
+        .value = spec->value,
+        .priority = spec->priority,
+        .on = on,
+        .off = spec->above ? on - band : on + band,
+    };
+    if (!rules_valid(&rule))
+      return ESP_ERR_INVALID_ARG;
+
+    // Inserción estable: con igual prioridad gana la que llegó primero
+    size_t j = i;
+    while (j > 0 && rules.rules[j - 1].priority < rule.priority) {
+      rules.rules[j] = rules.rules[j - 1];
+      j--;
+    }
+    rules.rules[j] = rule;
+  }
+
+  *out = rules;
+  return ESP_OK;
+}
+
+void rules_default(rules_t *rules) {
+  rules_compile(rules, rules_defaults,
+                sizeof(rules_defaults) / sizeof(rules_defaults[0]));
+}
+
+void rules_evaluate(rules_t *rules, const rules_inputs_t *inputs,
+                    uint8_t outputs[RULES_ACTUATOR_COUNT]) {
+  uint32_t claimed = 0;
+
+  memset(outputs, 0, RULES_ACTUATOR_COUNT);
+  for (int i = 0; i < rules->count; i++) {
+    const rule_t *rule = &rules->rules[i];
+    uint32_t bit = 1UL << i;
+    bool active = rules->active & bit;
+
+    // Sin lectura de esa entrada la regla conserva su estado
+    if (inputs->valid & (1UL << rule->input)) {
+      int32_t value = inputs->values[rule->input];
+      active = rule->above
+                   ? hysteresis_update(active, value, rule->on, rule->off)
+                   : hysteresis_update(active, -value, -rule->on, -rule->off);
+      rules->active = active ? rules->active | bit : rules->active & ~bit;
+    }
+
+    // Las reglas están ordenadas por prioridad: la primera activa manda
+    if (active && !(claimed & (1UL << rule->actuator))) {
+      claimed |= 1UL << rule->actuator;
+      outputs[rule->actuator] = rule->value;
+    }
+  }
+}
+
+int32_t rules_dew_point(int32_t temperature, int32_t humidity) {
+  // Aproximación de Magnus, válida entre -45 °C y 60 °C
+  const float a = 17.62f, b = 243.12f;
+  float t = temperature / 10.0f;
+  float rh = humidity > 0 ? humidity / 10.0f : 0.1f;
+  float gamma = logf(rh / 100.0f) + a * t / (b + t);
+  return lroundf(b * gamma / (a - gamma) * 10);
+}
+
+int rules_input_parse(const char *name, size_t len) {
+  char buf[16];
+  int sensor;
+
+  if (len >= sizeof(buf))
+    return -1;
+  memcpy(buf, name, len);
+  buf[len] = 0;
+
+  if (strcmp(buf, "dew_point") == 0)
+    return RULES_INPUT_DEW_POINT;
+  if (strcmp(buf, "temp_excess") == 0)
+    return RULES_INPUT_TEMP_EXCESS;
+  // temperature, humidity y temperature2/humidity2 en adelante, igual que
+  // en la telemetría
+  if (strcmp(buf, "temperature") == 0)
+    return RULES_INPUT_TEMPERATURE(0);
+  if (strcmp(buf, "humidity") == 0)
+    return RULES_INPUT_HUMIDITY(0);
+  if (sscanf(buf, "temperature%d", &sensor) == 1 && sensor >= 2 &&
+      sensor <= TELEMETRY_AUX_SENSORS + 1)
+    return RULES_INPUT_TEMPERATURE(sensor - 1);
+  if (sscanf(buf, "humidity%d", &sensor) == 1 && sensor >= 2 &&
+      sensor <= TELEMETRY_AUX_SENSORS + 1)
+    return RULES_INPUT_HUMIDITY(sensor - 1);
+  return -1;
+}
+
+int rules_actuator_parse(const char *name, size_t len) {
+  static const char *const names[RULES_ACTUATOR_COUNT] = {
+      [RULES_ACTUATOR_LED1] = "led1",
+      [RULES_ACTUATOR_LED2] = "led2",
+      [RULES_ACTUATOR_LED3] = "led3",
+      [RULES_ACTUATOR_BUZZER] = "buzzer",
+  };
+
+  for (int i = 0; i < RULES_ACTUATOR_COUNT; i++) {
+    if (strlen(names[i]) == len && memcmp(names[i], name, len) == 0)
+      return i;
+  }
+  return -1;
+}
+
+esp_err_t rules_save(const rules_t *rules) {
+  nvs_handle_t nvs;
+  esp_err_t ret = nvs_open(RULES_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+  if (ret != ESP_OK)
+    return ret;
+
+  // Un conjunto vacío también se guarda: deja las salidas siempre apagadas
+  ret = nvs_set_blob(nvs, RULES_NVS_KEY, rules->rules,
+                     rules->count * sizeof(rule_t));
+  if (ret == ESP_OK)
+    ret = nvs_commit(nvs);
+  nvs_close(nvs);
+  return ret;
+}
+
+esp_err_t rules_load(rules_t *rules) {
+  rule_t stored[RULES_MAX];
+  size_t size = sizeof(stored);
+  nvs_handle_t nvs;
+
+  esp_err_t ret = nvs_open(RULES_NVS_NAMESPACE, NVS_READONLY, &nvs);
+  if (ret != ESP_OK)
+    return ret;
+  ret = nvs_get_blob(nvs, RULES_NVS_KEY, stored, &size);
+  nvs_close(nvs);
+  if (ret != ESP_OK)
+    return ret;
+  if (size % sizeof(rule_t) != 0)
+    return ESP_ERR_INVALID_SIZE;
+
+  size_t count = size / sizeof(rule_t);
+  for (size_t i = 0; i < count; i++) {
+    if (!rules_valid(&stored[i]) ||
+        (i > 0 && stored[i].priority > stored[i - 1].priority))
+      return ESP_ERR_INVALID_STATE;
+  }
+
+  memcpy(rules->rules, stored, size);
+  rules->count = count;
+  rules->active = 0;
+  ESP_LOGI(TAG, "Loaded %u rules from NVS", (unsigned)count);
+  return ESP_OK;
+}
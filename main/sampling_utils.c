@@ -0,0 +1,139 @@
+/*******************************************************************************
+ * @file        sampling_utils.c
+ * @brief       Política de muestreo fija o adaptativa.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "sampling_utils.h"
+#include <math.h>
+#include <string.h>
+
+static const char *const mode_names[] = {
+    [SAMPLING_MODE_FIXED] = "fixed",
+    [SAMPLING_MODE_ADAPTIVE] = "adaptive",
+};
+
+bool sampling_policy_valid(const sampling_policy_t *policy) {
+  if (policy->period_ms < SAMPLING_PERIOD_FLOOR_MS ||
+      policy->period_ms > SAMPLING_PERIOD_CEIL_MS)
+    return false;
+  if (policy->mode == SAMPLING_MODE_FIXED)
+    return true;
+  // isfinite descarta también NaN, que pasa cualquier comparación como falsa
+  return policy->min_period_ms >= SAMPLING_PERIOD_FLOOR_MS &&
+         policy->min_period_ms <= policy->period_ms &&
+         policy->period_ms <= policy->max_period_ms &&
+         policy->max_period_ms <= SAMPLING_PERIOD_CEIL_MS &&
+         isfinite(policy->delta_temperature) &&
+         policy->delta_temperature >= 0 &&
+         isfinite(policy->delta_humidity) && policy->delta_humidity >= 0 &&
+         isfinite(policy->threshold_margin) && policy->threshold_margin >= 0;
+}
+
+// Índice del parámetro key, o -1 si la solicitud no lo trae
+static int sampling_param(const rpc_request_t *request, const char *key) {
+  return request->params >= 0
+             ? rpc_json_find(request->json, request->tokens, request->count,
+                             request->params, key)
+             : -1;
+}
+
+// Un parámetro ausente deja el valor; uno presente debe poder leerse
+static bool sampling_param_period(const rpc_request_t *request,
+                                  const char *key, uint32_t *out) {
+  int value;
+  if (sampling_param(request, key) < 0)
+    return true;
+  if (!rpc_param_int(request, key, &value) || value < 0)
+    return false;
+  *out = value;
+  return true;
+}
+
+static bool sampling_param_float(const rpc_request_t *request,
+                                 const char *key, float *out) {
+  return sampling_param(request, key) < 0 ||
+         rpc_param_float(request, key, out);
+}
+
+static bool sampling_param_mode(const rpc_request_t *request,
+                                sampling_mode_t *out) {
+  int idx = sampling_param(request, "mode");
+  if (idx < 0)
+    return true;
+
+  const rpc_json_token_t *token = &request->tokens[idx];
+  size_t len = token->end - token->start;
+  if (token->type != RPC_JSON_STRING)
+    return false;
+  for (size_t i = 0; i < sizeof(mode_names) / sizeof(mode_names[0]); i++) {
+    if (strlen(mode_names[i]) == len &&
+        memcmp(mode_names[i], request->json + token->start, len) == 0) {
+      *out = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+esp_err_t sampling_policy_parse(const rpc_request_t *request,
+                                sampling_policy_t *policy) {
+  sampling_policy_t next = *policy;
+
+  if (!sampling_param_mode(request, &next.mode) ||
+      !sampling_param_period(request, "period", &next.period_ms) ||
+      !sampling_param_period(request, "min", &next.min_period_ms) ||
+      !sampling_param_period(request, "max", &next.max_period_ms) ||
+      !sampling_param_float(request, "delta_temperature",
+                            &next.delta_temperature) ||
+      !sampling_param_float(request, "delta_humidity",
+                            &next.delta_humidity) ||
+      !sampling_param_float(request, "margin", &next.threshold_margin) ||
+      !sampling_policy_valid(&next))
+    return ESP_ERR_INVALID_ARG;
+
+  *policy = next;
+  return ESP_OK;
+}
+
+void sampling_init(sampling_t *sampling, const sampling_policy_t *policy) {
+  *sampling = (sampling_t){
+      .policy = *policy,
+      .period_ms = policy->period_ms,
+  };
+}
+
+// Acelerar de golpe ante un cambio y volver de a poco: cada muestra estable
+// duplica el periodo hasta el máximo
+uint32_t sampling_update(sampling_t *sampling, float temperature,
+                         float humidity, float threshold) {
+  const sampling_policy_t *policy = &sampling->policy;
+
+  if (policy->mode == SAMPLING_MODE_FIXED) {
+    sampling->period_ms = policy->period_ms;
+    return sampling->period_ms;
+  }
+
+  bool fast = fabsf(temperature - threshold) <= policy->threshold_margin;
+  if (sampling->primed) {
+    fast = fast ||
+           fabsf(temperature - sampling->last_temperature) >=
+               policy->delta_temperature ||
+           fabsf(humidity - sampling->last_humidity) >= policy->delta_humidity;
+  }
+  sampling->primed = true;
+  sampling->last_temperature = temperature;
+  sampling->last_humidity = humidity;
+
+  if (fast) {
+    sampling->period_ms = policy->min_period_ms;
+  } else if (sampling->period_ms < policy->max_period_ms / 2) {
+    sampling->period_ms *= 2;
+  } else {
+    sampling->period_ms = policy->max_period_ms;
+  }
+  return sampling->period_ms;
+}
@@ -0,0 +1,95 @@
+/*******************************************************************************
+ * @file        sleep_utils.c
+ * @brief       Estado retenido en memoria RTC y planificación del despertar
+ *              para el modo de muestreo con sueño profundo.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "sleep_utils.h"
+#include <string.h>
+
+static uint8_t sleep_crc8(const uint8_t *data, size_t len) {
+  uint8_t crc = 0;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++)
+      crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+  }
+  return crc;
+}
+
+static uint8_t sleep_state_crc(const sleep_state_t *state) {
+  return sleep_crc8((const uint8_t *)state, offsetof(sleep_state_t, crc));
+}
+
+void sleep_state_reset(sleep_state_t *state, float temp_threshold) {
+  // Limpiar también el relleno para que el CRC sea reproducible
+  memset(state, 0, sizeof(*state));
+  state->magic = SLEEP_STATE_MAGIC;
+  state->automatic_mode = true;
+  state->temp_threshold = temp_threshold;
+}
+
+bool sleep_state_valid(const sleep_state_t *state) {
+  return state->magic == SLEEP_STATE_MAGIC &&
+         state->pending_count <= SLEEP_PENDING_MAX &&
+         state->pending_head < SLEEP_PENDING_MAX &&
+         state->crc == sleep_state_crc(state);
+}
+
+void sleep_state_wake(sleep_state_t *state, int64_t now_ms) {
+  // Instante del despertar medido con el reloj del ciclo anterior
+  int64_t shift = state->sleep_at_ms + state->sleep_ms - now_ms;
+
+  for (size_t i = 0; i < state->pending_count; i++) {
+    state->pending[(state->pending_head + i) % SLEEP_PENDING_MAX].mono_ms -=
+        shift;
+  }
+}
+
+uint64_t sleep_state_prepare(sleep_state_t *state, int64_t now_ms,
+                             int64_t cycle_start_ms, uint32_t period_ms) {
+  // Descontar el tiempo despierto para mantener el periodo de muestreo
+  int64_t sleep_ms = (int64_t)period_ms - (now_ms - cycle_start_ms);
+  if (sleep_ms < SLEEP_MIN_MS)
+    sleep_ms = SLEEP_MIN_MS;
+
+  state->cycle++;
+  state->sleep_at_ms = now_ms;
+  state->sleep_ms = sleep_ms;
+  state->crc = sleep_state_crc(state);
+  return (uint64_t)sleep_ms * 1000;
+}
+
+void sleep_pending_push(sleep_state_t *state,
+                        const telemetry_sample_t *sample) {
+  size_t slot = (state->pending_head + state->pending_count) % SLEEP_PENDING_MAX;
+
+  if (state->pending_count == SLEEP_PENDING_MAX) {
+    state->pending_head = (state->pending_head + 1) % SLEEP_PENDING_MAX;
+  } else {
+    state->pending_count++;
+  }
+  memcpy(&state->pending[slot], sample, sizeof(*sample));
+}
+
+const telemetry_sample_t *sleep_pending_get(const sleep_state_t *state,
+                                            size_t index) {
+  if (index >= state->pending_count)
+    return NULL;
+  return &state->pending[(state->pending_head + index) % SLEEP_PENDING_MAX];
+}
+
+void sleep_pending_clear(sleep_state_t *state) {
+  state->pending_head = 0;
+  state->pending_count = 0;
+}
+
+bool sleep_should_connect(const sleep_state_t *state) {
+  // El primer ciclo siempre conecta para anunciar el estado inicial
+  return state->cycle == 0 || state->pending_count >= SLEEP_PUBLISH_EVERY ||
+         state->pending_count == SLEEP_PENDING_MAX;
+}
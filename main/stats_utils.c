@@ -0,0 +1,128 @@
+/*******************************************************************************
+ * @file        stats_utils.c
+ * @brief       Histogramas de latencia por etapa con escala logarítmica y
+ *              contadores atómicos, sin bloqueos.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "stats_utils.h"
+
+#if STATS_ENABLED
+
+#include <stdatomic.h>
+#include <stdio.h>
+
+static const char *const stage_names[STATS_STAGE_COUNT] = {
+    "dht_read",
+    "encode",
+    "publish",
+    "rpc",
+    "sample_jitter",
+    "tls_handshake",
+    "mqtt_reconnect",
+    "net_recover",
+};
+
+static const char *const counter_names[STATS_COUNTER_COUNT] = {
+    "read_retries",
+    "read_failures",
+    "tls_full",
+    "tls_resumed",
+};
+
+// Contadores de 32 bits: atómicos sin bloqueo también en el Xtensa
+typedef struct {
+  atomic_uint_least32_t buckets[STATS_BUCKETS];
+  atomic_uint_least32_t count;
+  atomic_uint_least32_t sum_us; // se desborda tras ~71 min acumulados
+  atomic_uint_least32_t max_us;
+} stats_histogram_t;
+
+static stats_histogram_t histograms[STATS_STAGE_COUNT];
+static atomic_uint_least32_t counters[STATS_COUNTER_COUNT];
+
+static unsigned stats_bucket(uint32_t us) {
+  unsigned bucket = us == 0 ? 0 : 32 - __builtin_clz(us);
+  return bucket < STATS_BUCKETS ? bucket : STATS_BUCKETS - 1;
+}
+
+void stats_record(stats_stage_t stage, int64_t elapsed_us) {
+  if (stage >= STATS_STAGE_COUNT)
+    return;
+  stats_histogram_t *histogram = &histograms[stage];
+  uint32_t us = elapsed_us < 0            ? 0
+                : elapsed_us > UINT32_MAX ? UINT32_MAX
+                                          : (uint32_t)elapsed_us;
+
+  atomic_fetch_add_explicit(&histogram->buckets[stats_bucket(us)], 1,
+                            memory_order_relaxed);
+  atomic_fetch_add_explicit(&histogram->count, 1, memory_order_relaxed);
+  atomic_fetch_add_explicit(&histogram->sum_us, us, memory_order_relaxed);
+
+  uint_least32_t max = atomic_load_explicit(&histogram->max_us,
+                                            memory_order_relaxed);
+  while (us > max &&
+         !atomic_compare_exchange_weak_explicit(&histogram->max_us, &max, us,
+                                                memory_order_relaxed,
+                                                memory_order_relaxed)) {
+  }
+}
+
+void stats_count(stats_counter_t counter) {
+  if (counter < STATS_COUNTER_COUNT)
+    atomic_fetch_add_explicit(&counters[counter], 1, memory_order_relaxed);
+}
+
+int stats_format(char *buf, size_t size) {
+  size_t len = 0;
+
+#define APPEND(...)                                                            \
+  do {                                                                         \
+    int n = snprintf(buf + len, size - len, __VA_ARGS__);                      \
+    if (n < 0 || (size_t)n >= size - len)                                      \
+      return 0;                                                                \
+    len += n;                                                                  \
+  } while (0)
+
+  APPEND("{");
+  for (int i = 0; i < STATS_STAGE_COUNT; i++) {
+    stats_histogram_t *histogram = &histograms[i];
+    uint32_t buckets[STATS_BUCKETS];
+    int last = -1;
+
+    // Copia sin bloqueo: puede mezclar muestras en curso, no importa aquí
+    for (int b = 0; b < STATS_BUCKETS; b++) {
+      buckets[b] = atomic_load_explicit(&histogram->buckets[b],
+                                        memory_order_relaxed);
+      if (buckets[b] != 0)
+        last = b;
+    }
+
+    APPEND("\"%s\":{\"count\":%lu,\"sum_us\":%lu,\"max_us\":%lu,\"buckets\":[",
+           stage_names[i],
+           (unsigned long)atomic_load_explicit(&histogram->count,
+                                               memory_order_relaxed),
+           (unsigned long)atomic_load_explicit(&histogram->sum_us,
+                                               memory_order_relaxed),
+           (unsigned long)atomic_load_explicit(&histogram->max_us,
+                                               memory_order_relaxed));
+    // Omitir los cubos vacíos del final
+    for (int b = 0; b <= last; b++)
+      APPEND("%s%lu", b ? "," : "", (unsigned long)buckets[b]);
+    APPEND("]},");
+  }
+  for (int i = 0; i < STATS_COUNTER_COUNT; i++) {
+    APPEND("\"%s\":%lu%s", counter_names[i],
+           (unsigned long)atomic_load_explicit(&counters[i],
+                                               memory_order_relaxed),
+           i + 1 < STATS_COUNTER_COUNT ? "," : "}");
+  }
+#undef APPEND
+
+  return len;
+}
+
+#endif // STATS_ENABLED
@@ -0,0 +1,204 @@
+/*******************************************************************************
+ * @file        telemetry_utils.c
+ * @brief       Búfer circular de muestras con marca de tiempo y publicación
+ *              por lotes hacia ThingsBoard.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "telemetry_utils.h"
+#include "encoder_utils.h"
+#include "esp_log.h"
+#include "hal.h"
+#include "log_utils.h"
+#include "publish_utils.h"
+#include "stats_utils.h"
+#include <math.h>
+#include <sys/time.h>
+
+static const char *TAG = "TELEMETRY";
+
+static telemetry_sample_t ring[TELEMETRY_RING_SIZE];
+static size_t ring_head = 0; // índice de la muestra más antigua
+static size_t ring_count = 0;
+static uint8_t payload[TELEMETRY_PAYLOAD_SIZE];
+
+// Último valor publicado por clave, referencia para las bandas muertas
+static telemetry_sample_t published;
+static int samples_since_keyframe = TELEMETRY_KEYFRAME_INTERVAL;
+
+void telemetry_init(void) {
+  ring_head = 0;
+  ring_count = 0;
+  telemetry_force_keyframe();
+}
+
+void telemetry_force_keyframe(void) {
+  samples_since_keyframe = TELEMETRY_KEYFRAME_INTERVAL;
+}
+
+uint16_t telemetry_sample_keys(const telemetry_sample_t *sample) {
+  uint16_t keys = TELEMETRY_KEYS_ALL;
+
+  for (int i = 0; i < TELEMETRY_AUX_SENSORS; i++) {
+    if (!(sample->aux_valid & (1 << i)))
+      keys &= ~TELEMETRY_KEYS_AUX(i);
+  }
+  return keys;
+}
+
+uint16_t telemetry_diff(telemetry_sample_t *sample) {
+  uint16_t keys = 0;
+
+  if (++samples_since_keyframe >= TELEMETRY_KEYFRAME_INTERVAL) {
+    samples_since_keyframe = 0;
+    keys = telemetry_sample_keys(sample);
+  } else {
+    if (fabsf(sample->temperature - published.temperature) >=
+        TELEMETRY_DEADBAND_TEMPERATURE)
+      keys |= 1 << TELEMETRY_KEY_TEMPERATURE;
+    if (fabsf(sample->humidity - published.humidity) >=
+        TELEMETRY_DEADBAND_HUMIDITY)
+      keys |= 1 << TELEMETRY_KEY_HUMIDITY;
+    if (sample->buzzer != published.buzzer)
+      keys |= 1 << TELEMETRY_KEY_BUZZER;
+    if (sample->buzzer_manual != published.buzzer_manual)
+      keys |= 1 << TELEMETRY_KEY_BUZZER_MODE;
+    if (sample->temp_threshold != published.temp_threshold)
+      keys |= 1 << TELEMETRY_KEY_TEMP_THRESHOLD;
+    if (sample->automatic_mode != published.automatic_mode)
+      keys |= 1 << TELEMETRY_KEY_MODE;
+    for (int i = 0; i < 3; i++) {
+      if (((sample->leds ^ published.leds) >> i) & 1)
+        keys |= 1 << (TELEMETRY_KEY_LED1 + i);
+    }
+    // Un sensor adicional que recupera la lectura se publica completo
+    for (int i = 0; i < TELEMETRY_AUX_SENSORS; i++) {
+      if (!(sample->aux_valid & (1 << i)))
+        continue;
+      bool fresh = !(published.aux_valid & (1 << i));
+      if (fresh || fabsf(sample->aux_temperature[i] -
+                         published.aux_temperature[i]) >=
+                       TELEMETRY_DEADBAND_TEMPERATURE)
+        keys |= 1 << TELEMETRY_KEY_AUX_TEMPERATURE(i);
+      if (fresh || fabsf(sample->aux_humidity[i] - published.aux_humidity[i]) >=
+                       TELEMETRY_DEADBAND_HUMIDITY)
+        keys |= 1 << TELEMETRY_KEY_AUX_HUMIDITY(i);
+    }
+  }
+
+  // Actualizar la referencia solo en las claves emitidas, así una deriva
+  // lenta se acumula hasta cruzar la banda muerta
+  if (keys & (1 << TELEMETRY_KEY_TEMPERATURE))
+    published.temperature = sample->temperature;
+  if (keys & (1 << TELEMETRY_KEY_HUMIDITY))
+    published.humidity = sample->humidity;
+  published.buzzer = sample->buzzer;
+  published.buzzer_manual = sample->buzzer_manual;
+  published.temp_threshold = sample->temp_threshold;
+  published.automatic_mode = sample->automatic_mode;
+  published.leds = sample->leds;
+  for (int i = 0; i < TELEMETRY_AUX_SENSORS; i++) {
+    if (keys & (1 << TELEMETRY_KEY_AUX_TEMPERATURE(i)))
+      published.aux_temperature[i] = sample->aux_temperature[i];
+    if (keys & (1 << TELEMETRY_KEY_AUX_HUMIDITY(i)))
+      published.aux_humidity[i] = sample->aux_humidity[i];
+    if (keys & TELEMETRY_KEYS_AUX(i))
+      published.aux_valid |= 1 << i;
+  }
+  published.aux_valid &= sample->aux_valid;
+
+  sample->keys = keys;
+  return keys;
+}
+
+void telemetry_push(const telemetry_sample_t *sample) {
+  if (ring_count == TELEMETRY_RING_SIZE) {
+    // Lleno: descartar la muestra más antigua
+    ring_head = (ring_head + 1) % TELEMETRY_RING_SIZE;
+    ring_count--;
+    ESP_LOGW(TAG, "Sample buffer full, dropping oldest sample");
+  }
+  ring[(ring_head + ring_count) % TELEMETRY_RING_SIZE] = *sample;
+  ring_count++;
+}
+
+size_t telemetry_pending(void) { return ring_count; }
+
+bool telemetry_should_flush(int64_t now_ms) {
+  if (ring_count == 0 || telemetry_epoch_offset_ms() == 0)
+    return false;
+  return ring_count >= TELEMETRY_BATCH_SIZE ||
+         now_ms - ring[ring_head].mono_ms >= TELEMETRY_MAX_AGE_MS;
+}
+
+int64_t telemetry_epoch_offset_ms(void) {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  if (tv.tv_sec < TELEMETRY_MIN_VALID_EPOCH_S)
+    return 0;
+  int64_t epoch_ms = (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+  return epoch_ms - hal_time_us() / 1000;
+}
+
+static void telemetry_pop(size_t count) {
+  ring_head = (ring_head + count) % TELEMETRY_RING_SIZE;
+  ring_count -= count;
+}
+
+int telemetry_flush(void) {
+  int64_t offset = telemetry_epoch_offset_ms();
+
+  // Sin hora real las muestras esperan en el anillo con su reloj monotónico
+  // y salen en un lote con la marca rebasada cuando SNTP sincronice, como
+  // las del registro sin conexión; sin marca el corredor las fecharía al
+  // recibirlas
+  if (offset == 0)
+    return ring_count > 0 ? -1 : 0;
+
+  while (ring_count > 0) {
+    const telemetry_encoder_t *encoder = encoder_get();
+    size_t used = 0;
+    size_t len = 0;
+
+    telemetry_batch_t batch;
+
+    STATS_BEGIN(encode_start);
+    encoder_batch_begin(&batch, payload, sizeof(payload));
+    while (used < ring_count) {
+      const telemetry_sample_t *sample =
+          &ring[(ring_head + used) % TELEMETRY_RING_SIZE];
+      if (!encoder_batch_add(&batch, sample, sample->mono_ms + offset))
+        break;
+      used++;
+    }
+    len = encoder_batch_end(&batch);
+    STATS_END(STATS_STAGE_ENCODE, encode_start);
+
+    if (used == 0 || len == 0) {
+      ESP_LOGE(TAG, "Sample does not fit in payload buffer");
+      telemetry_pop(1);
+      continue;
+    }
+
+    STATS_BEGIN(publish_start);
+    int msg_id = publish_send(PUBLISH_STREAM_TELEMETRY, encoder->topic,
+                              (const char *)payload, len);
+    STATS_END(STATS_STAGE_PUBLISH, publish_start);
+    // Con la bandeja llena esto pasa en cada vaciado; publish_utils ya lo
+    // cuenta como diferido, así que no se registra de inmediato
+    if (msg_id < 0) {
+      DLOGW(TAG, "Failed to send telemetry, keeping %u samples",
+            (unsigned)ring_count);
+      return -1;
+    }
+
+    DLOGI(TAG, "Sent %u samples (%u bytes %s)", (unsigned)used,
+          (unsigned)len, encoder->name);
+    telemetry_pop(used);
+  }
+
+  return 0;
+}
@@ -0,0 +1,55 @@
+/*******************************************************************************
+ * @file        tls_scan.c
+ * @brief       Seguimiento de los mensajes en claro del saludo TLS 1.2.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "tls_scan.h"
+
+void tls_scan_start(tls_scan_t *scan) { *scan = (tls_scan_t){.active = true}; }
+
+void tls_scan_feed(tls_scan_t *scan, const uint8_t *data, size_t len) {
+  for (size_t i = 0; i < len && scan->active; i++) {
+    uint8_t byte = data[i];
+
+    // Cabecera de registro: tipo, versión y longitud
+    if (scan->record_left == 0) {
+      scan->header = (scan->header << 8) | byte;
+      if (++scan->header_pos == 1) {
+        scan->record_type = byte;
+      } else if (scan->header_pos == TLS_RECORD_HEADER) {
+        scan->header_pos = 0;
+        scan->record_left = scan->header & 0xFFFF;
+        // Lo que sigue al ChangeCipherSpec ya va cifrado
+        if (scan->record_type == TLS_RECORD_CHANGE_CIPHER_SPEC) {
+          scan->change_cipher = true;
+          scan->active = false;
+        }
+      }
+      continue;
+    }
+
+    scan->record_left--;
+    if (scan->record_type != TLS_RECORD_HANDSHAKE)
+      continue;
+    // Cabecera de mensaje de saludo: tipo y longitud de 24 bits
+    if (scan->message_left == 0) {
+      scan->message = (scan->message << 8) | byte;
+      if (++scan->message_pos == 1) {
+        scan->certificate |= byte == TLS_HANDSHAKE_CERTIFICATE;
+      } else if (scan->message_pos == TLS_HANDSHAKE_HEADER) {
+        scan->message_pos = 0;
+        scan->message_left = scan->message & 0xFFFFFF;
+      }
+    } else {
+      scan->message_left--;
+    }
+  }
+}
+
+bool tls_scan_resumed(const tls_scan_t *scan) {
+  return scan->change_cipher && !scan->certificate;
+}
@@ -0,0 +1,446 @@
+/*******************************************************************************
+ * @file        tls_utils.c
+ * @brief       Transporte TLS con reanudación de sesión para esp-mqtt, sobre
+ *              sockets de lwIP y mbedTLS.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "tls_utils.h"
+#include "esp_crt_bundle.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "hal.h"
+#include "lwip/netdb.h"
+#include "lwip/sockets.h"
+#include "mbedtls/net_sockets.h"
+#include "mbedtls/ssl.h"
+#include "nvs.h"
+#include "stats_utils.h"
+#include "tls_scan.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TLS_NVS_NAMESPACE "tls"
+#define TLS_NVS_KEY "session"
+
+static const char *TAG = "TLS";
+
+// Sesión serializada junto con el servidor al que pertenece
+typedef struct {
+  char server_name[TLS_SERVER_NAME_SIZE];
+  uint16_t len; // 0 si no hay sesión guardada
+  uint8_t data[TLS_SESSION_MAX];
+} tls_session_t;
+
+typedef struct {
+  int sock;
+  bool ssl_ready;
+  mbedtls_ssl_context ssl;
+  mbedtls_ssl_config conf;
+#ifdef MQTT_CA_CERT_EMBEDDED
+  mbedtls_x509_crt ca;
+#endif
+  tls_scan_t scan;
+  char server_name[TLS_SERVER_NAME_SIZE];
+} tls_conn_t;
+
+// Copia en RAM de la sesión guardada en NVS. Con el certificado del par
+// ocupa unos kilobytes: no cabe en la memoria RTC, así que al despertar del
+// sueño profundo se vuelve a leer de NVS
+static tls_session_t saved_session;
+
+#ifdef MQTT_CA_CERT_EMBEDDED
+extern const char mqtt_ca_pem_start[] asm("_binary_mqtt_ca_pem_start");
+#endif
+
+static int tls_random(void *ctx, unsigned char *buf, size_t len) {
+  esp_fill_random(buf, len);
+  return 0;
+}
+
+static int tls_bio_send(void *ctx, const unsigned char *buf, size_t len) {
+  tls_conn_t *conn = ctx;
+  int ret = send(conn->sock, buf, len, 0);
+
+  if (ret < 0)
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR
+               ? MBEDTLS_ERR_SSL_WANT_WRITE
+               : MBEDTLS_ERR_NET_SEND_FAILED;
+  return ret;
+}
+
+static int tls_bio_recv(void *ctx, unsigned char *buf, size_t len) {
+  tls_conn_t *conn = ctx;
+  int ret = recv(conn->sock, buf, len, 0);
+
+  if (ret < 0)
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR
+               ? MBEDTLS_ERR_SSL_WANT_READ
+               : MBEDTLS_ERR_NET_RECV_FAILED;
+  tls_scan_feed(&conn->scan, buf, ret);
+  return ret;
+}
+
+// Esperar a que el socket se pueda leer o escribir; >0 listo, 0 si vence el
+// plazo (negativo: sin plazo)
+static int tls_wait(int sock, bool read, int timeout_ms) {
+  fd_set fds;
+  struct timeval tv = {timeout_ms / 1000, (timeout_ms % 1000) * 1000};
+
+  FD_ZERO(&fds);
+  FD_SET(sock, &fds);
+  return select(sock + 1, read ? &fds : NULL, read ? NULL : &fds, NULL,
+                timeout_ms < 0 ? NULL : &tv);
+}
+
+static int tls_remaining_ms(int64_t deadline_us) {
+  int64_t left = deadline_us - hal_time_us();
+  return left > 0 ? (int)(left / 1000) : 0;
+}
+
+static int tls_socket_connect(const char *host, int port, int timeout_ms) {
+  struct addrinfo hints = {.ai_family = AF_INET, .ai_socktype = SOCK_STREAM};
+  struct addrinfo *res = NULL;
+  char service[8];
+  int error = 0;
+  socklen_t error_len = sizeof(error);
+
+  snprintf(service, sizeof(service), "%d", port);
+  if (getaddrinfo(host, service, &hints, &res) != 0 || res == NULL) {
+    ESP_LOGE(TAG, "Cannot resolve %s", host);
+    return -1;
+  }
+
+  int sock = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+  if (sock >= 0) {
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+    if ((connect(sock, res->ai_addr, res->ai_addrlen) != 0 &&
+         errno != EINPROGRESS) ||
+        tls_wait(sock, false, timeout_ms) <= 0 ||
+        getsockopt(sock, SOL_SOCKET, SO_ERROR, &error, &error_len) != 0 ||
+        error != 0) {
+      ESP_LOGE(TAG, "Cannot connect to %s:%d", host, port);
+      close(sock);
+      sock = -1;
+    }
+  }
+  freeaddrinfo(res);
+  return sock;
+}
+
+static bool tls_session_matches(const tls_session_t *session,
+                                const char *server_name) {
+  return session->len > 0 && session->len <= TLS_SESSION_MAX &&
+         strncmp(session->server_name, server_name,
+                 TLS_SERVER_NAME_SIZE) == 0;
+}
+
+// Recuperar la sesión de NVS si la copia en RAM no es de este servidor
+static void tls_session_restore(const char *server_name) {
+  nvs_handle_t handle;
+  size_t size = sizeof(saved_session);
+
+  if (tls_session_matches(&saved_session, server_name))
+    return;
+  saved_session.len = 0;
+  if (nvs_open(TLS_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK)
+    return;
+  if (nvs_get_blob(handle, TLS_NVS_KEY, &saved_session, &size) != ESP_OK ||
+      !tls_session_matches(&saved_session, server_name))
+    saved_session.len = 0;
+  nvs_close(handle);
+}
+
+// Guardar la sesión negociada; NVS solo se escribe con sesiones nuevas,
+// no con cada ticket renovado, para no desgastar la flash. Un ticket
+// renovado sirve para las reconexiones hasta el siguiente arranque
+static void tls_session_store(tls_conn_t *conn, bool persist) {
+  mbedtls_ssl_session session;
+  size_t len = 0;
+  nvs_handle_t handle;
+
+  mbedtls_ssl_session_init(&session);
+  int ret = mbedtls_ssl_get_session(&conn->ssl, &session);
+  if (ret == 0)
+    ret = mbedtls_ssl_session_save(&session, saved_session.data,
+                                   sizeof(saved_session.data), &len);
+  mbedtls_ssl_session_free(&session);
+  if (ret != 0) {
+    ESP_LOGW(TAG, "Cannot save TLS session: -0x%04x", -ret);
+    saved_session.len = 0;
+    return;
+  }
+  memcpy(saved_session.server_name, conn->server_name,
+         sizeof(saved_session.server_name));
+  saved_session.len = len;
+
+  if (!persist ||
+      nvs_open(TLS_NVS_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK)
+    return;
+  size_t size = offsetof(tls_session_t, data) + len;
+  esp_err_t err = nvs_set_blob(handle, TLS_NVS_KEY, &saved_session, size);
+  if (err == ESP_OK)
+    err = nvs_commit(handle);
+  nvs_close(handle);
+  if (err != ESP_OK)
+    ESP_LOGW(TAG, "Failed to persist TLS session: %s", esp_err_to_name(err));
+}
+
+// Olvidar una sesión que el servidor rechaza con error en lugar de ignorarla
+static void tls_session_forget(void) {
+  nvs_handle_t handle;
+
+  saved_session.len = 0;
+  if (nvs_open(TLS_NVS_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK)
+    return;
+  if (nvs_erase_key(handle, TLS_NVS_KEY) == ESP_OK)
+    nvs_commit(handle);
+  nvs_close(handle);
+}
+
+static int tls_close(esp_transport_handle_t t) {
+  tls_conn_t *conn = esp_transport_get_context_data(t);
+
+  if (conn->ssl_ready) {
+    mbedtls_ssl_close_notify(&conn->ssl);
+    mbedtls_ssl_free(&conn->ssl);
+    conn->ssl_ready = false;
+  }
+  if (conn->sock >= 0) {
+    close(conn->sock);
+    conn->sock = -1;
+  }
+  return 0;
+}
+
+static int tls_connect(esp_transport_handle_t t, const char *host, int port,
+                       int timeout_ms) {
+  tls_conn_t *conn = esp_transport_get_context_data(t);
+  int64_t start = hal_time_us();
+  int64_t deadline = start + (int64_t)timeout_ms * 1000;
+  int64_t cpu_us = 0;
+  bool offered = false;
+  int ret;
+
+  tls_close(t);
+  conn->sock = tls_socket_connect(host, port, timeout_ms);
+  if (conn->sock < 0)
+    return -1;
+
+  mbedtls_ssl_init(&conn->ssl);
+  conn->ssl_ready = true;
+  ret = mbedtls_ssl_setup(&conn->ssl, &conn->conf);
+  if (ret == 0)
+    ret = mbedtls_ssl_set_hostname(&conn->ssl, conn->server_name);
+  if (ret != 0) {
+    ESP_LOGE(TAG, "TLS setup failed: -0x%04x", -ret);
+    tls_close(t);
+    return -1;
+  }
+  mbedtls_ssl_set_bio(&conn->ssl, conn, tls_bio_send, tls_bio_recv, NULL);
+
+  // Ofrecer la sesión guardada; si el servidor no la acepta, mbedTLS hace
+  // el saludo completo sin más
+  if (saved_session.len > 0) {
+    mbedtls_ssl_session session;
+    mbedtls_ssl_session_init(&session);
+    offered = mbedtls_ssl_session_load(&session, saved_session.data,
+                                       saved_session.len) == 0 &&
+              mbedtls_ssl_set_session(&conn->ssl, &session) == 0;
+    mbedtls_ssl_session_free(&session);
+  }
+
+  // Saludo sin bloquear: el CPU es el tiempo dentro de mbedTLS, sin contar
+  // las esperas de red
+  tls_scan_start(&conn->scan);
+  while (1) {
+    int64_t step = hal_time_us();
+    ret = mbedtls_ssl_handshake(&conn->ssl);
+    cpu_us += hal_time_us() - step;
+    if (ret == 0)
+      break;
+    if (ret != MBEDTLS_ERR_SSL_WANT_READ &&
+        ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+      ESP_LOGE(TAG, "TLS handshake failed: -0x%04x", -ret);
+      // Solo una alerta fatal del servidor o un certificado que no verifica
+      // invalidan la sesión; tras un error de red se vuelve a ofrecer
+      if (offered && (ret == MBEDTLS_ERR_SSL_FATAL_ALERT_MESSAGE ||
+                      ret == MBEDTLS_ERR_X509_CERT_VERIFY_FAILED))
+        tls_session_forget();
+      tls_close(t);
+      return -1;
+    }
+    int left = tls_remaining_ms(deadline);
+    if (left == 0 ||
+        tls_wait(conn->sock, ret == MBEDTLS_ERR_SSL_WANT_READ, left) <= 0) {
+      ESP_LOGE(TAG, "TLS handshake timed out");
+      tls_close(t);
+      return -1;
+    }
+  }
+  conn->scan.active = false;
+
+  bool resumed = offered && tls_scan_resumed(&conn->scan) &&
+                 mbedtls_ssl_get_version_number(&conn->ssl) ==
+                     MBEDTLS_SSL_VERSION_TLS1_2;
+  ESP_LOGI(TAG, "TLS handshake %s in %lld ms (%lld ms CPU)",
+           resumed ? "resumed" : "full",
+           (long long)((hal_time_us() - start) / 1000),
+           (long long)(cpu_us / 1000));
+  STATS_RECORD(STATS_STAGE_TLS_HANDSHAKE, cpu_us);
+  STATS_COUNT(resumed ? STATS_COUNTER_TLS_RESUMED : STATS_COUNTER_TLS_FULL);
+  tls_session_store(conn, !resumed);
+  return 0;
+}
+
+static int tls_read(esp_transport_handle_t t, char *buffer, int len,
+                    int timeout_ms) {
+  tls_conn_t *conn = esp_transport_get_context_data(t);
+  int64_t deadline = hal_time_us() + (int64_t)timeout_ms * 1000;
+
+  if (!conn->ssl_ready)
+    return -1;
+  while (1) {
+    int ret = mbedtls_ssl_read(&conn->ssl, (unsigned char *)buffer, len);
+    if (ret > 0)
+      return ret;
+    if (ret == 0 || ret == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY)
+      return ERR_TCP_TRANSPORT_CONNECTION_CLOSED_BY_FIN;
+    if (ret != MBEDTLS_ERR_SSL_WANT_READ &&
+        ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+      ESP_LOGE(TAG, "TLS read failed: -0x%04x", -ret);
+      return -1;
+    }
+    int left = tls_remaining_ms(deadline);
+    if (left == 0)
+      return ERR_TCP_TRANSPORT_CONNECTION_TIMEOUT;
+    if (tls_wait(conn->sock, ret == MBEDTLS_ERR_SSL_WANT_READ, left) < 0)
+      return -1;
+  }
+}
+
+static int tls_write(esp_transport_handle_t t, const char *buffer, int len,
+                     int timeout_ms) {
+  tls_conn_t *conn = esp_transport_get_context_data(t);
+  int64_t deadline = hal_time_us() + (int64_t)timeout_ms * 1000;
+
+  int written = 0;
+
+  if (!conn->ssl_ready)
+    return -1;
+  // mbedtls_ssl_write escribe a lo sumo un registro por llamada: seguir
+  // hasta entregar todo, como espera esp-mqtt
+  while (written < len) {
+    int ret = mbedtls_ssl_write(&conn->ssl,
+                                (const unsigned char *)buffer + written,
+                                len - written);
+    if (ret >= 0) {
+      written += ret;
+      continue;
+    }
+    if (ret != MBEDTLS_ERR_SSL_WANT_READ &&
+        ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+      ESP_LOGE(TAG, "TLS write failed: -0x%04x", -ret);
+      return -1;
+    }
+    int left = tls_remaining_ms(deadline);
+    if (left == 0)
+      return written > 0 ? written : ERR_TCP_TRANSPORT_CONNECTION_TIMEOUT;
+    if (tls_wait(conn->sock, ret == MBEDTLS_ERR_SSL_WANT_READ, left) < 0)
+      return -1;
+  }
+  return written;
+}
+
+static int tls_poll_read(esp_transport_handle_t t, int timeout_ms) {
+  tls_conn_t *conn = esp_transport_get_context_data(t);
+
+  if (!conn->ssl_ready)
+    return -1;
+  // Datos ya descifrados que no requieren leer del socket
+  if (mbedtls_ssl_get_bytes_avail(&conn->ssl) > 0)
+    return 1;
+  return tls_wait(conn->sock, true, timeout_ms);
+}
+
+static int tls_poll_write(esp_transport_handle_t t, int timeout_ms) {
+  tls_conn_t *conn = esp_transport_get_context_data(t);
+  return tls_wait(conn->sock, false, timeout_ms);
+}
+
+static int tls_destroy(esp_transport_handle_t t) {
+  tls_conn_t *conn = esp_transport_get_context_data(t);
+
+  tls_close(t);
+  mbedtls_ssl_config_free(&conn->conf);
+#ifdef MQTT_CA_CERT_EMBEDDED
+  mbedtls_x509_crt_free(&conn->ca);
+#endif
+  free(conn);
+  return 0;
+}
+
+int tls_transport_socket(esp_transport_handle_t t) {
+  tls_conn_t *conn = esp_transport_get_context_data(t);
+  return conn->sock;
+}
+
+esp_transport_handle_t tls_transport_create(const char *server_name) {
+  tls_conn_t *conn = calloc(1, sizeof(tls_conn_t));
+  esp_transport_handle_t t = esp_transport_init();
+  int ret;
+
+  if (conn == NULL || t == NULL) {
+    free(conn);
+    if (t != NULL)
+      esp_transport_destroy(t);
+    return NULL;
+  }
+  conn->sock = -1;
+  strncpy(conn->server_name, server_name, sizeof(conn->server_name) - 1);
+
+  mbedtls_ssl_config_init(&conn->conf);
+  ret = mbedtls_ssl_config_defaults(&conn->conf, MBEDTLS_SSL_IS_CLIENT,
+                                    MBEDTLS_SSL_TRANSPORT_STREAM,
+                                    MBEDTLS_SSL_PRESET_DEFAULT);
+  // En TLS 1.3 el certificado del servidor va cifrado y el ticket llega
+  // después del saludo: la detección de reanudación y el guardado de la
+  // sesión solo funcionan con TLS 1.2
+  mbedtls_ssl_conf_max_tls_version(&conn->conf, MBEDTLS_SSL_VERSION_TLS1_2);
+  mbedtls_ssl_conf_authmode(&conn->conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+  mbedtls_ssl_conf_rng(&conn->conf, tls_random, NULL);
+  mbedtls_ssl_conf_session_tickets(&conn->conf,
+                                   MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#ifdef MQTT_CA_CERT_EMBEDDED
+  // CA propia, por ejemplo la de un Mosquitto local de pruebas
+  mbedtls_x509_crt_init(&conn->ca);
+  if (ret == 0)
+    ret = mbedtls_x509_crt_parse(&conn->ca,
+                                 (const unsigned char *)mqtt_ca_pem_start,
+                                 strlen(mqtt_ca_pem_start) + 1);
+  mbedtls_ssl_conf_ca_chain(&conn->conf, &conn->ca, NULL);
+#else
+  if (ret == 0)
+    ret = esp_crt_bundle_attach(&conn->conf);
+#endif
+  if (ret != 0) {
+    ESP_LOGE(TAG, "TLS configuration failed: -0x%04x", -ret);
+    esp_transport_set_context_data(t, conn);
+    tls_destroy(t);
+    esp_transport_destroy(t);
+    return NULL;
+  }
+
+  tls_session_restore(conn->server_name);
+  if (saved_session.len > 0)
+    ESP_LOGI(TAG, "Resuming saved TLS session for %s", conn->server_name);
+
+  esp_transport_set_context_data(t, conn);
+  esp_transport_set_func(t, tls_connect, tls_read, tls_write, tls_close,
+                         tls_poll_read, tls_poll_write, tls_destroy);
+  return t;
+}
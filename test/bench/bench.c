@@ -0,0 +1,116 @@
+/*******************************************************************************
+ * @file        bench.c
+ * @brief       Medición, conteo de asignaciones y reporte de los casos.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Tiempo mínimo de cada medición al calibrar
+#define BENCH_MIN_TIME_NS 200000000ULL
+
+static bench_result_t results[BENCH_MAX_RESULTS];
+static size_t result_count = 0;
+static uint64_t fixed_iterations = 0;
+static uint64_t allocs = 0;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size) {
+  allocs++;
+  return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+  allocs++;
+  return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+  allocs++;
+  return __real_realloc(ptr, size);
+}
+
+void bench_count_alloc(void) { allocs++; }
+
+void bench_set_iterations(uint64_t iterations) {
+  fixed_iterations = iterations;
+}
+
+static uint64_t bench_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t bench_time(bench_fn_t fn, void *ctx, uint64_t iterations) {
+  uint64_t start = bench_now_ns();
+  for (uint64_t i = 0; i < iterations; i++) {
+    fn(ctx);
+  }
+  return bench_now_ns() - start;
+}
+
+const bench_result_t *bench_run(const char *name, bench_fn_t fn, void *ctx,
+                                size_t bytes) {
+  if (result_count == BENCH_MAX_RESULTS)
+    return NULL;
+
+  // Calentar cachés y duplicar las repeticiones hasta llenar el tiempo
+  uint64_t iterations = fixed_iterations ? fixed_iterations : 1;
+  uint64_t elapsed = bench_time(fn, ctx, iterations);
+  while (!fixed_iterations && elapsed < BENCH_MIN_TIME_NS) {
+    iterations *= 2;
+    elapsed = bench_time(fn, ctx, iterations);
+  }
+
+  uint64_t allocs_before = allocs;
+  elapsed = bench_time(fn, ctx, iterations);
+  uint64_t allocated = allocs - allocs_before;
+
+  bench_result_t *result = &results[result_count++];
+  snprintf(result->name, sizeof(result->name), "%s", name);
+  result->iterations = iterations;
+  result->ns_per_op = (double)elapsed / iterations;
+  result->allocs_per_op = (double)allocated / iterations;
+  result->bytes = bytes;
+  return result;
+}
+
+void bench_print(void) {
+  printf("%-40s %12s %10s %8s\n", "case", "ns/op", "allocs/op", "bytes");
+  for (size_t i = 0; i < result_count; i++) {
+    const bench_result_t *r = &results[i];
+    printf("%-40s %12.1f %10.2f %8zu\n", r->name, r->ns_per_op,
+           r->allocs_per_op, r->bytes);
+  }
+}
+
+int bench_write_json(const char *path) {
+  FILE *file = fopen(path, "w");
+  if (file == NULL) {
+    perror(path);
+    return -1;
+  }
+
+  fprintf(file, "{\"results\":[");
+  for (size_t i = 0; i < result_count; i++) {
+    const bench_result_t *r = &results[i];
+    fprintf(file,
+            "%s\n{\"name\":\"%s\",\"iterations\":%llu,\"ns_per_op\":%.2f,"
+            "\"allocs_per_op\":%.3f,\"bytes\":%zu}",
+            i ? "," : "", r->name, (unsigned long long)r->iterations,
+            r->ns_per_op, r->allocs_per_op, r->bytes);
+  }
+  fprintf(file, "\n]}\n");
+  return fclose(file) == 0 ? 0 : -1;
+}
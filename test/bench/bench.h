@@ -0,0 +1,56 @@
+/*******************************************************************************
+ * @file        bench.h
+ * @brief       Mediciones en el anfitrión de las rutas calientes del
+ *              firmware: cada caso se repite hasta llenar un tiempo mínimo y
+ *              se reporta en ns y asignaciones de memoria por operación.
+ *
+ *              Las asignaciones se cuentan envolviendo malloc, calloc y
+ *              realloc con --wrap del enlazador, así que solo cuentan las
+ *              llamadas desde el código enlazado estáticamente; las
+ *              bibliotecas compartidas deben reportar las suyas con
+ *              bench_count_alloc.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BENCH_MAX_RESULTS 64
+
+typedef void (*bench_fn_t)(void *ctx);
+
+typedef struct {
+  char name[64];
+  uint64_t iterations;
+  double ns_per_op;
+  double allocs_per_op;
+  size_t bytes; // tamaño del resultado (mensaje codificado), 0 si no aplica
+} bench_result_t;
+
+// Repeticiones fijas para todos los casos; 0 calibra por tiempo
+void bench_set_iterations(uint64_t iterations);
+// Medir fn(ctx); bytes se copia al resultado tal cual
+const bench_result_t *bench_run(const char *name, bench_fn_t fn, void *ctx,
+                                size_t bytes);
+void bench_count_alloc(void);
+
+// Tabla en la salida estándar y resultados en JSON
+void bench_print(void);
+int bench_write_json(const char *path);
+
+// Evitar que el compilador descarte un resultado que no se usa
+#define BENCH_KEEP(value) __asm__ volatile("" : : "g"(value) : "memory")
+
+// Grupos de casos, uno por archivo
+void bench_control(void);
+void bench_dht(void);
+void bench_encoder(void);
+void bench_rpc(void);
+
+#endif // BENCH_H
@@ -0,0 +1,100 @@
+/*******************************************************************************
+ * @file        bench_control.c
+ * @brief       Mediciones de un ciclo de control del modo automático: la
+ *              lectura pasa por los filtros, las reglas se evalúan y el
+ *              resultado se lleva a leds[] y al buzzer, como en
+ *              control_condition y control_apply_rules.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "bench.h"
+#include "buzzer_utils.h"
+#include "fake_hal.h"
+#include "filter_utils.h"
+#include "led_utils.h"
+#include "rules_utils.h"
+#include <math.h>
+
+#define BENCH_SENSORS 2
+
+// Los valores por defecto de proyecto_3_embebidos.c
+static const filter_config_t temperature_filter = {50, 2, 3, 1};
+static const filter_config_t humidity_filter = {150, 2, 3, 1};
+
+typedef struct {
+  filter_t filters[BENCH_SENSORS][2];
+  rules_t rules;
+  // Lecturas que se alternan en cada ciclo, en °C y %
+  float temperature[2];
+  float humidity[2];
+  unsigned cycle;
+} control_case_t;
+
+static void control_case_init(control_case_t *c) {
+  for (int i = 0; i < BENCH_SENSORS; i++) {
+    filter_init(&c->filters[i][0], &temperature_filter);
+    filter_init(&c->filters[i][1], &humidity_filter);
+  }
+  rules_default(&c->rules);
+  c->cycle = 0;
+}
+
+static void bench_cycle(void *ctx) {
+  control_case_t *c = ctx;
+  rules_inputs_t inputs = {0};
+  uint8_t outputs[RULES_ACTUATOR_COUNT];
+  unsigned phase = c->cycle++ & 1;
+
+  for (int i = 0; i < BENCH_SENSORS; i++) {
+    int32_t temperature, humidity;
+    filter_apply(&c->filters[i][0], lroundf(c->temperature[phase] * 10),
+                 &temperature);
+    filter_apply(&c->filters[i][1], lroundf(c->humidity[phase] * 10),
+                 &humidity);
+    inputs.values[RULES_INPUT_TEMPERATURE(i)] = temperature;
+    inputs.values[RULES_INPUT_HUMIDITY(i)] = humidity;
+    inputs.valid |= (1UL << RULES_INPUT_TEMPERATURE(i)) |
+                    (1UL << RULES_INPUT_HUMIDITY(i));
+  }
+  int32_t temperature = inputs.values[RULES_INPUT_TEMPERATURE(0)];
+  inputs.values[RULES_INPUT_DEW_POINT] =
+      rules_dew_point(temperature, inputs.values[RULES_INPUT_HUMIDITY(0)]);
+  inputs.values[RULES_INPUT_TEMP_EXCESS] =
+      temperature - lroundf(buzzer_get_threshold() * 10);
+  inputs.valid |=
+      (1UL << RULES_INPUT_DEW_POINT) | (1UL << RULES_INPUT_TEMP_EXCESS);
+
+  rules_evaluate(&c->rules, &inputs, outputs);
+  leds_update_auto(outputs[RULES_ACTUATOR_LED1] |
+                   outputs[RULES_ACTUATOR_LED2] << 1 |
+                   outputs[RULES_ACTUATOR_LED3] << 2);
+  buzzer_update_auto(outputs[RULES_ACTUATOR_BUZZER]);
+}
+
+void bench_control(void) {
+  // Lecturas estables: las salidas no cambian después del primer ciclo
+  static control_case_t steady = {
+      .temperature = {24.0f, 24.0f},
+      .humidity = {55.0f, 55.0f},
+  };
+  // Lecturas que cruzan los umbrales de un LED y del buzzer sin llegar a
+  // ser picos, así que las salidas cambian cada pocos ciclos
+  static control_case_t changing = {
+      .temperature = {28.0f, 32.5f},
+      .humidity = {60.0f, 70.0f},
+  };
+
+  fake_hal_reset();
+  leds_init();
+  buzzer_init();
+  buzzer_set_threshold(30.0f);
+
+  control_case_init(&steady);
+  bench_run("control/cycle_steady", bench_cycle, &steady, 0);
+  control_case_init(&changing);
+  bench_run("control/cycle_changing", bench_cycle, &changing, 0);
+  buzzer_play(BUZZER_PATTERN_OFF);
+}
@@ -0,0 +1,80 @@
+/*******************************************************************************
+ * @file        bench_dht.c
+ * @brief       Mediciones del decodificador DHT: tramas DHT11 y DHT22 a
+ *              partir de trazas de pulsos como las que graba el RMT, con y
+ *              sin ruido alrededor de la trama.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "bench.h"
+#include "dht11_decode.h"
+#include <stdbool.h>
+
+#define TRACE_MAX (2 * DHT_FRAME_BITS + 16)
+
+typedef struct {
+  dht_type_t type;
+  dht_pulse_t pulses[TRACE_MAX];
+  size_t count;
+} dht_case_t;
+
+static void trace_add(dht_case_t *c, uint8_t level, uint16_t duration_us) {
+  c->pulses[c->count++] = (dht_pulse_t){level, duration_us};
+}
+
+// Liberación de la línea, respuesta del sensor y los 40 bits con unos
+// microsegundos de variación, igual que en test_dht11_decode.c
+static void trace_frame(dht_case_t *c, const uint8_t data[DHT_FRAME_BYTES]) {
+  static const int8_t jitter[] = {0, 2, -3, 1, 4, -2, -1, 3};
+
+  trace_add(c, 1, 32);
+  trace_add(c, 0, 82);
+  trace_add(c, 1, 78);
+  for (int i = 0; i < DHT_FRAME_BITS; i++) {
+    bool one = (data[i / 8] >> (7 - i % 8)) & 1;
+    int8_t j = jitter[i % sizeof(jitter)];
+    trace_add(c, 0, 50 + j);
+    trace_add(c, 1, (one ? 70 : 26) + j);
+  }
+  trace_add(c, 0, 54);
+}
+
+// Decodificar la trama y convertirla, como hace hal_dht_read_all por sensor
+static void bench_decode(void *ctx) {
+  const dht_case_t *c = ctx;
+  uint8_t data[DHT_FRAME_BYTES];
+  float humidity = 0, temperature = 0;
+
+  if (dht_decode_pulses(c->pulses, c->count, data) == DHT_DECODE_OK)
+    dht_decode_values(c->type, data, &humidity, &temperature);
+  BENCH_KEEP(humidity);
+  BENCH_KEEP(temperature);
+}
+
+void bench_dht(void) {
+  static dht_case_t dht11 = {.type = DHT_TYPE_DHT11};
+  static dht_case_t dht22 = {.type = DHT_TYPE_DHT22};
+  static dht_case_t noisy = {.type = DHT_TYPE_DHT11};
+  static const uint8_t frame11[DHT_FRAME_BYTES] = {55, 0, 24, 3, 82};
+  // 65.2 % y -10.1 °C
+  static const uint8_t frame22[DHT_FRAME_BYTES] = {0x02, 0x8C, 0x80, 0x65,
+                                                   0x73};
+
+  trace_frame(&dht11, frame11);
+  trace_frame(&dht22, frame22);
+
+  // Pulsos espurios antes de la trama y el reposo de la línea al final
+  trace_add(&noisy, 1, 12);
+  trace_add(&noisy, 0, 5);
+  trace_add(&noisy, 1, 40);
+  trace_frame(&noisy, frame11);
+  trace_add(&noisy, 1, 0);
+  trace_add(&noisy, 1, 32000);
+
+  bench_run("dht/decode_dht11", bench_decode, &dht11, 0);
+  bench_run("dht/decode_dht22", bench_decode, &dht22, 0);
+  bench_run("dht/decode_noisy", bench_decode, &noisy, 0);
+}
@@ -0,0 +1,89 @@
+/*******************************************************************************
+ * @file        bench_encoder.c
+ * @brief       Mediciones de los codificadores de telemetría: tiempo y bytes
+ *              por muestra de JSON y CBOR, sueltas y en lotes con marca de
+ *              tiempo, frente al snprintf con %.1f que usaba el firmware
+ *              antes de los codificadores.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "bench.h"
+#include "encoder_utils.h"
+#include <stdio.h>
+
+#define BENCH_BATCH_SAMPLES 10
+#define BENCH_TS_MS 1756512000000LL
+
+typedef struct {
+  const telemetry_encoder_t *encoder;
+  telemetry_sample_t sample;
+  uint8_t buf[TELEMETRY_PAYLOAD_SIZE];
+  size_t len;
+} encoder_case_t;
+
+static const telemetry_sample_t bench_sample = {
+    .keys = (1 << TELEMETRY_KEY_AUX_FIRST) - 1,
+    .temperature = 24.3f,
+    .humidity = 55.0f,
+    .temp_threshold = 30.0f,
+    .buzzer = true,
+    .automatic_mode = true,
+    .leds = 0x03,
+};
+
+static void bench_snprintf(void *ctx) {
+  encoder_case_t *c = ctx;
+  const telemetry_sample_t *s = &c->sample;
+  c->len = snprintf(
+      (char *)c->buf, sizeof(c->buf),
+      "{\"temperature\":%.1f,\"humidity\":%.1f,\"buzzer\":%s,\"buzzer_"
+      "mode\":\"%s\",\"temp_threshold\":%.1f,\"mode\":\"%s\"}",
+      s->temperature, s->humidity, s->buzzer ? "true" : "false",
+      s->buzzer_manual ? "manual" : "auto", s->temp_threshold,
+      s->automatic_mode ? "automatic" : "manual");
+  BENCH_KEEP(c->buf);
+}
+
+static void bench_single(void *ctx) {
+  encoder_case_t *c = ctx;
+  c->len = encoder_single(c->encoder, c->buf, sizeof(c->buf), &c->sample);
+  BENCH_KEEP(c->buf);
+}
+
+static void bench_batch(void *ctx) {
+  encoder_case_t *c = ctx;
+  telemetry_batch_t batch = {
+      .encoder = c->encoder,
+      .buf = c->buf,
+      .size = sizeof(c->buf),
+  };
+  batch.len = c->encoder->begin(c->buf, sizeof(c->buf));
+  for (int i = 0; i < BENCH_BATCH_SAMPLES; i++) {
+    encoder_batch_add(&batch, &c->sample, BENCH_TS_MS + i * 20000);
+  }
+  c->len = encoder_batch_end(&batch);
+  BENCH_KEEP(c->buf);
+}
+
+static void bench_encoder_case(const char *name, bench_fn_t fn,
+                               const telemetry_encoder_t *encoder) {
+  static encoder_case_t c;
+
+  c = (encoder_case_t){.encoder = encoder, .sample = bench_sample};
+  fn(&c);
+  bench_run(name, fn, &c, c.len);
+}
+
+void bench_encoder(void) {
+  // El formato anterior solo llevaba las seis claves sin LEDs
+  bench_encoder_case("encode/snprintf_float", bench_snprintf, NULL);
+  bench_encoder_case("encode/json", bench_single, &telemetry_encoder_json);
+  bench_encoder_case("encode/cbor", bench_single, &telemetry_encoder_cbor);
+  bench_encoder_case("encode/json_batch10", bench_batch,
+                     &telemetry_encoder_json);
+  bench_encoder_case("encode/cbor_batch10", bench_batch,
+                     &telemetry_encoder_cbor);
+}
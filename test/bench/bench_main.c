@@ -0,0 +1,46 @@
+/*******************************************************************************
+ * @file        bench_main.c
+ * @brief       Ejecutable de las mediciones:
+ *
+ *                bench [-n repeticiones] [-o resultados.json]
+ *
+ *              Sin -n cada caso se repite hasta durar al menos 200 ms. Los
+ *              resultados se imprimen como tabla y se escriben en JSON
+ *              (bench_results.json por defecto).
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main(int argc, char **argv) {
+  const char *output = "bench_results.json";
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      bench_set_iterations(strtoull(argv[++i], NULL, 10));
+    } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      output = argv[++i];
+    } else {
+      fprintf(stderr, "usage: %s [-n iterations] [-o results.json]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  bench_dht();
+  bench_encoder();
+  bench_rpc();
+  bench_control();
+
+  bench_print();
+  if (bench_write_json(output) != 0)
+    return 1;
+  printf("Results written to %s\n", output);
+  return 0;
+}
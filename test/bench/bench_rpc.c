@@ -0,0 +1,474 @@
+/*******************************************************************************
+ * @file        bench_rpc.c
+ * @brief       Mediciones de las RPC: el analizador JSON frente a cJSON, que
+ *              era lo que usaba el firmware antes, y el despacho completo de
+ *              cada método desde rpc_handle_data hasta la respuesta.
+ *
+ *              Los manejadores reales viven en proyecto_3_embebidos.c junto
+ *              a las colas de FreeRTOS; aquí los reemplazan sustitutos que
+ *              leen los mismos parámetros y hacen las mismas validaciones,
+ *              pero dejan el comando en una variable en lugar de encolarlo.
+ *              La comparación con cJSON solo se compila si CMake lo
+ *              encuentra en el sistema.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "bench.h"
+#include "buzzer_utils.h"
+#include "conn_utils.h"
+#include "encoder_utils.h"
+#include "fake_publish.h"
+#include "filter_utils.h"
+#include "rpc_utils.h"
+#include "rules_utils.h"
+#include "sampling_utils.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef BENCH_CJSON
+#include <cJSON.h>
+#endif
+
+typedef struct {
+  const char *method;
+  const char *payload;
+  const char *key; // parámetro numérico que lee el manejador
+} rpc_case_t;
+
+static const rpc_case_t cases[] = {
+    {"setTempThreshold", "{\"method\":\"setTempThreshold\",\"params\":"
+                         "{\"threshold\":28.5}}",
+     "threshold"},
+    {"setFilter", "{\"method\":\"setFilter\",\"params\":{\"channel\":"
+                  "\"temperature\",\"spike\":3.5,\"reject\":3,\"median\":5,"
+                  "\"ema\":2}}",
+     "ema"},
+};
+
+// Lo mismo que hace rpc_dispatch antes de llamar al manejador: tokenizar,
+// buscar el método y los parámetros y leer un número
+static void bench_rpc_parse(void *ctx) {
+  const rpc_case_t *c = ctx;
+  rpc_json_token_t tokens[RPC_MAX_TOKENS];
+  int count = rpc_json_parse(c->payload, strlen(c->payload), tokens,
+                             RPC_MAX_TOKENS);
+  rpc_request_t request = {
+      .json = c->payload,
+      .tokens = tokens,
+      .count = count,
+      .params = rpc_json_find(c->payload, tokens, count, 0, "params"),
+      .device = -1,
+  };
+  int method = rpc_json_find(c->payload, tokens, count, 0, "method");
+  float value = 0;
+  rpc_param_float(&request, c->key, &value);
+  BENCH_KEEP(method);
+  BENCH_KEEP(value);
+}
+
+#ifdef BENCH_CJSON
+static void *bench_cjson_malloc(size_t size) {
+  bench_count_alloc();
+  return malloc(size);
+}
+
+static void bench_cjson_parse(void *ctx) {
+  const rpc_case_t *c = ctx;
+  cJSON *root = cJSON_ParseWithLength(c->payload, strlen(c->payload));
+  cJSON *method = cJSON_GetObjectItem(root, "method");
+  cJSON *params = cJSON_GetObjectItem(root, "params");
+  cJSON *value = cJSON_GetObjectItem(params, c->key);
+  double number = cJSON_IsNumber(value) ? value->valuedouble : 0;
+  BENCH_KEEP(method);
+  BENCH_KEEP(number);
+  cJSON_Delete(root);
+}
+#endif
+
+// Destino de los comandos de los sustitutos, en lugar de la cola de control
+static volatile uint32_t command_sink;
+
+static esp_err_t bench_post(uint32_t value) {
+  command_sink = value;
+  return ESP_OK;
+}
+
+static esp_err_t bench_set_mode(const rpc_request_t *request, char *result,
+                                size_t result_size) {
+  if (rpc_param_string_equals(request, "mode", "automatic"))
+    return bench_post(1);
+  if (rpc_param_string_equals(request, "mode", "manual"))
+    return bench_post(0);
+  return ESP_ERR_INVALID_ARG;
+}
+
+static esp_err_t bench_set_led(const rpc_request_t *request, char *result,
+                               size_t result_size) {
+  int led;
+  bool on;
+
+  if (!rpc_param_int(request, "led", &led) ||
+      !rpc_param_bool(request, "state", &on) || led < 1 || led > 3)
+    return ESP_ERR_INVALID_ARG;
+  return bench_post(led << 1 | on);
+}
+
+static esp_err_t bench_set_buzzer(const rpc_request_t *request, char *result,
+                                  size_t result_size) {
+  bool on;
+
+  if (!rpc_param_bool(request, "state", &on))
+    return ESP_ERR_INVALID_ARG;
+  return bench_post(on);
+}
+
+static esp_err_t bench_set_temp_threshold(const rpc_request_t *request,
+                                          char *result, size_t result_size) {
+  float threshold = 0;
+
+  if (!rpc_param_float(request, NULL, &threshold))
+    rpc_param_float(request, "threshold", &threshold);
+  if (!(threshold > 0 && threshold <= 80.0f))
+    return ESP_ERR_INVALID_ARG;
+  return bench_post(lroundf(threshold * 10));
+}
+
+static esp_err_t bench_set_encoding(const rpc_request_t *request, char *result,
+                                    size_t result_size) {
+  int idx = rpc_json_find(request->json, request->tokens, request->count,
+                          request->params, "encoding");
+  if (idx < 0 || request->tokens[idx].type != RPC_JSON_STRING)
+    return ESP_ERR_INVALID_ARG;
+
+  const rpc_json_token_t *name = &request->tokens[idx];
+  const telemetry_encoder_t *encoder =
+      encoder_find(request->json + name->start, name->end - name->start);
+  if (encoder == NULL)
+    return ESP_ERR_NOT_FOUND;
+  return bench_post((uintptr_t)encoder);
+}
+
+static esp_err_t bench_set_filter(const rpc_request_t *request, char *result,
+                                  size_t result_size) {
+  float spike;
+  int reject = 0, median = 0, ema = 0;
+
+  if (!rpc_param_string_equals(request, "channel", "temperature") &&
+      !rpc_param_string_equals(request, "channel", "humidity"))
+    return ESP_ERR_INVALID_ARG;
+  if (rpc_param_float(request, "spike", &spike) &&
+      !(spike >= 0 && spike * 10 <= FILTER_SPIKE_LIMIT_MAX))
+    return ESP_ERR_INVALID_ARG;
+  if (rpc_param_int(request, "reject", &reject) &&
+      (reject < 0 || reject > UINT8_MAX))
+    return ESP_ERR_INVALID_ARG;
+  if (rpc_param_int(request, "median", &median) &&
+      (median < 1 || median > FILTER_MEDIAN_MAX || median % 2 == 0))
+    return ESP_ERR_INVALID_ARG;
+  if (rpc_param_int(request, "ema", &ema) && (ema < 0 || ema > 8))
+    return ESP_ERR_INVALID_ARG;
+  return bench_post(reject << 16 | median << 8 | ema);
+}
+
+static esp_err_t bench_get_state(const rpc_request_t *request, char *result,
+                                 size_t result_size) {
+  telemetry_sample_t sample = {
+      .temperature = 24.3f,
+      .humidity = 55.0f,
+      .temp_threshold = 30.0f,
+      .automatic_mode = true,
+      .leds = 0x01,
+  };
+  int len = snprintf(result, result_size, "{\"version\":%lu,\"state\":", 42UL);
+
+  sample.keys = (1 << TELEMETRY_KEY_AUX_FIRST) - 1;
+  size_t n = telemetry_encoder_json.sample((uint8_t *)result + len,
+                                           result_size - len - 1, &sample, 0,
+                                           true);
+  if (n == 0)
+    return ESP_ERR_NO_MEM;
+  len += n;
+  result[len++] = '}';
+  result[len] = 0;
+  return ESP_OK;
+}
+
+static esp_err_t bench_set_sampling_policy(const rpc_request_t *request,
+                                           char *result, size_t result_size) {
+  sampling_policy_t policy = {
+      .mode = SAMPLING_MODE_FIXED,
+      .period_ms = 5000,
+      .min_period_ms = 2000,
+      .max_period_ms = 60000,
+      .delta_temperature = 0.5f,
+      .delta_humidity = 2.0f,
+      .threshold_margin = 1.0f,
+  };
+  int value;
+
+  if (rpc_param_string_equals(request, "mode", "fixed"))
+    policy.mode = SAMPLING_MODE_FIXED;
+  else if (rpc_param_string_equals(request, "mode", "adaptive"))
+    policy.mode = SAMPLING_MODE_ADAPTIVE;
+  if (rpc_param_int(request, "period", &value))
+    policy.period_ms = value < 0 ? 0 : value;
+  if (rpc_param_int(request, "min", &value))
+    policy.min_period_ms = value < 0 ? 0 : value;
+  if (rpc_param_int(request, "max", &value))
+    policy.max_period_ms = value < 0 ? 0 : value;
+  rpc_param_float(request, "delta_temperature", &policy.delta_temperature);
+  rpc_param_float(request, "delta_humidity", &policy.delta_humidity);
+  rpc_param_float(request, "margin", &policy.threshold_margin);
+  if (!sampling_policy_valid(&policy))
+    return ESP_ERR_INVALID_ARG;
+  return bench_post(policy.period_ms);
+}
+
+static const char *const buzzer_patterns[BUZZER_PATTERN_COUNT] = {
+    [BUZZER_PATTERN_OFF] = "off",
+    [BUZZER_PATTERN_CONTINUOUS] = "continuous",
+    [BUZZER_PATTERN_WARNING] = "warning",
+    [BUZZER_PATTERN_ALARM] = "alarm",
+    [BUZZER_PATTERN_CRITICAL] = "critical",
+};
+
+// El recorrido de rpc_set_rules sin guardar en NVS
+static esp_err_t bench_set_rules(const rpc_request_t *request, char *result,
+                                 size_t result_size) {
+  rule_spec_t specs[RULES_MAX];
+  rules_t rules;
+  size_t count = 0;
+  int list = rpc_json_find(request->json, request->tokens, request->count,
+                           request->params, "rules");
+
+  if (list < 0 || request->tokens[list].type != RPC_JSON_ARRAY)
+    return ESP_ERR_INVALID_ARG;
+  if (request->tokens[list].size > RULES_MAX)
+    return ESP_ERR_INVALID_SIZE;
+
+  int idx = list + 1;
+  for (int i = 0; i < request->tokens[list].size; i++) {
+    rpc_request_t rule = *request;
+    rule_spec_t *spec = &specs[count++];
+    int input, output, priority = 0;
+    bool on;
+
+    rule.params = idx;
+    idx = rpc_json_skip(request->tokens, request->count, idx);
+    if (request->tokens[rule.params].type != RPC_JSON_OBJECT)
+      return ESP_ERR_INVALID_ARG;
+    input = rpc_json_find(rule.json, rule.tokens, rule.count, rule.params,
+                          "input");
+    output = rpc_json_find(rule.json, rule.tokens, rule.count, rule.params,
+                           "output");
+    if (input < 0 || output < 0)
+      return ESP_ERR_INVALID_ARG;
+    const rpc_json_token_t *in = &rule.tokens[input];
+    const rpc_json_token_t *out = &rule.tokens[output];
+    input = rules_input_parse(rule.json + in->start, in->end - in->start);
+    output =
+        rules_actuator_parse(rule.json + out->start, out->end - out->start);
+    if (input < 0 || output < 0)
+      return ESP_ERR_INVALID_ARG;
+
+    *spec = (rule_spec_t){.input = input, .actuator = output};
+    spec->above = rpc_param_float(&rule, "above", &spec->threshold);
+    if (!spec->above && !rpc_param_float(&rule, "below", &spec->threshold))
+      return ESP_ERR_INVALID_ARG;
+    rpc_param_float(&rule, "hysteresis", &spec->hysteresis);
+    rpc_param_int(&rule, "priority", &priority);
+    if (output == RULES_ACTUATOR_BUZZER) {
+      spec->value = BUZZER_PATTERN_COUNT;
+      for (int p = 0; p < BUZZER_PATTERN_COUNT; p++) {
+        if (rpc_param_string_equals(&rule, "value", buzzer_patterns[p]))
+          spec->value = p;
+      }
+      if (spec->value == BUZZER_PATTERN_COUNT)
+        return ESP_ERR_INVALID_ARG;
+    } else if (rpc_param_string_equals(&rule, "value", "on") ||
+               rpc_param_string_equals(&rule, "value", "off")) {
+      spec->value = rpc_param_string_equals(&rule, "value", "on");
+    } else if (rpc_param_bool(&rule, "value", &on)) {
+      spec->value = on;
+    } else {
+      return ESP_ERR_INVALID_ARG;
+    }
+    spec->priority = priority;
+  }
+
+  esp_err_t ret = rules_compile(&rules, specs, count);
+  if (ret != ESP_OK)
+    return ret;
+  return bench_post(rules.count);
+}
+
+static esp_err_t bench_get_history(const rpc_request_t *request, char *result,
+                                   size_t result_size) {
+  int from = 0, limit = 20;
+  int idx = rpc_json_find(request->json, request->tokens, request->count,
+                          request->params, "tier");
+
+  if (idx >= 0 && !rpc_param_string_equals(request, "tier", "raw") &&
+      !rpc_param_string_equals(request, "tier", "minute") &&
+      !rpc_param_string_equals(request, "tier", "hour"))
+    return ESP_ERR_INVALID_ARG;
+  rpc_param_int(request, "from", &from);
+  rpc_param_int(request, "limit", &limit);
+  if (from < 0 || limit < 1)
+    return ESP_ERR_INVALID_ARG;
+  // Una página vacía: el historial no se compila en el anfitrión
+  return snprintf(result, result_size, "{\"next\":%d,\"samples\":[]}", from) >
+                 0
+             ? ESP_OK
+             : ESP_ERR_NO_MEM;
+}
+
+static esp_err_t bench_get_publish_stats(const rpc_request_t *request,
+                                         char *result, size_t result_size) {
+  return snprintf(result, result_size,
+                  "{\"depth\":0,\"telemetry\":{\"sent\":1200,\"dropped\":0}}") >
+                 0
+             ? ESP_OK
+             : ESP_ERR_NO_MEM;
+}
+
+static esp_err_t bench_get_connectivity(const rpc_request_t *request,
+                                        char *result, size_t result_size) {
+  static conn_t net;
+  static bool ready = false;
+
+  if (!ready) {
+    conn_init(&net, 1);
+    ready = true;
+  }
+  return conn_format(&net, 60000, result, result_size) > 0 ? ESP_OK
+                                                           : ESP_ERR_NO_MEM;
+}
+
+typedef struct {
+  const char *method;
+  rpc_handler_t handler;
+  const char *params;
+} dispatch_spec_t;
+
+typedef struct {
+  hal_mqtt_event_t event;
+  char payload[RPC_BUFFER_SIZE];
+} dispatch_case_t;
+
+// setRules con RULES_MAX reglas y los nombres y números más largos que se
+// aceptan, la solicitud más grande que debe caber en el despachador
+static char rules_params[RPC_BUFFER_SIZE - 64];
+
+static void bench_rules_params(void) {
+  static const char *const inputs[] = {"temperature4", "humidity3",
+                                       "temp_excess", "dew_point"};
+  static const char *const outputs[] = {"led1", "led2", "led3", "buzzer"};
+  size_t len = snprintf(rules_params, sizeof(rules_params), "{\"rules\":[");
+
+  for (int i = 0; i < RULES_MAX; i++) {
+    bool buzzer = i % 4 == 3;
+    len += snprintf(rules_params + len, sizeof(rules_params) - len,
+                    "%s{\"input\":\"%s\",\"%s\":%d.5,\"hysteresis\":%d.5,"
+                    "\"output\":\"%s\",\"value\":\"%s\",\"priority\":%d}",
+                    i ? "," : "", inputs[i % 4], i % 2 ? "below" : "above",
+                    i % 2 ? -100 - i : 100 + i, 100 + i, outputs[i % 4],
+                    buzzer ? "continuous" : "off", 255 - i);
+  }
+  snprintf(rules_params + len, sizeof(rules_params) - len, "]}");
+}
+
+static const dispatch_spec_t dispatch_specs[] = {
+    {"setMode", bench_set_mode, "{\"mode\":\"automatic\"}"},
+    {"setLED", bench_set_led, "{\"led\":2,\"state\":true}"},
+    {"setBuzzer", bench_set_buzzer, "{\"state\":false}"},
+    {"setTempThreshold", bench_set_temp_threshold, "28.5"},
+    {"setEncoding", bench_set_encoding, "{\"encoding\":\"json\"}"},
+    {"setFilter", bench_set_filter,
+     "{\"channel\":\"temperature\",\"spike\":3.5,\"reject\":3,\"median\":5,"
+     "\"ema\":2}"},
+    {"getState", bench_get_state, "{}"},
+    {"setSamplingPolicy", bench_set_sampling_policy,
+     "{\"mode\":\"adaptive\",\"period\":10000,\"min\":2000,\"max\":60000,"
+     "\"delta_temperature\":0.3,\"delta_humidity\":1.5,\"margin\":1.0}"},
+    {"getPublishStats", bench_get_publish_stats, "{}"},
+    {"setRules", bench_set_rules, rules_params},
+    {"getHistory", bench_get_history,
+     "{\"tier\":\"minute\",\"from\":0,\"limit\":20}"},
+    {"getConnectivity", bench_get_connectivity, "{}"},
+};
+
+// Una solicitud completa como la entrega el cliente MQTT: despacho,
+// manejador y respuesta por la capa de publicación
+static void bench_rpc_dispatch(void *ctx) {
+  dispatch_case_t *c = ctx;
+  rpc_handle_data(&c->event);
+}
+
+static void bench_rpc_dispatch_all(void) {
+  static const char topic[] = "v1/devices/me/rpc/request/42";
+  static dispatch_case_t cases[sizeof(dispatch_specs) /
+                               sizeof(dispatch_specs[0])];
+  size_t count = sizeof(dispatch_specs) / sizeof(dispatch_specs[0]);
+
+  bench_rules_params();
+  for (size_t i = 0; i < count; i++) {
+    const dispatch_spec_t *spec = &dispatch_specs[i];
+    dispatch_case_t *c = &cases[i];
+    char name[64];
+    int len = snprintf(c->payload, sizeof(c->payload),
+                       "{\"method\":\"%s\",\"params\":%s}", spec->method,
+                       spec->params);
+
+    rpc_register(spec->method, spec->handler);
+    c->event = (hal_mqtt_event_t){
+        .event_id = HAL_MQTT_EVENT_DATA,
+        .topic = topic,
+        .topic_len = sizeof(topic) - 1,
+        .data = c->payload,
+        .data_len = len,
+        .total_data_len = len,
+    };
+
+    // Un manejador que falla mediría la ruta de error, no la del método:
+    // se trata como una regresión
+    fake_publish_reset();
+    bench_rpc_dispatch(c);
+    const fake_publish_msg_t *reply = fake_publish_last();
+    if (reply == NULL || strstr(reply->data, "\"error\"") != NULL) {
+      fprintf(stderr, "rpc_dispatch/%s: bad reply %s\n", spec->method,
+              reply != NULL ? reply->data : "(none)");
+      exit(1);
+    }
+
+    snprintf(name, sizeof(name), "rpc_dispatch/%s", spec->method);
+    bench_run(name, bench_rpc_dispatch, c, len);
+  }
+}
+
+void bench_rpc(void) {
+#ifdef BENCH_CJSON
+  cJSON_Hooks hooks = {.malloc_fn = bench_cjson_malloc, .free_fn = free};
+  cJSON_InitHooks(&hooks);
+#endif
+
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    char name[64];
+    void *ctx = (void *)&cases[i];
+    size_t len = strlen(cases[i].payload);
+
+    snprintf(name, sizeof(name), "rpc_parse/%s", cases[i].method);
+    bench_run(name, bench_rpc_parse, ctx, len);
+#ifdef BENCH_CJSON
+    snprintf(name, sizeof(name), "rpc_parse_cjson/%s", cases[i].method);
+    bench_run(name, bench_cjson_parse, ctx, len);
+#endif
+  }
+
+  bench_rpc_dispatch_all();
+}
@@ -0,0 +1,73 @@
+#!/bin/sh
+# Hace de ThingsBoard frente al objetivo linux compilado con GATEWAY_MODE=1:
+# envía RPC envueltas por v1/gateway/rpc a distintos dispositivos hijos y
+# revisa cada respuesta.
+#
+#   mosquitto -p 1883 &
+#   idf.py -B build_linux -DSDKCONFIG=sdkconfig.linux -DGATEWAY_MODE=1 build
+#   ./build_linux/proyecto_3_embebidos.elf &
+#   sh test/load/gateway_rpc.sh
+#
+# Un corredor común reenvía a la pasarela sus propias respuestas, porque
+# comparten el tópico; el despachador las ignora al no traer "method".
+
+set -eu
+
+HOST=${HOST:-localhost}
+PORT=${PORT:-1883}
+TOPIC=v1/gateway/rpc
+TIMEOUT=${TIMEOUT:-5}
+
+replies=$(mktemp)
+trap 'kill "$sub" 2>/dev/null; rm -f "$replies"' EXIT INT TERM
+mosquitto_sub -h "$HOST" -p "$PORT" -q 1 -t "$TOPIC" >"$replies" &
+sub=$!
+sleep 1
+
+failures=0
+id=0
+
+# rpc <dispositivo> <método> <params> <patrón esperado en la respuesta>
+rpc() {
+  id=$((id + 1))
+  mosquitto_pub -h "$HOST" -p "$PORT" -q 1 -t "$TOPIC" -m \
+    "{\"device\":\"$1\",\"data\":{\"id\":$id,\"method\":\"$2\",\"params\":$3}}"
+
+  waited=0
+  while :; do
+    # La respuesta lleva el id fuera de "data"; la solicitud, dentro
+    reply=$(grep -F "\"device\":\"$1\",\"id\":$id," "$replies" || true)
+    [ -n "$reply" ] && break
+    waited=$((waited + 1))
+    if [ "$waited" -gt $((TIMEOUT * 10)) ]; then
+      echo "FAIL $1 $2: no reply"
+      failures=$((failures + 1))
+      return
+    fi
+    sleep 0.1
+  done
+
+  if echo "$reply" | grep -Eq "$4"; then
+    echo "PASS $1 $2"
+  else
+    echo "FAIL $1 $2: $reply"
+    failures=$((failures + 1))
+  fi
+}
+
+# El primer hijo lleva los LEDs, el zumbador y el modo
+rpc "DHT 1" getState '{}' '"state":\{'
+rpc "DHT 1" setLED '{"led":1,"state":true}' '"success":true'
+# Solo el lote por dispositivo es válido en modo pasarela
+rpc "DHT 1" setEncoding '{"encoding":"json"}' 'ESP_ERR_NOT_FOUND'
+rpc "DHT 1" setEncoding '{"encoding":"gateway"}' '"success":true'
+
+# Los demás solo atienden lo que distingue el dispositivo
+rpc "DHT 2" getState '{}' '"state":\{"temperature"|ESP_ERR_NOT_FOUND'
+rpc "DHT 2" setFilter '{"channel":"temperature","median":5}' '"success":true'
+rpc "DHT 2" setLED '{"led":1,"state":false}' 'not supported for this device'
+rpc "DHT 2" setMode '{"mode":"manual"}' 'not supported for this device'
+
+rpc "DHT 9" getState '{}' 'unknown device'
+
+[ "$failures" -eq 0 ]
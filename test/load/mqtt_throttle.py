@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+"""Proxy TCP que estrangula el enlace entre el objetivo linux y un corredor
+MQTT local, para probar la capa de publicación contra un corredor lento.
+
+Los bytes en ambos sentidos pasan a lo sumo a --rate bytes por segundo, así
+que las confirmaciones PUBACK llegan tarde y la bandeja de salida se llena.
+Con --stall el enlace se detiene por completo durante períodos fijos sin
+cerrar la conexión, como una red que deja de responder.
+
+    mosquitto -p 1884 &
+    python3 test/load/mqtt_throttle.py --rate 200 --stall 60:120 &
+    ./build_linux/proyecto_3_embebidos.elf
+
+El proxy escucha en 1883, el puerto del objetivo linux, y reenvía a 1884.
+
+Solo usa la biblioteca estándar.
+"""
+
+import argparse
+import asyncio
+import time
+
+CHUNK = 256
+
+
+class Link:
+    """Ritmo y cortes compartidos por todas las conexiones del proxy."""
+
+    def __init__(self, rate, stalls):
+        self.rate = rate
+        self.stalls = stalls
+        self.start = time.monotonic()
+        self.credit = 0.0
+        self.last = self.start
+        self.lock = asyncio.Lock()
+
+    def stalled(self):
+        elapsed = time.monotonic() - self.start
+        return any(begin <= elapsed < end for begin, end in self.stalls)
+
+    async def take(self, n):
+        async with self.lock:
+            while True:
+                now = time.monotonic()
+                if self.stalled():
+                    self.last = now
+                    await asyncio.sleep(0.05)
+                    continue
+                if self.rate <= 0:
+                    return
+                self.credit = min(self.credit + (now - self.last) * self.rate,
+                                  float(self.rate))
+                self.last = now
+                if self.credit >= n:
+                    self.credit -= n
+                    return
+                await asyncio.sleep((n - self.credit) / self.rate)
+
+
+async def pipe(link, reader, writer, name, counters):
+    try:
+        while True:
+            data = await reader.read(CHUNK)
+            if not data:
+                break
+            await link.take(len(data))
+            writer.write(data)
+            await writer.drain()
+            counters[name] += len(data)
+    except (ConnectionError, asyncio.CancelledError):
+        pass
+    finally:
+        writer.close()
+
+
+async def handle(link, args, counters, client_reader, client_writer):
+    broker_reader, broker_writer = await asyncio.open_connection(
+        args.broker_host, args.broker)
+    print("client connected", flush=True)
+    await asyncio.gather(
+        pipe(link, client_reader, broker_writer, "up", counters),
+        pipe(link, broker_reader, client_writer, "down", counters))
+    print("client disconnected", flush=True)
+
+
+async def report(link, counters, interval):
+    while True:
+        await asyncio.sleep(interval)
+        state = "stalled" if link.stalled() else "flowing"
+        print(f"{time.monotonic() - link.start:7.0f}s {state} "
+              f"up={counters['up']} down={counters['down']}", flush=True)
+
+
+def parse_stall(text):
+    begin, end = text.split(":")
+    return float(begin), float(end)
+
+
+async def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--listen", type=int, default=1883)
+    parser.add_argument("--broker", type=int, default=1884)
+    parser.add_argument("--broker-host", default="127.0.0.1")
+    parser.add_argument("--rate", type=float, default=200,
+                        help="bytes por segundo; 0 sin límite")
+    parser.add_argument("--stall", type=parse_stall, action="append",
+                        default=[], metavar="DESDE:HASTA",
+                        help="segundos desde el arranque sin tráfico")
+    parser.add_argument("--report", type=float, default=10)
+    args = parser.parse_args()
+
+    link = Link(args.rate, args.stall)
+    counters = {"up": 0, "down": 0}
+    server = await asyncio.start_server(
+        lambda r, w: handle(link, args, counters, r, w), "0.0.0.0",
+        args.listen)
+    asyncio.ensure_future(report(link, counters, args.report))
+    async with server:
+        await server.serve_forever()
+
+
+if __name__ == "__main__":
+    try:
+        asyncio.run(main())
+    except KeyboardInterrupt:
+        pass
@@ -0,0 +1,79 @@
+#!/bin/sh
+# Revisa que el corredor reanude sesiones TLS 1.2 como las ofrece
+# tls_utils: conecta una vez guardando la sesión y otra ofreciéndola, con
+# ticket y con ID de sesión (sin ticket). Si el corredor no reanuda, cada
+# reconexión del dispositivo hace el saludo completo.
+#
+#   HOST=demo.thingsboard.io sh test/load/tls_resume.sh
+#   HOST=192.168.1.10 CA=ca.pem SERVERNAME=broker.local \
+#     sh test/load/tls_resume.sh
+#
+# Con LOCAL=1 levanta un openssl s_server de TLS 1.2 con un certificado
+# desechable, para probar el script sin corredor.
+
+set -eu
+
+HOST=${HOST:-localhost}
+PORT=${PORT:-8883}
+SERVERNAME=${SERVERNAME:-$HOST}
+CA=${CA:-}
+LOCAL=${LOCAL:-0}
+
+work=$(mktemp -d)
+server=
+trap '[ -n "$server" ] && kill "$server" 2>/dev/null; rm -rf "$work"' \
+  EXIT INT TERM
+
+if [ "$LOCAL" = 1 ]; then
+  HOST=127.0.0.1
+  SERVERNAME=broker.local
+  openssl req -x509 -newkey ec -pkeyopt ec_paramgen_curve:P-256 -nodes \
+    -keyout "$work/key.pem" -out "$work/cert.pem" -days 1 \
+    -subj "/CN=$SERVERNAME" 2>/dev/null
+  openssl s_server -tls1_2 -accept "$PORT" -cert "$work/cert.pem" \
+    -key "$work/key.pem" -quiet >/dev/null 2>&1 </dev/null &
+  server=$!
+  CA=$work/cert.pem
+  sleep 1
+fi
+
+failures=0
+
+# connect <archivo de salida> [opciones de s_client]
+connect() {
+  out=$1
+  shift
+  openssl s_client -connect "$HOST:$PORT" -servername "$SERVERNAME" \
+    -tls1_2 ${CA:+-CAfile "$CA"} "$@" </dev/null >"$out" 2>&1 || true
+}
+
+# resume <nombre> [opciones de s_client]
+resume() {
+  name=$1
+  shift
+  rm -f "$work/session.pem"
+  connect "$work/first" -sess_out "$work/session.pem" "$@"
+  if ! grep -q "^New, TLSv1.2" "$work/first"; then
+    echo "FAIL $name: no TLS 1.2 handshake"
+    failures=$((failures + 1))
+    return
+  fi
+  # Sin ticket ni ID el corredor no deja nada que ofrecer
+  if [ ! -s "$work/session.pem" ]; then
+    echo "FAIL $name: no resumable session"
+    failures=$((failures + 1))
+    return
+  fi
+  connect "$work/second" -sess_in "$work/session.pem" "$@"
+  if grep -q "^Reused, TLSv1.2" "$work/second"; then
+    echo "PASS $name"
+  else
+    echo "FAIL $name: $(grep -E '^(New|Reused)' "$work/second" || echo 'no handshake')"
+    failures=$((failures + 1))
+  fi
+}
+
+resume "ticket"
+resume "session id" -no_ticket
+
+[ "$failures" -eq 0 ]
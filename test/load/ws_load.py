@@ -0,0 +1,318 @@
+#!/usr/bin/env python3
+"""Prueba de carga de /ws y /metrics con muchos clientes a la vez.
+
+Abre --clients conexiones WebSocket al dispositivo, más de las
+HTTP_WS_MAX_CLIENTS que admite, y revisa:
+
+  - que se admitan a lo sumo --max-clients y los demás se cierren sin
+    recibir tramas;
+  - que cada cliente admitido reciba muestras JSON válidas, con el mismo
+    texto para todos (la muestra se codifica una sola vez), y cuánto tarda
+    cada una respecto a la primera copia que llegó;
+  - que los clientes que dejan de leer (--slow) terminen desconectados en
+    lugar de retener las tramas compartidas;
+  - con --churn, que los clientes que se van y vuelven recuperen su lugar;
+  - que /metrics siga respondiendo durante la carga.
+
+    python3 test/load/ws_load.py --host 192.168.1.50 --clients 12 \\
+        --slow 2 --duration 120 --json ws_load.json
+
+Termina con 1 si algo no se cumple. Solo usa la biblioteca estándar.
+"""
+
+import argparse
+import asyncio
+import base64
+import hashlib
+import json
+import os
+import socket
+import struct
+import sys
+import time
+
+WS_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+OP_TEXT, OP_CLOSE, OP_PING, OP_PONG = 0x1, 0x8, 0x9, 0xA
+
+
+class Client:
+    def __init__(self, index, slow):
+        self.index = index
+        self.slow = slow
+        self.admitted = False
+        self.rejected = False
+        self.closed_by_server = False
+        self.frames = 0
+        self.invalid = 0
+        self.connects = 0
+        self.error = None
+
+
+class Stats:
+    def __init__(self):
+        # texto de la muestra -> instante de la primera copia recibida
+        self.first_seen = {}
+        self.delays_ms = []
+        self.metrics_ok = 0
+        self.metrics_failed = 0
+        self.metrics_ms = []
+        # clientes recibiendo tramas al mismo tiempo
+        self.admitted_now = 0
+        self.admitted_max = 0
+
+
+def frame(opcode, payload=b""):
+    """Trama de cliente, que siempre va enmascarada."""
+    mask = os.urandom(4)
+    header = bytes([0x80 | opcode])
+    if len(payload) < 126:
+        header += bytes([0x80 | len(payload)])
+    else:
+        header += bytes([0x80 | 126]) + struct.pack("!H", len(payload))
+    masked = bytes(b ^ mask[i % 4] for i, b in enumerate(payload))
+    return header + mask + masked
+
+
+async def read_frame(reader):
+    head = await reader.readexactly(2)
+    opcode = head[0] & 0x0F
+    length = head[1] & 0x7F
+    if length == 126:
+        length = struct.unpack("!H", await reader.readexactly(2))[0]
+    elif length == 127:
+        length = struct.unpack("!Q", await reader.readexactly(8))[0]
+    if head[1] & 0x80:
+        mask = await reader.readexactly(4)
+        data = await reader.readexactly(length)
+        data = bytes(b ^ mask[i % 4] for i, b in enumerate(data))
+    else:
+        data = await reader.readexactly(length)
+    return opcode, data
+
+
+async def handshake(args, slow):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    if slow:
+        # Una ventana pequeña para que el emisor se llene pronto
+        sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 1024)
+    sock.setblocking(False)
+    loop = asyncio.get_running_loop()
+    await asyncio.wait_for(loop.sock_connect(sock, (args.host, args.port)),
+                           args.timeout)
+    reader, writer = await asyncio.open_connection(
+        sock=sock, limit=256 if slow else 2 ** 16)
+
+    key = base64.b64encode(os.urandom(16)).decode()
+    writer.write((f"GET /ws HTTP/1.1\r\nHost: {args.host}\r\n"
+                  "Upgrade: websocket\r\nConnection: Upgrade\r\n"
+                  f"Sec-WebSocket-Key: {key}\r\n"
+                  "Sec-WebSocket-Version: 13\r\n\r\n").encode())
+    await writer.drain()
+    response = await asyncio.wait_for(reader.readuntil(b"\r\n\r\n"),
+                                      args.timeout)
+    lines = response.decode(errors="replace").split("\r\n")
+    if " 101 " not in lines[0] + " ":
+        raise ConnectionError(lines[0])
+    accept = base64.b64encode(
+        hashlib.sha1((key + WS_GUID).encode()).digest()).decode()
+    headers = {k.strip().lower(): v.strip()
+               for k, v in (l.split(":", 1) for l in lines[1:] if ":" in l)}
+    if headers.get("sec-websocket-accept") != accept:
+        raise ConnectionError("bad Sec-WebSocket-Accept")
+    return reader, writer
+
+
+async def session(args, client, stats, until):
+    """Una conexión; retorna cuando el servidor o --churn la cierran."""
+    client.connects += 1
+    client.rejected = False
+    reader, writer = await handshake(args, client.slow)
+    session_frames = 0
+    leave_at = until
+    if args.churn > 0:
+        leave_at = min(until, time.monotonic() + args.churn)
+
+    try:
+        if client.slow:
+            # Nunca leer: el dispositivo debe cerrar esta conexión. Al
+            # final, vaciar lo recibido y ver si llegó el cierre
+            await asyncio.sleep(max(0.0, until - time.monotonic()))
+            drain_until = time.monotonic() + args.timeout
+            try:
+                while time.monotonic() < drain_until:
+                    opcode, _ = await asyncio.wait_for(
+                        read_frame(reader), drain_until - time.monotonic())
+                    if opcode == OP_CLOSE:
+                        client.closed_by_server = True
+                        return
+            except (asyncio.IncompleteReadError, ConnectionError):
+                client.closed_by_server = True
+            except asyncio.TimeoutError:
+                pass
+            return
+
+        while True:
+            remaining = leave_at - time.monotonic()
+            if remaining <= 0:
+                writer.write(frame(OP_CLOSE, struct.pack("!H", 1000)))
+                await writer.drain()
+                return
+            try:
+                opcode, data = await asyncio.wait_for(read_frame(reader),
+                                                      remaining)
+            except asyncio.TimeoutError:
+                continue
+            if opcode == OP_CLOSE:
+                client.closed_by_server = True
+                return
+            if opcode == OP_PING:
+                writer.write(frame(OP_PONG, data))
+                await writer.drain()
+                continue
+            if opcode != OP_TEXT:
+                continue
+
+            if session_frames == 0:
+                client.admitted = True
+                stats.admitted_now += 1
+                stats.admitted_max = max(stats.admitted_max,
+                                         stats.admitted_now)
+            session_frames += 1
+            client.frames += 1
+            try:
+                json.loads(data)
+            except ValueError:
+                client.invalid += 1
+            now = time.monotonic()
+            first = stats.first_seen.setdefault(data, now)
+            stats.delays_ms.append((now - first) * 1000)
+    except (asyncio.IncompleteReadError, ConnectionError):
+        # Cerrada sin recibir nada: el dispositivo no tenía lugar
+        if session_frames == 0 and not client.slow:
+            client.rejected = True
+        client.closed_by_server = True
+    finally:
+        if session_frames > 0:
+            stats.admitted_now -= 1
+        writer.close()
+
+
+async def run_client(args, client, stats, until):
+    await asyncio.sleep(client.index * args.stagger)
+    while time.monotonic() < until:
+        try:
+            await session(args, client, stats, until)
+        except (OSError, asyncio.TimeoutError) as exc:
+            client.error = str(exc) or type(exc).__name__
+        if client.slow or (args.churn <= 0 and not client.rejected):
+            return
+        # Rechazado o de salida: reintentar después de una pausa
+        await asyncio.sleep(args.retry if client.rejected else 0.5)
+
+
+async def poll_metrics(args, stats, until):
+    while time.monotonic() < until:
+        start = time.monotonic()
+        try:
+            reader, writer = await asyncio.wait_for(
+                asyncio.open_connection(args.host, args.port), args.timeout)
+            writer.write((f"GET /metrics HTTP/1.1\r\nHost: {args.host}\r\n"
+                          "Connection: close\r\n\r\n").encode())
+            await writer.drain()
+            body = await asyncio.wait_for(reader.read(), args.timeout)
+            writer.close()
+            head, _, payload = body.partition(b"\r\n\r\n")
+            if b" 200 " not in head.split(b"\r\n")[0] + b" ":
+                raise ConnectionError(head.split(b"\r\n")[0].decode())
+            json.loads(payload)
+            stats.metrics_ok += 1
+            stats.metrics_ms.append((time.monotonic() - start) * 1000)
+        except (OSError, ValueError, asyncio.TimeoutError):
+            stats.metrics_failed += 1
+        await asyncio.sleep(args.metrics_interval)
+
+
+def percentile(values, p):
+    if not values:
+        return 0.0
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * p / 100))]
+
+
+async def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--clients", type=int, default=8)
+    parser.add_argument("--slow", type=int, default=0,
+                        help="clientes que nunca leen")
+    parser.add_argument("--max-clients", type=int, default=4,
+                        help="HTTP_WS_MAX_CLIENTS del dispositivo")
+    parser.add_argument("--duration", type=float, default=60)
+    parser.add_argument("--churn", type=float, default=0,
+                        help="segundos que cada cliente se queda; 0 siempre")
+    parser.add_argument("--stagger", type=float, default=0.05)
+    parser.add_argument("--retry", type=float, default=2)
+    parser.add_argument("--timeout", type=float, default=5)
+    parser.add_argument("--metrics-interval", type=float, default=1)
+    parser.add_argument("--json", help="guardar el resumen en este archivo")
+    args = parser.parse_args()
+
+    # Los lentos primero, para que ocupen lugar y el dispositivo los saque
+    clients = [Client(i, i < args.slow) for i in range(args.clients)]
+    stats = Stats()
+    until = time.monotonic() + args.duration
+    await asyncio.gather(poll_metrics(args, stats, until),
+                         *(run_client(args, c, stats, until) for c in clients))
+
+    fast = [c for c in clients if not c.slow]
+    admitted = [c for c in fast if c.admitted]
+    summary = {
+        "clients": args.clients,
+        "slow": args.slow,
+        "admitted": len(admitted),
+        "admitted_at_once": stats.admitted_max,
+        "never_admitted": sum(1 for c in fast if not c.admitted),
+        "slow_closed": sum(1 for c in clients if c.slow and c.closed_by_server),
+        "connects": sum(c.connects for c in clients),
+        "samples": len(stats.first_seen),
+        "frames": sum(c.frames for c in clients),
+        "frames_per_client": sorted(c.frames for c in admitted),
+        "invalid_frames": sum(c.invalid for c in clients),
+        "fanout_delay_ms": {"p50": percentile(stats.delays_ms, 50),
+                            "p99": percentile(stats.delays_ms, 99),
+                            "max": max(stats.delays_ms, default=0.0)},
+        "metrics_ok": stats.metrics_ok,
+        "metrics_failed": stats.metrics_failed,
+        "metrics_ms": {"p50": percentile(stats.metrics_ms, 50),
+                       "p99": percentile(stats.metrics_ms, 99)},
+        "errors": sorted({c.error for c in clients if c.error}),
+    }
+
+    failures = []
+    if not admitted:
+        failures.append("no client received samples")
+    if stats.admitted_max > args.max_clients:
+        failures.append(f"{stats.admitted_max} clients at once, "
+                        f"limit {args.max_clients}")
+    if summary["invalid_frames"]:
+        failures.append("frames that are not JSON")
+    if stats.metrics_ok == 0 or stats.metrics_failed > stats.metrics_ok / 10:
+        failures.append("/metrics unresponsive under load")
+    if args.slow and summary["slow_closed"] < args.slow:
+        failures.append(f"only {summary['slow_closed']} of {args.slow} "
+                        "slow clients were closed")
+    summary["failures"] = failures
+
+    print(json.dumps(summary, indent=2))
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(summary, f, indent=2)
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    try:
+        sys.exit(asyncio.run(main()))
+    except KeyboardInterrupt:
+        sys.exit(130)
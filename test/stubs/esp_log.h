@@ -0,0 +1,25 @@
+/*******************************************************************************
+ * @file        esp_log.h
+ * @brief       Sustituto de ESP-IDF para las pruebas en el anfitrión: los
+ *              registros se descartan, pero el compilador revisa sus formatos.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#ifndef ESP_LOG_H
+#define ESP_LOG_H
+
+#include <stdint.h>
+
+static inline void __attribute__((format(printf, 2, 3)))
+esp_log_discard(const char *tag, const char *format, ...) {}
+
+#define ESP_LOGE(tag, format, ...) esp_log_discard(tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) esp_log_discard(tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) esp_log_discard(tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) esp_log_discard(tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) esp_log_discard(tag, format, ##__VA_ARGS__)
+
+#endif // ESP_LOG_H
@@ -0,0 +1,120 @@
+/*******************************************************************************
+ * @file        fake_broker.c
+ * @brief       Corredor MQTT con ritmo de confirmación configurable para las
+ *              pruebas en el anfitrión.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "fake_broker.h"
+#include "freertos/task.h"
+#include "hal.h"
+#include <string.h>
+
+typedef struct {
+  char topic[64];
+  int len;
+} fake_message_t;
+
+// Bandeja de salida en orden de envío
+static fake_message_t inflight[FAKE_BROKER_INFLIGHT];
+static size_t inflight_head = 0;
+static size_t inflight_count = 0;
+static int outbox_bytes = 0;
+static int outbox_max = 0;
+static size_t limit = 0;
+
+static char delivered[FAKE_BROKER_LOG][64];
+static size_t delivered_count = 0;
+
+static uint32_t rate = 0;
+static uint64_t credit_milli = 0; // bytes confirmables, en milésimas
+static uint64_t now_ms = 0;
+static uint32_t delayed_ms = 0;
+static int next_id = 1;
+
+void fake_broker_reset(size_t outbox_limit) {
+  inflight_head = inflight_count = 0;
+  outbox_bytes = outbox_max = 0;
+  limit = outbox_limit;
+  delivered_count = 0;
+  rate = 0;
+  credit_milli = 0;
+  now_ms = 0;
+  delayed_ms = 0;
+  next_id = 1;
+}
+
+void fake_broker_set_rate(uint32_t bytes_per_s) { rate = bytes_per_s; }
+
+uint64_t fake_broker_now_ms(void) { return now_ms; }
+
+uint32_t fake_broker_delayed_ms(void) { return delayed_ms; }
+
+int fake_broker_max_outbox(void) { return outbox_max; }
+
+static void fake_deliver(const char *topic) {
+  if (delivered_count < FAKE_BROKER_LOG) {
+    strncpy(delivered[delivered_count], topic, sizeof(delivered[0]) - 1);
+    delivered[delivered_count][sizeof(delivered[0]) - 1] = 0;
+  }
+  delivered_count++;
+}
+
+size_t fake_broker_delivered(const char *topic_prefix) {
+  size_t prefix = strlen(topic_prefix);
+  size_t n = 0;
+
+  for (size_t i = 0; i < delivered_count && i < FAKE_BROKER_LOG; i++) {
+    if (strncmp(delivered[i], topic_prefix, prefix) == 0)
+      n++;
+  }
+  return n;
+}
+
+void fake_broker_advance_ms(uint32_t ms) {
+  now_ms += ms;
+  credit_milli += (uint64_t)rate * ms;
+
+  while (inflight_count > 0) {
+    fake_message_t *msg = &inflight[inflight_head];
+    if (credit_milli < (uint64_t)msg->len * 1000)
+      break;
+    credit_milli -= (uint64_t)msg->len * 1000;
+    outbox_bytes -= msg->len;
+    fake_deliver(msg->topic);
+    inflight_head = (inflight_head + 1) % FAKE_BROKER_INFLIGHT;
+    inflight_count--;
+  }
+  // Sin mensajes en espera el crédito no se acumula, como un enlace ocioso
+  if (inflight_count == 0)
+    credit_milli = 0;
+}
+
+void vTaskDelay(TickType_t ticks) { delayed_ms += ticks; }
+
+int hal_mqtt_publish(const char *topic, const char *data, int len, int qos,
+                     int retain) {
+  if (qos == 0) {
+    fake_deliver(topic);
+    return 0;
+  }
+  if ((limit != 0 && outbox_bytes + len > (int)limit) ||
+      inflight_count == FAKE_BROKER_INFLIGHT)
+    return -2;
+
+  fake_message_t *msg =
+      &inflight[(inflight_head + inflight_count) % FAKE_BROKER_INFLIGHT];
+  strncpy(msg->topic, topic, sizeof(msg->topic) - 1);
+  msg->topic[sizeof(msg->topic) - 1] = 0;
+  msg->len = len;
+  inflight_count++;
+  outbox_bytes += len;
+  if (outbox_bytes > outbox_max)
+    outbox_max = outbox_bytes;
+  return next_id++;
+}
+
+int hal_mqtt_outbox_size(void) { return outbox_bytes; }
@@ -0,0 +1,43 @@
+/*******************************************************************************
+ * @file        fake_broker.h
+ * @brief       Sustituto del cliente MQTT para las pruebas en el anfitrión:
+ *              un corredor que confirma los mensajes QoS1 a un ritmo
+ *              configurable, para reproducir un enlace lento o detenido.
+ *
+ *              Los mensajes QoS1 ocupan la bandeja de salida hasta que el
+ *              corredor los confirma en orden, gastando los bytes por segundo
+ *              del ritmo actual; con la bandeja en su límite la publicación
+ *              falla como en esp-mqtt. Los QoS0 se entregan de inmediato.
+ *              vTaskDelay no avanza el reloj del corredor: modela una espera
+ *              dentro de la tarea del cliente MQTT, que es la que procesaría
+ *              las confirmaciones.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#ifndef FAKE_BROKER_H
+#define FAKE_BROKER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FAKE_BROKER_INFLIGHT 256
+#define FAKE_BROKER_LOG 4096
+
+// Vaciar la bandeja y el registro; outbox_limit 0 no limita
+void fake_broker_reset(size_t outbox_limit);
+// Bytes por segundo que el corredor confirma; 0 detiene las confirmaciones
+void fake_broker_set_rate(uint32_t bytes_per_s);
+void fake_broker_advance_ms(uint32_t ms);
+uint64_t fake_broker_now_ms(void);
+
+// Milisegundos pasados en vTaskDelay desde el último reinicio
+uint32_t fake_broker_delayed_ms(void);
+// Mayor ocupación de la bandeja desde el último reinicio
+int fake_broker_max_outbox(void);
+// Mensajes entregados (QoS1 confirmados o QoS0) cuyo tópico empieza así
+size_t fake_broker_delivered(const char *topic_prefix);
+
+#endif // FAKE_BROKER_H
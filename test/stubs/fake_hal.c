@@ -0,0 +1,157 @@
+/*******************************************************************************
+ * @file        fake_hal.c
+ * @brief       GPIO, PWM y temporizadores de un disparo sobre un reloj
+ *              virtual para las pruebas en el anfitrión.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "fake_hal.h"
+#include <stdbool.h>
+#include <string.h>
+
+#define FAKE_HAL_PWM_CHANNELS 8
+#define FAKE_HAL_GPIOS 64
+
+typedef struct {
+  bool created;
+  bool armed;
+  uint64_t deadline_us;
+  hal_timer_cb_t callback;
+  void *arg;
+} fake_timer_t;
+
+static uint8_t gpio_levels[FAKE_HAL_GPIOS];
+static fake_timer_t timers[FAKE_HAL_TIMERS];
+static uint64_t now_us = 0;
+static uint64_t latency_us = 0;
+
+static uint32_t pwm_freq[FAKE_HAL_PWM_CHANNELS];
+static fake_pwm_event_t pwm_events[FAKE_HAL_PWM_EVENTS];
+static size_t pwm_count = 0;
+static unsigned freq_changes = 0;
+
+void fake_hal_reset(void) {
+  // Los temporizadores creados siguen existiendo, como en un módulo que ya
+  // guardó su identificador; solo se desarman
+  for (size_t i = 0; i < FAKE_HAL_TIMERS; i++)
+    timers[i].armed = false;
+  memset(pwm_freq, 0, sizeof(pwm_freq));
+  memset(gpio_levels, 0, sizeof(gpio_levels));
+  now_us = 0;
+  latency_us = 0;
+  pwm_count = 0;
+  freq_changes = 0;
+}
+
+uint64_t fake_hal_now_us(void) { return now_us; }
+
+void fake_hal_set_timer_latency_us(uint64_t us) { latency_us = us; }
+
+unsigned fake_hal_freq_changes(void) { return freq_changes; }
+
+size_t fake_hal_pwm_count(void) { return pwm_count; }
+
+const fake_pwm_event_t *fake_hal_pwm_event(size_t index) {
+  return index < pwm_count ? &pwm_events[index] : NULL;
+}
+
+size_t fake_hal_timers_armed(void) {
+  size_t armed = 0;
+  for (size_t i = 0; i < FAKE_HAL_TIMERS; i++)
+    armed += timers[i].armed;
+  return armed;
+}
+
+void fake_hal_advance_us(uint64_t us) {
+  uint64_t target = now_us + us;
+
+  for (;;) {
+    fake_timer_t *next = NULL;
+    for (size_t i = 0; i < FAKE_HAL_TIMERS; i++) {
+      if (timers[i].armed && timers[i].deadline_us <= target &&
+          (next == NULL || timers[i].deadline_us < next->deadline_us))
+        next = &timers[i];
+    }
+    if (next == NULL)
+      break;
+    // El callback puede volver a armar el mismo temporizador
+    now_us = next->deadline_us;
+    next->armed = false;
+    next->callback(next->arg);
+  }
+  now_us = target;
+}
+
+void hal_gpio_config_output(uint64_t pin_mask) {}
+
+void hal_gpio_set_level(uint8_t gpio, uint32_t level) {
+  if (gpio < FAKE_HAL_GPIOS)
+    gpio_levels[gpio] = level != 0;
+}
+
+int hal_gpio_get_level(uint8_t gpio) {
+  return gpio < FAKE_HAL_GPIOS ? gpio_levels[gpio] : 0;
+}
+
+esp_err_t hal_pwm_init(uint8_t channel, uint8_t gpio, uint32_t freq_hz,
+                       uint8_t duty_resolution_bits) {
+  if (channel >= FAKE_HAL_PWM_CHANNELS)
+    return ESP_ERR_INVALID_ARG;
+  pwm_freq[channel] = freq_hz;
+  return ESP_OK;
+}
+
+void hal_pwm_set_duty(uint8_t channel, uint32_t duty) {
+  if (channel >= FAKE_HAL_PWM_CHANNELS)
+    return;
+  if (pwm_count < FAKE_HAL_PWM_EVENTS) {
+    pwm_events[pwm_count++] = (fake_pwm_event_t){
+        .time_us = now_us,
+        .channel = channel,
+        .duty = duty,
+        .freq_hz = pwm_freq[channel],
+    };
+  }
+}
+
+esp_err_t hal_pwm_set_freq(uint8_t channel, uint32_t freq_hz) {
+  if (channel >= FAKE_HAL_PWM_CHANNELS)
+    return ESP_ERR_INVALID_ARG;
+  pwm_freq[channel] = freq_hz;
+  freq_changes++;
+  return ESP_OK;
+}
+
+esp_err_t hal_timer_create(hal_timer_cb_t callback, void *arg,
+                           hal_timer_t *timer) {
+  for (size_t i = 0; i < FAKE_HAL_TIMERS; i++) {
+    if (!timers[i].created) {
+      timers[i] = (fake_timer_t){.created = true, .callback = callback,
+                                 .arg = arg};
+      *timer = &timers[i];
+      return ESP_OK;
+    }
+  }
+  return ESP_ERR_NO_MEM;
+}
+
+esp_err_t hal_timer_start_once(hal_timer_t timer, uint64_t timeout_us) {
+  fake_timer_t *t = timer;
+
+  if (t == NULL || !t->created)
+    return ESP_ERR_INVALID_ARG;
+  if (t->armed)
+    return ESP_ERR_INVALID_STATE;
+  t->armed = true;
+  t->deadline_us = now_us + timeout_us + latency_us;
+  return ESP_OK;
+}
+
+void hal_timer_stop(hal_timer_t timer) {
+  fake_timer_t *t = timer;
+  if (t != NULL)
+    t->armed = false;
+}
@@ -0,0 +1,51 @@
+/*******************************************************************************
+ * @file        fake_hal.h
+ * @brief       Sustituto de la capa de hardware para las pruebas en el
+ *              anfitrión: GPIO, PWM y temporizadores de un disparo sobre un
+ *              reloj virtual.
+ *
+ *              Cada cambio del PWM queda registrado con el instante virtual
+ *              en que ocurrió. Los temporizadores se comportan como esp_timer:
+ *              arrancar uno que ya corre falla con ESP_ERR_INVALID_STATE, y
+ *              sus callbacks corren al avanzar el reloj, con una latencia de
+ *              despacho opcional.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#ifndef FAKE_HAL_H
+#define FAKE_HAL_H
+
+#include "hal.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define FAKE_HAL_TIMERS 4
+#define FAKE_HAL_PWM_EVENTS 256
+
+typedef struct {
+  uint64_t time_us;
+  uint8_t channel;
+  uint32_t duty;
+  uint32_t freq_hz; // frecuencia del canal al aplicar el ciclo de trabajo
+} fake_pwm_event_t;
+
+// Volver el reloj a cero, borrar el registro y desarmar los temporizadores
+void fake_hal_reset(void);
+uint64_t fake_hal_now_us(void);
+// Avanzar el reloj ejecutando en orden los callbacks que venzan
+void fake_hal_advance_us(uint64_t us);
+// Temporizadores armados que aún no vencen
+size_t fake_hal_timers_armed(void);
+// Retraso entre el vencimiento y la ejecución de cada callback
+void fake_hal_set_timer_latency_us(uint64_t us);
+// Reprogramaciones de frecuencia desde el último reinicio
+unsigned fake_hal_freq_changes(void);
+
+// Cada llamada a hal_pwm_set_duty, aunque repita el valor anterior
+size_t fake_hal_pwm_count(void);
+const fake_pwm_event_t *fake_hal_pwm_event(size_t index);
+
+#endif // FAKE_HAL_H
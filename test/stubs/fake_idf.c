@@ -0,0 +1,202 @@
+/*******************************************************************************
+ * @file        fake_idf.c
+ * @brief       Sustitutos en RAM de la partición de flash y de NVS para las
+ *              pruebas en el anfitrión.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "fake_idf.h"
+#include "esp_err.h"
+#include "nvs.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#define FAKE_NVS_ENTRIES 32
+#define FAKE_NVS_KEY_SIZE 32
+#define FAKE_NVS_VALUE_SIZE 4096
+
+static esp_partition_t partition = {
+    .type = ESP_PARTITION_TYPE_DATA,
+    .erase_size = FAKE_FLASH_SECTOR_SIZE,
+    .label = "offline",
+};
+static uint8_t flash[FAKE_FLASH_MAX_SIZE];
+static unsigned erase_counts[FAKE_FLASH_MAX_SIZE / FAKE_FLASH_SECTOR_SIZE];
+static long cut_after = -1;
+
+typedef struct {
+  bool used;
+  char key[FAKE_NVS_KEY_SIZE]; // "<espacio>/<clave>"
+  uint8_t value[FAKE_NVS_VALUE_SIZE];
+  size_t len;
+} nvs_entry_t;
+
+static nvs_entry_t nvs_entries[FAKE_NVS_ENTRIES];
+static const char *nvs_namespaces[8];
+static size_t nvs_namespace_count = 0;
+
+const char *esp_err_to_name(esp_err_t code) {
+  return code == ESP_OK ? "ESP_OK" : "ERROR";
+}
+
+/* -------------------------------- Partición ------------------------------- */
+
+void fake_flash_reset(size_t size) {
+  partition.size = size;
+  memset(flash, 0xFF, sizeof(flash));
+  memset(erase_counts, 0, sizeof(erase_counts));
+  cut_after = -1;
+}
+
+uint8_t *fake_flash_data(void) { return flash; }
+
+void fake_flash_cut_after(long bytes) { cut_after = bytes; }
+
+unsigned fake_flash_erase_count(size_t offset) {
+  return erase_counts[offset / FAKE_FLASH_SECTOR_SIZE];
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type,
+                                                esp_partition_subtype_t subtype,
+                                                const char *label) {
+  if (partition.size == 0 || strcmp(label, partition.label) != 0)
+    return NULL;
+  return &partition;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *p, size_t offset,
+                             void *dst, size_t size) {
+  if (offset + size > p->size)
+    return ESP_ERR_INVALID_SIZE;
+  memcpy(dst, flash + offset, size);
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *p, size_t offset,
+                              const void *src, size_t size) {
+  const uint8_t *bytes = src;
+  if (offset + size > p->size)
+    return ESP_ERR_INVALID_SIZE;
+  for (size_t i = 0; i < size; i++) {
+    if (cut_after == 0)
+      return ESP_FAIL;
+    if (cut_after > 0)
+      cut_after--;
+    flash[offset + i] &= bytes[i];
+  }
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *p, size_t offset,
+                                    size_t size) {
+  if (offset % FAKE_FLASH_SECTOR_SIZE != 0 ||
+      size % FAKE_FLASH_SECTOR_SIZE != 0 || offset + size > p->size)
+    return ESP_ERR_INVALID_ARG;
+  if (cut_after == 0)
+    return ESP_FAIL;
+  memset(flash + offset, 0xFF, size);
+  for (size_t s = offset; s < offset + size; s += FAKE_FLASH_SECTOR_SIZE) {
+    erase_counts[s / FAKE_FLASH_SECTOR_SIZE]++;
+  }
+  return ESP_OK;
+}
+
+/* ----------------------------------- NVS ---------------------------------- */
+
+void fake_nvs_reset(void) { memset(nvs_entries, 0, sizeof(nvs_entries)); }
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t mode,
+                   nvs_handle_t *handle) {
+  for (size_t i = 0; i < nvs_namespace_count; i++) {
+    if (strcmp(nvs_namespaces[i], name) == 0) {
+      *handle = i;
+      return ESP_OK;
+    }
+  }
+  if (nvs_namespace_count == sizeof(nvs_namespaces) / sizeof(nvs_namespaces[0]))
+    return ESP_ERR_NO_MEM;
+  nvs_namespaces[nvs_namespace_count] = name;
+  *handle = nvs_namespace_count++;
+  return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle) {}
+
+esp_err_t nvs_commit(nvs_handle_t handle) { return ESP_OK; }
+
+static nvs_entry_t *nvs_find(nvs_handle_t handle, const char *key,
+                             bool create) {
+  char full[FAKE_NVS_KEY_SIZE];
+  nvs_entry_t *free_entry = NULL;
+
+  snprintf(full, sizeof(full), "%s/%s", nvs_namespaces[handle], key);
+  for (size_t i = 0; i < FAKE_NVS_ENTRIES; i++) {
+    if (nvs_entries[i].used && strcmp(nvs_entries[i].key, full) == 0)
+      return &nvs_entries[i];
+    if (!nvs_entries[i].used && free_entry == NULL)
+      free_entry = &nvs_entries[i];
+  }
+  if (!create || free_entry == NULL)
+    return NULL;
+  free_entry->used = true;
+  strcpy(free_entry->key, full);
+  return free_entry;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key) {
+  nvs_entry_t *entry = nvs_find(handle, key, false);
+  if (entry == NULL)
+    return ESP_ERR_NVS_NOT_FOUND;
+  entry->used = false;
+  return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *value,
+                       size_t *length) {
+  nvs_entry_t *entry = nvs_find(handle, key, false);
+  if (entry == NULL)
+    return ESP_ERR_NVS_NOT_FOUND;
+  if (value == NULL) {
+    *length = entry->len;
+    return ESP_OK;
+  }
+  if (*length < entry->len)
+    return ESP_ERR_NVS_INVALID_LENGTH;
+  memcpy(value, entry->value, entry->len);
+  *length = entry->len;
+  return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value,
+                       size_t length) {
+  if (length > FAKE_NVS_VALUE_SIZE)
+    return ESP_ERR_NVS_INVALID_LENGTH;
+  nvs_entry_t *entry = nvs_find(handle, key, true);
+  if (entry == NULL)
+    return ESP_ERR_NVS_NO_FREE_PAGES;
+  memcpy(entry->value, value, length);
+  entry->len = length;
+  return ESP_OK;
+}
+
+esp_err_t nvs_get_u8(nvs_handle_t handle, const char *key, uint8_t *value) {
+  size_t length = sizeof(*value);
+  return nvs_get_blob(handle, key, value, &length);
+}
+
+esp_err_t nvs_set_u8(nvs_handle_t handle, const char *key, uint8_t value) {
+  return nvs_set_blob(handle, key, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *value,
+                      size_t *length) {
+  return nvs_get_blob(handle, key, value, length);
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value) {
+  return nvs_set_blob(handle, key, value, strlen(value) + 1);
+}
@@ -0,0 +1,41 @@
+/*******************************************************************************
+ * @file        fake_idf.h
+ * @brief       Controles de los sustitutos de ESP-IDF para las pruebas en el
+ *              anfitrión.
+ *
+ *              La partición falsa se comporta como la flash NOR: borrar pone
+ *              sectores completos en 0xFF y escribir solo baja bits de 1 a 0.
+ *              Se puede cortar la energía tras una cantidad de bytes para
+ *              dejar un registro a medio escribir, y cuenta borrados por
+ *              sector para revisar el desgaste. NVS guarda en RAM y no se
+ *              limpia en los reinicios simulados, igual que la flash.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#ifndef FAKE_IDF_H
+#define FAKE_IDF_H
+
+#include "esp_partition.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define FAKE_FLASH_SECTOR_SIZE 4096
+#define FAKE_FLASH_MAX_SIZE (64 * 1024)
+
+// Crear la partición con ese tamaño (múltiplo del sector), toda borrada;
+// 0 hace que esp_partition_find_first no la encuentre
+void fake_flash_reset(size_t size);
+uint8_t *fake_flash_data(void);
+// Tras escribir esta cantidad de bytes las escrituras fallan sin efecto,
+// como si se cortara la energía; -1 desactiva el corte
+void fake_flash_cut_after(long bytes);
+// Borrados del sector que contiene ese desplazamiento
+unsigned fake_flash_erase_count(size_t offset);
+
+// Vaciar todo NVS
+void fake_nvs_reset(void);
+
+#endif // FAKE_IDF_H
@@ -0,0 +1,50 @@
+/*******************************************************************************
+ * @file        fake_publish.c
+ * @brief       Registro de mensajes publicados para las pruebas en el
+ *              anfitrión.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "fake_publish.h"
+#include <stdio.h>
+#include <string.h>
+
+static fake_publish_msg_t messages[FAKE_PUBLISH_MAX];
+static size_t count = 0; // mensajes publicados; se guardan los últimos
+static bool rejecting = false;
+
+void fake_publish_reset(void) {
+  count = 0;
+  rejecting = false;
+}
+
+void fake_publish_reject(bool reject) { rejecting = reject; }
+
+size_t fake_publish_count(void) { return count; }
+
+const fake_publish_msg_t *fake_publish_msg(size_t index) {
+  if (index >= count || count - index > FAKE_PUBLISH_MAX)
+    return NULL;
+  return &messages[index % FAKE_PUBLISH_MAX];
+}
+
+const fake_publish_msg_t *fake_publish_last(void) {
+  return count > 0 ? fake_publish_msg(count - 1) : NULL;
+}
+
+int publish_send(publish_stream_t stream, const char *topic, const char *data,
+                 size_t len) {
+  if (rejecting || len > FAKE_PUBLISH_SIZE)
+    return -1;
+
+  fake_publish_msg_t *msg = &messages[count % FAKE_PUBLISH_MAX];
+  msg->stream = stream;
+  snprintf(msg->topic, sizeof(msg->topic), "%s", topic);
+  memcpy(msg->data, data, len);
+  msg->data[len] = '\0';
+  msg->len = len;
+  return (int)++count;
+}
@@ -0,0 +1,36 @@
+/*******************************************************************************
+ * @file        fake_publish.h
+ * @brief       Sustituto de publish_utils para las pruebas en el anfitrión:
+ *              guarda cada mensaje publicado para revisarlo después, y puede
+ *              simular que la bandeja de salida rechaza los envíos.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#ifndef FAKE_PUBLISH_H
+#define FAKE_PUBLISH_H
+
+#include "publish_utils.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+#define FAKE_PUBLISH_MAX 64
+#define FAKE_PUBLISH_SIZE 2048
+
+typedef struct {
+  publish_stream_t stream;
+  char topic[PUBLISH_TOPIC_SIZE];
+  char data[FAKE_PUBLISH_SIZE + 1]; // terminado en '\0' para revisarlo
+  size_t len;
+} fake_publish_msg_t;
+
+void fake_publish_reset(void);
+// Con true publish_send retorna -1 sin guardar nada
+void fake_publish_reject(bool reject);
+size_t fake_publish_count(void);
+const fake_publish_msg_t *fake_publish_msg(size_t index);
+const fake_publish_msg_t *fake_publish_last(void);
+
+#endif // FAKE_PUBLISH_H
@@ -0,0 +1,33 @@
+/*******************************************************************************
+ * @file        semphr.h
+ * @brief       Sustituto de los mutex de FreeRTOS para las pruebas en el
+ *              anfitrión, que corren en un solo hilo: tomar siempre tiene
+ *              éxito.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#ifndef SEMPHR_H
+#define SEMPHR_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef int *SemaphoreHandle_t;
+
+static inline SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+  static int mutex;
+  return &mutex;
+}
+
+static inline BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex,
+                                        TickType_t ticks) {
+  return pdTRUE;
+}
+
+static inline BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex) {
+  return pdTRUE;
+}
+
+#endif // SEMPHR_H
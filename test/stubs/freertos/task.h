@@ -0,0 +1,19 @@
+/*******************************************************************************
+ * @file        task.h
+ * @brief       Sustituto de las tareas de FreeRTOS para las pruebas en el
+ *              anfitrión. vTaskDelay lo implementa el sustituto que modela
+ *              el tiempo de cada prueba.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#ifndef TASK_H
+#define TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+void vTaskDelay(TickType_t ticks);
+
+#endif // TASK_H
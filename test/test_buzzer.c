@@ -0,0 +1,216 @@
+/*******************************************************************************
+ * @file        test_buzzer.c
+ * @brief       Pruebas del secuenciador del buzzer sobre un reloj virtual: el
+ *              instante y la duración de cada paso de los patrones, las
+ *              frecuencias de la sirena, el cambio de patrón a mitad de un
+ *              paso y la latencia del despacho de los temporizadores.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "buzzer_pattern.h"
+#include "buzzer_utils.h"
+#include "fake_hal.h"
+#include "test_utils.h"
+
+#define MS 1000ULL
+
+typedef struct {
+  uint32_t freq_hz; // 0 en los silencios
+  uint32_t duration_ms;
+} expected_step_t;
+
+// Mismas tablas que buzzer_utils.c, vistas desde el PWM
+static const expected_step_t alarm[] = {
+    {BUZZER_FREQUENCY, 100}, {0, 100}, {BUZZER_FREQUENCY, 100},
+    {0, 100},                {BUZZER_FREQUENCY, 100}, {0, 600},
+};
+static const expected_step_t critical[] = {
+    {1500, 150}, {2000, 150}, {2500, 150}, {3000, 150}, {0, 100},
+};
+
+static void setup(void) {
+  fake_hal_reset();
+  CHECK_INT(buzzer_init(), ESP_OK);
+  buzzer_set_threshold(TEMP_THRESHOLD);
+}
+
+// Revisar los pasos registrados desde first contra la tabla, repetida
+// loops veces; retorna el índice siguiente
+static size_t check_steps(size_t first, uint64_t start_us,
+                          const expected_step_t *steps, size_t count,
+                          int loops) {
+  uint64_t t = start_us;
+  size_t index = first;
+
+  for (int loop = 0; loop < loops; loop++) {
+    for (size_t i = 0; i < count; i++, index++) {
+      const fake_pwm_event_t *event = fake_hal_pwm_event(index);
+      CHECK(event != NULL);
+      if (event == NULL)
+        return index;
+      CHECK_INT(event->channel, BUZZER_PWM_CHANNEL);
+      CHECK_INT(event->time_us, t);
+      CHECK_INT(event->duty, steps[i].freq_hz ? BUZZER_PWM_DUTY : 0);
+      if (steps[i].freq_hz != 0)
+        CHECK_INT(event->freq_hz, steps[i].freq_hz);
+      t += steps[i].duration_ms * MS;
+    }
+  }
+  return index;
+}
+
+static void test_alarm_timing(void) {
+  setup();
+  buzzer_play(BUZZER_PATTERN_ALARM);
+  fake_hal_advance_us(0);
+  // Tres vueltas completas y el inicio de la cuarta
+  fake_hal_advance_us(3 * 1100 * MS);
+
+  CHECK_INT(fake_hal_pwm_count(), 3 * 6 + 1);
+  size_t next = check_steps(0, 0, alarm, 6, 3);
+  CHECK_INT(fake_hal_pwm_event(next)->time_us, 3 * 1100 * MS);
+  CHECK_INT(fake_hal_pwm_event(next)->duty, BUZZER_PWM_DUTY);
+  // El tono no cambia: el temporizador LEDC no se reprograma
+  CHECK_INT(fake_hal_freq_changes(), 0);
+}
+
+// La sirena reprograma la frecuencia en cada tono, pero no en el silencio ni
+// al volver a un tono que ya estaba configurado
+static void test_critical_siren(void) {
+  setup();
+  buzzer_play(BUZZER_PATTERN_CRITICAL);
+  fake_hal_advance_us(2 * 700 * MS - 1);
+
+  CHECK_INT(fake_hal_pwm_count(), 2 * 5);
+  check_steps(0, 0, critical, 5, 2);
+  CHECK_INT(fake_hal_freq_changes(), 2 * 4);
+
+  buzzer_play(BUZZER_PATTERN_CONTINUOUS);
+  fake_hal_advance_us(0);
+  CHECK_INT(fake_hal_freq_changes(), 2 * 4 + 1);
+  CHECK_INT(fake_hal_pwm_event(10)->freq_hz, BUZZER_FREQUENCY);
+}
+
+// Un patrón nuevo empieza en el momento en que se pide, no al terminar el
+// paso en curso del anterior
+static void test_switch_mid_step(void) {
+  setup();
+  buzzer_play(BUZZER_PATTERN_WARNING);
+  fake_hal_advance_us(500 * MS); // dentro del silencio de 1800 ms
+  CHECK_INT(fake_hal_pwm_count(), 2);
+
+  buzzer_play(BUZZER_PATTERN_ALARM);
+  fake_hal_advance_us(1100 * MS);
+  check_steps(2, 500 * MS, alarm, 6, 1);
+  CHECK_INT(buzzer_get_pattern(), BUZZER_PATTERN_ALARM);
+
+  // Pedir dos veces el mismo patrón automático no lo reinicia
+  buzzer_update_auto(BUZZER_PATTERN_ALARM);
+  size_t count = fake_hal_pwm_count();
+  fake_hal_advance_us(50 * MS);
+  CHECK_INT(fake_hal_pwm_count(), count);
+}
+
+// El tono fijo no usa el temporizador y apagar silencia de inmediato
+static void test_continuous_and_off(void) {
+  setup();
+  buzzer_set(true, false);
+  fake_hal_advance_us(0);
+  CHECK_INT(fake_hal_pwm_count(), 1);
+  CHECK_INT(fake_hal_pwm_event(0)->duty, BUZZER_PWM_DUTY);
+  CHECK_INT(fake_hal_timers_armed(), 0);
+  CHECK(buzzer_get_state());
+
+  fake_hal_advance_us(60000 * MS);
+  CHECK_INT(fake_hal_pwm_count(), 1);
+
+  buzzer_play(BUZZER_PATTERN_ALARM);
+  fake_hal_advance_us(150 * MS);
+  buzzer_set(false, false);
+  fake_hal_advance_us(0);
+  const fake_pwm_event_t *last = fake_hal_pwm_event(fake_hal_pwm_count() - 1);
+  CHECK_INT(last->time_us, 60150 * MS);
+  CHECK_INT(last->duty, 0);
+  CHECK_INT(fake_hal_timers_armed(), 0);
+  CHECK(!buzzer_get_state());
+}
+
+// Con el callback despachado tarde, cada paso dura su tiempo más a lo sumo
+// esa latencia: ningún paso se acorta
+static void test_dispatch_latency(void) {
+  const uint64_t latency_us = 350;
+
+  setup();
+  fake_hal_set_timer_latency_us(latency_us);
+  buzzer_play(BUZZER_PATTERN_CRITICAL);
+  fake_hal_advance_us(5 * 700 * MS);
+
+  size_t count = fake_hal_pwm_count();
+  CHECK(count >= 4 * 5);
+  for (size_t i = 1; i < count; i++) {
+    uint64_t length = fake_hal_pwm_event(i)->time_us -
+                      fake_hal_pwm_event(i - 1)->time_us;
+    uint64_t nominal = critical[(i - 1) % 5].duration_ms * MS;
+    CHECK(length >= nominal && length <= nominal + latency_us);
+  }
+}
+
+// El modo manual ignora los patrones de las reglas hasta cambiar el umbral
+static void test_manual_mode(void) {
+  setup();
+  buzzer_set(true, true);
+  fake_hal_advance_us(0);
+  CHECK(buzzer_is_manual_mode());
+
+  buzzer_update_auto(BUZZER_PATTERN_CRITICAL);
+  fake_hal_advance_us(1000 * MS);
+  CHECK_INT(buzzer_get_pattern(), BUZZER_PATTERN_CONTINUOUS);
+  CHECK_INT(fake_hal_pwm_count(), 1);
+
+  buzzer_set_threshold(28.0f);
+  CHECK(!buzzer_is_manual_mode());
+  buzzer_update_auto(BUZZER_PATTERN_CRITICAL);
+  fake_hal_advance_us(0);
+  CHECK_INT(buzzer_get_pattern(), BUZZER_PATTERN_CRITICAL);
+  CHECK_INT(fake_hal_pwm_event(1)->freq_hz, 1500);
+}
+
+// El secuenciador solo: repeticiones finitas, infinitas y patrón vacío
+static void test_player(void) {
+  static const buzzer_step_t steps[] = {{2000, 512, 100}, {0, 0, 100}};
+  buzzer_pattern_t pattern = {steps, 2, 3};
+  buzzer_player_t player;
+  int played = 0, total_ms = 0;
+
+  for (const buzzer_step_t *step = buzzer_player_start(&player, &pattern);
+       step != NULL; step = buzzer_player_next(&player)) {
+    total_ms += step->duration_ms;
+    played++;
+  }
+  CHECK_INT(played, 6);
+  CHECK_INT(total_ms, 600);
+  CHECK(buzzer_player_next(&player) == NULL);
+
+  pattern.repeat = 0;
+  const buzzer_step_t *step = buzzer_player_start(&player, &pattern);
+  for (int i = 0; i < 1000 && step != NULL; i++)
+    step = buzzer_player_next(&player);
+  CHECK(step != NULL);
+
+  CHECK(buzzer_player_start(&player, &(buzzer_pattern_t){NULL, 0, 1}) == NULL);
+  CHECK(buzzer_player_start(&player, NULL) == NULL);
+}
+
+int main(void) {
+  RUN_TEST(test_alarm_timing);
+  RUN_TEST(test_critical_siren);
+  RUN_TEST(test_switch_mid_step);
+  RUN_TEST(test_continuous_and_off);
+  RUN_TEST(test_dispatch_latency);
+  RUN_TEST(test_manual_mode);
+  RUN_TEST(test_player);
+  return TEST_EXIT();
+}
@@ -0,0 +1,262 @@
+/*******************************************************************************
+ * @file        test_conn.c
+ * @brief       Simulación del gestor de conectividad con reloj virtual: caída
+ *              del punto de acceso, corredor caído con la red bien, vuelta a
+ *              la espera inicial tras un rato estable, señal débil, asociación
+ *              sin IP y pérdida de la IP sin perder el enlace. Cada espera se
+ *              revisa contra la exponencial y su variación aleatoria.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "conn_utils.h"
+#include "test_utils.h"
+
+static conn_t conn;
+static int64_t now_ms;
+
+static conn_action_t event(conn_event_t event, conn_reason_t reason) {
+  return conn_event(&conn, event, reason, now_ms);
+}
+
+// Avanzar el reloj hasta el próximo plazo y revisarlo, como hace la HAL
+static conn_action_t next_deadline(void) {
+  int64_t wait = conn_wait_ms(&conn, now_ms);
+  CHECK(wait >= 0);
+  if (wait > 0)
+    now_ms += wait;
+  return conn_poll(&conn, now_ms);
+}
+
+// La última espera está dentro de la variación de la exponencial que
+// corresponde a los fallos seguidos
+static bool backoff_ok(void) {
+  uint32_t nominal = CONN_BACKOFF_BASE_MS;
+  for (int i = 1; i < conn.attempts && nominal < CONN_BACKOFF_MAX_MS; i++)
+    nominal *= 2;
+  if (nominal > CONN_BACKOFF_MAX_MS)
+    nominal = CONN_BACKOFF_MAX_MS;
+  uint32_t spread = nominal / 100 * CONN_BACKOFF_JITTER_PCT;
+  return conn.state == CONN_STATE_BACKOFF &&
+         conn.backoff_ms >= nominal - spread &&
+         conn.backoff_ms <= nominal + spread;
+}
+
+// Arranque normal: asociación, IP y corredor
+static void start_online(uint32_t seed) {
+  conn_init(&conn, seed);
+  now_ms = 0;
+  CHECK_INT(event(CONN_EVENT_WIFI_UP, CONN_REASON_NONE), CONN_ACTION_NONE);
+  CHECK_INT(conn.state, CONN_STATE_IP_WAITING);
+  now_ms += 500;
+  CHECK_INT(event(CONN_EVENT_IP_UP, CONN_REASON_NONE),
+            CONN_ACTION_MQTT_CONNECT);
+  now_ms += 300;
+  event(CONN_EVENT_MQTT_UP, CONN_REASON_NONE);
+  CHECK_INT(conn.state, CONN_STATE_ONLINE);
+}
+
+// Cada fallo duplica la espera hasta el máximo, con la variación de
+// CONN_BACKOFF_JITTER_PCT; semillas distintas no reintentan a la vez
+static void test_backoff_growth(void) {
+  uint32_t first[2];
+
+  for (int run = 0; run < 2; run++) {
+    start_online(run + 1);
+    for (int i = 0; i < 10; i++) {
+      event(CONN_EVENT_MQTT_DOWN, CONN_REASON_MQTT_REFUSED);
+      CHECK(backoff_ok());
+      CHECK_INT(conn.capped, conn.backoff_ms >= CONN_BACKOFF_MAX_MS -
+                                 CONN_BACKOFF_MAX_MS / 100 *
+                                     CONN_BACKOFF_JITTER_PCT);
+      if (i == 0)
+        first[run] = conn.backoff_ms;
+      CHECK_INT(next_deadline(), CONN_ACTION_MQTT_CONNECT);
+    }
+    CHECK(conn.capped);
+    CHECK_INT(conn.reasons[CONN_REASON_MQTT_REFUSED], 10);
+  }
+  CHECK(first[0] != first[1]);
+}
+
+// El punto de acceso desaparece cinco minutos: la caída del corredor que
+// sigue no se cuenta aparte, los intentos se espacian y la recuperación se
+// mide desde que se perdió el enlace
+static void test_ap_outage(void) {
+  start_online(12345);
+  now_ms += 100000;
+  int64_t down_ms = now_ms;
+  event(CONN_EVENT_WIFI_DOWN, CONN_REASON_WIFI_BEACON_LOSS);
+  CHECK(backoff_ok());
+  CHECK_INT(event(CONN_EVENT_MQTT_DOWN, CONN_REASON_MQTT_TRANSPORT),
+            CONN_ACTION_NONE);
+  CHECK_INT(conn.reasons[CONN_REASON_MQTT_TRANSPORT], 0);
+
+  int tries = 0;
+  while (now_ms - down_ms < 300000) {
+    CHECK_INT(next_deadline(), CONN_ACTION_WIFI_CONNECT);
+    tries++;
+    now_ms += 3000; // el escaneo no encuentra el punto de acceso
+    event(CONN_EVENT_WIFI_DOWN, CONN_REASON_WIFI_NO_AP);
+    CHECK(backoff_ok());
+  }
+  // 1 + 2 + 4 + ... + 64 s y luego 120 s; con reintento fijo serían cientos
+  CHECK(tries >= 7 && tries <= 10);
+  CHECK_INT(conn.reasons[CONN_REASON_WIFI_NO_AP], tries);
+  CHECK_INT(conn.reasons[CONN_REASON_WIFI_BEACON_LOSS], 1);
+
+  CHECK_INT(next_deadline(), CONN_ACTION_WIFI_CONNECT);
+  now_ms += 1000;
+  event(CONN_EVENT_WIFI_UP, CONN_REASON_NONE);
+  now_ms += 200;
+  CHECK_INT(event(CONN_EVENT_IP_UP, CONN_REASON_NONE),
+            CONN_ACTION_MQTT_CONNECT);
+  CHECK_INT(conn.attempts, 0);
+  event(CONN_EVENT_MQTT_UP, CONN_REASON_NONE);
+  CHECK_INT(conn.outages, 1);
+  CHECK_INT(conn.last_recovery_ms, now_ms - down_ms);
+}
+
+// Con la red bien, el corredor caído solo reintenta MQTT. Una caída poco
+// después de reconectar sigue la espera que llevaba
+static void test_broker_outage(void) {
+  start_online(7);
+  now_ms += 10000;
+  event(CONN_EVENT_MQTT_DOWN, CONN_REASON_MQTT_TRANSPORT);
+  CHECK(backoff_ok());
+  for (int i = 0; i < 3; i++) {
+    CHECK_INT(next_deadline(), CONN_ACTION_MQTT_CONNECT);
+    CHECK_INT(conn.state, CONN_STATE_MQTT_CONNECTING);
+    now_ms += 50;
+    event(CONN_EVENT_MQTT_DOWN, CONN_REASON_MQTT_REFUSED);
+    CHECK(backoff_ok());
+  }
+  CHECK_INT(conn.attempts, 4);
+  CHECK_INT(conn.reasons[CONN_REASON_MQTT_REFUSED], 3);
+  CHECK_INT(next_deadline(), CONN_ACTION_MQTT_CONNECT);
+  event(CONN_EVENT_MQTT_UP, CONN_REASON_NONE);
+  CHECK_INT(conn.outages, 0); // la red nunca se fue
+  CHECK_INT(conn_wait_ms(&conn, now_ms), -1);
+
+  now_ms += 10000;
+  event(CONN_EVENT_MQTT_DOWN, CONN_REASON_MQTT_TRANSPORT);
+  CHECK_INT(conn.attempts, 5);
+  CHECK(backoff_ok());
+}
+
+// Tras CONN_STABLE_MS en línea, la caída vuelve a la espera inicial
+static void test_stable_resets_backoff(void) {
+  start_online(99);
+  for (int i = 0; i < 5; i++) {
+    event(CONN_EVENT_MQTT_DOWN, CONN_REASON_MQTT_TRANSPORT);
+    CHECK_INT(next_deadline(), CONN_ACTION_MQTT_CONNECT);
+  }
+  event(CONN_EVENT_MQTT_UP, CONN_REASON_NONE);
+  now_ms += CONN_STABLE_MS;
+  event(CONN_EVENT_MQTT_DOWN, CONN_REASON_MQTT_TRANSPORT);
+  CHECK_INT(conn.attempts, 1);
+  CHECK(backoff_ok());
+}
+
+// Con señal débil los intentos MQTT se posponen hasta que la espera llega
+// al máximo; después se intenta igual
+static void test_weak_signal(void) {
+  start_online(4242);
+  now_ms += CONN_STABLE_MS;
+  conn_set_rssi(&conn, CONN_RSSI_MIN - 5);
+  event(CONN_EVENT_MQTT_DOWN, CONN_REASON_MQTT_TRANSPORT);
+
+  int postponed = 0;
+  conn_action_t action;
+  while ((action = next_deadline()) == CONN_ACTION_NONE && postponed < 20) {
+    postponed++;
+    CHECK(backoff_ok());
+  }
+  CHECK_INT(action, CONN_ACTION_MQTT_CONNECT);
+  CHECK(conn.capped);
+  CHECK(postponed > 0);
+  CHECK_INT(conn.reasons[CONN_REASON_WEAK_SIGNAL], postponed);
+  event(CONN_EVENT_MQTT_UP, CONN_REASON_NONE);
+  CHECK(!conn.capped);
+
+  // Con buena señal el intento ya no se pospone
+  conn_set_rssi(&conn, -60);
+  now_ms += CONN_STABLE_MS;
+  event(CONN_EVENT_MQTT_DOWN, CONN_REASON_MQTT_TRANSPORT);
+  CHECK_INT(next_deadline(), CONN_ACTION_MQTT_CONNECT);
+}
+
+// Asociado sin IP: pasado CONN_IP_TIMEOUT_MS se fuerza una nueva
+// asociación, y la desasociación propia no se cuenta como caída
+static void test_no_ip_reassociates(void) {
+  start_online(5);
+  now_ms += CONN_STABLE_MS;
+  event(CONN_EVENT_WIFI_DOWN, CONN_REASON_WIFI_AUTH);
+  CHECK_INT(next_deadline(), CONN_ACTION_WIFI_CONNECT);
+  event(CONN_EVENT_WIFI_UP, CONN_REASON_NONE);
+
+  int64_t associated_ms = now_ms;
+  CHECK_INT(next_deadline(), CONN_ACTION_WIFI_DISCONNECT);
+  CHECK_INT(now_ms - associated_ms, CONN_IP_TIMEOUT_MS);
+  CHECK_INT(conn.reasons[CONN_REASON_IP_TIMEOUT], 1);
+  CHECK(backoff_ok());
+
+  event(CONN_EVENT_WIFI_DOWN, CONN_REASON_WIFI_OTHER);
+  CHECK_INT(conn.reasons[CONN_REASON_WIFI_OTHER], 0);
+  CHECK_INT(next_deadline(), CONN_ACTION_WIFI_CONNECT);
+  event(CONN_EVENT_WIFI_UP, CONN_REASON_NONE);
+  CHECK_INT(event(CONN_EVENT_IP_UP, CONN_REASON_NONE),
+            CONN_ACTION_MQTT_CONNECT);
+  event(CONN_EVENT_MQTT_UP, CONN_REASON_NONE);
+  CHECK_INT(conn.outages, 1);
+}
+
+// La IP se pierde sin perder el enlace: se espera a que vuelva sin
+// reasociar, y el corredor que cae mientras tanto no programa reintentos
+static void test_ip_lost(void) {
+  start_online(11);
+  now_ms += 1000;
+  event(CONN_EVENT_IP_LOST, CONN_REASON_NONE);
+  CHECK_INT(conn.state, CONN_STATE_IP_WAITING);
+  event(CONN_EVENT_MQTT_DOWN, CONN_REASON_MQTT_TRANSPORT);
+  CHECK_INT(conn.state, CONN_STATE_IP_WAITING);
+  CHECK_INT(conn.reasons[CONN_REASON_MQTT_TRANSPORT], 0);
+
+  now_ms += 2000;
+  CHECK_INT(conn_poll(&conn, now_ms), CONN_ACTION_NONE);
+  CHECK_INT(event(CONN_EVENT_IP_UP, CONN_REASON_NONE),
+            CONN_ACTION_MQTT_CONNECT);
+  event(CONN_EVENT_MQTT_UP, CONN_REASON_NONE);
+  CHECK_INT(conn.reasons[CONN_REASON_IP_LOST], 1);
+  CHECK_INT(conn.outages, 1);
+  CHECK_INT(conn.last_recovery_ms, 2000);
+}
+
+static void test_format(void) {
+  char buf[512];
+
+  start_online(3);
+  event(CONN_EVENT_MQTT_DOWN, CONN_REASON_MQTT_REFUSED);
+  int len = conn_format(&conn, now_ms, buf, sizeof(buf));
+  CHECK(len > 0);
+  CHECK_INT(len, strlen(buf));
+  CHECK(strncmp(buf, "{\"state\":\"backoff\",", 19) == 0);
+  CHECK(strstr(buf, "\"mqtt_refused\":1") != NULL);
+  CHECK(strcmp(buf + len - 2, "}}") == 0);
+  // Sin espacio no deja JSON a medias
+  CHECK_INT(conn_format(&conn, now_ms, buf, 40), 0);
+}
+
+int main(void) {
+  RUN_TEST(test_backoff_growth);
+  RUN_TEST(test_ap_outage);
+  RUN_TEST(test_broker_outage);
+  RUN_TEST(test_stable_resets_backoff);
+  RUN_TEST(test_weak_signal);
+  RUN_TEST(test_no_ip_reassociates);
+  RUN_TEST(test_ip_lost);
+  RUN_TEST(test_format);
+  return TEST_EXIT();
+}
@@ -0,0 +1,164 @@
+/*******************************************************************************
+ * @file        test_dht11_decode.c
+ * @brief       Pruebas del decodificador DHT con trazas de pulsos como las
+ *              que entrega la captura RMT: tramas DHT11 y DHT22, capturas
+ *              con ruido antes y después de la trama, bits faltantes y
+ *              sumas de verificación corruptas.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "dht11_decode.h"
+#include "test_utils.h"
+#include <math.h>
+#include <stdbool.h>
+
+#define TRACE_MAX (2 * DHT_FRAME_BITS + 16)
+
+typedef struct {
+  dht_pulse_t pulses[TRACE_MAX];
+  size_t count;
+} trace_t;
+
+static void trace_add(trace_t *trace, uint8_t level, uint16_t duration_us) {
+  trace->pulses[trace->count++] = (dht_pulse_t){level, duration_us};
+}
+
+// Trama tal como la graba el RMT: liberación de la línea, respuesta de
+// 80/80 us y 40 bits de 50 us en bajo seguidos del pulso en alto. Los anchos
+// varían unos microsegundos como en una captura real.
+static void trace_frame(trace_t *trace, const uint8_t data[DHT_FRAME_BYTES]) {
+  static const int8_t jitter[] = {0, 2, -3, 1, 4, -2, -1, 3};
+
+  trace_add(trace, 1, 32);
+  trace_add(trace, 0, 82);
+  trace_add(trace, 1, 78);
+  for (int i = 0; i < DHT_FRAME_BITS; i++) {
+    bool one = (data[i / 8] >> (7 - i % 8)) & 1;
+    int8_t j = jitter[i % sizeof(jitter)];
+    trace_add(trace, 0, 50 + j);
+    trace_add(trace, 1, (one ? 70 : 26) + j);
+  }
+  trace_add(trace, 0, 54);
+}
+
+static void frame_with_checksum(uint8_t data[DHT_FRAME_BYTES], uint8_t b0,
+                                uint8_t b1, uint8_t b2, uint8_t b3) {
+  data[0] = b0;
+  data[1] = b1;
+  data[2] = b2;
+  data[3] = b3;
+  data[4] = b0 + b1 + b2 + b3;
+}
+
+static void test_dht11_frame(void) {
+  uint8_t sent[DHT_FRAME_BYTES], data[DHT_FRAME_BYTES];
+  trace_t trace = {0};
+  float humidity, temperature;
+
+  frame_with_checksum(sent, 55, 0, 24, 3);
+  trace_frame(&trace, sent);
+  CHECK_INT(dht_decode_pulses(trace.pulses, trace.count, data), DHT_DECODE_OK);
+  CHECK(memcmp(data, sent, sizeof(sent)) == 0);
+
+  dht_decode_values(DHT_TYPE_DHT11, data, &humidity, &temperature);
+  CHECK(fabsf(humidity - 55.0f) < 0.01f);
+  CHECK(fabsf(temperature - 24.3f) < 0.01f);
+}
+
+static void test_dht11_negative(void) {
+  uint8_t sent[DHT_FRAME_BYTES], data[DHT_FRAME_BYTES];
+  trace_t trace = {0};
+  float humidity, temperature;
+
+  // El bit alto del decimal marca la temperatura bajo cero
+  frame_with_checksum(sent, 40, 0, 2, 0x80 | 5);
+  trace_frame(&trace, sent);
+  CHECK_INT(dht_decode_pulses(trace.pulses, trace.count, data), DHT_DECODE_OK);
+  dht_decode_values(DHT_TYPE_DHT11, data, &humidity, &temperature);
+  CHECK(fabsf(temperature + 2.5f) < 0.01f);
+}
+
+static void test_dht22_frame(void) {
+  uint8_t sent[DHT_FRAME_BYTES], data[DHT_FRAME_BYTES];
+  trace_t trace = {0};
+  float humidity, temperature;
+
+  // 65.2 % y -10.1 °C en décimas de 16 bits con signo en el bit alto
+  frame_with_checksum(sent, 652 >> 8, 652 & 0xFF, 0x80 | (101 >> 8),
+                      101 & 0xFF);
+  trace_frame(&trace, sent);
+  CHECK_INT(dht_decode_pulses(trace.pulses, trace.count, data), DHT_DECODE_OK);
+  dht_decode_values(DHT_TYPE_DHT22, data, &humidity, &temperature);
+  CHECK(fabsf(humidity - 65.2f) < 0.01f);
+  CHECK(fabsf(temperature + 10.1f) < 0.01f);
+}
+
+// Pulsos espurios antes de la trama y la línea en reposo al final no
+// desplazan los bits: se toman los últimos 40 pulsos en alto válidos
+static void test_noise_around_frame(void) {
+  uint8_t sent[DHT_FRAME_BYTES], data[DHT_FRAME_BYTES];
+  trace_t trace = {0};
+
+  frame_with_checksum(sent, 71, 0, 19, 9);
+  trace_add(&trace, 1, 12);
+  trace_add(&trace, 0, 5);
+  trace_add(&trace, 1, 40);
+  trace_frame(&trace, sent);
+  trace_add(&trace, 1, 0);     // símbolo de cierre del RMT
+  trace_add(&trace, 1, 32000); // reposo, más largo que cualquier bit
+  CHECK_INT(dht_decode_pulses(trace.pulses, trace.count, data), DHT_DECODE_OK);
+  CHECK(memcmp(data, sent, sizeof(sent)) == 0);
+}
+
+// Una captura cortada por el final del búfer del RMT pierde bits
+static void test_short_frame(void) {
+  uint8_t sent[DHT_FRAME_BYTES], data[DHT_FRAME_BYTES];
+  trace_t trace = {0};
+
+  frame_with_checksum(sent, 55, 0, 24, 0);
+  trace_frame(&trace, sent);
+  // Quitar la respuesta del sensor y los primeros bits
+  CHECK_INT(dht_decode_pulses(trace.pulses + 13, trace.count - 13, data),
+            DHT_DECODE_ERR_SHORT);
+  CHECK_INT(dht_decode_pulses(trace.pulses, 0, data), DHT_DECODE_ERR_SHORT);
+}
+
+static void test_bad_checksum(void) {
+  uint8_t sent[DHT_FRAME_BYTES], data[DHT_FRAME_BYTES];
+  trace_t trace = {0};
+
+  frame_with_checksum(sent, 55, 0, 24, 0);
+  sent[4] ^= 0x01;
+  trace_frame(&trace, sent);
+  CHECK_INT(dht_decode_pulses(trace.pulses, trace.count, data),
+            DHT_DECODE_ERR_CHECKSUM);
+}
+
+// Un bit 0 estirado por ruido hasta el umbral se lee como 1 y la suma de
+// verificación lo detecta
+static void test_corrupted_bit(void) {
+  uint8_t sent[DHT_FRAME_BYTES], data[DHT_FRAME_BYTES];
+  trace_t trace = {0};
+
+  frame_with_checksum(sent, 55, 0, 24, 0);
+  trace_frame(&trace, sent);
+  // Primer bit de la humedad (0): pulso en alto en el índice 4
+  CHECK_INT(trace.pulses[4].level, 1);
+  trace.pulses[4].duration_us = DHT_BIT_THRESHOLD_US + 5;
+  CHECK_INT(dht_decode_pulses(trace.pulses, trace.count, data),
+            DHT_DECODE_ERR_CHECKSUM);
+}
+
+int main(void) {
+  RUN_TEST(test_dht11_frame);
+  RUN_TEST(test_dht11_negative);
+  RUN_TEST(test_dht22_frame);
+  RUN_TEST(test_noise_around_frame);
+  RUN_TEST(test_short_frame);
+  RUN_TEST(test_bad_checksum);
+  RUN_TEST(test_corrupted_bit);
+  return TEST_EXIT();
+}
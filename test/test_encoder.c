@@ -0,0 +1,166 @@
+/*******************************************************************************
+ * @file        test_encoder.c
+ * @brief       Pruebas de los codificadores de telemetría: el texto JSON y
+ *              los bytes CBOR de muestras conocidas, lotes con marca de
+ *              tiempo y lotes que no caben en el búfer.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "encoder_utils.h"
+#include "test_utils.h"
+
+#define TS_MS 1756512000000LL // 30/8/2025
+
+static telemetry_sample_t sample_full(void) {
+  return (telemetry_sample_t){
+      .keys = (1 << TELEMETRY_KEY_AUX_FIRST) - 1,
+      .temperature = 24.3f,
+      .humidity = 55.0f,
+      .temp_threshold = 30.0f,
+      .buzzer = true,
+      .buzzer_manual = false,
+      .automatic_mode = true,
+      .leds = 0x05,
+  };
+}
+
+static void test_json_single(void) {
+  telemetry_sample_t sample = sample_full();
+  char buf[256];
+
+  size_t len = encoder_single(&telemetry_encoder_json, (uint8_t *)buf,
+                              sizeof(buf), &sample);
+  CHECK(len > 0);
+  buf[len] = 0;
+  CHECK_STR(buf, "{\"temperature\":24.3,\"humidity\":55.0,\"buzzer\":true,"
+                 "\"buzzer_mode\":\"auto\",\"temp_threshold\":30.0,"
+                 "\"mode\":\"automatic\",\"led1\":1,\"led2\":0,\"led3\":1}");
+}
+
+// Solo van las claves de la máscara; los negativos sin el formateo de
+// flotantes de newlib
+static void test_json_batch(void) {
+  telemetry_sample_t a = {
+      .keys = (1 << TELEMETRY_KEY_TEMPERATURE),
+      .temperature = -2.5f,
+  };
+  telemetry_sample_t b = {
+      .keys = (1 << TELEMETRY_KEY_HUMIDITY) | TELEMETRY_KEYS_AUX(0),
+      .humidity = 40.04f,
+      .aux_temperature = {-0.06f},
+      .aux_humidity = {99.96f},
+  };
+  telemetry_batch_t batch;
+  char buf[256];
+
+  batch = (telemetry_batch_t){.encoder = &telemetry_encoder_json};
+  batch.buf = (uint8_t *)buf;
+  batch.size = sizeof(buf);
+  batch.len = telemetry_encoder_json.begin(batch.buf, batch.size);
+  CHECK(encoder_batch_add(&batch, &a, TS_MS));
+  CHECK(encoder_batch_add(&batch, &b, TS_MS + 5000));
+  size_t len = encoder_batch_end(&batch);
+  CHECK(len > 0);
+  buf[len] = 0;
+  CHECK_STR(buf, "[{\"ts\":1756512000000,\"values\":{\"temperature\":-2.5}},"
+                 "{\"ts\":1756512005000,\"values\":{\"humidity\":40.0,"
+                 "\"temperature2\":-0.1,\"humidity2\":100.0}}]");
+}
+
+static void test_cbor_single(void) {
+  telemetry_sample_t sample = {
+      .keys = (1 << TELEMETRY_KEY_TEMPERATURE) | (1 << TELEMETRY_KEY_HUMIDITY) |
+              (1 << TELEMETRY_KEY_BUZZER),
+      .temperature = 21.5f,
+      .humidity = 55.0f,
+      .buzzer = true,
+  };
+  // Mapa de 3 pares: 0 => 215, 1 => 550, 2 => true
+  static const uint8_t expected[] = {0xA3, 0x00, 0x18, 0xD7, 0x01,
+                                     0x19, 0x02, 0x26, 0x02, 0xF5};
+  uint8_t buf[64];
+
+  size_t len = encoder_single(&telemetry_encoder_cbor, buf, sizeof(buf),
+                              &sample);
+  CHECK_INT(len, sizeof(expected));
+  CHECK(memcmp(buf, expected, sizeof(expected)) == 0);
+}
+
+static void test_cbor_batch(void) {
+  telemetry_sample_t sample = {
+      .keys = (1 << TELEMETRY_KEY_TEMPERATURE),
+      .temperature = -10.1f,
+  };
+  // Arreglo indefinido con un mapa de 2 pares: -1 => ts en 64 bits y
+  // 0 => -101, y el cierre
+  static const uint8_t expected[] = {
+      0x9F, 0xA2, 0x20, 0x1B, 0x00, 0x00, 0x01, 0x98, 0xF8,
+      0x46, 0x18, 0x00, 0x00, 0x38, 0x64, 0xFF,
+  };
+  telemetry_batch_t batch = {.encoder = &telemetry_encoder_cbor};
+  uint8_t buf[64];
+
+  batch.buf = buf;
+  batch.size = sizeof(buf);
+  batch.len = telemetry_encoder_cbor.begin(buf, sizeof(buf));
+  CHECK(encoder_batch_add(&batch, &sample, TS_MS));
+  CHECK_INT(encoder_batch_end(&batch), sizeof(expected));
+  CHECK(memcmp(buf, expected, sizeof(expected)) == 0);
+}
+
+// La muestra que no cabe se rechaza y el lote sigue cerrando bien
+static void test_batch_full(void) {
+  telemetry_sample_t sample = sample_full();
+  telemetry_batch_t batch = {.encoder = &telemetry_encoder_json};
+  char buf[300];
+  int added = 0;
+
+  batch.buf = (uint8_t *)buf;
+  batch.size = sizeof(buf);
+  batch.len = telemetry_encoder_json.begin(batch.buf, batch.size);
+  while (added < 10 && encoder_batch_add(&batch, &sample, TS_MS))
+    added++;
+  CHECK_INT(added, 1);
+  size_t len = encoder_batch_end(&batch);
+  CHECK(len > 0 && len < sizeof(buf));
+  CHECK_INT(buf[len - 1], ']');
+
+  // Un lote vacío no produce mensaje
+  batch.len = telemetry_encoder_json.begin(batch.buf, batch.size);
+  batch.count = 0;
+  CHECK_INT(encoder_batch_end(&batch), 0);
+}
+
+// El nombre se valida sin tocar el codificador activo; el cambio llega
+// después desde la tarea que publica
+static void test_find_and_set(void) {
+  const telemetry_encoder_t *initial = encoder_get();
+
+  CHECK(encoder_find("cbor", 4) == &telemetry_encoder_cbor);
+  CHECK(encoder_find("json", 4) == &telemetry_encoder_json);
+  CHECK(encoder_find("cbo", 3) == NULL);
+  CHECK(encoder_find("cbor2", 5) == NULL);
+  CHECK(encoder_find("", 0) == NULL);
+  // Sin GATEWAY_MODE el lote por dispositivo no se ofrece
+  CHECK(encoder_find("gateway", 7) == NULL);
+  CHECK(encoder_get() == initial);
+
+  encoder_set(&telemetry_encoder_cbor);
+  CHECK(encoder_get() == &telemetry_encoder_cbor);
+  encoder_set(NULL);
+  CHECK(encoder_get() == &telemetry_encoder_cbor);
+  encoder_set(initial);
+}
+
+int main(void) {
+  RUN_TEST(test_json_single);
+  RUN_TEST(test_json_batch);
+  RUN_TEST(test_cbor_single);
+  RUN_TEST(test_cbor_batch);
+  RUN_TEST(test_batch_full);
+  RUN_TEST(test_find_and_set);
+  return TEST_EXIT();
+}
@@ -0,0 +1,176 @@
+/*******************************************************************************
+ * @file        test_gateway.c
+ * @brief       Pruebas del modo pasarela, compiladas con GATEWAY_MODE=1: las
+ *              RPC llegan envueltas por v1/gateway/rpc como las reenvía
+ *              ThingsBoard, cada una se despacha al dispositivo hijo que
+ *              nombra y la respuesta vuelve con el mismo sobre.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "encoder_utils.h"
+#include "fake_publish.h"
+#include "gateway_utils.h"
+#include "rpc_utils.h"
+#include "test_utils.h"
+
+_Static_assert(GATEWAY_MODE, "test_gateway must be built with GATEWAY_MODE=1");
+
+// Dispositivo que vio el último manejador, o -2 si no se llamó
+static int device_seen;
+
+static esp_err_t rpc_whole(const rpc_request_t *request, char *result,
+                           size_t result_size) {
+  device_seen = request->device;
+  return ESP_OK;
+}
+
+static esp_err_t rpc_per_device(const rpc_request_t *request, char *result,
+                                size_t result_size) {
+  device_seen = request->device;
+  snprintf(result, result_size, "{\"device\":%d}", request->device);
+  return ESP_OK;
+}
+
+static rpc_deferred_t deferred;
+
+static esp_err_t rpc_later(const rpc_request_t *request, char *result,
+                           size_t result_size) {
+  device_seen = request->device;
+  esp_err_t ret = rpc_defer(&deferred);
+  return ret == ESP_OK ? RPC_DEFERRED : ret;
+}
+
+// Una solicitud como la que ThingsBoard entrega a la pasarela
+static void gateway_rpc(const char *device, const char *method) {
+  char payload[160];
+  snprintf(payload, sizeof(payload),
+           "{\"device\":\"%s\",\"data\":{\"id\":42,\"method\":\"%s\","
+           "\"params\":{}}}",
+           device, method);
+  hal_mqtt_event_t event = {
+      .event_id = HAL_MQTT_EVENT_DATA,
+      .topic = GATEWAY_RPC_TOPIC,
+      .topic_len = strlen(GATEWAY_RPC_TOPIC),
+      .data = payload,
+      .data_len = strlen(payload),
+      .total_data_len = strlen(payload),
+  };
+  device_seen = -2;
+  fake_publish_reset();
+  rpc_handle_data(&event);
+}
+
+static const char *reply(void) {
+  const fake_publish_msg_t *msg = fake_publish_last();
+  CHECK(msg != NULL);
+  if (msg == NULL)
+    return "";
+  CHECK_STR(msg->topic, GATEWAY_RPC_TOPIC);
+  return msg->data;
+}
+
+// El primer hijo lleva los LEDs, el zumbador y el modo: atiende todo
+static void test_first_device_takes_all(void) {
+  gateway_rpc("DHT 1", "whole");
+  CHECK_INT(device_seen, 0);
+  CHECK_STR(reply(),
+            "{\"device\":\"DHT 1\",\"id\":42,\"data\":{\"success\":true}}");
+
+  gateway_rpc("DHT 1", "perDevice");
+  CHECK_INT(device_seen, 0);
+  CHECK_STR(reply(), "{\"device\":\"DHT 1\",\"id\":42,\"data\":{\"device\":0}}");
+}
+
+// Los demás solo atienden los métodos que distinguen el dispositivo; el
+// resto no llega al manejador, que actuaría sobre el equipo completo
+static void test_child_dispatch(void) {
+  gateway_rpc("DHT 3", "perDevice");
+  CHECK_INT(device_seen, 2);
+  CHECK_STR(reply(), "{\"device\":\"DHT 3\",\"id\":42,\"data\":{\"device\":2}}");
+
+  gateway_rpc("DHT 2", "whole");
+  CHECK_INT(device_seen, -2);
+  CHECK_STR(reply(), "{\"device\":\"DHT 2\",\"id\":42,\"data\":{\"success\":"
+                     "false,\"error\":\"not supported for this device\"}}");
+}
+
+static void test_unknown_device(void) {
+  gateway_rpc("DHT 9", "perDevice");
+  CHECK_INT(device_seen, -2);
+  CHECK_STR(reply(), "{\"device\":\"DHT 9\",\"id\":42,\"data\":{\"success\":"
+                     "false,\"error\":\"unknown device\"}}");
+}
+
+// Un corredor común reenvía a la pasarela sus propias respuestas, que no
+// traen "method": contestarlas las repetiría sin fin
+static void test_own_reply_ignored(void) {
+  const char *echo =
+      "{\"device\":\"DHT 1\",\"id\":42,\"data\":{\"success\":true}}";
+  hal_mqtt_event_t event = {
+      .event_id = HAL_MQTT_EVENT_DATA,
+      .topic = GATEWAY_RPC_TOPIC,
+      .topic_len = strlen(GATEWAY_RPC_TOPIC),
+      .data = echo,
+      .data_len = strlen(echo),
+      .total_data_len = strlen(echo),
+  };
+  fake_publish_reset();
+  rpc_handle_data(&event);
+  CHECK_INT(fake_publish_count(), 0);
+}
+
+// Fuera del sobre de pasarela la solicitud es para el equipo completo
+static void test_direct_request(void) {
+  const char *payload = "{\"method\":\"perDevice\",\"params\":{}}";
+  const char *topic = "v1/devices/me/rpc/request/5";
+  hal_mqtt_event_t event = {
+      .event_id = HAL_MQTT_EVENT_DATA,
+      .topic = topic,
+      .topic_len = strlen(topic),
+      .data = payload,
+      .data_len = strlen(payload),
+      .total_data_len = strlen(payload),
+  };
+  fake_publish_reset();
+  rpc_handle_data(&event);
+  CHECK_INT(device_seen, -1);
+  const fake_publish_msg_t *msg = fake_publish_last();
+  CHECK(msg != NULL && strcmp(msg->topic, RPC_RESPONSE_TOPIC "5") == 0);
+}
+
+// ThingsBoard solo acepta el lote por dispositivo de la API de pasarela
+static void test_encoder_names(void) {
+  CHECK(encoder_get() == &telemetry_encoder_gateway);
+  CHECK(encoder_find("gateway", 7) == &telemetry_encoder_gateway);
+  CHECK(encoder_find("json", 4) == NULL);
+  CHECK(encoder_find("cbor", 4) == NULL);
+}
+
+// Una respuesta diferida vuelve con el sobre del hijo que la pidió
+static void test_deferred_reply(void) {
+  gateway_rpc("DHT 1", "later");
+  CHECK_INT(device_seen, 0);
+  CHECK_INT(fake_publish_count(), 0);
+
+  rpc_reply_deferred(&deferred, ESP_OK);
+  CHECK_STR(reply(),
+            "{\"device\":\"DHT 1\",\"id\":42,\"data\":{\"success\":true}}");
+}
+
+int main(void) {
+  rpc_register("whole", rpc_whole);
+  rpc_register_device("perDevice", rpc_per_device);
+  rpc_register("later", rpc_later);
+
+  RUN_TEST(test_first_device_takes_all);
+  RUN_TEST(test_child_dispatch);
+  RUN_TEST(test_unknown_device);
+  RUN_TEST(test_own_reply_ignored);
+  RUN_TEST(test_direct_request);
+  RUN_TEST(test_encoder_names);
+  RUN_TEST(test_deferred_reply);
+  return TEST_EXIT();
+}
@@ -0,0 +1,222 @@
+/*******************************************************************************
+ * @file        test_history.c
+ * @brief       Pruebas del historial local: cierre de minutos y su
+ *              acumulación en la hora, el minuto en curso que ya empieza otra
+ *              hora, las páginas de getHistory (cursor "next", un elemento
+ *              que no cabe, "from" pasado el final) y la restauración de las
+ *              cubetas desde NVS tras un reinicio.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "fake_idf.h"
+#include "history_utils.h"
+#include "test_utils.h"
+
+#define BASE_S 1756512000LL // 30/8/2025 00:00 UTC, inicio de una hora
+#define TAIL_SIZE 24        // HISTORY_TAIL_SIZE
+
+static char out[2048];
+
+// Una muestra a los s segundos de BASE_S, con hora válida
+static void add(int64_t s, float temperature, float humidity) {
+  history_add(s * 1000, (BASE_S + s) * 1000, temperature, humidity);
+}
+
+// Una muestra por minuto desde el minuto first hasta antes de last
+static void add_minutes(int first, int last) {
+  for (int minute = first; minute < last; minute++)
+    add(minute * 60, 20.0f, 50.0f);
+}
+
+// Reiniciar con NVS vacío
+static void boot_clean(void) {
+  fake_nvs_reset();
+  CHECK_INT(history_init(), ESP_OK);
+}
+
+static const char *format(history_tier_t tier, size_t from, size_t limit) {
+  int len = history_format(tier, from, limit, 0, out, sizeof(out));
+  CHECK(len > 0);
+  CHECK_INT(len, strlen(out));
+  return len > 0 ? out : "";
+}
+
+// Un minuto se cierra con la primera muestra del siguiente y la hora en
+// curso incluye los minutos cerrados y el abierto
+static void test_minute_rollover(void) {
+  boot_clean();
+  add(0, 20.0f, 50.0f);
+  add(20, 22.0f, 52.0f);
+  add(40, 21.0f, 51.5f);
+  CHECK_STR(format(HISTORY_TIER_MINUTE, 0, 16),
+            "{\"tier\":\"minute\",\"total\":1,\"from\":0,\"items\":["
+            "{\"ts\":1756512000000,\"n\":3,\"t\":[20.0,21.0,22.0],"
+            "\"h\":[50.0,51.2,52.0]}],\"next\":null}");
+
+  add(60, 25.0f, 55.0f);
+  CHECK_STR(format(HISTORY_TIER_MINUTE, 0, 16),
+            "{\"tier\":\"minute\",\"total\":2,\"from\":0,\"items\":["
+            "{\"ts\":1756512000000,\"n\":3,\"t\":[20.0,21.0,22.0],"
+            "\"h\":[50.0,51.2,52.0]},"
+            "{\"ts\":1756512060000,\"n\":1,\"t\":[25.0,25.0,25.0],"
+            "\"h\":[55.0,55.0,55.0]}],\"next\":null}");
+  CHECK_STR(format(HISTORY_TIER_HOUR, 0, 16),
+            "{\"tier\":\"hour\",\"total\":1,\"from\":0,\"items\":["
+            "{\"ts\":1756512000000,\"n\":4,\"t\":[20.0,22.0,25.0],"
+            "\"h\":[50.0,52.1,55.0]}],\"next\":null}");
+}
+
+// El minuto en curso que empieza otra hora va como una hora nueva, sin
+// mezclarse con la anterior, hasta que esa hora se cierra
+static void test_minute_folds_into_hour(void) {
+  boot_clean();
+  add_minutes(0, 60);
+  add(3600, 30.0f, 60.0f);
+  CHECK_STR(format(HISTORY_TIER_HOUR, 0, 16),
+            "{\"tier\":\"hour\",\"total\":2,\"from\":0,\"items\":["
+            "{\"ts\":1756512000000,\"n\":60,\"t\":[20.0,20.0,20.0],"
+            "\"h\":[50.0,50.0,50.0]},"
+            "{\"ts\":1756515600000,\"n\":1,\"t\":[30.0,30.0,30.0],"
+            "\"h\":[60.0,60.0,60.0]}],\"next\":null}");
+
+  // Al cerrar el primer minuto de la hora nueva se cierra la anterior
+  add(3660, 32.0f, 62.0f);
+  CHECK_STR(format(HISTORY_TIER_HOUR, 0, 16),
+            "{\"tier\":\"hour\",\"total\":2,\"from\":0,\"items\":["
+            "{\"ts\":1756512000000,\"n\":60,\"t\":[20.0,20.0,20.0],"
+            "\"h\":[50.0,50.0,50.0]},"
+            "{\"ts\":1756515600000,\"n\":2,\"t\":[30.0,31.0,32.0],"
+            "\"h\":[60.0,61.0,62.0]}],\"next\":null}");
+  CHECK_STR(format(HISTORY_TIER_HOUR, 1, 1),
+            "{\"tier\":\"hour\",\"total\":2,\"from\":1,\"items\":["
+            "{\"ts\":1756515600000,\"n\":2,\"t\":[30.0,31.0,32.0],"
+            "\"h\":[60.0,61.0,62.0]}],\"next\":null}");
+
+  // El nivel de minutos retiene solo la última hora
+  format(HISTORY_TIER_MINUTE, 0, 1);
+  CHECK(strstr(out, "\"total\":61,") != NULL);
+  CHECK(strstr(out, "\"ts\":1756512060000,") != NULL);
+}
+
+// Las páginas siguen el cursor "next" y se cortan donde no cabe un elemento
+static void test_paging(void) {
+  boot_clean();
+  for (int i = 0; i < 5; i++)
+    history_add(i * 20000, 0, 20.0f + i, 50.0f);
+
+  CHECK_STR(format(HISTORY_TIER_RAW, 0, 2),
+            "{\"tier\":\"raw\",\"total\":5,\"from\":0,\"items\":["
+            "{\"mono\":0,\"t\":20.0,\"h\":50.0},"
+            "{\"mono\":20000,\"t\":21.0,\"h\":50.0}],\"next\":2}");
+  CHECK_STR(format(HISTORY_TIER_RAW, 2, 2),
+            "{\"tier\":\"raw\",\"total\":5,\"from\":2,\"items\":["
+            "{\"mono\":40000,\"t\":22.0,\"h\":50.0},"
+            "{\"mono\":60000,\"t\":23.0,\"h\":50.0}],\"next\":4}");
+  CHECK_STR(format(HISTORY_TIER_RAW, 4, 2),
+            "{\"tier\":\"raw\",\"total\":5,\"from\":4,\"items\":["
+            "{\"mono\":80000,\"t\":24.0,\"h\":50.0}],\"next\":null}");
+
+  // Con hora válida los crudos llevan ts
+  CHECK(history_format(HISTORY_TIER_RAW, 4, 1, BASE_S * 1000, out,
+                       sizeof(out)) > 0);
+  CHECK(strstr(out, "{\"ts\":1756512080000,\"t\":24.0") != NULL);
+
+  // "from" pasado el final da una página vacía sin siguiente
+  CHECK_STR(format(HISTORY_TIER_RAW, 9, 2),
+            "{\"tier\":\"raw\",\"total\":5,\"from\":9,\"items\":[],"
+            "\"next\":null}");
+  CHECK_STR(format(HISTORY_TIER_HOUR, 0, 2),
+            "{\"tier\":\"hour\",\"total\":0,\"from\":0,\"items\":[],"
+            "\"next\":null}");
+}
+
+// Un búfer que no alcanza para el segundo elemento corta la página tras el
+// primero; si no alcanza ni para uno, no hay respuesta
+static void test_page_cut_at_buffer(void) {
+  char expected[256], small[256];
+
+  boot_clean();
+  for (int i = 0; i < 3; i++)
+    history_add(i * 20000, 0, 20.0f, 50.0f);
+
+  strcpy(expected, format(HISTORY_TIER_RAW, 0, 1));
+  CHECK_STR(expected,
+            "{\"tier\":\"raw\",\"total\":3,\"from\":0,\"items\":["
+            "{\"mono\":0,\"t\":20.0,\"h\":50.0}],\"next\":1}");
+  size_t items_end = strlen(expected) - strlen("],\"next\":1}");
+  const char *second = ",{\"mono\":20000,\"t\":20.0,\"h\":50.0}";
+
+  // Justo un byte menos del que necesita el segundo elemento
+  size_t size = items_end + strlen(second) + TAIL_SIZE;
+  CHECK_INT(history_format(HISTORY_TIER_RAW, 0, 16, 0, small, size),
+            strlen(expected));
+  CHECK_STR(small, expected);
+
+  // Con ese byte entra el segundo
+  CHECK(history_format(HISTORY_TIER_RAW, 0, 16, 0, small, size + 1) > 0);
+  CHECK(strstr(small, second) != NULL);
+  CHECK(strstr(small, "\"next\":2}") != NULL);
+
+  // Ni el primero cabe
+  size = items_end - strlen("{\"mono\":0,\"t\":20.0,\"h\":50.0}") + TAIL_SIZE;
+  CHECK_INT(history_format(HISTORY_TIER_RAW, 0, 16, 0, small, size), 0);
+}
+
+// Los minutos se guardan cada HISTORY_SAVE_MINUTES minutos cerrados junto con
+// la hora en curso; lo posterior y el anillo crudo se pierden al reiniciar
+static void test_restore_from_nvs(void) {
+  boot_clean();
+  add_minutes(0, HISTORY_SAVE_MINUTES - 1);
+  CHECK_INT(history_init(), ESP_OK);
+  CHECK_STR(format(HISTORY_TIER_MINUTE, 0, 16),
+            "{\"tier\":\"minute\",\"total\":0,\"from\":0,\"items\":[],"
+            "\"next\":null}");
+
+  boot_clean();
+  add_minutes(0, HISTORY_SAVE_MINUTES + 3);
+  CHECK_INT(history_init(), ESP_OK);
+
+  format(HISTORY_TIER_MINUTE, 0, 16);
+  char total[32];
+  snprintf(total, sizeof(total), "\"total\":%d,", HISTORY_SAVE_MINUTES);
+  CHECK(strstr(out, total) != NULL);
+  CHECK(strstr(out, "\"next\":null}") != NULL);
+
+  char hour[160];
+  snprintf(hour, sizeof(hour),
+           "{\"tier\":\"hour\",\"total\":1,\"from\":0,\"items\":["
+           "{\"ts\":1756512000000,\"n\":%d,\"t\":[20.0,20.0,20.0],"
+           "\"h\":[50.0,50.0,50.0]}],\"next\":null}",
+           HISTORY_SAVE_MINUTES);
+  CHECK_STR(format(HISTORY_TIER_HOUR, 0, 16), hour);
+  CHECK_STR(format(HISTORY_TIER_RAW, 0, 16),
+            "{\"tier\":\"raw\",\"total\":0,\"from\":0,\"items\":[],"
+            "\"next\":null}");
+
+  // Lo restaurado sigue acumulando donde quedó
+  add(HISTORY_SAVE_MINUTES * 60, 20.0f, 50.0f);
+  snprintf(total, sizeof(total), "\"n\":%d,", HISTORY_SAVE_MINUTES + 1);
+  format(HISTORY_TIER_HOUR, 0, 16);
+  CHECK(strstr(out, total) != NULL);
+
+  // Una hora cerrada se guarda aunque no toque por minutos
+  boot_clean();
+  add_minutes(0, 61);
+  add(61 * 60, 20.0f, 50.0f);
+  CHECK_INT(history_init(), ESP_OK);
+  format(HISTORY_TIER_HOUR, 0, 16);
+  CHECK(strstr(out, "\"total\":2,") != NULL);
+  CHECK(strstr(out, "{\"ts\":1756512000000,\"n\":60,") != NULL);
+}
+
+int main(void) {
+  RUN_TEST(test_minute_rollover);
+  RUN_TEST(test_minute_folds_into_hour);
+  RUN_TEST(test_paging);
+  RUN_TEST(test_page_cut_at_buffer);
+  RUN_TEST(test_restore_from_nvs);
+  return TEST_EXIT();
+}
@@ -0,0 +1,230 @@
+/*******************************************************************************
+ * @file        test_offline.c
+ * @brief       Pruebas de la cola persistente en flash sobre una partición en
+ *              RAM con la semántica de la flash NOR: orden del vaciado,
+ *              vuelta del anillo durante un corte de horas, registros a
+ *              medio escribir por un reinicio y registros sin hora de un
+ *              arranque anterior.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "fake_idf.h"
+#include "fake_publish.h"
+#include "offline_utils.h"
+#include "test_utils.h"
+#include <stdlib.h>
+
+#define SECTOR_SLOTS (OFFLINE_SECTOR_SIZE / OFFLINE_RECORD_SIZE)
+#define SAMPLE_PERIOD_MS 5000
+#define EPOCH_MS 1756512000000LL // 30/8/2025
+
+static int64_t epoch_offset_ms = 0;
+
+int64_t telemetry_epoch_offset_ms(void) { return epoch_offset_ms; }
+
+uint16_t telemetry_sample_keys(const telemetry_sample_t *sample) {
+  return (1 << TELEMETRY_KEY_TEMPERATURE) | (1 << TELEMETRY_KEY_HUMIDITY);
+}
+
+// La muestra n se toma en n * SAMPLE_PERIOD_MS del reloj monotónico y lleva
+// n en la temperatura para reconocerla al publicarse
+static telemetry_sample_t sample_at(int n) {
+  return (telemetry_sample_t){
+      .mono_ms = (int64_t)n * SAMPLE_PERIOD_MS,
+      .temperature = (n % 1000) / 10.0f,
+      .humidity = 50.0f,
+      .temp_threshold = 30.0f,
+  };
+}
+
+static void setup(size_t sectors) {
+  fake_flash_reset(sectors * OFFLINE_SECTOR_SIZE);
+  fake_nvs_reset();
+  fake_publish_reset();
+  epoch_offset_ms = EPOCH_MS;
+  CHECK_INT(offline_init(), ESP_OK);
+}
+
+// Vaciar toda la cola y retornar las marcas de tiempo publicadas en orden
+static size_t drain_all(int64_t *ts, size_t max) {
+  size_t n = 0;
+
+  fake_publish_reset();
+  for (int guard = 0; offline_pending() > 0 && guard < 10000; guard++) {
+    if (offline_drain() <= 0)
+      break;
+    const fake_publish_msg_t *msg = fake_publish_last();
+    CHECK_INT(msg->stream, PUBLISH_STREAM_BACKLOG);
+    for (const char *p = msg->data; (p = strstr(p, "\"ts\":")) != NULL;) {
+      p += 5;
+      if (n < max)
+        ts[n] = strtoll(p, NULL, 10);
+      n++;
+    }
+  }
+  return n;
+}
+
+static void test_drain_order(void) {
+  int64_t ts[64];
+
+  setup(2);
+  for (int i = 0; i < 20; i++) {
+    telemetry_sample_t sample = sample_at(i);
+    CHECK_INT(offline_append(&sample), ESP_OK);
+  }
+  CHECK_INT(offline_pending(), 20);
+
+  // Con la bandeja llena nada se marca como consumido
+  fake_publish_reject(true);
+  CHECK_INT(offline_drain(), -1);
+  CHECK_INT(offline_pending(), 20);
+
+  CHECK_INT(drain_all(ts, 64), 20);
+  for (int i = 0; i < 20; i++) {
+    CHECK_INT(ts[i], EPOCH_MS + (int64_t)i * SAMPLE_PERIOD_MS);
+  }
+  CHECK(strstr(fake_publish_msg(0)->data, "\"temperature\":0.1") != NULL);
+  CHECK_INT(offline_pending(), 0);
+}
+
+// Un reinicio reconstruye la cabeza y la cola recorriendo la partición
+static void test_reboot_resumes(void) {
+  int64_t ts[64];
+
+  setup(2);
+  for (int i = 0; i < 30; i++) {
+    telemetry_sample_t sample = sample_at(i);
+    offline_append(&sample);
+  }
+  CHECK_INT(offline_drain(), OFFLINE_DRAIN_BATCH);
+
+  CHECK_INT(offline_init(), ESP_OK);
+  CHECK_INT(offline_pending(), 30 - OFFLINE_DRAIN_BATCH);
+  CHECK_INT(drain_all(ts, 64), 30 - OFFLINE_DRAIN_BATCH);
+  CHECK_INT(ts[0], EPOCH_MS + (int64_t)OFFLINE_DRAIN_BATCH * SAMPLE_PERIOD_MS);
+}
+
+// Corte de seis horas con una muestra cada 5 s y un reinicio a la mitad: la
+// partición da varias vueltas, se conservan las muestras más recientes en
+// orden y el desgaste queda repartido entre los sectores
+static void test_long_outage_wraparound(void) {
+  const int samples = 6 * 3600 * 1000 / SAMPLE_PERIOD_MS;
+  const size_t sectors = 4;
+  const size_t slots = sectors * SECTOR_SLOTS;
+  static int64_t ts[4 * SECTOR_SLOTS];
+
+  setup(sectors);
+  for (int i = 0; i < samples; i++) {
+    telemetry_sample_t sample = sample_at(i);
+    CHECK_INT(offline_append(&sample), ESP_OK);
+    if (i == samples / 2)
+      CHECK_INT(offline_init(), ESP_OK);
+  }
+
+  // Los registros más viejos se pierden de a un sector, el que se borra
+  // cuando la cola lo alcanza
+  size_t pending = offline_pending();
+  CHECK(pending >= slots - SECTOR_SLOTS);
+  CHECK(pending < slots);
+
+  CHECK_INT(offline_init(), ESP_OK);
+  CHECK_INT(offline_pending(), pending);
+
+  size_t n = drain_all(ts, slots);
+  CHECK_INT(n, pending);
+  for (size_t i = 0; i < n && i < slots; i++) {
+    int sample = samples - (int)n + (int)i;
+    CHECK_INT(ts[i], EPOCH_MS + (int64_t)sample * SAMPLE_PERIOD_MS);
+  }
+
+  unsigned min = UINT32_MAX, max = 0;
+  for (size_t s = 0; s < sectors; s++) {
+    unsigned count = fake_flash_erase_count(s * OFFLINE_SECTOR_SIZE);
+    min = count < min ? count : min;
+    max = count > max ? count : max;
+  }
+  CHECK(min > 0);
+  CHECK(max - min <= 1);
+}
+
+// Un reinicio a mitad de una escritura deja un registro sin marcador; al
+// arrancar se salta y las muestras siguientes no se escriben encima
+static void test_torn_record(void) {
+  int64_t ts[64];
+  telemetry_sample_t sample;
+
+  setup(2);
+  for (int i = 0; i < 5; i++) {
+    sample = sample_at(i);
+    offline_append(&sample);
+  }
+  fake_flash_cut_after(OFFLINE_RECORD_SIZE / 2);
+  sample = sample_at(5);
+  CHECK(offline_append(&sample) != ESP_OK);
+  fake_flash_cut_after(-1);
+
+  CHECK_INT(offline_init(), ESP_OK);
+  CHECK_INT(offline_pending(), 5);
+  for (int i = 6; i < 9; i++) {
+    sample = sample_at(i);
+    CHECK_INT(offline_append(&sample), ESP_OK);
+  }
+
+  CHECK_INT(offline_init(), ESP_OK);
+  CHECK_INT(offline_pending(), 8);
+  CHECK_INT(drain_all(ts, 64), 8);
+  for (int i = 0; i < 8; i++) {
+    int expected = i < 5 ? i : i + 1;
+    CHECK_INT(ts[i], EPOCH_MS + (int64_t)expected * SAMPLE_PERIOD_MS);
+  }
+}
+
+// Sin SNTP el registro guarda el reloj monotónico: en el mismo arranque se
+// fecha al sincronizar, pero el de un arranque anterior ya no se puede
+// fechar y se descarta en lugar de publicarse sin marca de tiempo
+static void test_monotonic_records(void) {
+  int64_t ts[64];
+  telemetry_sample_t sample;
+
+  setup(2);
+  epoch_offset_ms = 0;
+  for (int i = 0; i < 3; i++) {
+    sample = sample_at(i);
+    offline_append(&sample);
+  }
+
+  CHECK_INT(offline_init(), ESP_OK);
+  for (int i = 0; i < 2; i++) {
+    sample = sample_at(i);
+    offline_append(&sample);
+  }
+  CHECK_INT(offline_pending(), 5);
+
+  // Aún sin hora: las del arranque actual esperan
+  CHECK_INT(offline_drain(), 0);
+  CHECK_INT(fake_publish_count(), 0);
+  CHECK_INT(offline_pending(), 2);
+
+  epoch_offset_ms = EPOCH_MS;
+  CHECK_INT(drain_all(ts, 64), 2);
+  CHECK_INT(ts[0], EPOCH_MS);
+  CHECK_INT(ts[1], EPOCH_MS + SAMPLE_PERIOD_MS);
+  CHECK_INT(offline_pending(), 0);
+
+  // Los descartados quedan consumidos también tras reiniciar
+  CHECK_INT(offline_init(), ESP_OK);
+  CHECK_INT(offline_pending(), 0);
+}
+
+int main(void) {
+  RUN_TEST(test_drain_order);
+  RUN_TEST(test_reboot_resumes);
+  RUN_TEST(test_long_outage_wraparound);
+  RUN_TEST(test_torn_record);
+  RUN_TEST(test_monotonic_records);
+  return TEST_EXIT();
+}
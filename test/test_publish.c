@@ -0,0 +1,260 @@
+/*******************************************************************************
+ * @file        test_publish.c
+ * @brief       Pruebas de la capa de publicación contra un corredor lento: las
+ *              respuestas RPC no esperan dentro de la tarea del cliente MQTT,
+ *              se retienen en orden con la bandeja llena y salen al
+ *              liberarse, y una prueba de resistencia alterna un enlace
+ *              rápido, uno estrangulado y uno detenido durante veinte
+ *              minutos simulados.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "fake_broker.h"
+#include "publish_utils.h"
+#include "rpc_utils.h"
+#include "test_utils.h"
+#include <stdlib.h>
+
+#define OUTBOX_LIMIT (2 * PUBLISH_OUTBOX_LIMIT) // el de mqtt_init
+#define TELEMETRY_TOPIC "v1/devices/me/telemetry"
+#define GATEWAY_TOPIC "v1/gateway/rpc"
+#define RESPONSE_TOPIC "v1/devices/me/rpc/response/"
+#define SAMPLE_SIZE 400
+#define RING_SIZE 32 // TELEMETRY_RING_SIZE
+
+static esp_err_t rpc_set_led(const rpc_request_t *request, char *result,
+                             size_t result_size) {
+  int led;
+  return rpc_param_int(request, "led", &led) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+// Una solicitud tal como la entrega el cliente MQTT desde su tarea
+static void rpc_request(int id) {
+  char topic[64], payload[64];
+  snprintf(topic, sizeof(topic), "v1/devices/me/rpc/request/%d", id);
+  snprintf(payload, sizeof(payload),
+           "{\"method\":\"setLED\",\"params\":{\"led\":%d,\"state\":true}}",
+           id % 3 + 1);
+  hal_mqtt_event_t event = {
+      .event_id = HAL_MQTT_EVENT_DATA,
+      .topic = topic,
+      .topic_len = strlen(topic),
+      .data = payload,
+      .data_len = strlen(payload),
+      .total_data_len = strlen(payload),
+  };
+  rpc_handle_data(&event);
+}
+
+static bool reply_delivered(int id) {
+  char topic[64];
+  snprintf(topic, sizeof(topic), RESPONSE_TOPIC "%d", id);
+  // El prefijo "…/7" también cubriría "…/70": comparar el tópico completo
+  size_t n = fake_broker_delivered(topic);
+  for (int digit = 0; digit < 10; digit++) {
+    char longer[72];
+    snprintf(longer, sizeof(longer), "%s%d", topic, digit);
+    n -= fake_broker_delivered(longer);
+  }
+  return n == 1;
+}
+
+// Contador de un flujo leído de publish_format, como lo ve getPublishStats
+static unsigned long stream_counter(const char *stream, const char *key) {
+  char stats[1024], pattern[48];
+  CHECK(publish_format(stats, sizeof(stats)) > 0);
+
+  snprintf(pattern, sizeof(pattern), "\"%s\":{", stream);
+  const char *p = strstr(stats, pattern);
+  CHECK(p != NULL);
+  if (p == NULL)
+    return 0;
+  snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+  p = strstr(p, pattern);
+  return p != NULL ? strtoul(p + strlen(pattern), NULL, 10) : 0;
+}
+
+static void fill_outbox(void) {
+  static char sample[SAMPLE_SIZE];
+  memset(sample, 'x', sizeof(sample));
+  while (hal_mqtt_outbox_size() < PUBLISH_OUTBOX_LIMIT) {
+    CHECK(publish_send(PUBLISH_STREAM_TELEMETRY, TELEMETRY_TOPIC, sample,
+                       sizeof(sample)) >= 0);
+  }
+}
+
+// Dejar que el corredor confirme todo y enviar lo retenido
+static void drain(void) {
+  fake_broker_set_rate(100000);
+  fake_broker_advance_ms(PUBLISH_POLL_INTERVAL_MS);
+  publish_poll();
+  fake_broker_advance_ms(PUBLISH_POLL_INTERVAL_MS);
+}
+
+// Con la bandeja llena la respuesta no espera: se retiene y sale con
+// publish_poll en cuanto el corredor confirma lo anterior. Dos solicitudes
+// pendientes tienen tópicos distintos y llegan las dos respuestas
+static void test_rpc_reply_never_blocks(void) {
+  fake_broker_reset(OUTBOX_LIMIT);
+  fill_outbox();
+  unsigned long coalesced = stream_counter("rpc", "coalesced");
+  unsigned long dropped = stream_counter("rpc", "dropped");
+
+  rpc_request(1);
+  rpc_request(2);
+  CHECK_INT(fake_broker_delayed_ms(), 0);
+  CHECK(publish_pending());
+  CHECK_INT(stream_counter("rpc", "pending"), 2);
+
+  // Sin espacio publish_poll no hace nada
+  publish_poll();
+  CHECK(publish_pending());
+
+  // Con espacio pero aún retenidas, la siguiente va detrás sin adelantarlas
+  fake_broker_set_rate(100000);
+  fake_broker_advance_ms(PUBLISH_POLL_INTERVAL_MS);
+  rpc_request(3);
+  CHECK_INT(stream_counter("rpc", "pending"), 3);
+
+  drain();
+  CHECK(!publish_pending());
+  CHECK(reply_delivered(1));
+  CHECK(reply_delivered(2));
+  CHECK(reply_delivered(3));
+  CHECK_INT(stream_counter("rpc", "coalesced"), coalesced);
+  CHECK_INT(stream_counter("rpc", "dropped"), dropped);
+}
+
+// Las respuestas del gateway comparten tópico y pueden ocupar un resultado
+// completo dentro del sobre, como getStats o getHistory
+static void test_large_gateway_replies_held(void) {
+  static char reply[RPC_ENVELOPE_SIZE];
+  unsigned long dropped = stream_counter("rpc", "dropped");
+
+  memset(reply, 'r', sizeof(reply));
+  fake_broker_reset(OUTBOX_LIMIT);
+  fill_outbox();
+  CHECK_INT(publish_send(PUBLISH_STREAM_RPC, GATEWAY_TOPIC, reply,
+                         sizeof(reply)),
+            -1);
+  CHECK_INT(publish_send(PUBLISH_STREAM_RPC, GATEWAY_TOPIC, reply,
+                         sizeof(reply)),
+            -1);
+  CHECK_INT(stream_counter("rpc", "pending"), 2);
+
+  drain();
+  CHECK_INT(fake_broker_delivered(GATEWAY_TOPIC), 2);
+  CHECK_INT(stream_counter("rpc", "dropped"), dropped);
+}
+
+// Sin lugares libres se descarta la respuesta nueva, no una retenida
+static void test_hold_full_drops_newest(void) {
+  unsigned long dropped = stream_counter("rpc", "dropped");
+
+  fake_broker_reset(OUTBOX_LIMIT);
+  fill_outbox();
+  for (int id = 1; id <= PUBLISH_HOLD_DEPTH + 1; id++)
+    rpc_request(id);
+  CHECK_INT(stream_counter("rpc", "dropped"), dropped + 1);
+  CHECK_INT(stream_counter("rpc", "pending"), PUBLISH_HOLD_DEPTH);
+
+  drain();
+  for (int id = 1; id <= PUBLISH_HOLD_DEPTH; id++)
+    CHECK(reply_delivered(id));
+  CHECK(!reply_delivered(PUBLISH_HOLD_DEPTH + 1));
+  CHECK(!publish_pending());
+}
+
+// Veinte minutos con una muestra cada 5 s, una RPC cada 7 s y un reporte de
+// diagnóstico cada 30 s: enlace rápido, luego estrangulado a 60 B/s, luego
+// detenido cinco minutos y de nuevo rápido. La tarea de comunicaciones
+// reintenta cada PUBLISH_POLL_INTERVAL_MS.
+static void test_soak_throttled_broker(void) {
+  const uint32_t step_ms = PUBLISH_POLL_INTERVAL_MS;
+  const uint64_t end_ms = 20 * 60 * 1000;
+  static char sample[SAMPLE_SIZE];
+  size_t ring = 0; // muestras retenidas por el productor
+  unsigned samples = 0, ring_dropped = 0, requests = 0;
+  unsigned long rpc_sent = stream_counter("rpc", "sent");
+  unsigned long rpc_dropped = stream_counter("rpc", "dropped");
+  unsigned long rpc_coalesced = stream_counter("rpc", "coalesced");
+  int first_stalled_request = 0;
+
+  memset(sample, 't', sizeof(sample));
+  fake_broker_reset(OUTBOX_LIMIT);
+
+  for (uint64_t t = 0; t < end_ms; t += step_ms) {
+    uint32_t minute = t / 60000;
+    bool stalled = minute >= 10 && minute < 15;
+    fake_broker_set_rate(minute < 5 || minute >= 15 ? 100000
+                         : stalled                  ? 0
+                                                    : 60);
+
+    if (t % 5000 == 0) {
+      samples++;
+      if (ring == RING_SIZE)
+        ring_dropped++;
+      else
+        ring++;
+    }
+    // telemetry_flush: lo que la capa rechaza se queda en el anillo
+    while (ring > 0 && publish_send(PUBLISH_STREAM_TELEMETRY, TELEMETRY_TOPIC,
+                                    sample, sizeof(sample)) >= 0)
+      ring--;
+
+    if (t % 7000 == 0) {
+      uint32_t before = fake_broker_delayed_ms();
+      rpc_request(++requests);
+      CHECK_INT(fake_broker_delayed_ms(), before);
+      if (stalled && first_stalled_request == 0)
+        first_stalled_request = requests;
+    }
+    if (t % 30000 == 0) {
+      publish_send(PUBLISH_STREAM_DIAGNOSTICS, TELEMETRY_TOPIC,
+                   "{\"diag\":1}", 10);
+    }
+
+    publish_poll();
+    fake_broker_advance_ms(step_ms);
+    CHECK(hal_mqtt_outbox_size() <= OUTBOX_LIMIT);
+  }
+
+  // Nada esperó dentro de la tarea del cliente MQTT
+  CHECK_INT(fake_broker_delayed_ms(), 0);
+  CHECK(fake_broker_max_outbox() <= PUBLISH_OUTBOX_LIMIT + SAMPLE_SIZE);
+
+  // La telemetría se recupera sin huecos salvo lo que el anillo descartó
+  CHECK_INT(ring, 0);
+  CHECK(ring_dropped > 0);
+  // (los reportes de diagnóstico comparten el tópico)
+  CHECK_INT(fake_broker_delivered(TELEMETRY_TOPIC) -
+                stream_counter("diagnostics", "sent"),
+            samples - ring_dropped);
+
+  // Cada RPC se respondió o se descartó con la cola llena; ninguna
+  // respuesta reemplazó a otra
+  unsigned long sent = stream_counter("rpc", "sent") - rpc_sent;
+  unsigned long dropped = stream_counter("rpc", "dropped") - rpc_dropped;
+  CHECK_INT(sent + dropped, requests);
+  CHECK_INT(stream_counter("rpc", "coalesced"), rpc_coalesced);
+  CHECK(dropped > 0);
+  CHECK_INT(fake_broker_delivered(RESPONSE_TOPIC), sent);
+  // Las primeras respuestas retenidas durante el corte salen al recuperarse
+  CHECK(first_stalled_request > 0);
+  CHECK(reply_delivered(first_stalled_request));
+  CHECK(!publish_pending());
+}
+
+int main(void) {
+  CHECK_INT(publish_init(), ESP_OK);
+  rpc_register("setLED", rpc_set_led);
+
+  RUN_TEST(test_rpc_reply_never_blocks);
+  RUN_TEST(test_large_gateway_replies_held);
+  RUN_TEST(test_hold_full_drops_newest);
+  RUN_TEST(test_soak_throttled_broker);
+  return TEST_EXIT();
+}
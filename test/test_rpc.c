@@ -0,0 +1,219 @@
+/*******************************************************************************
+ * @file        test_rpc.c
+ * @brief       Pruebas del despachador RPC: solicitudes completas pasan por
+ *              rpc_handle_data como llegarían del cliente MQTT y la
+ *              respuesta se revisa en el registro de publicaciones.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "fake_publish.h"
+#include "rpc_utils.h"
+#include "test_utils.h"
+
+// Lo que leyó el último manejador
+static bool float_ok;
+static float float_value;
+static bool int_ok;
+static int int_value;
+
+static esp_err_t rpc_read_value(const rpc_request_t *request, char *result,
+                                size_t result_size) {
+  float_ok = rpc_param_float(request, "value", &float_value);
+  int_ok = rpc_param_int(request, "value", &int_value);
+  return ESP_OK;
+}
+
+// Solicitud que otra tarea termina, como setRules
+static rpc_deferred_t deferred;
+
+static esp_err_t rpc_later(const rpc_request_t *request, char *result,
+                           size_t result_size) {
+  esp_err_t ret = rpc_defer(&deferred);
+  return ret == ESP_OK ? RPC_DEFERRED : ret;
+}
+
+static void rpc_send(const char *topic, const char *payload) {
+  hal_mqtt_event_t event = {
+      .event_id = HAL_MQTT_EVENT_DATA,
+      .topic = topic,
+      .topic_len = strlen(topic),
+      .data = payload,
+      .data_len = strlen(payload),
+      .total_data_len = strlen(payload),
+  };
+  rpc_handle_data(&event);
+}
+
+static void rpc_value(const char *value) {
+  char payload[128];
+  snprintf(payload, sizeof(payload),
+           "{\"method\":\"readValue\",\"params\":{\"value\":%s}}", value);
+  float_ok = int_ok = false;
+  rpc_send("v1/devices/me/rpc/request/7", payload);
+}
+
+static void test_param_numbers(void) {
+  rpc_value("21.5");
+  CHECK(float_ok && float_value == 21.5f);
+  CHECK(int_ok && int_value == 21);
+
+  rpc_value("-40");
+  CHECK(int_ok && int_value == -40);
+
+  rpc_value("1e9");
+  CHECK(int_ok && int_value == 1000000000);
+}
+
+// Valores que strtof acepta pero que no son números finitos, o que no caben
+// en un int: convertirlos con (int) sería indefinido
+static void test_param_rejects_non_finite(void) {
+  static const char *const values[] = {"nan", "NaN", "inf", "-inf", "1e39",
+                                       "-1e39"};
+
+  for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+    rpc_value(values[i]);
+    CHECK(!float_ok);
+    CHECK(!int_ok);
+  }
+
+  rpc_value("1e30");
+  CHECK(float_ok);
+  CHECK(!int_ok);
+  rpc_value("-3e9");
+  CHECK(!int_ok);
+  rpc_value("2147483648");
+  CHECK(!int_ok);
+
+  rpc_value("12abc");
+  CHECK(!float_ok);
+}
+
+static void test_reply_topic(void) {
+  fake_publish_reset();
+  rpc_value("1");
+  const fake_publish_msg_t *msg = fake_publish_last();
+  CHECK(msg != NULL);
+  if (msg == NULL)
+    return;
+  CHECK_INT(msg->stream, PUBLISH_STREAM_RPC);
+  CHECK_STR(msg->topic, "v1/devices/me/rpc/response/7");
+  CHECK_STR(msg->data, "{\"success\":true}");
+}
+
+static void check_error_reply(const char *topic, const char *error) {
+  const fake_publish_msg_t *msg = fake_publish_last();
+  char expected[96];
+  CHECK_INT(fake_publish_count(), 1);
+  CHECK(msg != NULL);
+  if (msg == NULL)
+    return;
+  snprintf(expected, sizeof(expected),
+           "{\"success\":false,\"error\":\"%s\"}", error);
+  CHECK_STR(msg->topic, topic);
+  CHECK_STR(msg->data, expected);
+}
+
+// Lo que no se puede leer también se responde, para que el servidor no
+// espere hasta el vencimiento
+static void test_malformed_replies(void) {
+  fake_publish_reset();
+  rpc_send("v1/devices/me/rpc/request/8", "{\"method\":");
+  check_error_reply("v1/devices/me/rpc/response/8", "malformed request");
+
+  fake_publish_reset();
+  rpc_send("v1/devices/me/rpc/request/9", "{\"params\":{}}");
+  check_error_reply("v1/devices/me/rpc/response/9", "malformed request");
+
+  fake_publish_reset();
+  rpc_send("v1/devices/me/rpc/request/10", "{\"method\":\"nope\"}");
+  check_error_reply("v1/devices/me/rpc/response/10", "unknown method");
+}
+
+// Más tokens de los que caben: un arreglo de RPC_MAX_TOKENS números
+static void test_too_many_tokens(void) {
+  static char payload[RPC_BUFFER_SIZE];
+  size_t len = snprintf(payload, sizeof(payload),
+                        "{\"method\":\"readValue\",\"params\":[");
+  for (int i = 0; i < RPC_MAX_TOKENS; i++)
+    len += snprintf(payload + len, sizeof(payload) - len, "%s1",
+                    i ? "," : "");
+  snprintf(payload + len, sizeof(payload) - len, "]}");
+  CHECK(strlen(payload) < RPC_BUFFER_SIZE);
+
+  fake_publish_reset();
+  rpc_send("v1/devices/me/rpc/request/11", payload);
+  check_error_reply("v1/devices/me/rpc/response/11", "malformed request");
+}
+
+// Un mensaje que no cabe en el búfer se descarta desde el primer fragmento
+// y se responde una sola vez
+static void test_oversized_request(void) {
+  static char payload[RPC_BUFFER_SIZE + 64];
+  const char *topic = "v1/devices/me/rpc/request/12";
+  size_t total = sizeof(payload) - 1;
+
+  memset(payload, ' ', total);
+  memcpy(payload, "{\"method\":\"readValue\"", 21);
+  payload[total - 1] = '}';
+  fake_publish_reset();
+  for (size_t offset = 0; offset < total; offset += 1024) {
+    size_t chunk = total - offset < 1024 ? total - offset : 1024;
+    hal_mqtt_event_t event = {
+        .event_id = HAL_MQTT_EVENT_DATA,
+        .topic = offset == 0 ? topic : NULL,
+        .topic_len = offset == 0 ? strlen(topic) : 0,
+        .data = payload + offset,
+        .data_len = chunk,
+        .total_data_len = total,
+        .current_data_offset = offset,
+    };
+    rpc_handle_data(&event);
+  }
+  check_error_reply("v1/devices/me/rpc/response/12", "request too large");
+}
+
+// Una respuesta diferida no sale al volver el manejador sino cuando la
+// tarea que termina el trabajo la envía, aunque entre tanto lleguen otras
+static void test_deferred_reply(void) {
+  rpc_deferred_t first;
+
+  fake_publish_reset();
+  rpc_send("v1/devices/me/rpc/request/12", "{\"method\":\"later\"}");
+  CHECK_INT(fake_publish_count(), 0);
+  first = deferred;
+  rpc_send("v1/devices/me/rpc/request/13", "{\"method\":\"later\"}");
+  rpc_value("1");
+  CHECK_INT(fake_publish_count(), 1);
+
+  rpc_reply_deferred(&first, ESP_OK);
+  const fake_publish_msg_t *msg = fake_publish_last();
+  CHECK(msg != NULL);
+  if (msg != NULL) {
+    CHECK_STR(msg->topic, "v1/devices/me/rpc/response/12");
+    CHECK_STR(msg->data, "{\"success\":true}");
+  }
+
+  fake_publish_reset();
+  rpc_reply_deferred(&deferred, ESP_ERR_TIMEOUT);
+  check_error_reply("v1/devices/me/rpc/response/13", "ERROR");
+
+  // Fuera de un manejador no hay solicitud que diferir
+  CHECK_INT(rpc_defer(&first), ESP_ERR_INVALID_STATE);
+}
+
+int main(void) {
+  rpc_register("readValue", rpc_read_value);
+  rpc_register("later", rpc_later);
+
+  RUN_TEST(test_param_numbers);
+  RUN_TEST(test_param_rejects_non_finite);
+  RUN_TEST(test_reply_topic);
+  RUN_TEST(test_malformed_replies);
+  RUN_TEST(test_too_many_tokens);
+  RUN_TEST(test_oversized_request);
+  RUN_TEST(test_deferred_reply);
+  return TEST_EXIT();
+}
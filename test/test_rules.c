@@ -0,0 +1,112 @@
+/*******************************************************************************
+ * @file        test_rules.c
+ * @brief       Pruebas del motor de reglas: las reglas por defecto con su
+ *              histéresis, la prioridad por actuador, la validación de
+ *              setRules y la copia en NVS.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "buzzer_utils.h"
+#include "fake_idf.h"
+#include "rules_utils.h"
+#include "test_utils.h"
+#include <math.h>
+
+// Un ciclo con la humedad y el exceso sobre el umbral en décimas
+static void evaluate(rules_t *rules, int32_t humidity, int32_t excess,
+                     uint8_t outputs[RULES_ACTUATOR_COUNT]) {
+  rules_inputs_t inputs = {
+      .values[RULES_INPUT_HUMIDITY(0)] = humidity,
+      .values[RULES_INPUT_TEMP_EXCESS] = excess,
+      .valid = (1UL << RULES_INPUT_HUMIDITY(0)) |
+               (1UL << RULES_INPUT_TEMP_EXCESS),
+  };
+  rules_evaluate(rules, &inputs, outputs);
+}
+
+static void test_default_leds(void) {
+  rules_t rules;
+  uint8_t out[RULES_ACTUATOR_COUNT];
+
+  rules_default(&rules);
+  evaluate(&rules, 660, -10, out);
+  CHECK(out[RULES_ACTUATOR_LED1] && out[RULES_ACTUATOR_LED2]);
+  CHECK(!out[RULES_ACTUATOR_LED3]);
+  CHECK_INT(out[RULES_ACTUATOR_BUZZER], BUZZER_PATTERN_OFF);
+
+  // Bajo el umbral pero dentro de la histéresis el LED sigue encendido
+  evaluate(&rules, 640, -10, out);
+  CHECK(out[RULES_ACTUATOR_LED2]);
+  evaluate(&rules, 620, -10, out);
+  CHECK(!out[RULES_ACTUATOR_LED2]);
+}
+
+// Por actuador manda la regla activa de mayor prioridad
+static void test_default_buzzer_levels(void) {
+  rules_t rules;
+  uint8_t out[RULES_ACTUATOR_COUNT];
+
+  rules_default(&rules);
+  evaluate(&rules, 400, 10, out);
+  CHECK_INT(out[RULES_ACTUATOR_BUZZER], BUZZER_PATTERN_WARNING);
+  evaluate(&rules, 400, 45, out);
+  CHECK_INT(out[RULES_ACTUATOR_BUZZER], BUZZER_PATTERN_CRITICAL);
+  evaluate(&rules, 400, 38, out);
+  CHECK_INT(out[RULES_ACTUATOR_BUZZER], BUZZER_PATTERN_CRITICAL);
+  evaluate(&rules, 400, 30, out);
+  CHECK_INT(out[RULES_ACTUATOR_BUZZER], BUZZER_PATTERN_ALARM);
+}
+
+// Un umbral o una histéresis que no es finita o que desborda las décimas
+// deja el conjunto anterior intacto
+static void test_compile_rejects_invalid(void) {
+  rules_t rules;
+  rule_spec_t spec = {RULES_INPUT_DEW_POINT, true, 18.0f, 1.0f,
+                      RULES_ACTUATOR_LED3,   1,    1};
+  const float bad_thresholds[] = {NAN, INFINITY, -INFINITY, 1e30f, -1e30f};
+  const float bad_hysteresis[] = {NAN, INFINITY, -1.0f, 1e30f};
+
+  rules_default(&rules);
+  uint8_t count = rules.count;
+
+  CHECK_INT(rules_compile(&rules, &spec, 1), ESP_OK);
+  CHECK_INT(rules.count, 1);
+  CHECK_INT(rules.rules[0].on, 180);
+  CHECK_INT(rules.rules[0].off, 170);
+
+  rules_default(&rules);
+  for (size_t i = 0; i < sizeof(bad_thresholds) / sizeof(float); i++) {
+    rule_spec_t bad = spec;
+    bad.threshold = bad_thresholds[i];
+    CHECK_INT(rules_compile(&rules, &bad, 1), ESP_ERR_INVALID_ARG);
+  }
+  for (size_t i = 0; i < sizeof(bad_hysteresis) / sizeof(float); i++) {
+    rule_spec_t bad = spec;
+    bad.hysteresis = bad_hysteresis[i];
+    CHECK_INT(rules_compile(&rules, &bad, 1), ESP_ERR_INVALID_ARG);
+  }
+  CHECK_INT(rules.count, count);
+}
+
+static void test_nvs_round_trip(void) {
+  rules_t saved, loaded = {0};
+
+  fake_nvs_reset();
+  CHECK_INT(rules_load(&loaded), ESP_ERR_NVS_NOT_FOUND);
+  rules_default(&saved);
+  CHECK_INT(rules_save(&saved), ESP_OK);
+  CHECK_INT(rules_load(&loaded), ESP_OK);
+  CHECK_INT(loaded.count, saved.count);
+  CHECK(memcmp(loaded.rules, saved.rules, saved.count * sizeof(rule_t)) == 0);
+}
+
+int main(void) {
+  RUN_TEST(test_default_leds);
+  RUN_TEST(test_default_buzzer_levels);
+  RUN_TEST(test_compile_rejects_invalid);
+  RUN_TEST(test_nvs_round_trip);
+  return TEST_EXIT();
+}
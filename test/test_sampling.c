@@ -0,0 +1,155 @@
+/*******************************************************************************
+ * @file        test_sampling.c
+ * @brief       Pruebas de la política de muestreo: validación de los periodos
+ *              y los márgenes que llegan por setSamplingPolicy, los cambios
+ *              parciales sobre la política activa, y el periodo adaptativo
+ *              que se acorta ante cambios y se alarga al estabilizarse.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "sampling_utils.h"
+#include "test_utils.h"
+#include <math.h>
+
+static const sampling_policy_t adaptive = {
+    .mode = SAMPLING_MODE_ADAPTIVE,
+    .period_ms = 20000,
+    .min_period_ms = 5000,
+    .max_period_ms = 120000,
+    .delta_temperature = 0.5f,
+    .delta_humidity = 2.0f,
+    .threshold_margin = 1.0f,
+};
+
+static void test_policy_valid(void) {
+  sampling_policy_t policy = adaptive;
+  CHECK(sampling_policy_valid(&policy));
+
+  policy.mode = SAMPLING_MODE_FIXED;
+  policy.period_ms = SAMPLING_PERIOD_FLOOR_MS - 1;
+  CHECK(!sampling_policy_valid(&policy));
+  policy.period_ms = SAMPLING_PERIOD_CEIL_MS;
+  CHECK(sampling_policy_valid(&policy));
+  policy.period_ms = SAMPLING_PERIOD_CEIL_MS + 1;
+  CHECK(!sampling_policy_valid(&policy));
+
+  policy = adaptive;
+  policy.max_period_ms = SAMPLING_PERIOD_CEIL_MS + 1;
+  CHECK(!sampling_policy_valid(&policy));
+  policy = adaptive;
+  policy.min_period_ms = policy.period_ms + 1;
+  CHECK(!sampling_policy_valid(&policy));
+}
+
+// NaN pasa cualquier comparación como falsa e infinito deja el modo
+// adaptativo siempre rápido o siempre lento
+static void test_policy_rejects_non_finite(void) {
+  const float bad[] = {NAN, INFINITY, -1.0f};
+
+  for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+    sampling_policy_t policy = adaptive;
+    policy.delta_temperature = bad[i];
+    CHECK(!sampling_policy_valid(&policy));
+    policy = adaptive;
+    policy.delta_humidity = bad[i];
+    CHECK(!sampling_policy_valid(&policy));
+    policy = adaptive;
+    policy.threshold_margin = bad[i];
+    CHECK(!sampling_policy_valid(&policy));
+  }
+}
+
+static void test_adaptive_period(void) {
+  sampling_t sampling;
+
+  sampling_init(&sampling, &adaptive);
+  CHECK_INT(sampling_update(&sampling, 20.0f, 50.0f, 30.0f), 40000);
+  CHECK_INT(sampling_update(&sampling, 20.1f, 50.5f, 30.0f), 80000);
+  CHECK_INT(sampling_update(&sampling, 20.1f, 50.5f, 30.0f), 120000);
+  CHECK_INT(sampling_update(&sampling, 20.1f, 50.5f, 30.0f), 120000);
+
+  // Un salto de temperatura vuelve al mínimo de golpe
+  CHECK_INT(sampling_update(&sampling, 21.0f, 50.5f, 30.0f), 5000);
+  CHECK_INT(sampling_update(&sampling, 21.0f, 50.5f, 30.0f), 10000);
+
+  // Cerca del umbral se mantiene rápido aunque no cambie
+  CHECK_INT(sampling_update(&sampling, 29.5f, 50.5f, 30.0f), 5000);
+  CHECK_INT(sampling_update(&sampling, 29.5f, 50.5f, 30.0f), 5000);
+}
+
+// Parámetros de setSamplingPolicy como los entrega el despachador
+static esp_err_t parse(const char *params, sampling_policy_t *policy) {
+  rpc_json_token_t tokens[32];
+  int count = rpc_json_parse(params, strlen(params), tokens, 32);
+  CHECK(count > 0);
+  rpc_request_t request = {
+      .json = params,
+      .tokens = tokens,
+      .count = count,
+      .params = 0,
+      .device = -1,
+  };
+  return sampling_policy_parse(&request, policy);
+}
+
+// Un modo que no es "fixed" ni "adaptive" se rechaza sin cambiar nada
+static void test_parse_unknown_mode(void) {
+  sampling_policy_t policy = adaptive;
+
+  CHECK_INT(parse("{\"mode\":\"adaptiv\"}", &policy), ESP_ERR_INVALID_ARG);
+  CHECK_INT(parse("{\"mode\":\"fixedd\"}", &policy), ESP_ERR_INVALID_ARG);
+  CHECK_INT(parse("{\"mode\":1}", &policy), ESP_ERR_INVALID_ARG);
+  CHECK(memcmp(&policy, &adaptive, sizeof(policy)) == 0);
+
+  CHECK_INT(parse("{\"mode\":\"fixed\"}", &policy), ESP_OK);
+  CHECK_INT(policy.mode, SAMPLING_MODE_FIXED);
+  CHECK_INT(policy.period_ms, adaptive.period_ms);
+}
+
+// Los parámetros ausentes conservan los de la política activa, que también
+// cuentan al validar
+static void test_parse_from_active(void) {
+  sampling_policy_t policy = adaptive;
+
+  CHECK_INT(parse("{}", &policy), ESP_OK);
+  CHECK(memcmp(&policy, &adaptive, sizeof(policy)) == 0);
+
+  CHECK_INT(parse("{\"max\":60000}", &policy), ESP_OK);
+  CHECK_INT(policy.mode, SAMPLING_MODE_ADAPTIVE);
+  CHECK_INT(policy.period_ms, adaptive.period_ms);
+  CHECK_INT(policy.min_period_ms, adaptive.min_period_ms);
+  CHECK_INT(policy.max_period_ms, 60000);
+  CHECK(policy.delta_temperature == adaptive.delta_temperature);
+
+  // El periodo inicial no puede quedar bajo el mínimo activo
+  CHECK_INT(parse("{\"period\":3000}", &policy), ESP_ERR_INVALID_ARG);
+  CHECK_INT(policy.period_ms, adaptive.period_ms);
+  CHECK_INT(parse("{\"period\":6000,\"margin\":0.5}", &policy), ESP_OK);
+  CHECK_INT(policy.period_ms, 6000);
+  CHECK(policy.threshold_margin == 0.5f);
+  CHECK_INT(policy.max_period_ms, 60000);
+}
+
+// Un parámetro presente que no se puede leer no se ignora
+static void test_parse_unreadable(void) {
+  sampling_policy_t policy = adaptive;
+
+  CHECK_INT(parse("{\"min\":\"fast\"}", &policy), ESP_ERR_INVALID_ARG);
+  CHECK_INT(parse("{\"period\":-1}", &policy), ESP_ERR_INVALID_ARG);
+  CHECK_INT(parse("{\"period\":1e39}", &policy), ESP_ERR_INVALID_ARG);
+  CHECK_INT(parse("{\"delta_humidity\":nan}", &policy), ESP_ERR_INVALID_ARG);
+  CHECK(memcmp(&policy, &adaptive, sizeof(policy)) == 0);
+}
+
+int main(void) {
+  RUN_TEST(test_policy_valid);
+  RUN_TEST(test_policy_rejects_non_finite);
+  RUN_TEST(test_parse_unknown_mode);
+  RUN_TEST(test_parse_from_active);
+  RUN_TEST(test_parse_unreadable);
+  RUN_TEST(test_adaptive_period);
+  return TEST_EXIT();
+}
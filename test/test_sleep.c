@@ -0,0 +1,199 @@
+/*******************************************************************************
+ * @file        test_sleep.c
+ * @brief       Pruebas del estado retenido para el sueño profundo: validación
+ *              de la memoria RTC, el anillo de muestras pendientes, la
+ *              duración del sueño y una secuencia de ciclos simulados en la
+ *              que el reloj monotónico vuelve a empezar en cada despertar.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "sleep_utils.h"
+#include "test_utils.h"
+
+#define PERIOD_MS 20000
+
+// La prueba se compila con SLEEP_PUBLISH_EVERY=4 para cubrir los ciclos que
+// solo acumulan
+_Static_assert(SLEEP_PUBLISH_EVERY == 4, "test expects SLEEP_PUBLISH_EVERY=4");
+
+static sleep_state_t state;
+
+static telemetry_sample_t sample_at(int64_t mono_ms) {
+  return (telemetry_sample_t){.mono_ms = mono_ms, .temperature = 21.0f};
+}
+
+// Tras un arranque en frío la memoria RTC tiene basura y se reinicia; el
+// estado solo queda válido una vez sellado antes de dormir
+static void test_validation(void) {
+  memset(&state, 0xA5, sizeof(state));
+  CHECK(!sleep_state_valid(&state));
+
+  sleep_state_reset(&state, 30.0f);
+  CHECK(state.automatic_mode);
+  CHECK(state.temp_threshold == 30.0f);
+  CHECK_INT(state.cycle, 0);
+  CHECK(!sleep_state_valid(&state));
+
+  sleep_state_prepare(&state, 500, 0, PERIOD_MS);
+  CHECK_INT(state.cycle, 1);
+  CHECK(sleep_state_valid(&state));
+
+  // Un bit alterado, un índice fuera del anillo o un estado de otra versión
+  // se descartan
+  sleep_state_t copy = state;
+  copy.last_humidity = 1.0f;
+  CHECK(!sleep_state_valid(&copy));
+
+  copy = state;
+  copy.pending_count = SLEEP_PENDING_MAX + 1;
+  CHECK(!sleep_state_valid(&copy));
+
+  copy = state;
+  copy.magic = 0x534C5031;
+  CHECK(!sleep_state_valid(&copy));
+}
+
+static void test_pending_ring(void) {
+  sleep_state_reset(&state, 30.0f);
+  CHECK(sleep_pending_get(&state, 0) == NULL);
+
+  // Al llenarse se descarta la más antigua y el orden se conserva
+  for (int i = 0; i < SLEEP_PENDING_MAX + 4; i++) {
+    telemetry_sample_t sample = sample_at(i * 100);
+    sleep_pending_push(&state, &sample);
+  }
+  CHECK_INT(state.pending_count, SLEEP_PENDING_MAX);
+  for (int i = 0; i < SLEEP_PENDING_MAX; i++) {
+    CHECK_INT(sleep_pending_get(&state, i)->mono_ms, (i + 4) * 100);
+  }
+  CHECK(sleep_pending_get(&state, SLEEP_PENDING_MAX) == NULL);
+
+  sleep_state_prepare(&state, 500, 0, PERIOD_MS);
+  CHECK(sleep_state_valid(&state));
+
+  sleep_pending_clear(&state);
+  CHECK_INT(state.pending_count, 0);
+  CHECK(sleep_pending_get(&state, 0) == NULL);
+}
+
+// El tiempo despierto se descuenta del periodo, con un mínimo de sueño
+static void test_sleep_duration(void) {
+  sleep_state_reset(&state, 30.0f);
+  CHECK_INT(sleep_state_prepare(&state, 2500, 500, PERIOD_MS),
+            (uint64_t)18000 * 1000);
+  CHECK_INT(state.sleep_at_ms, 2500);
+  CHECK_INT(state.sleep_ms, 18000);
+
+  CHECK_INT(sleep_state_prepare(&state, 19800, 0, PERIOD_MS),
+            (uint64_t)SLEEP_MIN_MS * 1000);
+  CHECK_INT(sleep_state_prepare(&state, 50000, 0, PERIOD_MS),
+            (uint64_t)SLEEP_MIN_MS * 1000);
+  CHECK_INT(state.cycle, 3);
+}
+
+static void test_should_connect(void) {
+  sleep_state_reset(&state, 30.0f);
+  // El primer ciclo anuncia el estado aunque no haya muestras
+  CHECK(sleep_should_connect(&state));
+  sleep_state_prepare(&state, 500, 0, PERIOD_MS);
+
+  for (int i = 1; i < SLEEP_PUBLISH_EVERY; i++) {
+    telemetry_sample_t sample = sample_at(i);
+    sleep_pending_push(&state, &sample);
+    CHECK(!sleep_should_connect(&state));
+  }
+  telemetry_sample_t sample = sample_at(0);
+  sleep_pending_push(&state, &sample);
+  CHECK(sleep_should_connect(&state));
+}
+
+// Ciclos como los de sleep_cycle: el reloj de cada despertar empieza de
+// nuevo y el tiempo de arranque, la lectura y el tiempo despierto varían.
+// Algunas conexiones fallan y las muestras se quedan varios ciclos; al final
+// cada muestra retenida debe marcar el instante real en que se tomó,
+// expresado en el reloj del último despertar.
+static void test_cycle_simulation(void) {
+  static const struct {
+    int64_t start_ms; // reloj monotónico al entrar al ciclo
+    int64_t read_ms;  // duración de la lectura
+    int64_t awake_ms; // duración total del ciclo despierto
+    bool connected;   // si MQTT conectó al intentar publicar
+  } cycles[] = {
+      {180, 40, 900, true},    {35, 42, 120, false},  {37, 38, 110, false},
+      {41, 45, 130, false},    {39, 40, 10500, false}, {36, 41, 140, false},
+      {180, 39, 19500, false}, {40, 44, 125, false},   {38, 40, 115, false},
+      {42, 43, 120, false},
+  };
+  const size_t count = sizeof(cycles) / sizeof(cycles[0]);
+  int64_t real_wake_ms = 1000000; // tiempo real del despertar
+  int64_t real_sample_ms[sizeof(cycles) / sizeof(cycles[0])];
+  size_t first_pending = 0;
+  int64_t now_ms = 0;
+
+  memset(&state, 0x5A, sizeof(state));
+  for (size_t k = 0; k < count; k++) {
+    int64_t start_ms = cycles[k].start_ms;
+    bool warm = k > 0 && sleep_state_valid(&state);
+
+    CHECK(warm == (k > 0));
+    if (warm) {
+      sleep_state_wake(&state, start_ms);
+    } else {
+      sleep_state_reset(&state, 30.0f);
+    }
+
+    // El reloj del ciclo marca start_ms en el instante del despertar
+    now_ms = start_ms + cycles[k].read_ms;
+    telemetry_sample_t sample = sample_at(now_ms);
+    sleep_pending_push(&state, &sample);
+    real_sample_ms[k] = real_wake_ms + cycles[k].read_ms;
+
+    if (sleep_should_connect(&state) && cycles[k].connected) {
+      sleep_pending_clear(&state);
+      first_pending = k + 1;
+    }
+
+    now_ms = start_ms + cycles[k].awake_ms;
+    uint64_t sleep_us = sleep_state_prepare(&state, now_ms, start_ms,
+                                            PERIOD_MS);
+    CHECK(sleep_us >= (uint64_t)SLEEP_MIN_MS * 1000);
+    if (cycles[k].awake_ms + SLEEP_MIN_MS <= PERIOD_MS) {
+      CHECK_INT(cycles[k].awake_ms * 1000 + sleep_us,
+                (uint64_t)PERIOD_MS * 1000);
+    }
+    real_wake_ms += cycles[k].awake_ms + (int64_t)(sleep_us / 1000);
+  }
+
+  // Despertar final: reubicar lo retenido en el reloj del ciclo nuevo
+  CHECK(sleep_state_valid(&state));
+  CHECK_INT(state.cycle, count);
+  int64_t start_ms = 33;
+  sleep_state_wake(&state, start_ms);
+
+  CHECK_INT(state.pending_count, count - first_pending);
+  for (size_t i = 0; i < state.pending_count; i++) {
+    int64_t real_ms = real_sample_ms[first_pending + i];
+    CHECK_INT(sleep_pending_get(&state, i)->mono_ms,
+              real_ms - real_wake_ms + start_ms);
+  }
+
+  // Entre muestras consecutivas queda el periodo más la variación de la
+  // lectura, salvo tras el ciclo que no alcanzó el sueño mínimo
+  for (size_t i = 1; i < state.pending_count; i++) {
+    int64_t gap = sleep_pending_get(&state, i)->mono_ms -
+                  sleep_pending_get(&state, i - 1)->mono_ms;
+    CHECK(gap >= PERIOD_MS - 10 && gap <= PERIOD_MS + 10 + 500);
+  }
+}
+
+int main(void) {
+  RUN_TEST(test_validation);
+  RUN_TEST(test_pending_ring);
+  RUN_TEST(test_sleep_duration);
+  RUN_TEST(test_should_connect);
+  RUN_TEST(test_cycle_simulation);
+  return TEST_EXIT();
+}
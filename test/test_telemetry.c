@@ -0,0 +1,139 @@
+/*******************************************************************************
+ * @file        test_telemetry.c
+ * @brief       Pruebas del anillo de telemetría: sin SNTP las muestras se
+ *              retienen con su reloj monotónico y salen en un solo lote con
+ *              la marca rebasada al sincronizar, y lo que la bandeja rechaza
+ *              se queda en el anillo.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "encoder_utils.h"
+#include "fake_idf.h"
+#include "fake_publish.h"
+#include "telemetry_utils.h"
+#include "test_utils.h"
+#include <sys/time.h>
+
+#define SAMPLE_PERIOD_MS 5000
+#define EPOCH_MS 1756512000000LL // 30/8/2025
+
+// Reloj monotónico y hora real (0 antes de que SNTP sincronice)
+static int64_t now_ms = 0;
+static int64_t epoch_at_zero_ms = 0;
+
+int64_t hal_time_us(void) { return now_ms * 1000; }
+
+// Se enlaza con --wrap=gettimeofday
+int __wrap_gettimeofday(struct timeval *tv, void *tz) {
+  int64_t epoch_ms = epoch_at_zero_ms ? epoch_at_zero_ms + now_ms : 0;
+  tv->tv_sec = epoch_ms / 1000;
+  tv->tv_usec = epoch_ms % 1000 * 1000;
+  return 0;
+}
+
+static void setup(void) {
+  now_ms = 0;
+  epoch_at_zero_ms = 0;
+  fake_publish_reset();
+  fake_publish_reject(false);
+  encoder_set(&telemetry_encoder_json);
+  telemetry_init();
+}
+
+// La muestra n se toma en n * SAMPLE_PERIOD_MS y lleva n en la temperatura
+static void push_at(int n) {
+  telemetry_sample_t sample = {
+      .mono_ms = (int64_t)n * SAMPLE_PERIOD_MS,
+      .temperature = (float)n,
+      .humidity = 50.0f,
+      .temp_threshold = 30.0f,
+  };
+  now_ms = sample.mono_ms;
+  sample.keys = telemetry_sample_keys(&sample);
+  telemetry_push(&sample);
+}
+
+// Posición en el mensaje del elemento con la marca ts, o NULL
+static const char *find_ts(const char *data, int64_t ts_ms) {
+  char key[32];
+  snprintf(key, sizeof(key), "{\"ts\":%lld,", (long long)ts_ms);
+  return strstr(data, key);
+}
+
+// Sin hora real nada sale ni se descarta; al sincronizar, todo sale en un
+// solo lote fechado con la hora de captura
+static void test_held_until_sntp(void) {
+  setup();
+  for (int n = 1; n <= 4; n++) {
+    push_at(n);
+    CHECK(!telemetry_should_flush(now_ms));
+    CHECK_INT(telemetry_flush(), -1);
+  }
+  CHECK_INT(fake_publish_count(), 0);
+  CHECK_INT(telemetry_pending(), 4);
+
+  // SNTP sincroniza a los 22 s del arranque
+  now_ms = 22000;
+  epoch_at_zero_ms = EPOCH_MS;
+  CHECK(telemetry_should_flush(now_ms));
+  CHECK_INT(telemetry_flush(), 0);
+  CHECK_INT(telemetry_pending(), 0);
+  CHECK_INT(fake_publish_count(), 1);
+
+  const fake_publish_msg_t *msg = fake_publish_last();
+  CHECK_INT(msg->stream, PUBLISH_STREAM_TELEMETRY);
+  CHECK_STR(msg->topic, TELEMETRY_TOPIC);
+  CHECK(msg->data[0] == '[');
+  const char *prev = msg->data;
+  for (int n = 1; n <= 4; n++) {
+    const char *item = find_ts(msg->data, EPOCH_MS + n * SAMPLE_PERIOD_MS);
+    CHECK(item != NULL && item >= prev);
+    prev = item != NULL ? item : prev;
+  }
+}
+
+// Con hora real cada muestra sale al llegar, también con marca de tiempo
+static void test_synced_sample_sent(void) {
+  setup();
+  epoch_at_zero_ms = EPOCH_MS;
+  push_at(1);
+  CHECK(telemetry_should_flush(now_ms));
+  CHECK_INT(telemetry_flush(), 0);
+  CHECK_INT(fake_publish_count(), 1);
+  CHECK(find_ts(fake_publish_last()->data, EPOCH_MS + SAMPLE_PERIOD_MS) !=
+        NULL);
+
+  // Un anillo vacío no tiene nada pendiente, haya hora o no
+  epoch_at_zero_ms = 0;
+  CHECK(!telemetry_should_flush(now_ms));
+  CHECK_INT(telemetry_flush(), 0);
+}
+
+// Lo que la bandeja rechaza se queda en el anillo y sale en el siguiente lote
+static void test_rejected_kept(void) {
+  setup();
+  epoch_at_zero_ms = EPOCH_MS;
+  fake_publish_reject(true);
+  push_at(1);
+  push_at(2);
+  CHECK_INT(telemetry_flush(), -1);
+  CHECK_INT(telemetry_pending(), 2);
+
+  fake_publish_reject(false);
+  CHECK_INT(telemetry_flush(), 0);
+  CHECK_INT(fake_publish_count(), 1);
+  CHECK(find_ts(fake_publish_last()->data, EPOCH_MS + SAMPLE_PERIOD_MS) !=
+        NULL);
+  CHECK(find_ts(fake_publish_last()->data, EPOCH_MS + 2 * SAMPLE_PERIOD_MS) !=
+        NULL);
+}
+
+int main(void) {
+  RUN_TEST(test_held_until_sntp);
+  RUN_TEST(test_synced_sample_sent);
+  RUN_TEST(test_rejected_kept);
+  return TEST_EXIT();
+}
@@ -0,0 +1,154 @@
+/*******************************************************************************
+ * @file        test_tls_scan.c
+ * @brief       Pruebas de la detección de reanudación TLS 1.2 con saludos
+ *              capturados de OpenSSL y con registros armados a mano: mensajes
+ *              repartidos entre registros, varios mensajes por registro y
+ *              bytes cifrados tras el ChangeCipherSpec.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#include "test_utils.h"
+#include "tls_flights.h"
+#include "tls_scan.h"
+
+#define STREAM_MAX 256
+
+// Registros armados a mano, como los entregaría el socket
+typedef struct {
+  uint8_t data[STREAM_MAX];
+  size_t len;
+} stream_t;
+
+static void put(stream_t *s, const uint8_t *data, size_t len) {
+  memcpy(s->data + s->len, data, len);
+  s->len += len;
+}
+
+static void put_record(stream_t *s, uint8_t type, const uint8_t *body,
+                       size_t len) {
+  uint8_t header[TLS_RECORD_HEADER] = {type, 0x03, 0x03, len >> 8, len};
+  put(s, header, sizeof(header));
+  put(s, body, len);
+}
+
+// Un mensaje de saludo con el cuerpo relleno de fill
+static size_t message(uint8_t *out, uint8_t type, size_t len, uint8_t fill) {
+  out[0] = type;
+  out[1] = len >> 16;
+  out[2] = len >> 8;
+  out[3] = len;
+  memset(out + TLS_HANDSHAKE_HEADER, fill, len);
+  return TLS_HANDSHAKE_HEADER + len;
+}
+
+static void put_change_cipher(stream_t *s) {
+  static const uint8_t ccs = 1;
+  // El Finished cifrado empieza con un byte que parece un Certificate
+  static const uint8_t finished[] = {TLS_HANDSHAKE_CERTIFICATE, 0, 0, 4,
+                                     0x5a, 0x5a, 0x5a, 0x5a};
+  put_record(s, TLS_RECORD_CHANGE_CIPHER_SPEC, &ccs, 1);
+  put_record(s, TLS_RECORD_HANDSHAKE, finished, sizeof(finished));
+}
+
+static tls_scan_t scan_chunks(const uint8_t *data, size_t len, size_t chunk) {
+  tls_scan_t scan;
+  tls_scan_start(&scan);
+  for (size_t i = 0; i < len; i += chunk)
+    tls_scan_feed(&scan, data + i, len - i < chunk ? len - i : chunk);
+  return scan;
+}
+
+static void test_captured_full(void) {
+  tls_scan_t scan = scan_chunks(flight_full, sizeof(flight_full),
+                                sizeof(flight_full));
+  CHECK(scan.certificate);
+  CHECK(scan.change_cipher);
+  CHECK(!tls_scan_resumed(&scan));
+}
+
+static void test_captured_resumed(void) {
+  tls_scan_t scan = scan_chunks(flight_resumed, sizeof(flight_resumed),
+                                sizeof(flight_resumed));
+  CHECK(!scan.certificate);
+  CHECK(scan.change_cipher);
+  CHECK(tls_scan_resumed(&scan));
+}
+
+// recv entrega los bytes en trozos de cualquier tamaño
+static void test_any_chunk_size(void) {
+  for (size_t chunk = 1; chunk <= 64; chunk++) {
+    tls_scan_t full = scan_chunks(flight_full, sizeof(flight_full), chunk);
+    tls_scan_t resumed =
+        scan_chunks(flight_resumed, sizeof(flight_resumed), chunk);
+    CHECK(!tls_scan_resumed(&full));
+    CHECK(tls_scan_resumed(&resumed));
+  }
+}
+
+// Un saludo que se corta antes del ChangeCipherSpec no cuenta como
+// reanudado aunque no haya llegado el certificado
+static void test_incomplete(void) {
+  tls_scan_t scan = scan_chunks(flight_resumed, sizeof(flight_resumed) - 6,
+                                sizeof(flight_resumed));
+  CHECK(!scan.change_cipher);
+  CHECK(!tls_scan_resumed(&scan));
+}
+
+// Lo que sigue al ChangeCipherSpec va cifrado y no se interpreta
+static void test_encrypted_ignored(void) {
+  stream_t s = {0};
+  uint8_t body[64];
+
+  put_record(&s, TLS_RECORD_HANDSHAKE, body, message(body, 2, 40, 0));
+  put_change_cipher(&s);
+  tls_scan_t scan = scan_chunks(s.data, s.len, s.len);
+  CHECK(tls_scan_resumed(&scan));
+}
+
+// Solo cuentan las cabeceras de mensaje, no los bytes de los cuerpos
+static void test_body_bytes_ignored(void) {
+  stream_t s = {0};
+  uint8_t body[64];
+
+  put_record(&s, TLS_RECORD_HANDSHAKE, body,
+             message(body, 2, 48, TLS_HANDSHAKE_CERTIFICATE));
+  put_change_cipher(&s);
+  tls_scan_t scan = scan_chunks(s.data, s.len, 3);
+  CHECK(tls_scan_resumed(&scan));
+}
+
+// Varios mensajes en un registro y un mensaje repartido entre registros,
+// con la cabecera del Certificate partida en dos
+static void test_record_boundaries(void) {
+  stream_t s = {0};
+  uint8_t messages[128];
+  size_t len = message(messages, 2, 30, 0);
+  len += message(messages + len, TLS_HANDSHAKE_CERTIFICATE, 60, 0x30);
+  len += message(messages + len, 14, 0, 0);
+
+  // ServerHello y los dos primeros bytes de la cabecera del Certificate
+  size_t split = TLS_HANDSHAKE_HEADER + 30 + 2;
+  put_record(&s, TLS_RECORD_HANDSHAKE, messages, split);
+  put_record(&s, TLS_RECORD_HANDSHAKE, messages + split, len - split);
+  put_change_cipher(&s);
+
+  for (size_t chunk = 1; chunk <= s.len; chunk++) {
+    tls_scan_t scan = scan_chunks(s.data, s.len, chunk);
+    CHECK(scan.certificate);
+    CHECK(!tls_scan_resumed(&scan));
+  }
+}
+
+int main(void) {
+  RUN_TEST(test_captured_full);
+  RUN_TEST(test_captured_resumed);
+  RUN_TEST(test_any_chunk_size);
+  RUN_TEST(test_incomplete);
+  RUN_TEST(test_encrypted_ignored);
+  RUN_TEST(test_body_bytes_ignored);
+  RUN_TEST(test_record_boundaries);
+  return TEST_EXIT();
+}
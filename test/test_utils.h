@@ -0,0 +1,58 @@
+/*******************************************************************************
+ * @file        test_utils.h
+ * @brief       Aserciones mínimas para las pruebas en el anfitrión: cada
+ *              fallo se informa con su archivo y línea, y el programa retorna
+ *              distinto de cero para que ctest lo marque.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#ifndef TEST_UTILS_H
+#define TEST_UTILS_H
+
+#include <stdio.h>
+#include <string.h>
+
+static int test_failures = 0;
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+      test_failures++;                                                         \
+    }                                                                          \
+  } while (0)
+
+#define CHECK_INT(actual, expected)                                            \
+  do {                                                                         \
+    long long a_ = (long long)(actual), e_ = (long long)(expected);            \
+    if (a_ != e_) {                                                            \
+      fprintf(stderr, "%s:%d: %s is %lld, expected %lld\n", __FILE__,          \
+              __LINE__, #actual, a_, e_);                                      \
+      test_failures++;                                                         \
+    }                                                                          \
+  } while (0)
+
+#define CHECK_STR(actual, expected)                                            \
+  do {                                                                         \
+    const char *a_ = (actual), *e_ = (expected);                               \
+    if (strcmp(a_, e_) != 0) {                                                 \
+      fprintf(stderr, "%s:%d: %s is\n  %s\nexpected\n  %s\n", __FILE__,        \
+              __LINE__, #actual, a_, e_);                                      \
+      test_failures++;                                                         \
+    }                                                                          \
+  } while (0)
+
+// Ejecutar un caso e informar su resultado
+#define RUN_TEST(test)                                                         \
+  do {                                                                         \
+    int before_ = test_failures;                                               \
+    test();                                                                    \
+    printf("%s %s\n", test_failures == before_ ? "PASS" : "FAIL", #test);      \
+  } while (0)
+
+#define TEST_EXIT() (test_failures == 0 ? 0 : 1)
+
+#endif // TEST_UTILS_H
@@ -0,0 +1,102 @@
+/*******************************************************************************
+ * @file        tls_flights.h
+ * @brief       Lo que envía un servidor TLS 1.2 hasta su ChangeCipherSpec,
+ *              capturado de openssl s_server -tls1_2 con un certificado EC
+ *              propio: un saludo completo (ServerHello, Certificate,
+ *              ServerKeyExchange, ServerHelloDone, NewSessionTicket) y uno
+ *              reanudado con ese ticket (solo ServerHello). Se capturó con
+ *              openssl s_client -sess_out y luego -sess_in, como hace
+ *              test/load/tls_resume.sh.
+ * @author      Nagel Mejía Segura, Wilberth Gutiérrez Montero, Óscar González Cambronero
+ * @date        30/8/2025
+ * @version     1.0.0
+ *
+ ******************************************************************************/
+
+#ifndef TLS_FLIGHTS_H
+#define TLS_FLIGHTS_H
+
+#include <stdint.h>
+
+static const uint8_t flight_full[] = {
+    0x16, 0x03, 0x03, 0x00, 0x41, 0x02, 0x00, 0x00, 0x3d, 0x03, 0x03, 0x6c,
+    0xc5, 0x4d, 0xcf, 0xe9, 0x3a, 0x56, 0x06, 0x2d, 0x5c, 0x14, 0x68, 0xf9,
+    0xfc, 0xf1, 0x65, 0x48, 0x57, 0xbb, 0x1a, 0xea, 0x85, 0x4d, 0xf1, 0x5f,
+    0x29, 0x21, 0xcc, 0xd3, 0xdd, 0x9d, 0xaf, 0x00, 0xc0, 0x2c, 0x00, 0x00,
+    0x15, 0xff, 0x01, 0x00, 0x01, 0x00, 0x00, 0x0b, 0x00, 0x04, 0x03, 0x00,
+    0x01, 0x02, 0x00, 0x23, 0x00, 0x00, 0x00, 0x17, 0x00, 0x00, 0x16, 0x03,
+    0x03, 0x01, 0x91, 0x0b, 0x00, 0x01, 0x8d, 0x00, 0x01, 0x8a, 0x00, 0x01,
+    0x87, 0x30, 0x82, 0x01, 0x83, 0x30, 0x82, 0x01, 0x29, 0xa0, 0x03, 0x02,
+    0x01, 0x02, 0x02, 0x14, 0x47, 0xc9, 0x3d, 0x36, 0x1c, 0x98, 0xac, 0x99,
+    0x3d, 0x3d, 0x84, 0x95, 0xb0, 0x80, 0xa3, 0xc0, 0xba, 0x25, 0x2d, 0x66,
+    0x30, 0x0a, 0x06, 0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x04, 0x03, 0x02,
+    0x30, 0x17, 0x31, 0x15, 0x30, 0x13, 0x06, 0x03, 0x55, 0x04, 0x03, 0x0c,
+    0x0c, 0x62, 0x72, 0x6f, 0x6b, 0x65, 0x72, 0x2e, 0x6c, 0x6f, 0x63, 0x61,
+    0x6c, 0x30, 0x1e, 0x17, 0x0d, 0x32, 0x36, 0x31, 0x30, 0x31, 0x37, 0x30,
+    0x30, 0x35, 0x37, 0x34, 0x34, 0x5a, 0x17, 0x0d, 0x33, 0x36, 0x31, 0x30,
+    0x31, 0x34, 0x30, 0x30, 0x35, 0x37, 0x34, 0x34, 0x5a, 0x30, 0x17, 0x31,
+    0x15, 0x30, 0x13, 0x06, 0x03, 0x55, 0x04, 0x03, 0x0c, 0x0c, 0x62, 0x72,
+    0x6f, 0x6b, 0x65, 0x72, 0x2e, 0x6c, 0x6f, 0x63, 0x61, 0x6c, 0x30, 0x59,
+    0x30, 0x13, 0x06, 0x07, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x02, 0x01, 0x06,
+    0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x03, 0x01, 0x07, 0x03, 0x42, 0x00,
+    0x04, 0xc2, 0xb8, 0x8c, 0x98, 0x32, 0x16, 0x9b, 0x3e, 0x6a, 0xec, 0x7c,
+    0x76, 0xbb, 0xd8, 0xc9, 0xef, 0x8a, 0xbc, 0x9e, 0x67, 0xf9, 0x7c, 0xb8,
+    0x1f, 0xf6, 0x57, 0xed, 0xfe, 0x6e, 0x39, 0x95, 0xaa, 0x70, 0x20, 0x6b,
+    0xc2, 0x88, 0xb7, 0xa3, 0x2c, 0xf0, 0x8a, 0x34, 0x2d, 0xcd, 0x30, 0x43,
+    0xf3, 0xb4, 0x87, 0xd8, 0x92, 0xf5, 0xce, 0x4f, 0x8d, 0x05, 0x7e, 0x23,
+    0x90, 0xb4, 0xcb, 0xbd, 0x96, 0xa3, 0x53, 0x30, 0x51, 0x30, 0x1d, 0x06,
+    0x03, 0x55, 0x1d, 0x0e, 0x04, 0x16, 0x04, 0x14, 0xbe, 0x1c, 0x7a, 0xf6,
+    0x28, 0x52, 0x20, 0xbb, 0x4a, 0x96, 0x20, 0x8a, 0x53, 0xce, 0x19, 0x7a,
+    0x7a, 0x79, 0x90, 0x47, 0x30, 0x1f, 0x06, 0x03, 0x55, 0x1d, 0x23, 0x04,
+    0x18, 0x30, 0x16, 0x80, 0x14, 0xbe, 0x1c, 0x7a, 0xf6, 0x28, 0x52, 0x20,
+    0xbb, 0x4a, 0x96, 0x20, 0x8a, 0x53, 0xce, 0x19, 0x7a, 0x7a, 0x79, 0x90,
+    0x47, 0x30, 0x0f, 0x06, 0x03, 0x55, 0x1d, 0x13, 0x01, 0x01, 0xff, 0x04,
+    0x05, 0x30, 0x03, 0x01, 0x01, 0xff, 0x30, 0x0a, 0x06, 0x08, 0x2a, 0x86,
+    0x48, 0xce, 0x3d, 0x04, 0x03, 0x02, 0x03, 0x48, 0x00, 0x30, 0x45, 0x02,
+    0x21, 0x00, 0xcb, 0xd9, 0x28, 0x62, 0xb8, 0xef, 0x64, 0x57, 0x12, 0xcb,
+    0x4e, 0xfd, 0xa4, 0x25, 0x0b, 0xf5, 0xbc, 0xcd, 0xbe, 0x8a, 0xee, 0xda,
+    0xed, 0xdc, 0x3a, 0x73, 0xd7, 0x01, 0x12, 0x26, 0x8b, 0x83, 0x02, 0x20,
+    0x67, 0x08, 0x13, 0xe2, 0x13, 0x5a, 0x60, 0x3d, 0x89, 0xba, 0x0e, 0xdb,
+    0xee, 0x89, 0xe6, 0x38, 0x9f, 0x44, 0x99, 0xc2, 0xd7, 0xe2, 0x41, 0xee,
+    0x6a, 0x70, 0xe1, 0xf4, 0x1d, 0x02, 0xb2, 0x57, 0x16, 0x03, 0x03, 0x00,
+    0x73, 0x0c, 0x00, 0x00, 0x6f, 0x03, 0x00, 0x1d, 0x20, 0x2f, 0xa4, 0x73,
+    0x23, 0x18, 0x25, 0x47, 0x33, 0x10, 0x39, 0x3d, 0x22, 0xc9, 0x46, 0x7f,
+    0x81, 0x84, 0x03, 0x0d, 0x92, 0xfc, 0xbe, 0x85, 0x1e, 0x97, 0x2e, 0x90,
+    0xba, 0x14, 0x4d, 0xe2, 0x50, 0x04, 0x03, 0x00, 0x47, 0x30, 0x45, 0x02,
+    0x20, 0x24, 0xa6, 0xf1, 0x75, 0xbd, 0xec, 0x98, 0x2d, 0x32, 0x07, 0x05,
+    0x31, 0x5b, 0x45, 0xc2, 0x56, 0x7c, 0xda, 0x4f, 0x4a, 0x54, 0xa9, 0xa8,
+    0x6d, 0x10, 0xbd, 0x19, 0x0b, 0xe7, 0x57, 0xdf, 0xd4, 0x02, 0x21, 0x00,
+    0xe3, 0x83, 0xbf, 0x3f, 0x7b, 0xfa, 0xd0, 0x9c, 0xb5, 0x50, 0x8b, 0x87,
+    0xc6, 0xb6, 0x9e, 0x14, 0x2d, 0xc0, 0xe5, 0x56, 0x01, 0x19, 0x27, 0x8a,
+    0xaa, 0xbc, 0xcf, 0xbc, 0x78, 0xdc, 0x45, 0xc5, 0x16, 0x03, 0x03, 0x00,
+    0x04, 0x0e, 0x00, 0x00, 0x00, 0x16, 0x03, 0x03, 0x00, 0xba, 0x04, 0x00,
+    0x00, 0xb6, 0x00, 0x00, 0x1c, 0x20, 0x00, 0xb0, 0x99, 0xfd, 0xf3, 0x89,
+    0x1e, 0x18, 0x03, 0x5a, 0x35, 0x14, 0xcb, 0xdc, 0x92, 0xa1, 0x80, 0x7b,
+    0xb3, 0x40, 0x25, 0x82, 0x88, 0xa1, 0xd0, 0x03, 0xbc, 0xc9, 0x76, 0x0d,
+    0x67, 0x22, 0xf0, 0x83, 0xf5, 0xa4, 0x47, 0x09, 0xd1, 0xbc, 0x2b, 0x79,
+    0xcb, 0xfc, 0x97, 0x13, 0x24, 0xdc, 0xf3, 0x24, 0x15, 0x20, 0x71, 0x44,
+    0x1c, 0x27, 0xab, 0x8b, 0x40, 0xb6, 0x47, 0x30, 0xc8, 0xb8, 0x7d, 0x65,
+    0xe8, 0x58, 0xbb, 0x75, 0x1f, 0x46, 0xee, 0x4a, 0x68, 0x88, 0xac, 0x81,
+    0xfd, 0x18, 0xd7, 0x44, 0x51, 0x17, 0x77, 0xf3, 0xa3, 0x35, 0xaf, 0xbe,
+    0x2a, 0x51, 0xbc, 0x11, 0x2e, 0x8d, 0x48, 0x86, 0x00, 0x37, 0x68, 0x70,
+    0x40, 0x10, 0x6d, 0xd4, 0x44, 0x6a, 0x9b, 0x42, 0xb3, 0x1f, 0xa6, 0x06,
+    0x31, 0xbe, 0xd0, 0x79, 0x52, 0x4e, 0x21, 0x20, 0x5a, 0x52, 0x1f, 0x3d,
+    0x8e, 0x96, 0x6f, 0x20, 0xdd, 0x67, 0x5b, 0xd7, 0x62, 0x82, 0x53, 0xb8,
+    0x5a, 0xb7, 0x1a, 0x3d, 0xe8, 0x62, 0xc3, 0x9a, 0x33, 0x97, 0x98, 0xbb,
+    0xe7, 0x0a, 0x41, 0x99, 0xc7, 0xa6, 0x01, 0x00, 0x29, 0xa3, 0xce, 0xcd,
+    0xdf, 0xf0, 0x85, 0x34, 0x2f, 0x90, 0x8e, 0x8d, 0xa8, 0xb6, 0x37, 0xf7,
+    0x8a, 0x96, 0xf6, 0x65, 0x14, 0x03, 0x03, 0x00, 0x01, 0x01,
+};
+
+static const uint8_t flight_resumed[] = {
+    0x16, 0x03, 0x03, 0x00, 0x55, 0x02, 0x00, 0x00, 0x51, 0x03, 0x03, 0xe0,
+    0x8c, 0xfb, 0xa8, 0xa0, 0xc6, 0xa5, 0x5f, 0x5a, 0x77, 0xac, 0x1a, 0x7d,
+    0xb8, 0x2e, 0xb6, 0x5f, 0x82, 0x7a, 0x4a, 0x27, 0x37, 0xaf, 0xb3, 0x3c,
+    0x26, 0xd6, 0xb0, 0x5b, 0x9d, 0xc4, 0x25, 0x20, 0xb2, 0x7b, 0x05, 0x81,
+    0xb8, 0x25, 0x34, 0x9d, 0xbd, 0xf3, 0xd8, 0xe0, 0x08, 0xf9, 0x95, 0xa7,
+    0x1b, 0xb0, 0x6c, 0xaa, 0x2d, 0xac, 0xff, 0xc3, 0x93, 0x57, 0x86, 0xde,
+    0xa6, 0xbe, 0x9f, 0x96, 0xc0, 0x2c, 0x00, 0x00, 0x09, 0xff, 0x01, 0x00,
+    0x01, 0x00, 0x00, 0x17, 0x00, 0x00, 0x14, 0x03, 0x03, 0x00, 0x01, 0x01,
+};
+
+#endif // TLS_FLIGHTS_H